@@ -144,6 +144,13 @@ typedef struct cmt_abi_bytes {
     void *data;
 } cmt_abi_bytes_t;
 
+/** @b bytes value scattered over @p count fragments, encoded as if they were
+ * concatenated */
+typedef struct cmt_abi_bytes_iov {
+    size_t count;                /**< number of fragments in @p iov */
+    const cmt_abi_bytes_t *iov;  /**< fragments, in order */
+} cmt_abi_bytes_iov_t;
+
 /** Create a function selector from an array of bytes
  * @param [in] funsel function selector bytes
  * @return
@@ -313,6 +320,30 @@ int cmt_abi_put_bytes_s(cmt_buf_t *me, cmt_buf_t *offset);
 //int cmt_abi_put_bytes_d(cmt_buf_t *me, cmt_buf_t *offset, size_t n, const void *data, const void *start);
 int cmt_abi_put_bytes_d(cmt_buf_t *me, cmt_buf_t *offset, const cmt_buf_t *frame, const cmt_abi_bytes_t *payload);
 
+/** Encode the dynamic part of @b bytes, gathered from the fragments of @p
+ * payload, into the message. Each fragment is copied exactly once.
+ * used in conjunction with @ref cmt_abi_put_bytes_s
+ *
+ * @param [in,out] me      initialized buffer
+ * @param [in]     offset  initialized from @ref cmt_abi_put_bytes_s
+ * @param [in]     frame   starting point for offset calculation (first byte after funsel)
+ * @param [in]     payload fragments of the @b bytes value
+ *
+ * @return
+ * |        |                        |
+ * |-------:|------------------------|
+ * |       0| success                |
+ * |-ENOBUFS| no space left in @p me | */
+int cmt_abi_put_bytes_d_iov(cmt_buf_t *me, cmt_buf_t *offset, const cmt_buf_t *frame,
+    const cmt_abi_bytes_iov_t *payload);
+
+/** Total length in bytes of the fragments of @p payload
+ *
+ * @param [in] payload fragments
+ * @return
+ * - sum of the fragment lengths, SIZE_MAX if it overflows */
+size_t cmt_abi_bytes_iov_length(const cmt_abi_bytes_iov_t *payload);
+
 /** Reserve @b n bytes of data from the buffer into @b res to be filled by the
  * caller
  *
@@ -0,0 +1,160 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/** @file
+ * @defgroup libcmt_arena arena
+ * Bump allocator for per input scratch memory
+ *
+ * Allocations are carved in order from a region reserved up front and are
+ * never freed individually. The whole arena is released at once with
+ * @ref cmt_arena_reset, or back to a checkpoint with @ref cmt_arena_rewind.
+ *
+ * When registered with @ref cmt_rollup_set_arena, @ref cmt_rollup_finish
+ * resets it before the next input, so a handler can allocate freely while
+ * processing a request without touching the heap:
+ * @code
+ * ...
+ * static uint8_t scratch[1 << 20];
+ * cmt_arena_t arena[1];
+ * cmt_arena_init(arena, sizeof scratch, scratch);
+ * cmt_rollup_set_arena(rollup, arena);
+ *
+ * for (;;) {
+ *     cmt_rollup_finish(rollup, &finish);
+ *     ...
+ *     cmt_abi_bytes_t name;
+ *     cmt_arena_get_bytes_d(arena, &start, of, &name);
+ *     ...
+ * }
+ * @endcode
+ *
+ * @ingroup libcmt
+ * @{ */
+#ifndef CMT_ARENA_H
+#define CMT_ARENA_H
+#include "abi.h"
+#include "buf.h"
+
+enum {
+    CMT_ARENA_ALIGN = 16, /**< alignment used when none is requested, suits any fundamental type */
+};
+
+/** Bump allocator state, allocations are taken from @b top to @b end */
+typedef struct cmt_arena {
+    uint8_t *begin; /**< begin of the backing memory */
+    uint8_t *end;   /**< end of the backing memory */
+    uint8_t *top;   /**< first free byte */
+    uint8_t *peak;  /**< highest @b top seen since initialization */
+} cmt_arena_t;
+
+/** Checkpoint of an arena, see @ref cmt_arena_mark */
+typedef struct cmt_arena_mark {
+    uint8_t *top;
+} cmt_arena_mark_t;
+
+/** Initialize @p me arena backed by @p data, @p length bytes in size
+ *
+ * @param [out] me     uninitialized instance
+ * @param [in]  length size in bytes of @p data
+ * @param [in]  data   the backing memory to be used
+ *
+ * @note @p data memory must outlive @p me. */
+void cmt_arena_init(cmt_arena_t *me, size_t length, void *data);
+
+/** Allocate @p n bytes aligned to @p align
+ *
+ * @param [in,out] me    initialized arena
+ * @param [in]     n     size in bytes
+ * @param [in]     align power of two alignment, 0 for @ref CMT_ARENA_ALIGN
+ *
+ * @return
+ * - pointer to the allocated memory, valid until the arena is reset or
+ *   rewound past it
+ * - NULL if there is not enough space left or @p align is invalid */
+void *cmt_arena_alloc(cmt_arena_t *me, size_t n, size_t align);
+
+/** Allocate @p n bytes as a buffer, suitable as scratch space for encoding
+ *
+ * @param [in,out] me  initialized arena
+ * @param [in]     n   size in bytes
+ * @param [out]    out allocated buffer
+ *
+ * @return
+ * |        |                             |
+ * |-------:|-----------------------------|
+ * |       0| success                     |
+ * |-ENOBUFS| not enough space left       |
+ * |-EINVAL | invalid parameters          | */
+int cmt_arena_alloc_buf(cmt_arena_t *me, size_t n, cmt_buf_t *out);
+
+/** Copy @p n bytes of @p data into the arena, followed by a NUL terminator
+ *
+ * @param [in,out] me   initialized arena
+ * @param [in]     n    size in bytes of @p data
+ * @param [in]     data contents to copy
+ *
+ * @return
+ * - pointer to the copy
+ * - NULL if there is not enough space left */
+void *cmt_arena_dup(cmt_arena_t *me, size_t n, const void *data);
+
+/** Decode a @b bytes or @b string dynamic field into arena memory
+ *
+ * Same as @ref cmt_abi_get_bytes_d, but the contents are copied (and NUL
+ * terminated) so they remain valid after the rx buffer is overwritten, e.g.:
+ * by a @ref cmt_gio_request.
+ *
+ * @param [in,out] me    initialized arena
+ * @param [in]     start starting point for offset calculation (first byte after funsel)
+ * @param [in]     of    offset to the field, from @ref cmt_abi_get_bytes_s
+ * @param [out]    out   decoded contents
+ *
+ * @return
+ * |        |                                 |
+ * |-------:|---------------------------------|
+ * |       0| success                         |
+ * |-ENOBUFS| not enough space left in arena  |
+ * |     < 0| errors from @ref cmt_abi_peek_bytes_d | */
+int cmt_arena_get_bytes_d(cmt_arena_t *me, const cmt_buf_t *start, cmt_buf_t of[1], cmt_abi_bytes_t *out);
+
+/** Take a checkpoint of the current allocations
+ *
+ * @param [in] me initialized arena
+ * @return checkpoint to be passed to @ref cmt_arena_rewind */
+cmt_arena_mark_t cmt_arena_mark(const cmt_arena_t *me);
+
+/** Release every allocation made after @p mark was taken
+ *
+ * @param [in,out] me   initialized arena
+ * @param [in]     mark checkpoint from @ref cmt_arena_mark on this arena */
+void cmt_arena_rewind(cmt_arena_t *me, cmt_arena_mark_t mark);
+
+/** Release every allocation
+ *
+ * @param [in,out] me initialized arena */
+void cmt_arena_reset(cmt_arena_t *me);
+
+/** Bytes currently allocated, including alignment padding
+ *
+ * @param [in] me initialized arena */
+size_t cmt_arena_used(const cmt_arena_t *me);
+
+/** Largest @ref cmt_arena_used seen since initialization, for sizing the backing memory
+ *
+ * @param [in] me initialized arena */
+size_t cmt_arena_peak(const cmt_arena_t *me);
+
+#endif /* CMT_ARENA_H */
+/** @} */
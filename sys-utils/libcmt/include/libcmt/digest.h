@@ -0,0 +1,148 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/** @file
+ * @defgroup libcmt_digest digest
+ * Golden output digests of the mock
+ *
+ * Regression runs only need to know whether the outputs changed. With @p
+ * CMT_OUTPUT_DIGEST the mock hashes every output, report, exception, gio
+ * request and outputs root hash instead of writing it, and logs one compact
+ * @ref cmt_digest_entry_t per input. @p CMT_OUTPUT_DIGEST_EXPECTED compares
+ * the run against a log kept from a previous one, and reports the first input
+ * and output that differ:
+ *
+ * ```
+ * CMT_INPUTS_FILE=inputs.txt CMT_OUTPUT_DIGEST=golden.digest ./application
+ * CMT_INPUTS_FILE=inputs.txt CMT_OUTPUT_DIGEST=new.digest CMT_OUTPUT_DIGEST_EXPECTED=golden.digest ./application
+ * digest diff golden.digest new.digest
+ * ```
+ *
+ * Each output is hashed as `keccak(kind, length, payload)`, with the kind
+ * of @ref libcmt_outlog and both integers as 4 bytes in native endianness.
+ * The digest of an input is the keccak of the hashes of its outputs, in the
+ * order they were emitted, the running digest is `keccak(running, digest)`
+ * over every input so far. The file is a @ref cmt_digest_header_t, then the
+ * entries, each followed by the first 8 bytes of the hash of every output,
+ * enough to tell which one changed. Inputs without outputs have no entry.
+ *
+ * @ingroup libcmt
+ * @{ */
+#ifndef CMT_DIGEST_H
+#define CMT_DIGEST_H
+#include "keccak.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+enum {
+    CMT_DIGEST_VERSION = 1, /**< file format version */
+};
+
+/** File header */
+typedef struct cmt_digest_header {
+    char magic[8];    /**< `CMTDGST1` */
+    uint32_t version; /**< @ref CMT_DIGEST_VERSION */
+    uint32_t pad;     /**< zero */
+} cmt_digest_header_t;
+
+/** Outputs of one input, followed by @b count uint64_t output hashes */
+typedef struct cmt_digest_entry {
+    uint64_t input;                     /**< index of the input, UINT64_MAX before the first */
+    uint32_t count;                     /**< outputs of the input */
+    uint32_t pad;                       /**< zero */
+    uint8_t digest[CMT_KECCAK_LENGTH];  /**< keccak of the output hashes */
+    uint8_t running[CMT_KECCAK_LENGTH]; /**< keccak of the previous running digest and @b digest */
+} cmt_digest_entry_t;
+
+/** First difference between two runs */
+typedef struct cmt_digest_divergence {
+    uint64_t input;  /**< index of the input */
+    uint32_t output; /**< index of the output in the input, in emission order */
+} cmt_digest_divergence_t;
+
+/** Digest state */
+typedef struct cmt_digest {
+    void *file;                         /**< FILE of the log, NULL when not written */
+    void *expected;                     /**< FILE of the expected log, NULL when not comparing */
+    cmt_keccak_t state[1];              /**< digest of the current input */
+    cmt_digest_entry_t entry;           /**< the current input */
+    uint64_t *hashes;                   /**< output hashes of the current input */
+    uint32_t capacity;                  /**< entries allocated in @b hashes */
+    uint64_t *expected_hashes;          /**< scratch space for the expected entry */
+    uint32_t expected_capacity;         /**< entries allocated in @b expected_hashes */
+    uint8_t running[CMT_KECCAK_LENGTH]; /**< running digest of the finished inputs */
+    bool diverged;                      /**< @b divergence is set */
+    cmt_digest_divergence_t divergence; /**< first difference from the expected log */
+} cmt_digest_t;
+
+/** Start a digest
+ *
+ * @param [out] me       uninitialized state
+ * @param [in]  filepath log to write, truncated, or NULL
+ * @param [in]  expected log to compare against, or NULL
+ *
+ * @return
+ * |        |                             |
+ * |-------:|-----------------------------|
+ * |       0| success                     |
+ * |-EPROTO | @p expected is not a digest |
+ * |     < 0| failure with a -errno value | */
+int cmt_digest_open(cmt_digest_t *me, const char *filepath, const char *expected);
+
+/** Hash an output into the digest of @p input, finishing the previous input
+ * if this is a new one
+ *
+ * @param [in,out] me     opened digest
+ * @param [in]     input  index of the input that emitted it
+ * @param [in]     kind   @ref CMT_OUTLOG_OUTPUT and friends
+ * @param [in]     length size in bytes of @p data
+ * @param [in]     data   the output
+ *
+ * @return
+ * |   |                             |
+ * |--:|-----------------------------|
+ * |  0| success                     |
+ * |< 0| failure with a -errno value | */
+int cmt_digest_add(cmt_digest_t *me, uint64_t input, uint32_t kind, uint32_t length, const void *data);
+
+/** Finish the last input, check the expected log has nothing left and close the files
+ *
+ * @param [in,out] me opened digest
+ *
+ * @return
+ * |   |                             |
+ * |--:|-----------------------------|
+ * |  0| success                     |
+ * |< 0| failure with a -errno value | */
+int cmt_digest_close(cmt_digest_t *me);
+
+/** Compare two digest logs
+ *
+ * @param [in]  expected   log of the reference run
+ * @param [in]  actual     log of the run to check
+ * @param [out] divergence first difference, when they differ
+ *
+ * @return
+ * |        |                                   |
+ * |-------:|-----------------------------------|
+ * |       0| same outputs                      |
+ * |       1| different, see @p divergence      |
+ * |-EPROTO | one of them is not a digest log   |
+ * |     < 0| failure with a -errno value       | */
+int cmt_digest_compare(const char *expected, const char *actual, cmt_digest_divergence_t *divergence);
+
+#endif /* CMT_DIGEST_H */
+/** @} */
@@ -0,0 +1,174 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/** @file
+ * @defgroup libcmt_eip712 eip712
+ * EIP-712 typed structured data hashing
+ *
+ * Reference: https://eips.ethereum.org/EIPS/eip-712
+ *
+ * Struct types are registered once, dependencies first. Registration computes
+ * the `typeHash` of each type, including the referenced types in its
+ * `encodeType`, so it never has to be derived again:
+ * @code
+ * ...
+ * cmt_eip712_t types[1];
+ * const cmt_eip712_type_t *person, *mail;
+ * cmt_eip712_init(types);
+ * cmt_eip712_register(types, "Person", "string name,address wallet", &person);
+ * cmt_eip712_register(types, "Mail", "Person from,Person to,string contents", &mail);
+ * ...
+ * @endcode
+ *
+ * Instances are hashed by streaming the encoded members, in declaration order,
+ * straight into a keccak state. Nested structs and arrays are hashed with a
+ * state of their own and their digest put into the parent:
+ * @code
+ * ...
+ * uint8_t from[CMT_KECCAK_LENGTH], hash[CMT_KECCAK_LENGTH], digest[CMT_KECCAK_LENGTH];
+ * cmt_keccak_t st[1];
+ *
+ * cmt_eip712_hash_begin(st, person);
+ * cmt_eip712_put_bytes(st, &from_name);
+ * cmt_eip712_put_address(st, &from_wallet);
+ * cmt_eip712_hash_end(st, from);
+ *
+ * cmt_eip712_hash_begin(st, mail);
+ * cmt_eip712_put_hash(st, from);
+ * ...
+ * cmt_eip712_hash_end(st, hash);
+ * cmt_eip712_digest(domain_separator, hash, digest);
+ * ...
+ * @endcode
+ *
+ * @ingroup libcmt
+ * @{ */
+#ifndef CMT_EIP712_H
+#define CMT_EIP712_H
+#include "abi.h"
+#include "keccak.h"
+
+enum {
+    CMT_EIP712_MAX_TYPES = 32, /**< maximum number of registered struct types */
+};
+
+/** A registered struct type */
+typedef struct cmt_eip712_type {
+    const char *name;                     /**< struct name, e.g.: `Mail` */
+    const char *members;                  /**< canonical member list, e.g.: `Person from,Person to,string contents` */
+    uint32_t deps;                        /**< bitmask of (transitively) referenced types */
+    uint8_t type_hash[CMT_KECCAK_LENGTH]; /**< keccak(encodeType) */
+} cmt_eip712_type_t;
+
+/** Set of registered struct types, initialize with @ref cmt_eip712_init */
+typedef struct cmt_eip712 {
+    int count;
+    cmt_eip712_type_t types[CMT_EIP712_MAX_TYPES];
+} cmt_eip712_t;
+
+/** Initialize an empty @ref cmt_eip712_t
+ *
+ * @param [out] me uninitialized state */
+void cmt_eip712_init(cmt_eip712_t *me);
+
+/** Register a struct type and compute its type hash
+ *
+ * @param [in,out] me      initialized state
+ * @param [in]     name    struct name
+ * @param [in]     members comma separated `type name` pairs, without spaces
+ *                         around the commas, in declaration order
+ * @param [out]    type    registered type (may be NULL)
+ *
+ * @return
+ * |        |                                                    |
+ * |-------:|----------------------------------------------------|
+ * |       0| success                                            |
+ * |-ENOBUFS| more than @ref CMT_EIP712_MAX_TYPES types           |
+ * |-ENOENT | a member references a struct that is not registered|
+ * |-EINVAL | invalid parameters or malformed @p members          |
+ *
+ * @note @p name and @p members are not copied and must outlive @p me.
+ * Register referenced types before the types that use them. */
+int cmt_eip712_register(cmt_eip712_t *me, const char *name, const char *members, const cmt_eip712_type_t **type);
+
+/** Look up a registered type by @p name
+ *
+ * @return
+ * - the registered type
+ * - NULL if not found */
+const cmt_eip712_type_t *cmt_eip712_find(const cmt_eip712_t *me, const char *name);
+
+/** Start hashing an instance of @p type (absorbs its cached type hash)
+ *
+ * @param [out] st   uninitialized keccak state
+ * @param [in]  type registered type */
+void cmt_eip712_hash_begin(cmt_keccak_t *st, const cmt_eip712_type_t *type);
+
+/** Finish hashing a struct instance or an array
+ *
+ * @param [in,out] st   state with all members added
+ * @param [out]    hash resulting `hashStruct` (or array hash) */
+void cmt_eip712_hash_end(cmt_keccak_t *st, uint8_t hash[CMT_KECCAK_LENGTH]);
+
+/** Start hashing an array, put its elements then finish with @ref cmt_eip712_hash_end
+ *
+ * @param [out] st uninitialized keccak state */
+void cmt_eip712_array_begin(cmt_keccak_t *st);
+
+/** Put a @b uintN member from a native endianness integer of @p n bytes
+ *
+ * @return
+ * |        |                                          |
+ * |-------:|------------------------------------------|
+ * |       0| success                                  |
+ * |   -EDOM| integer not representable in @p 32 bytes | */
+int cmt_eip712_put_uint(cmt_keccak_t *st, size_t n, const void *data);
+
+/** Put a 32 byte word member as is: @b uint256, @b int256 or @b bytes32 */
+void cmt_eip712_put_u256(cmt_keccak_t *st, const cmt_abi_u256_t *value);
+
+/** Put an @b address member */
+void cmt_eip712_put_address(cmt_keccak_t *st, const cmt_abi_address_t *address);
+
+/** Put a @b bool member */
+void cmt_eip712_put_bool(cmt_keccak_t *st, bool value);
+
+/** Put a @b bytes or @b string member (hashes its contents) */
+void cmt_eip712_put_bytes(cmt_keccak_t *st, const cmt_abi_bytes_t *value);
+
+/** Put an already hashed member: nested struct or array */
+void cmt_eip712_put_hash(cmt_keccak_t *st, const uint8_t hash[CMT_KECCAK_LENGTH]);
+
+/** Compute the domain separator of the
+ * `EIP712Domain(string name,string version,uint256 chainId,address verifyingContract)` domain
+ *
+ * @param [out] separator          resulting domain separator
+ * @param [in]  name               signing domain name
+ * @param [in]  version            signing domain version
+ * @param [in]  chain_id           chain id
+ * @param [in]  verifying_contract verifying contract address */
+void cmt_eip712_domain(uint8_t separator[CMT_KECCAK_LENGTH], const cmt_abi_bytes_t *name,
+    const cmt_abi_bytes_t *version, uint64_t chain_id, const cmt_abi_address_t *verifying_contract);
+
+/** Compute the digest to be signed: `keccak("\x19\x01" || separator || hash)`
+ *
+ * @param [in]  separator domain separator
+ * @param [in]  hash      `hashStruct` of the message
+ * @param [out] digest    resulting digest */
+void cmt_eip712_digest(const uint8_t separator[CMT_KECCAK_LENGTH], const uint8_t hash[CMT_KECCAK_LENGTH],
+    uint8_t digest[CMT_KECCAK_LENGTH]);
+
+#endif /* CMT_EIP712_H */
+/** @} */
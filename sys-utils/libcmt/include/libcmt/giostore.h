@@ -0,0 +1,150 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/** @file
+ * @defgroup libcmt_giostore giostore
+ * Content addressed gio responses for the mock
+ *
+ * The mock answers a @ref cmt_gio_request with the next entry of @p
+ * CMT_INPUTS. Applications that issue many preimage style queries would need
+ * long input lists in the exact order of the queries. With @p CMT_GIO_STORE
+ * the mock looks the response up by the request instead, and only falls back
+ * to @p CMT_INPUTS when it is not found:
+ *
+ * ```
+ * CMT_GIO_STORE=responses/ CMT_INPUTS=0:advance.bin ./application
+ * ```
+ *
+ * A store is either a directory or a pack file. In a directory the response
+ * to a request of @b domain and @b id is the file `<domain>-<keccak(id)>.bin`,
+ * with the hash in lowercase hex. Files read from it are kept in memory, up to
+ * @p CMT_GIO_CACHE_LENGTH bytes (16MB by default), the least recently used are
+ * dropped first. A pack is a read only file mapped into memory with the same
+ * responses. Build one out of a directory, or find the name of a response
+ * file, with the giostore tool:
+ *
+ * ```
+ * giostore pack responses/ responses.pack
+ * giostore name 42 id.bin
+ * ```
+ *
+ * The pack is a @ref cmt_giostore_header_t, @b count @ref
+ * cmt_giostore_entry_t sorted by @b domain then @b key, then the responses.
+ * All integers are in native endianness. Responses from the store have the
+ * response code 0.
+ *
+ * @ingroup libcmt
+ * @{ */
+#ifndef CMT_GIOSTORE_H
+#define CMT_GIOSTORE_H
+#include <stddef.h>
+#include <stdint.h>
+
+enum {
+    CMT_GIOSTORE_VERSION = 1,                                          /**< pack format version */
+    CMT_GIOSTORE_KEY_LENGTH = 32,                                      /**< keccak of the request id */
+    CMT_GIOSTORE_NAME_LENGTH = 5 + 1 + 2 * CMT_GIOSTORE_KEY_LENGTH + 5, /**< see @ref cmt_giostore_name */
+};
+
+/** Pack header */
+typedef struct cmt_giostore_header {
+    char magic[8];    /**< `CMTGIOP1` */
+    uint32_t version; /**< @ref CMT_GIOSTORE_VERSION */
+    uint32_t count;   /**< number of entries */
+} cmt_giostore_header_t;
+
+/** Pack index entry */
+typedef struct cmt_giostore_entry {
+    uint8_t key[CMT_GIOSTORE_KEY_LENGTH]; /**< keccak of the request id */
+    uint16_t domain;                      /**< request domain */
+    uint16_t pad[3];                      /**< zero */
+    uint64_t offset;                      /**< file offset of the response */
+    uint64_t length;                      /**< response size in bytes */
+} cmt_giostore_entry_t;
+
+/** Lookup counters */
+typedef struct cmt_giostore_stats {
+    uint64_t lookups; /**< calls to @ref cmt_giostore_find */
+    uint64_t found;   /**< lookups answered by the store */
+    uint64_t cached;  /**< lookups answered from memory, without reading a file */
+    uint64_t evicted; /**< responses dropped from the cache */
+} cmt_giostore_stats_t;
+
+typedef struct cmt_giostore cmt_giostore_t;
+
+/** Open the store at @p path, a directory or a pack file
+ *
+ * @param [out] me           the store, release it with @ref cmt_giostore_close
+ * @param [in]  path         directory or pack file
+ * @param [in]  cache_length bytes of responses to keep in memory, for a directory
+ *
+ * @return
+ * |        |                             |
+ * |-------:|-----------------------------|
+ * |       0| success                     |
+ * |-EPROTO | not a valid pack            |
+ * |     < 0| failure with a -errno value | */
+int cmt_giostore_open(cmt_giostore_t **me, const char *path, size_t cache_length);
+
+/** Look up the response to a gio request
+ *
+ * @param [in,out] me        opened store
+ * @param [in]     domain    request domain
+ * @param [in]     id_length size in bytes of @p id
+ * @param [in]     id        request id
+ * @param [out]    data      response, valid until the next call on @p me
+ * @param [out]    length    response size in bytes
+ *
+ * @return
+ * |        |                             |
+ * |-------:|-----------------------------|
+ * |       0| success                     |
+ * |-ENOENT | not in the store            |
+ * |     < 0| failure with a -errno value | */
+int cmt_giostore_find(cmt_giostore_t *me, uint16_t domain, size_t id_length, const void *id, const void **data,
+    size_t *length);
+
+/** Lookup counters of @p me
+ *
+ * @param [in] me opened store */
+const cmt_giostore_stats_t *cmt_giostore_get_stats(const cmt_giostore_t *me);
+
+/** Release the memory and mapping of @p me
+ *
+ * @param [in] me opened store, or NULL */
+void cmt_giostore_close(cmt_giostore_t *me);
+
+/** Write the responses of the directory @p dir into the pack @p path
+ *
+ * @param [in] dir  directory of `<domain>-<keccak(id)>.bin` files, others are ignored
+ * @param [in] path pack file, truncated
+ *
+ * @return
+ * |   |                             |
+ * |--:|-----------------------------|
+ * |  0| success                     |
+ * |< 0| failure with a -errno value | */
+int cmt_giostore_pack(const char *dir, const char *path);
+
+/** File name in a directory store of a request, `<domain>-<keccak(id)>.bin`
+ *
+ * @param [in]  domain    request domain
+ * @param [in]  id_length size in bytes of @p id
+ * @param [in]  id        request id
+ * @param [out] name      at least @ref CMT_GIOSTORE_NAME_LENGTH bytes, NUL terminated */
+void cmt_giostore_name(uint16_t domain, size_t id_length, const void *id, char *name);
+
+#endif /* CMT_GIOSTORE_H */
+/** @} */
@@ -29,13 +29,19 @@
  *
  * @include examples/io.c
  *
- * There are two implementations provided: `ioctl` that interacts with the
- * cartesi-machine linux driver and `mock` that reads and writes the host
- * filesystem, used for testing.
+ * There are three implementations provided: `ioctl` that interacts with the
+ * cartesi-machine linux driver, `mock` that reads and writes the host
+ * filesystem, used for testing, and `loopback` that exchanges inputs and
+ * outputs with callbacks, used for benchmarking. They are selected at
+ * initialization with @ref cmt_io_init_driver and @ref cmt_io_init_loopback.
  *
  * @section Environment variables
  *
- * this module exposes two environment variables: @p CMT_DEBUG and @p CMT_INPUTS.
+ * this module exposes the environment variables: @p CMT_DEBUG, @p CMT_IO_DRIVER, @p CMT_IO_FLAGS,
+ * @p CMT_INPUTS, @p CMT_INPUTS_FILE, @p CMT_OUTPUT_LOG, @p CMT_TX_LENGTH, @p CMT_RX_LENGTH, @p CMT_STATS,
+ * @p CMT_IO_RECORD, @p CMT_IO_RECORD_COMPRESS, @p CMT_IO_REPLAY, @p CMT_MOCK_SOCKET, @p CMT_MOCK_SHM,
+ * @p CMT_GIO_STORE, @p CMT_INSPECT_FORKS and @p CMT_IO_COST. The mock ones can be given per instance instead,
+ * see @ref cmt_io_init_mock.
  *
  * @p CMT_DEBUG prints runtime information during application execution.
  *
@@ -43,17 +49,123 @@
  * CMT_DEBUG=yes ./application
  * ```
  *
+ * @p CMT_IO_DRIVER selects the driver used by @ref cmt_io_init, either
+ * `ioctl`, `mock`, `replay`, `socket` or `shm`. Like the other host driver
+ * variables it is only read by the mock build, the RISC-V library always
+ * talks to @p /dev/cmio.
+ *
+ * ```
+ * CMT_IO_DRIVER=mock CMT_INPUTS=0:advance.bin ./application
+ * ```
+ *
+ * @p CMT_IO_FLAGS sets the mapping flags used by @ref cmt_io_init and
+ * @ref cmt_io_init_driver, a comma separated list of `prefault`, `willneed`,
+ * `hugepage` and `async` (@ref CMT_IO_ASYNC_OUTPUTS).
+ *
+ * ```
+ * CMT_IO_FLAGS=prefault,willneed ./application
+ * ```
+ *
  * @p CMT_INPUTS feeds inputs to the mock (ignored for ioctl).
  *
  * ```
  * CMT_INPUTS=0:advance.bin,1:inspect.bin ./application
  * ```
  *
+ * @p CMT_INPUTS_FILE does the same from a file with one `<reason>:<filepath>`
+ * entry per line, read as the inputs are consumed, for histories too long
+ * for the environment. Empty lines and lines starting with `#` are skipped.
+ *
+ * ```
+ * CMT_INPUTS_FILE=inputs.txt ./application
+ * ```
+ *
+ * @p CMT_OUTPUT_LOG appends the mock outputs to a single file instead of
+ * writing a file per output, see @ref libcmt_outlog.
+ *
+ * ```
+ * CMT_INPUTS_FILE=inputs.txt CMT_OUTPUT_LOG=outputs.log ./application
+ * ```
+ *
+ * @p CMT_OUTPUT_DIGEST hashes the mock outputs into a compact log instead of
+ * writing them, and @p CMT_OUTPUT_DIGEST_EXPECTED compares them with the log
+ * of a previous run, see @ref libcmt_digest.
+ *
+ * ```
+ * CMT_INPUTS_FILE=inputs.txt CMT_OUTPUT_DIGEST_EXPECTED=golden.digest ./application
+ * ```
+ *
+ * @p CMT_MOCK_SOCKET connects the mock to an input generator listening on
+ * that Unix socket instead of using files, see @ref cmt_io_socket_request_t.
+ *
+ * ```
+ * CMT_MOCK_SOCKET=/tmp/generator.sock ./application
+ * ```
+ *
+ * @p CMT_MOCK_SHM does the same with a host process that shares tx and rx
+ * with the application, for yields without copies, see @ref libcmt_shm.
+ *
+ * ```
+ * CMT_MOCK_SHM=/tmp/host.sock ./application
+ * ```
+ *
+ * @p CMT_INSPECT_FORKS runs each inspect of the mock in a forked copy of
+ * the application, up to that many at once, while the parent moves on to
+ * the next inputs. As on the machine, inspects see the state left by the
+ * previous advances and their changes to it are discarded. All outputs
+ * are stored in input order, those of the parent wait in a temporary file
+ * for the inspects before them, so runs have the same logs and digests
+ * with any number of forks. The gio requests of an inspect are answered
+ * from @p CMT_GIO_STORE only. An inspect ends its forked copy when it is
+ * accepted, rejected, raises an exception or calls @ref cmt_io_fini.
+ *
+ * ```
+ * CMT_INPUTS_FILE=inputs.txt CMT_INSPECT_FORKS=$(nproc) ./application
+ * ```
+ *
+ * @p CMT_TX_LENGTH and @p CMT_RX_LENGTH set the size in bytes of the mock
+ * buffers, 2MB by default, to match the machine configuration.
+ *
+ * ```
+ * CMT_RX_LENGTH=$((32 << 20)) CMT_INPUTS=0:large.bin ./application
+ * ```
+ *
+ * @p CMT_STATS prints the yield statistics (see @ref cmt_io_get_stats) to
+ * stderr at @ref cmt_io_fini. An empty value or `0` leaves them off.
+ *
+ * ```
+ * CMT_STATS=yes ./application
+ * ```
+ *
+ * @p CMT_IO_RECORD records the session to a file, with any driver, and
+ * @p CMT_IO_REPLAY names the recording fed back by the `replay` driver, see
+ * @ref libcmt_record.
+ *
+ * ```
+ * CMT_IO_RECORD=session.rec ./application
+ * CMT_IO_DRIVER=replay CMT_IO_REPLAY=session.rec ./application
+ * ```
+ *
+ * @p CMT_IO_COST models the latency of each yield on the machine, which the
+ * host drivers make nearly free. Entries are `<kind>=<fixed>[+<per-byte>]`
+ * in nanoseconds, per yield and per byte sent and received, with the kinds
+ * printed by @p CMT_STATS (`tx-output`, `gio`, ...) or `yield` for all of
+ * them. @p CMT_IO_COST_FILE reads them from a file instead, one per line,
+ * with `#` comments. The modeled cost adds up in @ref
+ * cmt_io_stats_kind_t::modeled_ns as virtual time, @p CMT_IO_COST_SLEEP also
+ * sleeps for it. The total of every input is written as CSV to @p
+ * CMT_IO_COST_REPORT, stderr by default.
+ *
+ * ```
+ * CMT_IO_COST="yield=20000,tx-output=50000+0.5,gio=200000+1" ./application
+ * ```
+ *
  * @ingroup libcmt
  * @{ */
 #ifndef CMT_IO_H
 #define CMT_IO_H
 #include "buf.h"
+#include <stdbool.h>
 #include <stdint.h>
 
 /** Device */
@@ -87,16 +199,179 @@ enum {
     HTIF_YIELD_REASON_INSPECT = 1, /**< Input is inspect */
 };
 
-typedef struct {
+/** Kinds of yield tracked by @ref cmt_io_stats_t */
+enum {
+    CMT_IO_STATS_PROGRESS,     /**< @ref HTIF_YIELD_AUTOMATIC_REASON_PROGRESS */
+    CMT_IO_STATS_TX_OUTPUT,    /**< @ref HTIF_YIELD_AUTOMATIC_REASON_TX_OUTPUT */
+    CMT_IO_STATS_TX_REPORT,    /**< @ref HTIF_YIELD_AUTOMATIC_REASON_TX_REPORT */
+    CMT_IO_STATS_RX_ACCEPTED,  /**< @ref HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED */
+    CMT_IO_STATS_RX_REJECTED,  /**< @ref HTIF_YIELD_MANUAL_REASON_RX_REJECTED */
+    CMT_IO_STATS_TX_EXCEPTION, /**< @ref HTIF_YIELD_MANUAL_REASON_TX_EXCEPTION */
+    CMT_IO_STATS_GIO,          /**< any other manual reason, a gio domain */
+    CMT_IO_STATS_OTHER,        /**< anything else, invalid requests */
+    CMT_IO_STATS_KINDS,        /**< number of kinds */
+};
+
+enum {
+    CMT_IO_STATS_BUCKETS = 32, /**< latency histogram buckets */
+};
+
+/** Counters of one kind of yield */
+typedef struct cmt_io_stats_kind {
+    uint64_t count;      /**< yields performed */
+    uint64_t errors;     /**< yields that failed */
+    uint64_t tx_bytes;   /**< bytes sent, the request @b data (except for progress) */
+    uint64_t rx_bytes;   /**< bytes received, the reply @b data of accepted, rejected and gio */
+    uint64_t elapsed_ns; /**< total time spent yielding, in nanoseconds */
+    uint64_t max_ns;     /**< longest yield, in nanoseconds */
+    uint64_t modeled_ns; /**< cost of the yields under @p CMT_IO_COST, in nanoseconds */
+    /** bucket @b i counts yields that took less than 2^i nanoseconds (and
+     * at least 2^(i-1)), the last bucket also counts the longer ones. */
+    uint64_t histogram[CMT_IO_STATS_BUCKETS];
+} cmt_io_stats_kind_t;
+
+/** Page fault counters of the tx and rx buffers, see @ref cmt_io_init_ex */
+typedef struct cmt_io_stats_pages {
+    uint64_t total;       /**< pages spanned by tx and rx */
+    uint64_t resident;    /**< pages already mapped after init, first touches that will not fault */
+    uint64_t init_faults; /**< minor faults of the calling thread during init, where the prefaulting cost went,
+                           * including those of the driver setup itself */
+} cmt_io_stats_pages_t;
+
+/** Yield statistics, indexed by @ref CMT_IO_STATS_PROGRESS and friends */
+typedef struct cmt_io_stats {
+    cmt_io_stats_kind_t kind[CMT_IO_STATS_KINDS];
+    cmt_io_stats_pages_t pages; /**< mapping of the tx and rx buffers */
+} cmt_io_stats_t;
+
+/** yield struct cmt_io_yield */
+typedef struct cmt_io_yield {
+    uint8_t dev;
+    uint8_t cmd;
+    uint16_t reason;
+    uint32_t data;
+} cmt_io_yield_t;
+
+/** Drivers, see @ref cmt_io_init_driver */
+enum {
+    CMT_IO_DRIVER_DEFAULT = 0,  /**< ioctl for the riscv64 library, @p CMT_IO_DRIVER if set or mock for the host one */
+    CMT_IO_DRIVER_IOCTL = 1,    /**< cartesi-machine linux driver, @p /dev/cmio */
+    CMT_IO_DRIVER_MOCK = 2,     /**< host filesystem, see @p CMT_INPUTS */
+    CMT_IO_DRIVER_LOOPBACK = 3, /**< in memory, see @ref cmt_io_init_loopback */
+    CMT_IO_DRIVER_REPLAY = 4,   /**< recorded session, see @p CMT_IO_REPLAY and @ref cmt_io_init_replay */
+    CMT_IO_DRIVER_SOCKET = 5,   /**< input generator on a Unix socket, see @p CMT_MOCK_SOCKET */
+    CMT_IO_DRIVER_SHM = 6,      /**< host process sharing tx and rx, see @p CMT_MOCK_SHM */
+};
+
+/** Mapping flags of the tx and rx buffers, see @ref cmt_io_init_ex */
+enum {
+    CMT_IO_PREFAULT = 1 << 0,      /**< populate the page tables at init (MAP_POPULATE) instead of on first touch */
+    CMT_IO_WILLNEED = 1 << 1,      /**< madvise(MADV_WILLNEED) the buffers */
+    CMT_IO_HUGEPAGE = 1 << 2,      /**< madvise(MADV_HUGEPAGE) the buffers, a hint for anonymous memory only */
+    CMT_IO_ASYNC_OUTPUTS = 1 << 3, /**< mock only, write the outputs from a background thread, ignored by the others */
+};
+
+/** Frame sent to the input generator by the socket driver, for every yield
+ *
+ * Followed by @b length bytes of tx. Automatic yields (outputs, reports and
+ * progress) get no reply and are batched, they reach the generator together
+ * with the next manual yield, which is answered with a @ref
+ * cmt_io_socket_reply_t. Integers are in native endianness, both ends run on
+ * the same host. The generator closes the connection when it has no inputs
+ * left, the pending @ref HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED then fails with
+ * -ENODATA, as with the mock. */
+typedef struct cmt_io_socket_request {
+    uint8_t cmd;     /**< @ref HTIF_YIELD_CMD_AUTOMATIC or @ref HTIF_YIELD_CMD_MANUAL */
+    uint8_t pad;     /**< zero */
+    uint16_t reason; /**< the yield reason, a gio domain for the other manual ones */
+    uint32_t data;   /**< the yield data, a length or the progress */
+    uint32_t length; /**< payload bytes that follow, 0 for progress */
+} cmt_io_socket_request_t;
+
+/** Frame sent back by the input generator for every manual yield, followed
+ * by @b data bytes copied to rx */
+typedef struct cmt_io_socket_reply {
+    uint16_t reason; /**< @ref HTIF_YIELD_REASON_ADVANCE, @ref HTIF_YIELD_REASON_INSPECT or the gio response code */
+    uint16_t pad;    /**< zero */
+    uint32_t data;   /**< payload bytes that follow */
+} cmt_io_socket_reply_t;
+
+/** Loopback driver callbacks, see @ref cmt_io_init_loopback */
+typedef struct cmt_io_loopback {
+    /** Produce the next input, also called to answer gio requests.
+     *
+     * Write the payload into @p rx and set @p reason (@ref HTIF_YIELD_REASON_ADVANCE,
+     * @ref HTIF_YIELD_REASON_INSPECT or the gio response code) and @p length.
+     *
+     * @return 0 on success, -ENODATA when there are no inputs left or a negative errno */
+    int (*input)(void *context, cmt_buf_t rx, uint16_t *reason, uint32_t *length);
+
+    /** Observe the data sent by @p rr: outputs, reports, exceptions, gio
+     * requests and the outputs root hash. May be NULL to discard them.
+     *
+     * @return 0 on success or a negative errno, returned by @ref cmt_io_yield */
+    int (*output)(void *context, const cmt_io_yield_t *rr, const void *data);
+
+    void *context; /**< passed to the callbacks */
+    bool checksum; /**< fold every output into @ref cmt_io_driver_loopback_t::checksum */
+    int flags;     /**< @ref CMT_IO_PREFAULT and friends */
+} cmt_io_loopback_t;
+
+/** Mock driver configuration, see @ref cmt_io_init_mock
+ *
+ * Takes the place of the environment variables of the same names, which are
+ * process wide, so each instance can have its own inputs and outputs. Strings
+ * must outlive the driver, NULL leaves the feature off. */
+typedef struct cmt_io_mock_config {
+    const char *inputs;          /**< as @p CMT_INPUTS, `<reason>:<filepath>` comma separated entries */
+    const char *inputs_file;     /**< as @p CMT_INPUTS_FILE, takes precedence over @b inputs */
+    const char *output_log;      /**< as @p CMT_OUTPUT_LOG */
+    const char *output_digest;   /**< as @p CMT_OUTPUT_DIGEST, see @ref libcmt_digest */
+    const char *expected_digest; /**< as @p CMT_OUTPUT_DIGEST_EXPECTED */
+    const char *output_dir;      /**< directory of the output files, next to the inputs when NULL */
+    const char *gio_store;       /**< as @p CMT_GIO_STORE, see @ref libcmt_giostore */
+    size_t gio_cache_length;     /**< as @p CMT_GIO_CACHE_LENGTH, 0 for 16MB */
+    size_t tx_length;            /**< as @p CMT_TX_LENGTH, 0 for 2MB */
+    size_t rx_length;            /**< as @p CMT_RX_LENGTH, 0 for 2MB */
+    uint32_t inspect_forks;      /**< as @p CMT_INSPECT_FORKS, 0 to run the inspects in process */
+    const char *record;          /**< as @p CMT_IO_RECORD, see @ref libcmt_record */
+    bool record_compress;        /**< as @p CMT_IO_RECORD_COMPRESS */
+    const char *cost;            /**< as @p CMT_IO_COST */
+    const char *cost_file;       /**< as @p CMT_IO_COST_FILE */
+    const char *cost_report;     /**< as @p CMT_IO_COST_REPORT, stderr when NULL */
+    bool cost_sleep;             /**< as @p CMT_IO_COST_SLEEP */
+    int flags;                   /**< @ref CMT_IO_PREFAULT and friends */
+} cmt_io_mock_config_t;
+
+/** State shared by every driver, the first member of each one of them */
+typedef struct cmt_io_driver_base {
+    const struct cmt_io_ops *ops; /**< driver implementation */
     cmt_buf_t tx[1];
     cmt_buf_t rx[1];
+    cmt_io_stats_t stats;
+    struct cmt_record *record; /**< @p CMT_IO_RECORD, NULL when not recording */
+    struct cmt_io_cost *cost;  /**< @p CMT_IO_COST, NULL when yields are not modeled */
+} cmt_io_driver_base_t;
+
+typedef struct {
+    cmt_io_driver_base_t base;
     int fd;
 } cmt_io_driver_ioctl_t;
 
 typedef struct {
-    cmt_buf_t tx[1];
-    cmt_buf_t rx[1];
+    cmt_io_driver_base_t base;
     cmt_buf_t inputs_left;
+    void *inputs_file;                /**< FILE of @p CMT_INPUTS_FILE, NULL to use @p CMT_INPUTS */
+    struct cmt_outlog *output_log;    /**< @p CMT_OUTPUT_LOG, NULL to write a file per output */
+    struct cmt_io_writer *writer;     /**< background writer of @ref CMT_IO_ASYNC_OUTPUTS, NULL to write in the yield */
+    struct cmt_giostore *gio_store;   /**< @p CMT_GIO_STORE, NULL to answer gio requests from the inputs */
+    struct cmt_digest *output_digest; /**< @p CMT_OUTPUT_DIGEST, NULL to store the outputs */
+    struct cmt_io_inspects *inspects; /**< @p CMT_INSPECT_FORKS, NULL to run the inspects in process */
+    void *inspect_outputs;            /**< FILE the outputs go to in a forked inspect, NULL in the parent */
+    const char *output_dir;           /**< see @ref cmt_io_mock_config_t::output_dir */
+    uint64_t input_index;             /**< advance or inspect being processed, UINT64_MAX before the first */
+    int flags;                        /**< @ref CMT_IO_PREFAULT and friends */
+    size_t input_mapped;              /**< bytes at the start of rx backed by the current input file */
 
     int input_type;
     char input_filename[128];
@@ -109,21 +384,57 @@ typedef struct {
     int gio_seq;
 } cmt_io_driver_mock_t;
 
+typedef struct {
+    cmt_io_driver_base_t base;
+    cmt_io_loopback_t callbacks;
+    uint64_t inputs;   /**< inputs loaded, including gio responses */
+    uint64_t checksum; /**< FNV-1a of the outputs, when enabled */
+    bool first;        /**< no input was loaded yet */
+} cmt_io_driver_loopback_t;
+
+typedef struct {
+    cmt_io_driver_base_t base;
+    const uint8_t *begin; /**< the recording, mapped read only */
+    const uint8_t *next;  /**< next event */
+    const uint8_t *end;   /**< end of the recording */
+    int flags;            /**< of the recording, @ref CMT_RECORD_COMPRESS */
+    uint64_t events;      /**< events replayed so far */
+    uint64_t mismatches;  /**< requests sending a different amount of data than recorded */
+} cmt_io_driver_replay_t;
+
+typedef struct {
+    cmt_io_driver_base_t base;
+    int fd;            /**< connection to the generator */
+    uint8_t *in;       /**< read buffer */
+    size_t in_begin;   /**< unread bytes of @b in start here */
+    size_t in_end;     /**< and end here */
+    uint8_t *out;      /**< write buffer, frames not sent yet */
+    size_t out_length; /**< bytes in @b out */
+} cmt_io_driver_socket_t;
+
+typedef struct {
+    cmt_io_driver_base_t base;
+    int fd;                          /**< connection to the host, to notice it going away */
+    int events[2];                   /**< eventfds of the application and the host, -1 to sleep on the futex */
+    struct cmt_shm_control *control; /**< start of the shared memory */
+    size_t length;                   /**< size in bytes of the shared memory */
+    bool spin;                       /**< spin before sleeping, there is more than one cpu */
+} cmt_io_driver_shm_t;
+
 /** Implementation specific cmio state. */
 typedef union cmt_io_driver {
+    cmt_io_driver_base_t base;
     cmt_io_driver_ioctl_t ioctl;
     cmt_io_driver_mock_t mock;
+    cmt_io_driver_loopback_t loopback;
+    cmt_io_driver_replay_t replay;
+    cmt_io_driver_socket_t socket;
+    cmt_io_driver_shm_t shm;
 } cmt_io_driver_t;
 
-/** yield struct cmt_io_yield */
-typedef struct cmt_io_yield {
-    uint8_t dev;
-    uint8_t cmd;
-    uint16_t reason;
-    uint32_t data;
-} cmt_io_yield_t;
-
 /** Open the io device and initialize the driver. Release its resources with @ref cmt_io_fini.
+ *
+ * Same as @ref cmt_io_init_driver with @ref CMT_IO_DRIVER_DEFAULT.
  *
  * @param [in] me A uninitialized @ref cmt_io_driver state
  *
@@ -134,6 +445,110 @@ typedef struct cmt_io_yield {
  * |< 0| failure with a -errno value | */
 int cmt_io_init(cmt_io_driver_t *me);
 
+/** Initialize @p me with a specific driver. Release its resources with @ref cmt_io_fini.
+ *
+ * @param [in] me     A uninitialized @ref cmt_io_driver state
+ * @param [in] driver @ref CMT_IO_DRIVER_DEFAULT, @ref CMT_IO_DRIVER_IOCTL, @ref CMT_IO_DRIVER_MOCK (the socket
+ *                    or shm one if @p CMT_MOCK_SOCKET or @p CMT_MOCK_SHM is set), @ref CMT_IO_DRIVER_REPLAY (of
+ *                    @p CMT_IO_REPLAY), @ref CMT_IO_DRIVER_SOCKET (of @p CMT_MOCK_SOCKET) or @ref
+ *                    CMT_IO_DRIVER_SHM (of @p CMT_MOCK_SHM)
+ *
+ * @return
+ * |       |                                                   |
+ * |------:|---------------------------------------------------|
+ * |      0| success                                           |
+ * |-ENOSYS| @p driver is not part of this build (ioctl on the host, the host ones on riscv64) |
+ * |-EINVAL| invalid @p driver, use @ref cmt_io_init_loopback for loopback |
+ * |    < 0| failure with a -errno value                       | */
+int cmt_io_init_driver(cmt_io_driver_t *me, int driver);
+
+/** Initialize @p me with a specific driver and mapping @p flags. Release its resources with @ref cmt_io_fini.
+ *
+ * The first write into each tx page (and read of each rx page) takes a page
+ * fault, expensive under emulation. @ref CMT_IO_PREFAULT moves them all to
+ * init, when the buffers are mapped. @ref cmt_io_stats_pages_t reports the
+ * outcome. Hints the kernel does not support are ignored. The mock honours
+ * the same flags, so their effect can be measured on the host, e.g.: with
+ * `perf stat -e page-faults`.
+ *
+ * With @ref CMT_IO_ASYNC_OUTPUTS the mock copies each output into one of
+ * @b 16 pooled buffers and returns from the yield, a background thread writes
+ * them in order. The yield blocks while all buffers are in flight. Everything
+ * is written by the time @ref cmt_io_fini returns, write errors are reported
+ * by the next output yield or at fini.
+ *
+ * @param [in] me     A uninitialized @ref cmt_io_driver state
+ * @param [in] driver same as @ref cmt_io_init_driver
+ * @param [in] flags  @ref CMT_IO_PREFAULT, @ref CMT_IO_WILLNEED, @ref CMT_IO_HUGEPAGE and @ref CMT_IO_ASYNC_OUTPUTS, or 0
+ *
+ * @return
+ * |       |                                   |
+ * |------:|-----------------------------------|
+ * |      0| success                           |
+ * |-EINVAL| invalid @p driver or unknown @p flags |
+ * |    < 0| same as @ref cmt_io_init_driver   | */
+int cmt_io_init_ex(cmt_io_driver_t *me, int driver, int flags);
+
+/** Initialize @p me with the loopback driver. Release its resources with @ref cmt_io_fini.
+ *
+ * Inputs come from @p callbacks and outputs are handed back to it, without
+ * touching a device or the filesystem. Useful to measure the application
+ * and libcmt overhead alone, on the host or on the target.
+ *
+ * @param [in] me        A uninitialized @ref cmt_io_driver state
+ * @param [in] callbacks input source and output sink, copied into @p me
+ *
+ * @return
+ * |       |                             |
+ * |------:|-----------------------------|
+ * |      0| success                     |
+ * |-EINVAL| missing @p input callback   |
+ * |    < 0| failure with a -errno value | */
+int cmt_io_init_loopback(cmt_io_driver_t *me, const cmt_io_loopback_t *callbacks);
+
+/** Initialize @p me with the mock driver, configured by @p config instead of
+ * the environment. Release its resources with @ref cmt_io_fini.
+ *
+ * Mock instances share no state, any number of them can run at the same time,
+ * each one used by a single thread at a time. Give them different @b
+ * output_log or @b output_dir when their inputs have the same names, and
+ * different @b record and @b cost_report. The recording and cost model
+ * variables of the environment only apply to the instances initialized
+ * without a @p config. @p CMT_TRACE is process wide and best left unset.
+ *
+ * @param [in] me     A uninitialized @ref cmt_io_driver state
+ * @param [in] config inputs, outputs and buffer sizes, NULL to read them from the environment
+ *
+ * @return
+ * |       |                             |
+ * |------:|-----------------------------|
+ * |      0| success                     |
+ * |-EINVAL| unknown @b flags            |
+ * |-ENOSYS| riscv64 library, no mock   |
+ * |    < 0| failure with a -errno value | */
+int cmt_io_init_mock(cmt_io_driver_t *me, const cmt_io_mock_config_t *config);
+
+/** Initialize @p me with the replay driver. Release its resources with @ref cmt_io_fini.
+ *
+ * Each yield is answered with the reply and rx payload recorded for it in
+ * @p filepath (see @ref libcmt_record), as long as the application makes the
+ * same requests in the same order. A request for a different command or
+ * reason fails with -EPROTO, a different amount of data is only counted in
+ * @ref cmt_io_driver_replay_t::mismatches.
+ *
+ * @param [in] me       A uninitialized @ref cmt_io_driver state
+ * @param [in] filepath recording made with @p CMT_IO_RECORD
+ * @param [in] flags    same as @ref cmt_io_init_ex, applied to the buffers and the mapped recording
+ *
+ * @return
+ * |       |                                   |
+ * |------:|-----------------------------------|
+ * |      0| success                           |
+ * |-EINVAL| invalid parameters or not a recording |
+ * |-ENOSYS| riscv64 library, no replay driver |
+ * |    < 0| failure with a -errno value       | */
+int cmt_io_init_replay(cmt_io_driver_t *me, const char *filepath, int flags);
+
 /** Release the driver resources and close the io device.
  *
  * @param [in] me A successfully initialized state by @ref cmt_io_init
@@ -165,4 +580,15 @@ cmt_buf_t cmt_io_get_rx(cmt_io_driver_t *me);
  * - negative errno code on error */
 int cmt_io_yield(cmt_io_driver_t *me, cmt_io_yield_t *rr);
 
+/** Retrieve the yield statistics collected since @ref cmt_io_init
+ *
+ * Each @ref cmt_io_yield is accounted to a kind, with the elapsed time
+ * measured around the yield itself.
+ *
+ * @param [in] me A successfully initialized state by @ref cmt_io_init
+ * @return
+ * - statistics, valid until @ref cmt_io_fini is called.
+ * - NULL if @p me is NULL */
+const cmt_io_stats_t *cmt_io_get_stats(cmt_io_driver_t *me);
+
 #endif /* CMT_IO_H */
@@ -0,0 +1,130 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/** @file
+ * @defgroup libcmt_outlog outlog
+ * Append only log of the mock outputs
+ *
+ * By default the mock writes every output to its own small file. Replaying
+ * a long history that way creates millions of files. With @p CMT_OUTPUT_LOG
+ * the mock appends them, framed, to a single buffered file instead:
+ *
+ * ```
+ * CMT_INPUTS_FILE=inputs.txt CMT_OUTPUT_LOG=outputs.log ./application
+ * ```
+ *
+ * The file is a @ref cmt_outlog_header_t, then one @ref cmt_outlog_record_t
+ * per output, each followed by its payload padded to 8 bytes. @ref
+ * cmt_outlog_close appends an index of the record offsets and a @ref
+ * cmt_outlog_footer_t, for random access. A log without the footer, from a
+ * process that did not finish, can still be read sequentially. All integers
+ * are in native endianness. List and extract the outputs on the host with:
+ *
+ * ```
+ * outlog list outputs.log
+ * outlog extract outputs.log 42 > output.bin
+ * ```
+ *
+ * @ingroup libcmt
+ * @{ */
+#ifndef CMT_OUTLOG_H
+#define CMT_OUTLOG_H
+#include <stddef.h>
+#include <stdint.h>
+
+enum {
+    CMT_OUTLOG_VERSION = 1, /**< file format version */
+    CMT_OUTLOG_ALIGN = 8,   /**< payloads are padded to a multiple of this */
+};
+
+/** Record kinds, the same outputs the mock writes to individual files */
+enum {
+    CMT_OUTLOG_OUTPUT = 0,            /**< `<name>.output-<seq>.bin` */
+    CMT_OUTLOG_REPORT = 1,            /**< `<name>.report-<seq>.bin` */
+    CMT_OUTLOG_EXCEPTION = 2,         /**< `<name>.exception-<seq>.bin` */
+    CMT_OUTLOG_GIO = 3,               /**< `<name>.gio-<seq>.bin` */
+    CMT_OUTLOG_OUTPUTS_ROOT_HASH = 4, /**< `<name>.outputs_root_hash.bin` */
+};
+
+/** File header */
+typedef struct cmt_outlog_header {
+    char magic[8];    /**< `CMTOLOG1` */
+    uint32_t version; /**< @ref CMT_OUTLOG_VERSION */
+    uint32_t pad;     /**< zero */
+} cmt_outlog_header_t;
+
+/** Record header, followed by @b length bytes of payload and padding */
+typedef struct cmt_outlog_record {
+    uint64_t input;  /**< index of the advance or inspect being processed, from 0, UINT64_MAX before the first */
+    uint32_t kind;   /**< @ref CMT_OUTLOG_OUTPUT ... */
+    uint32_t seq;    /**< per input and kind, from 0 */
+    uint32_t length; /**< payload size in bytes */
+    uint32_t pad;    /**< zero */
+} cmt_outlog_record_t;
+
+/** File footer, at the very end */
+typedef struct cmt_outlog_footer {
+    uint64_t index; /**< file offset of @b count uint64_t record offsets */
+    uint64_t count; /**< number of records */
+    char magic[8];  /**< `CMTOLOGX` */
+} cmt_outlog_footer_t;
+
+/** Writer state */
+typedef struct cmt_outlog {
+    void *file;        /**< buffered FILE */
+    uint64_t offset;   /**< bytes written so far */
+    uint64_t *index;   /**< record offsets */
+    uint64_t count;    /**< records written */
+    uint64_t capacity; /**< entries allocated in @b index */
+} cmt_outlog_t;
+
+/** Create the log @p filepath, truncating it
+ *
+ * @param [out] me       uninitialized state
+ * @param [in]  filepath log file
+ *
+ * @return
+ * |   |                             |
+ * |--:|-----------------------------|
+ * |  0| success                     |
+ * |< 0| failure with a -errno value | */
+int cmt_outlog_open(cmt_outlog_t *me, const char *filepath);
+
+/** Append a record
+ *
+ * @param [in,out] me     opened log
+ * @param [in]     record header, @b pad is ignored
+ * @param [in]     data   @b record->length bytes of payload
+ *
+ * @return
+ * |   |                             |
+ * |--:|-----------------------------|
+ * |  0| success                     |
+ * |< 0| failure with a -errno value | */
+int cmt_outlog_append(cmt_outlog_t *me, const cmt_outlog_record_t *record, const void *data);
+
+/** Write the index and footer, then close the log
+ *
+ * @param [in,out] me opened log
+ *
+ * @return
+ * |   |                             |
+ * |--:|-----------------------------|
+ * |  0| success                     |
+ * |< 0| failure with a -errno value | */
+int cmt_outlog_close(cmt_outlog_t *me);
+
+#endif /* CMT_OUTLOG_H */
+/** @} */
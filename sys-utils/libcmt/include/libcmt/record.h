@@ -0,0 +1,129 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/** @file
+ * @defgroup libcmt_record record
+ * Recording of cmio sessions, for deterministic replay
+ *
+ * With @p CMT_IO_RECORD set, @ref cmt_io_yield appends every request, its
+ * reply and the rx payload it delivered to the named file, whatever the
+ * driver. On the machine this captures real traffic, gio responses and
+ * rejections included. @p CMT_IO_RECORD_COMPRESS shrinks the payloads with a
+ * zero run length encoding, which suits ABI encoded data well.
+ *
+ * ```
+ * CMT_IO_RECORD=session.rec CMT_IO_RECORD_COMPRESS=yes ./application
+ * ```
+ *
+ * The replay driver (see @ref cmt_io_init_replay) maps the recording and
+ * answers each yield with the recorded reply, without touching the filesystem
+ * per event, so the application can be rerun and timed against the exact
+ * same inputs:
+ *
+ * ```
+ * CMT_IO_DRIVER=replay CMT_IO_REPLAY=session.rec ./application
+ * ```
+ *
+ * The file is a @ref cmt_record_header_t followed by one event per yield,
+ * until the end of the file. Events are encoded with unsigned LEB128 varints:
+ *
+ * | field        | encoding                                           |
+ * |--------------|----------------------------------------------------|
+ * | cmd          | 1 byte, the request                                |
+ * | reason       | varint, the request                                |
+ * | data         | varint, the request                                |
+ * | rc           | varint, zigzag encoded return of the yield         |
+ * | reason       | varint, the reply, only if rc is 0                 |
+ * | data         | varint, the reply, only if rc is 0                 |
+ * | length       | varint, rx payload size, only if rc is 0           |
+ * | payload      | @b length bytes or, with @ref CMT_RECORD_COMPRESS, pairs of a varint literal count, the literal bytes and a varint zero count until @b length bytes are produced |
+ *
+ * The payload is the first @b data bytes of rx after a manual yield, empty
+ * after an automatic one.
+ *
+ * @ingroup libcmt
+ * @{ */
+#ifndef CMT_RECORD_H
+#define CMT_RECORD_H
+#include "io.h"
+
+enum {
+    CMT_RECORD_VERSION = 1, /**< file format version */
+};
+
+/** Recording flags */
+enum {
+    CMT_RECORD_COMPRESS = 1 << 0, /**< zero run length encoding of the payloads */
+};
+
+/** File header */
+typedef struct cmt_record_header {
+    char magic[8];      /**< `CMTRCRD1` */
+    uint32_t version;   /**< @ref CMT_RECORD_VERSION */
+    uint32_t flags;     /**< @ref CMT_RECORD_COMPRESS */
+    uint64_t tx_length; /**< size of the tx buffer of the recorded session */
+    uint64_t rx_length; /**< size of the rx buffer of the recorded session */
+} cmt_record_header_t;
+
+/** Recording state */
+typedef struct cmt_record {
+    void *file;      /**< FILE being written */
+    int flags;       /**< @ref CMT_RECORD_COMPRESS */
+    uint64_t events; /**< events appended so far */
+} cmt_record_t;
+
+/** Create (or truncate) @p filepath and write the header
+ *
+ * @param [out] me        uninitialized instance
+ * @param [in]  filepath  file to write the recording to
+ * @param [in]  flags     @ref CMT_RECORD_COMPRESS or 0
+ * @param [in]  tx_length size of the tx buffer of the session
+ * @param [in]  rx_length size of the rx buffer of the session
+ *
+ * @return
+ * |       |                             |
+ * |------:|-----------------------------|
+ * |      0| success                     |
+ * |-EINVAL| invalid parameters          |
+ * |    < 0| failure with a -errno value | */
+int cmt_record_open(cmt_record_t *me, const char *filepath, int flags, size_t tx_length, size_t rx_length);
+
+/** Append one yield
+ *
+ * @param [in,out] me      open recording
+ * @param [in]     request the yield as sent
+ * @param [in]     rc      what the yield returned
+ * @param [in]     reply   the yield as returned, ignored if @p rc is not 0
+ * @param [in]     rx      the rx buffer, its first @b reply->data bytes are
+ *                         recorded after a manual yield
+ *
+ * @return
+ * |        |                                    |
+ * |-------:|------------------------------------|
+ * |       0| success                            |
+ * |-ENOBUFS| @b reply->data is larger than @p rx |
+ * |    -EIO| write failure                      |
+ * |-EINVAL | invalid parameters                 | */
+int cmt_record_append(cmt_record_t *me, const cmt_io_yield_t *request, int rc, const cmt_io_yield_t *reply,
+    const cmt_buf_t *rx);
+
+/** Flush and close the file, then release @p me
+ *
+ * @param [in,out] me open recording
+ * @return 0 on success or a negative errno */
+int cmt_record_close(cmt_record_t *me);
+
+#endif /* CMT_RECORD_H */
+/** @} */
@@ -32,13 +32,23 @@
 #ifndef CMT_ROLLUP_H
 #define CMT_ROLLUP_H
 #include "abi.h"
+#include "arena.h"
 #include "io.h"
 #include "merkle.h"
 
+/** Output being written in place, between a reserve and a commit, see @ref cmt_rollup_reserve_notice */
+typedef struct cmt_rollup_reservation {
+    int kind;          /**< 0 when there is none, or the output kind */
+    size_t offset;     /**< of the payload in tx */
+    size_t max_length; /**< payload bytes reserved */
+} cmt_rollup_reservation_t;
+
 typedef struct cmt_rollup {
     union cmt_io_driver io[1];
     uint32_t fromhost_data;
     cmt_merkle_t merkle[1];
+    cmt_arena_t *arena;
+    cmt_rollup_reservation_t reserved;
 } cmt_rollup_t;
 
 /** Public struct with the advance state contents */
@@ -86,6 +96,37 @@ typedef struct cmt_gio {
  * |< 0| failure with a -errno value | */
 int cmt_rollup_init(cmt_rollup_t *me);
 
+/** Initialize a @ref cmt_rollup_t state on top of the loopback io driver.
+ *
+ * Inputs are produced and outputs consumed by @p callbacks, see @ref
+ * cmt_io_init_loopback. Meant for benchmarks and tests of the application
+ * logic, the outputs merkle tree is maintained as usual.
+ *
+ * @param [in] me        uninitialized state
+ * @param [in] callbacks input source and output sink
+ *
+ * @return
+ * |   |                             |
+ * |--:|-----------------------------|
+ * |  0| success                     |
+ * |< 0| failure with a -errno value | */
+int cmt_rollup_init_loopback(cmt_rollup_t *me, const cmt_io_loopback_t *callbacks);
+
+/** Initialize a @ref cmt_rollup_t state on top of a mock io driver of its own.
+ *
+ * Each state gets an independent mock instance, see @ref cmt_io_init_mock, so
+ * a test harness can run many applications on as many threads in one process.
+ *
+ * @param [in] me     uninitialized state
+ * @param [in] config inputs, outputs and buffer sizes, NULL to read them from the environment
+ *
+ * @return
+ * |   |                             |
+ * |--:|-----------------------------|
+ * |  0| success                     |
+ * |< 0| failure with a -errno value | */
+int cmt_rollup_init_mock(cmt_rollup_t *me, const cmt_io_mock_config_t *config);
+
 /** Finalize a @ref cmt_rollup_t state previously initialized with @ref
  * cmt_rollup_init
  *
@@ -96,7 +137,9 @@ void cmt_rollup_fini(cmt_rollup_t *me);
 
 /** Emit a voucher
  *
- * Equivalent to the `Voucher(address,uint256,bytes)` solidity call.
+ * Equivalent to the `Voucher(address,uint256,bytes)` solidity call. The
+ * payload is hashed for the outputs merkle tree as it is copied into the
+ * transmit buffer, a chunk at a time, instead of read again afterwards.
  *
  * @param [in,out] me             initialized @ref cmt_rollup_t instance
  * @param [in]     address        destination data
@@ -140,6 +183,58 @@ int cmt_rollup_emit_delegate_call_voucher(cmt_rollup_t *me, const cmt_abi_addres
  * |< 0| failure with a -errno value | */
 int cmt_rollup_emit_notice(cmt_rollup_t *me, const cmt_abi_bytes_t *payload, uint64_t *index);
 
+/** Emit a voucher with its payload gathered from fragments
+ *
+ * Same as @ref cmt_rollup_emit_voucher, each fragment of @p payload is copied
+ * exactly once into the transmit buffer, and hashed for the outputs merkle
+ * tree while still in cache.
+ *
+ * @param [in,out] me             initialized @ref cmt_rollup_t instance
+ * @param [in]     address        destination data
+ * @param [in]     value          value data
+ * @param [in]     payload        message contents, as fragments
+ * @param [out]    index          index of emitted voucher, if successful
+ *
+ * @return
+ * |   |                             |
+ * |--:|-----------------------------|
+ * |  0| success                     |
+ * |< 0| failure with a -errno value | */
+int cmt_rollup_emit_voucher_iov(cmt_rollup_t *me, const cmt_abi_address_t *address, const cmt_abi_u256_t *value,
+    const cmt_abi_bytes_iov_t *payload, uint64_t *index);
+
+/** Emit a delegate call voucher with its payload gathered from fragments
+ *
+ * Same as @ref cmt_rollup_emit_delegate_call_voucher, see @ref cmt_rollup_emit_voucher_iov.
+ *
+ * @param [in,out] me             initialized @ref cmt_rollup_t instance
+ * @param [in]     address        destination data
+ * @param [in]     payload        message contents, as fragments
+ * @param [out]    index          index of emitted voucher, if successful
+ *
+ * @return
+ * |   |                             |
+ * |--:|-----------------------------|
+ * |  0| success                     |
+ * |< 0| failure with a -errno value | */
+int cmt_rollup_emit_delegate_call_voucher_iov(cmt_rollup_t *me, const cmt_abi_address_t *address,
+    const cmt_abi_bytes_iov_t *payload, uint64_t *index);
+
+/** Emit a notice with its payload gathered from fragments
+ *
+ * Same as @ref cmt_rollup_emit_notice, see @ref cmt_rollup_emit_voucher_iov.
+ *
+ * @param [in,out] me          initialized cmt_rollup_t instance
+ * @param [in]     payload     message contents, as fragments
+ * @param [out]    index       index of emitted notice, if successful
+ *
+ * @return
+ * |   |                             |
+ * |--:|-----------------------------|
+ * |  0| success                     |
+ * |< 0| failure with a -errno value | */
+int cmt_rollup_emit_notice_iov(cmt_rollup_t *me, const cmt_abi_bytes_iov_t *payload, uint64_t *index);
+
 /** Emit a report
  * @param [in,out] me      initialized cmt_rollup_t instance
  * @param [in]     n       sizeof @p data in bytes
@@ -152,6 +247,149 @@ int cmt_rollup_emit_notice(cmt_rollup_t *me, const cmt_abi_bytes_t *payload, uin
  * |< 0| failure with a -errno value | */
 int cmt_rollup_emit_report(cmt_rollup_t *me, const cmt_abi_bytes_t *payload);
 
+/** Emit a report with its contents gathered from fragments
+ *
+ * @param [in,out] me      initialized cmt_rollup_t instance
+ * @param [in]     payload message contents, as fragments
+ *
+ * @return
+ * |   |                             |
+ * |--:|-----------------------------|
+ * |  0| success                     |
+ * |< 0| failure with a -errno value | */
+int cmt_rollup_emit_report_iov(cmt_rollup_t *me, const cmt_abi_bytes_iov_t *payload);
+
+/** Reserve space for the payload of a notice inside the transmit buffer
+ *
+ * The notice is encoded around @p span, which the application fills in place
+ * before @ref cmt_rollup_commit_notice emits it, so large payloads are never
+ * built in a buffer of their own and then copied. Nothing else may be emitted
+ * or yielded in between, they reuse the same buffer: any other emit, gio
+ * request or @ref cmt_rollup_finish drops the reservation and the commit
+ * fails.
+ *
+ * @param [in,out] me         initialized cmt_rollup_t instance
+ * @param [in]     max_length most bytes the payload will take
+ * @param [out]    span       @p max_length writable bytes, where the payload goes
+ *
+ * @return
+ * |        |                                    |
+ * |-------:|------------------------------------|
+ * |       0| success                            |
+ * |-ENOBUFS| @p max_length does not fit in tx   |
+ * |     < 0| failure with a -errno value        | */
+int cmt_rollup_reserve_notice(cmt_rollup_t *me, size_t max_length, cmt_abi_bytes_t *span);
+
+/** Emit the notice reserved by @ref cmt_rollup_reserve_notice
+ *
+ * Sets the payload length to @p length and zeroes its padding.
+ *
+ * @param [in,out] me     initialized cmt_rollup_t instance
+ * @param [in]     length bytes of the span used, up to the reserved maximum
+ * @param [out]    index  index of emitted notice, if successful
+ *
+ * @return
+ * |        |                                                       |
+ * |-------:|-------------------------------------------------------|
+ * |       0| success                                               |
+ * |-EINVAL | no notice reserved, or @p length is past the reserved |
+ * |     < 0| failure with a -errno value                           | */
+int cmt_rollup_commit_notice(cmt_rollup_t *me, size_t length, uint64_t *index);
+
+/** Reserve space for the payload of a voucher inside the transmit buffer
+ *
+ * Same as @ref cmt_rollup_reserve_notice, for @ref cmt_rollup_emit_voucher.
+ *
+ * @param [in,out] me         initialized @ref cmt_rollup_t instance
+ * @param [in]     address    destination data
+ * @param [in]     value      value data
+ * @param [in]     max_length most bytes the payload will take
+ * @param [out]    span       @p max_length writable bytes, where the payload goes
+ *
+ * @return
+ * |        |                                    |
+ * |-------:|------------------------------------|
+ * |       0| success                            |
+ * |-ENOBUFS| @p max_length does not fit in tx   |
+ * |     < 0| failure with a -errno value        | */
+int cmt_rollup_reserve_voucher(cmt_rollup_t *me, const cmt_abi_address_t *address, const cmt_abi_u256_t *value,
+    size_t max_length, cmt_abi_bytes_t *span);
+
+/** Emit the voucher reserved by @ref cmt_rollup_reserve_voucher
+ *
+ * @param [in,out] me     initialized @ref cmt_rollup_t instance
+ * @param [in]     length bytes of the span used, up to the reserved maximum
+ * @param [out]    index  index of emitted voucher, if successful
+ *
+ * @return
+ * |        |                                                        |
+ * |-------:|--------------------------------------------------------|
+ * |       0| success                                                |
+ * |-EINVAL | no voucher reserved, or @p length is past the reserved |
+ * |     < 0| failure with a -errno value                            | */
+int cmt_rollup_commit_voucher(cmt_rollup_t *me, size_t length, uint64_t *index);
+
+/** Reserve space for the payload of a delegate call voucher inside the transmit buffer
+ *
+ * Same as @ref cmt_rollup_reserve_notice, for @ref cmt_rollup_emit_delegate_call_voucher.
+ *
+ * @param [in,out] me         initialized @ref cmt_rollup_t instance
+ * @param [in]     address    destination data
+ * @param [in]     max_length most bytes the payload will take
+ * @param [out]    span       @p max_length writable bytes, where the payload goes
+ *
+ * @return
+ * |        |                                    |
+ * |-------:|------------------------------------|
+ * |       0| success                            |
+ * |-ENOBUFS| @p max_length does not fit in tx   |
+ * |     < 0| failure with a -errno value        | */
+int cmt_rollup_reserve_delegate_call_voucher(cmt_rollup_t *me, const cmt_abi_address_t *address, size_t max_length,
+    cmt_abi_bytes_t *span);
+
+/** Emit the delegate call voucher reserved by @ref cmt_rollup_reserve_delegate_call_voucher
+ *
+ * @param [in,out] me     initialized @ref cmt_rollup_t instance
+ * @param [in]     length bytes of the span used, up to the reserved maximum
+ * @param [out]    index  index of emitted voucher, if successful
+ *
+ * @return
+ * |        |                                                        |
+ * |-------:|--------------------------------------------------------|
+ * |       0| success                                                |
+ * |-EINVAL | no voucher reserved, or @p length is past the reserved |
+ * |     < 0| failure with a -errno value                            | */
+int cmt_rollup_commit_delegate_call_voucher(cmt_rollup_t *me, size_t length, uint64_t *index);
+
+/** Reserve space for a report inside the transmit buffer
+ *
+ * Same as @ref cmt_rollup_reserve_notice, for @ref cmt_rollup_emit_report.
+ *
+ * @param [in,out] me         initialized cmt_rollup_t instance
+ * @param [in]     max_length most bytes the report will take
+ * @param [out]    span       @p max_length writable bytes, where the report goes
+ *
+ * @return
+ * |        |                                    |
+ * |-------:|------------------------------------|
+ * |       0| success                            |
+ * |-ENOBUFS| @p max_length does not fit in tx   |
+ * |     < 0| failure with a -errno value        | */
+int cmt_rollup_reserve_report(cmt_rollup_t *me, size_t max_length, cmt_abi_bytes_t *span);
+
+/** Emit the report reserved by @ref cmt_rollup_reserve_report
+ *
+ * @param [in,out] me     initialized cmt_rollup_t instance
+ * @param [in]     length bytes of the span used, up to the reserved maximum
+ *
+ * @return
+ * |        |                                                       |
+ * |-------:|-------------------------------------------------------|
+ * |       0| success                                               |
+ * |-EINVAL | no report reserved, or @p length is past the reserved |
+ * |     < 0| failure with a -errno value                           | */
+int cmt_rollup_commit_report(cmt_rollup_t *me, size_t length);
+
 /** Emit a exception
  * @param [in,out] me          initialized cmt_rollup_t instance
  * @param [in]     data_length data length in bytes
@@ -203,6 +441,10 @@ int cmt_rollup_read_inspect_state(cmt_rollup_t *me, cmt_rollup_inspect_t *inspec
 /** Finish processing of current advance or inspect.
  * Waits for and returns the next advance or inspect query when available.
  *
+ * The arena registered with @ref cmt_rollup_set_arena, if any, is reset
+ * before the next query is read, whether the current one is accepted or
+ * rejected.
+ *
  * @param [in,out] me      initialized cmt_rollup_t instance
  * @param [in,out] finish  initialized cmt_rollup_finish_t instance
  *
@@ -213,6 +455,14 @@ int cmt_rollup_read_inspect_state(cmt_rollup_t *me, cmt_rollup_inspect_t *inspec
  * |< 0| failure with a -errno value | */
 int cmt_rollup_finish(cmt_rollup_t *me, cmt_rollup_finish_t *finish);
 
+/** Register @p arena to be reset by @ref cmt_rollup_finish after each input
+ *
+ * @param [in,out] me    initialized cmt_rollup_t instance
+ * @param [in]     arena initialized arena, or NULL to unregister
+ *
+ * @note @p arena must outlive @p me or be unregistered. */
+void cmt_rollup_set_arena(cmt_rollup_t *me, cmt_arena_t *arena);
+
 /** Performs a generic IO request
  *
  * @param [in,out] me  initialized cmt_rollup_t instance
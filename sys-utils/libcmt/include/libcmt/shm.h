@@ -0,0 +1,161 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/** @file
+ * @defgroup libcmt_shm shm
+ * Shared memory transport to a host process
+ *
+ * The shm driver hands the yields to a separate host process, a stand in for
+ * the emulator and the node, through memory both of them map. The host
+ * creates a memfd with a @ref cmt_shm_control_t page, tx and rx, listens on a
+ * Unix socket and passes the memfd to the application that connects to it.
+ * From then on a yield only touches the shared memory: the application writes
+ * tx in place and passes the turn to the host, which reads tx in place, writes
+ * rx and passes the turn back. The side left waiting spins for a while, then
+ * sleeps on a futex, or on an eventfd with @ref CMT_SHM_EVENTFD, for hosts
+ * built around poll. The other side only wakes it up if it did fall asleep,
+ * so a busy session makes no copies and no system calls beyond the wakeups.
+ *
+ * ```
+ * shm-host /tmp/host.sock 0:advance.bin 1:inspect.bin &
+ * CMT_MOCK_SHM=/tmp/host.sock ./application
+ * ```
+ *
+ * The host answers every yield with @ref cmt_shm_host_reply, the automatic
+ * ones included, so the application does not overwrite tx before the host
+ * is done with it. When the host has no inputs left it closes the session
+ * and the pending @ref HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED fails with
+ * -ENODATA, as with the mock. The connection stays open for the whole
+ * session, either side notices the other one going away with it.
+ *
+ * @ingroup libcmt
+ * @{ */
+#ifndef CMT_SHM_H
+#define CMT_SHM_H
+#include "io.h"
+
+enum {
+    CMT_SHM_VERSION = 1,           /**< control page layout version */
+    CMT_SHM_CONTROL_LENGTH = 4096, /**< tx starts after the control page */
+};
+
+/** Flags of @ref cmt_shm_host_open */
+enum {
+    CMT_SHM_EVENTFD = 1 << 0, /**< sleep on eventfds instead of the futex, they come with the memfd */
+};
+
+/** Values of @ref cmt_shm_control_t::turn */
+enum {
+    CMT_SHM_APPLICATION = 0, /**< the application runs, the host waits for a yield */
+    CMT_SHM_HOST = 1,        /**< the host handles @b request, the application waits for the reply */
+    CMT_SHM_CLOSED = 2,      /**< the host has no more inputs */
+};
+
+/** Start of the shared memory, integers in native endianness */
+typedef struct cmt_shm_control {
+    char magic[8];          /**< `CMTSHM01` */
+    uint32_t version;       /**< @ref CMT_SHM_VERSION */
+    uint32_t flags;         /**< @ref CMT_SHM_EVENTFD */
+    uint64_t tx_offset;     /**< of tx in the memfd, @ref CMT_SHM_CONTROL_LENGTH */
+    uint64_t rx_offset;     /**< of rx in the memfd, page aligned, after tx */
+    uint32_t tx_length;     /**< size in bytes of tx */
+    uint32_t rx_length;     /**< size in bytes of rx */
+    uint32_t turn;          /**< @ref CMT_SHM_APPLICATION ..., the futex word, only accessed atomically */
+    uint32_t asleep[2];     /**< the application [0] or the host [1] may be blocked waiting for its turn */
+    uint32_t pad;           /**< zero */
+    cmt_io_yield_t request; /**< yield of the application, valid on the host turn */
+    cmt_io_yield_t reply;   /**< @b reason and @b data of the answer, valid on the application turn */
+} cmt_shm_control_t;
+
+typedef struct cmt_shm_host cmt_shm_host_t;
+
+/** Create the shared memory and listen on @p path for the application
+ *
+ * @param [out] me        the host, release it with @ref cmt_shm_host_close
+ * @param [in]  path      Unix socket to create, replaced if it exists
+ * @param [in]  tx_length size in bytes of tx, 0 for 2MB
+ * @param [in]  rx_length size in bytes of rx, 0 for 2MB
+ * @param [in]  flags     @ref CMT_SHM_EVENTFD or 0
+ *
+ * @return
+ * |   |                             |
+ * |--:|-----------------------------|
+ * |  0| success                     |
+ * |< 0| failure with a -errno value | */
+int cmt_shm_host_open(cmt_shm_host_t **me, const char *path, uint32_t tx_length, uint32_t rx_length, int flags);
+
+/** Wait for the application to connect and pass it the shared memory
+ *
+ * @param [in,out] me opened host
+ *
+ * @return
+ * |   |                             |
+ * |--:|-----------------------------|
+ * |  0| success                     |
+ * |< 0| failure with a -errno value | */
+int cmt_shm_host_accept(cmt_shm_host_t *me);
+
+/** Wait for the next yield of the application
+ *
+ * Its payload, if any, is at the start of @ref cmt_shm_host_get_tx. Answer it
+ * with @ref cmt_shm_host_reply.
+ *
+ * @param [in,out] me      host with an application connected
+ * @param [out]    request the yield
+ *
+ * @return
+ * |        |                                  |
+ * |-------:|----------------------------------|
+ * |       0| success                          |
+ * |-EPIPE  | the application went away        |
+ * |-EINVAL | the previous yield has no reply  |
+ * |     < 0| failure with a -errno value      | */
+int cmt_shm_host_wait(cmt_shm_host_t *me, cmt_io_yield_t *request);
+
+/** Answer the yield returned by @ref cmt_shm_host_wait and hand the turn back
+ *
+ * For manual yields, write the input or gio response at the start of @ref
+ * cmt_shm_host_get_rx first. Automatic ones ignore @p reason and @p length.
+ *
+ * @param [in,out] me     host waiting for a reply
+ * @param [in]     reason @ref HTIF_YIELD_REASON_ADVANCE, @ref HTIF_YIELD_REASON_INSPECT or the gio response code
+ * @param [in]     length bytes of rx
+ *
+ * @return
+ * |        |                                  |
+ * |-------:|----------------------------------|
+ * |       0| success                          |
+ * |-EINVAL | no yield to answer               |
+ * |-ENOBUFS| @p length is larger than rx      | */
+int cmt_shm_host_reply(cmt_shm_host_t *me, uint16_t reason, uint32_t length);
+
+/** tx as seen by the host, what the application wrote
+ *
+ * @param [in] me opened host */
+cmt_buf_t cmt_shm_host_get_tx(cmt_shm_host_t *me);
+
+/** rx as seen by the host, where the replies go
+ *
+ * @param [in] me opened host */
+cmt_buf_t cmt_shm_host_get_rx(cmt_shm_host_t *me);
+
+/** End the session, the pending yield of the application fails with -ENODATA,
+ * then release the memory and remove the socket
+ *
+ * @param [in] me opened host, or NULL */
+void cmt_shm_host_close(cmt_shm_host_t *me);
+
+#endif /* CMT_SHM_H */
+/** @} */
@@ -0,0 +1,125 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/** @file
+ * @defgroup libcmt_trace trace
+ * Binary event trace
+ *
+ * A fixed size ring of timestamped events kept in memory while the application
+ * runs. Recording an event is a handful of stores, so tracing barely disturbs
+ * the timing of what is being traced, unlike the @p CMT_DEBUG messages.
+ *
+ * Enable it by naming the output file with @p CMT_TRACE:
+ *
+ * ```
+ * CMT_TRACE=app.trace ./application
+ * ```
+ *
+ * The ring is written to that file by @ref cmt_io_fini, or when the process
+ * is terminated by SIGINT, SIGTERM or SIGABRT. The last
+ * @ref CMT_TRACE_CAPACITY events are kept. Decode it on the host with:
+ *
+ * ```
+ * trace-decode app.trace
+ * ```
+ *
+ * While tracing, the yield messages of @p CMT_DEBUG are not printed.
+ *
+ * @ingroup libcmt
+ * @{ */
+#ifndef CMT_TRACE_H
+#define CMT_TRACE_H
+#include <stdbool.h>
+#include <stdint.h>
+
+enum {
+    CMT_TRACE_CAPACITY = 4096, /**< events kept in the ring, a power of 2 */
+    CMT_TRACE_VERSION = 1,     /**< file format version */
+};
+
+/** Event types */
+enum {
+    CMT_TRACE_YIELD_TOHOST = 1,   /**< yield request: @b cmd, @b reason and @b data */
+    CMT_TRACE_YIELD_FROMHOST = 2, /**< yield reply: @b cmd, @b reason, @b data and @b rc */
+    CMT_TRACE_EMIT = 3,           /**< output emitted: kind in @b cmd, size in @b data and @b rc */
+    CMT_TRACE_FINISH = 4,         /**< next input: type in @b reason, length in @b data and @b rc */
+    CMT_TRACE_ERROR = 5,          /**< failed call: line in src/rollup.c in @b data and @b rc */
+};
+
+/** Kinds of @ref CMT_TRACE_EMIT */
+enum {
+    CMT_TRACE_EMIT_VOUCHER = 1,
+    CMT_TRACE_EMIT_DELEGATE_CALL_VOUCHER = 2,
+    CMT_TRACE_EMIT_NOTICE = 3,
+    CMT_TRACE_EMIT_REPORT = 4,
+    CMT_TRACE_EMIT_EXCEPTION = 5,
+    CMT_TRACE_EMIT_GIO = 6,
+};
+
+/** Clock sources, the unit of @ref cmt_trace_event_t::time */
+enum {
+    CMT_TRACE_CLOCK_NS = 0,     /**< nanoseconds from CLOCK_MONOTONIC */
+    CMT_TRACE_CLOCK_RDTIME = 1, /**< RISC-V `rdtime` ticks */
+};
+
+/** One event, as stored in the ring and in the file (native endianness) */
+typedef struct cmt_trace_event {
+    uint64_t time;   /**< timestamp */
+    uint8_t type;    /**< event type, @ref CMT_TRACE_YIELD_TOHOST ... */
+    uint8_t cmd;     /**< event specific */
+    uint16_t reason; /**< event specific */
+    uint32_t data;   /**< event specific */
+    int32_t rc;      /**< result, 0 or a -errno value */
+    uint32_t pad;    /**< zero */
+} cmt_trace_event_t;
+
+/** File header, followed by @b count events from oldest to newest */
+typedef struct cmt_trace_header {
+    char magic[8];     /**< `CMTTRACE` */
+    uint32_t version;  /**< @ref CMT_TRACE_VERSION */
+    uint32_t clock;    /**< @ref CMT_TRACE_CLOCK_NS or @ref CMT_TRACE_CLOCK_RDTIME */
+    uint64_t total;    /**< events recorded, including the ones overwritten */
+    uint64_t count;    /**< events in the file */
+} cmt_trace_header_t;
+
+/** Enable tracing if @p CMT_TRACE is set, called by @ref cmt_io_init.
+ * Installs the signal handlers that write the trace on abnormal exit.
+ * Counted, every io driver open at the same time shares the one trace. */
+void cmt_trace_init(void);
+
+/** Write the trace to the @p CMT_TRACE file and disable tracing, called by @ref cmt_io_fini.
+ * Only the last of the matching @ref cmt_trace_init calls does it.
+ *
+ * @return
+ * |   |                             |
+ * |--:|-----------------------------|
+ * |  0| success or tracing disabled |
+ * |< 0| failure with a -errno value | */
+int cmt_trace_fini(void);
+
+/** Check if tracing is enabled */
+bool cmt_trace_enabled(void);
+
+/** Record an event, does nothing if tracing is disabled
+ *
+ * @param [in] type   event type
+ * @param [in] cmd    event specific
+ * @param [in] reason event specific
+ * @param [in] data   event specific
+ * @param [in] rc     result */
+void cmt_trace(uint8_t type, uint8_t cmd, uint16_t reason, uint32_t data, int32_t rc);
+
+#endif /* CMT_TRACE_H */
+/** @} */
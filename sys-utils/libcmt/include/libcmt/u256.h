@@ -0,0 +1,174 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/** @file
+ * @defgroup libcmt_u256 u256
+ * 256 bit unsigned integer arithmetic
+ *
+ * @ref cmt_abi_u256_t stores values in the big endian wire format of the EVM,
+ * good for encoding and decoding but not for arithmetic. @ref cmt_u256_t keeps
+ * the same value as four native 64 bit limbs, least significant first.
+ *
+ * Decode straight into limbs, compute, encode back:
+ * @code
+ * ...
+ * cmt_u256_t balance, amount;
+ * if (cmt_u256_get(rd, &amount))
+ *     return -EBADMSG;
+ * if (cmt_u256_sub(&balance, &balance, &amount)) // borrow
+ *     return -ERANGE;
+ * cmt_u256_put(wr, &balance);
+ * ...
+ * @endcode
+ *
+ * Operations are not constant time, do not use them on secrets.
+ *
+ * @ingroup libcmt
+ * @{ */
+#ifndef CMT_U256_H
+#define CMT_U256_H
+#include "abi.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+enum {
+    CMT_U256_LIMBS = 4, /**< number of 64 bit limbs in a @ref cmt_u256_t */
+};
+
+/** 256 bit unsigned integer, as native 64 bit limbs (least significant first) */
+typedef struct cmt_u256 {
+    uint64_t limb[CMT_U256_LIMBS];
+} cmt_u256_t;
+
+/** Set @p me to the value of @p x
+ *
+ * @param [out] me result
+ * @param [in]  x  value */
+void cmt_u256_from_u64(cmt_u256_t *me, uint64_t x);
+
+/** Convert @p me to a uint64_t
+ *
+ * @param [in]  me value
+ * @param [out] x  result
+ *
+ * @return
+ * |        |                                     |
+ * |-------:|-------------------------------------|
+ * |       0| success                             |
+ * |   -EDOM| value not representable in 64 bits  | */
+int cmt_u256_to_u64(const cmt_u256_t *me, uint64_t *x);
+
+/** Convert the big endian @p abi word into limbs
+ *
+ * @param [out] me  result
+ * @param [in]  abi value in the EVM format */
+void cmt_u256_from_abi(cmt_u256_t *me, const cmt_abi_u256_t *abi);
+
+/** Convert the limbs in @p me into a big endian @p abi word
+ *
+ * @param [in]  me  value
+ * @param [out] abi result in the EVM format */
+void cmt_u256_to_abi(const cmt_u256_t *me, cmt_abi_u256_t *abi);
+
+/** Consume and decode a uint256 from the buffer directly into limbs
+ *
+ * @param [in,out] me    initialized buffer
+ * @param [out]    value decoded value
+ *
+ * @return
+ * |        |                        |
+ * |-------:|------------------------|
+ * |       0| success                |
+ * |-ENOBUFS| no space left in @p me | */
+int cmt_u256_get(cmt_buf_t *me, cmt_u256_t *value);
+
+/** Encode a uint256 into the buffer directly from limbs
+ *
+ * @param [in,out] me    initialized buffer
+ * @param [in]     value value to encode
+ *
+ * @return
+ * |        |                        |
+ * |-------:|------------------------|
+ * |       0| success                |
+ * |-ENOBUFS| no space left in @p me | */
+int cmt_u256_put(cmt_buf_t *me, const cmt_u256_t *value);
+
+/** Check if @p me is zero */
+bool cmt_u256_is_zero(const cmt_u256_t *me);
+
+/** Compare @p a and @p b
+ *
+ * @return
+ * - -1 when @p a < @p b
+ * -  0 when @p a == @p b
+ * -  1 when @p a > @p b */
+int cmt_u256_cmp(const cmt_u256_t *a, const cmt_u256_t *b);
+
+/** Compute @p r = @p a + @p b (mod 2^256), @p r may alias the operands
+ *
+ * @return
+ * - true on carry out (overflow) */
+bool cmt_u256_add(cmt_u256_t *r, const cmt_u256_t *a, const cmt_u256_t *b);
+
+/** Compute @p r = @p a - @p b (mod 2^256), @p r may alias the operands
+ *
+ * @return
+ * - true on borrow out (@p a < @p b) */
+bool cmt_u256_sub(cmt_u256_t *r, const cmt_u256_t *a, const cmt_u256_t *b);
+
+/** Compute @p r = @p a * @p b (mod 2^256), @p r may alias the operands
+ *
+ * @return
+ * - true when the full product does not fit in 256 bits */
+bool cmt_u256_mul(cmt_u256_t *r, const cmt_u256_t *a, const cmt_u256_t *b);
+
+/** Compute @p q = @p a / @p b and @p r = @p a % @p b
+ *
+ * @param [out] q quotient (may be NULL)
+ * @param [out] r remainder (may be NULL)
+ * @param [in]  a dividend
+ * @param [in]  b divisor
+ *
+ * @return
+ * |        |                        |
+ * |-------:|------------------------|
+ * |       0| success                |
+ * |   -EDOM| division by zero       | */
+int cmt_u256_divmod(cmt_u256_t *q, cmt_u256_t *r, const cmt_u256_t *a, const cmt_u256_t *b);
+
+/** Compute @p r = floor(@p a * @p b / @p d) with a full 512 bit intermediate product
+ *
+ * @param [out] r result
+ * @param [in]  a multiplicand
+ * @param [in]  b multiplier
+ * @param [in]  d divisor
+ *
+ * @return
+ * |           |                                |
+ * |----------:|--------------------------------|
+ * |          0| success                        |
+ * |      -EDOM| division by zero               |
+ * |-EOVERFLOW | result does not fit in 256 bits| */
+int cmt_u256_muldiv(cmt_u256_t *r, const cmt_u256_t *a, const cmt_u256_t *b, const cmt_u256_t *d);
+
+/** Compute @p r = @p a << @p n, shifts of 256 or more bits result in zero */
+void cmt_u256_shl(cmt_u256_t *r, const cmt_u256_t *a, unsigned n);
+
+/** Compute @p r = @p a >> @p n, shifts of 256 or more bits result in zero */
+void cmt_u256_shr(cmt_u256_t *r, const cmt_u256_t *a, unsigned n);
+
+#endif /* CMT_U256_H */
+/** @} */
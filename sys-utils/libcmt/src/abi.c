@@ -167,6 +167,9 @@ int cmt_abi_reserve_bytes_d(cmt_buf_t *me, cmt_buf_t *of, size_t n, cmt_buf_t *o
     int rc = 0;
     cmt_buf_t tmp[1];
     cmt_buf_t sz[1];
+    if (n > SIZE_MAX - (CMT_ABI_U256_LENGTH - 1)) {
+        return -ENOBUFS;
+    }
     size_t n32 = align_forward(n, CMT_ABI_U256_LENGTH);
 
     rc = cmt_buf_split(me, CMT_ABI_U256_LENGTH, sz, tmp);
@@ -205,6 +208,35 @@ int cmt_abi_put_bytes_d(cmt_buf_t *me, cmt_buf_t *offset, const cmt_buf_t *frame
     return 0;
 }
 
+size_t cmt_abi_bytes_iov_length(const cmt_abi_bytes_iov_t *payload) {
+    size_t length = 0;
+    for (size_t i = 0; i < payload->count; ++i) {
+        if (payload->iov[i].length > SIZE_MAX - length) {
+            return SIZE_MAX;
+        }
+        length += payload->iov[i].length;
+    }
+    return length;
+}
+
+int cmt_abi_put_bytes_d_iov(cmt_buf_t *me, cmt_buf_t *offset, const cmt_buf_t *frame,
+    const cmt_abi_bytes_iov_t *payload) {
+    cmt_buf_t res[1];
+    int rc = cmt_abi_reserve_bytes_d(me, offset, cmt_abi_bytes_iov_length(payload), res, frame->begin);
+    if (rc) {
+        return rc;
+    }
+    uint8_t *p = res->begin;
+    for (size_t i = 0; i < payload->count; ++i) {
+        if (payload->iov[i].length) {
+            // NOLINTNEXTLINE(clang-analyzer-security.insecureAPI.DeprecatedOrUnsafeBufferHandling)
+            memcpy(p, payload->iov[i].data, payload->iov[i].length);
+            p += payload->iov[i].length;
+        }
+    }
+    return 0;
+}
+
 uint32_t cmt_abi_peek_funsel(cmt_buf_t *me) {
     if (cmt_buf_length(me) < 4) {
         return 0;
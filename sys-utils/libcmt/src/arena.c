@@ -0,0 +1,118 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "libcmt/arena.h"
+
+#include <errno.h>
+#include <string.h>
+
+void cmt_arena_init(cmt_arena_t *me, size_t length, void *data) {
+    me->begin = data;
+    me->end = me->begin + length;
+    me->top = me->begin;
+    me->peak = me->begin;
+}
+
+void *cmt_arena_alloc(cmt_arena_t *me, size_t n, size_t align) {
+    if (align == 0) {
+        align = CMT_ARENA_ALIGN;
+    }
+    if (!me || (align & (align - 1))) {
+        return NULL;
+    }
+
+    size_t pad = -(uintptr_t) me->top & (align - 1);
+    size_t left = me->end - me->top;
+    if (pad > left || n > left - pad) {
+        return NULL;
+    }
+
+    uint8_t *p = me->top + pad;
+    me->top = p + n;
+    if (me->top > me->peak) {
+        me->peak = me->top;
+    }
+    return p;
+}
+
+int cmt_arena_alloc_buf(cmt_arena_t *me, size_t n, cmt_buf_t *out) {
+    if (!me || !out) {
+        return -EINVAL;
+    }
+    uint8_t *p = cmt_arena_alloc(me, n, 1);
+    if (!p) {
+        return -ENOBUFS;
+    }
+    cmt_buf_init(out, n, p);
+    return 0;
+}
+
+void *cmt_arena_dup(cmt_arena_t *me, size_t n, const void *data) {
+    if (n == SIZE_MAX) {
+        return NULL;
+    }
+    uint8_t *p = cmt_arena_alloc(me, n + 1, 1);
+    if (!p) {
+        return NULL;
+    }
+    if (n) {
+        memcpy(p, data, n);
+    }
+    p[n] = '\0';
+    return p;
+}
+
+int cmt_arena_get_bytes_d(cmt_arena_t *me, const cmt_buf_t *start, cmt_buf_t of[1], cmt_abi_bytes_t *out) {
+    if (!me || !out) {
+        return -EINVAL;
+    }
+
+    cmt_buf_t bytes[1];
+    int rc = cmt_abi_peek_bytes_d(start, of, bytes);
+    if (rc) {
+        return rc;
+    }
+
+    size_t n = cmt_buf_length(bytes);
+    void *data = cmt_arena_dup(me, n, bytes->begin);
+    if (!data) {
+        return -ENOBUFS;
+    }
+    out->length = n;
+    out->data = data;
+    return 0;
+}
+
+cmt_arena_mark_t cmt_arena_mark(const cmt_arena_t *me) {
+    return (cmt_arena_mark_t){me->top};
+}
+
+void cmt_arena_rewind(cmt_arena_t *me, cmt_arena_mark_t mark) {
+    if (mark.top >= me->begin && mark.top <= me->top) {
+        me->top = mark.top;
+    }
+}
+
+void cmt_arena_reset(cmt_arena_t *me) {
+    me->top = me->begin;
+}
+
+size_t cmt_arena_used(const cmt_arena_t *me) {
+    return me->top - me->begin;
+}
+
+size_t cmt_arena_peak(const cmt_arena_t *me) {
+    return me->peak - me->begin;
+}
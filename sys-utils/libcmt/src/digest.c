@@ -0,0 +1,303 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "libcmt/digest.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    DIGEST_BUFFER_LENGTH = 64 << 10, /**< stdio buffer of the log */
+};
+
+static const char digest_magic[8] = {'C', 'M', 'T', 'D', 'G', 'S', 'T', '1'};
+
+static int digest_reserve(uint64_t **hashes, uint32_t *capacity, uint32_t count) {
+    if (count <= *capacity) {
+        return 0;
+    }
+    uint64_t n = *capacity ? *capacity : 64;
+    while (n < count) {
+        n *= 2;
+    }
+    if (n > UINT32_MAX) {
+        n = UINT32_MAX;
+    }
+    uint64_t *it = realloc(*hashes, n * sizeof(*it));
+    if (!it) {
+        return -ENOMEM;
+    }
+    *hashes = it;
+    *capacity = (uint32_t) n;
+    return 0;
+}
+
+static int digest_read_header(FILE *file) {
+    cmt_digest_header_t header;
+    if (fread(&header, sizeof(header), 1, file) != 1) {
+        return ferror(file) ? -EIO : -EPROTO;
+    }
+    if (memcmp(header.magic, digest_magic, sizeof(digest_magic)) != 0 || header.version != CMT_DIGEST_VERSION) {
+        return -EPROTO;
+    }
+    return 0;
+}
+
+/* next entry of @p file and its output hashes, 1 at the end of the file */
+static int digest_read_entry(FILE *file, cmt_digest_entry_t *entry, uint64_t **hashes, uint32_t *capacity) {
+    size_t n = fread(entry, 1, sizeof(*entry), file);
+    if (n != sizeof(*entry)) {
+        if (ferror(file)) {
+            return -EIO;
+        }
+        return n == 0 ? 1 : -EPROTO;
+    }
+    int rc = digest_reserve(hashes, capacity, entry->count);
+    if (rc) {
+        return rc;
+    }
+    if (fread(*hashes, sizeof(**hashes), entry->count, file) != entry->count) {
+        return ferror(file) ? -EIO : -EPROTO;
+    }
+    return 0;
+}
+
+/* order of inputs in a log, outputs before the first input (UINT64_MAX) come first */
+static bool digest_input_before(uint64_t a, uint64_t b) {
+    return a + 1 < b + 1;
+}
+
+/* first difference between entries at the same position of two logs, false if they are equal */
+static bool digest_diverges(const cmt_digest_entry_t *expected, const uint64_t *expected_hashes,
+    const cmt_digest_entry_t *actual, const uint64_t *actual_hashes, cmt_digest_divergence_t *divergence) {
+    if (expected->input != actual->input) { // one of them has no outputs for an input
+        divergence->input = digest_input_before(expected->input, actual->input) ? expected->input : actual->input;
+        divergence->output = 0;
+        return true;
+    }
+    uint32_t n = expected->count < actual->count ? expected->count : actual->count;
+    uint32_t i = 0;
+    while (i < n && expected_hashes[i] == actual_hashes[i]) {
+        ++i;
+    }
+    if (expected->count == actual->count && memcmp(expected->digest, actual->digest, sizeof(actual->digest)) == 0) {
+        return false;
+    }
+    divergence->input = actual->input;
+    divergence->output = i;
+    return true;
+}
+
+/* close the entry of the current input: write it and compare it with the expected one */
+static int digest_finish(cmt_digest_t *me) {
+    cmt_digest_entry_t *entry = &me->entry;
+    if (!entry->count) {
+        return 0;
+    }
+    cmt_keccak_final(me->state, entry->digest);
+    cmt_keccak_t running[1];
+    cmt_keccak_init(running);
+    cmt_keccak_update(running, sizeof(me->running), me->running);
+    cmt_keccak_update(running, sizeof(entry->digest), entry->digest);
+    cmt_keccak_final(running, entry->running);
+    memcpy(me->running, entry->running, sizeof(me->running));
+
+    uint32_t count = entry->count;
+    entry->count = 0;
+    if (me->file) {
+        cmt_digest_entry_t it = *entry;
+        it.count = count;
+        if (fwrite(&it, sizeof(it), 1, me->file) != 1 ||
+            fwrite(me->hashes, sizeof(*me->hashes), count, me->file) != count) {
+            return -EIO;
+        }
+    }
+
+    if (me->expected && !me->diverged) {
+        cmt_digest_entry_t expected;
+        int rc = digest_read_entry(me->expected, &expected, &me->expected_hashes, &me->expected_capacity);
+        if (rc < 0) {
+            return rc;
+        }
+        cmt_digest_entry_t actual = *entry;
+        actual.count = count;
+        if (rc == 1) { // the expected run has no more outputs
+            me->diverged = true;
+            me->divergence = (cmt_digest_divergence_t){.input = actual.input, .output = 0};
+        } else {
+            me->diverged = digest_diverges(&expected, me->expected_hashes, &actual, me->hashes, &me->divergence);
+        }
+    }
+    return 0;
+}
+
+static void digest_release(cmt_digest_t *me) {
+    if (me->file) {
+        (void) fclose(me->file);
+        me->file = NULL;
+    }
+    if (me->expected) {
+        (void) fclose(me->expected);
+        me->expected = NULL;
+    }
+    free(me->hashes);
+    me->hashes = NULL;
+    me->capacity = 0;
+    free(me->expected_hashes);
+    me->expected_hashes = NULL;
+    me->expected_capacity = 0;
+}
+
+int cmt_digest_open(cmt_digest_t *me, const char *filepath, const char *expected) {
+    if (!me) {
+        return -EINVAL;
+    }
+    memset(me, 0, sizeof(*me));
+
+    if (filepath) {
+        FILE *file = fopen(filepath, "wb");
+        if (!file) {
+            return -errno;
+        }
+        (void) setvbuf(file, NULL, _IOFBF, DIGEST_BUFFER_LENGTH);
+        me->file = file;
+
+        cmt_digest_header_t header = {.version = CMT_DIGEST_VERSION};
+        memcpy(header.magic, digest_magic, sizeof(header.magic));
+        if (fwrite(&header, sizeof(header), 1, file) != 1) {
+            digest_release(me);
+            return -EIO;
+        }
+    }
+
+    if (expected) {
+        FILE *file = fopen(expected, "rb");
+        if (!file) {
+            int rc = -errno;
+            digest_release(me);
+            return rc;
+        }
+        me->expected = file;
+        int rc = digest_read_header(file);
+        if (rc) {
+            digest_release(me);
+            return rc;
+        }
+    }
+    return 0;
+}
+
+int cmt_digest_add(cmt_digest_t *me, uint64_t input, uint32_t kind, uint32_t length, const void *data) {
+    if (!me || (!data && length)) {
+        return -EINVAL;
+    }
+    if (me->entry.count && me->entry.input != input) {
+        int rc = digest_finish(me);
+        if (rc) {
+            return rc;
+        }
+    }
+    if (me->entry.count == UINT32_MAX) {
+        return -ENOBUFS;
+    }
+    int rc = digest_reserve(&me->hashes, &me->capacity, me->entry.count + 1);
+    if (rc) {
+        return rc;
+    }
+    if (!me->entry.count) {
+        cmt_keccak_init(me->state);
+        me->entry.input = input;
+    }
+
+    uint8_t md[CMT_KECCAK_LENGTH];
+    cmt_keccak_t output[1];
+    cmt_keccak_init(output);
+    cmt_keccak_update(output, sizeof(kind), &kind);
+    cmt_keccak_update(output, sizeof(length), &length);
+    cmt_keccak_update(output, length, data);
+    cmt_keccak_final(output, md);
+    cmt_keccak_update(me->state, sizeof(md), md);
+
+    uint64_t hash = 0;
+    memcpy(&hash, md, sizeof(hash));
+    me->hashes[me->entry.count++] = hash;
+    return 0;
+}
+
+int cmt_digest_close(cmt_digest_t *me) {
+    if (!me) {
+        return -EINVAL;
+    }
+    int rc = digest_finish(me);
+    if (!rc && me->expected && !me->diverged) {
+        cmt_digest_entry_t expected;
+        rc = digest_read_entry(me->expected, &expected, &me->expected_hashes, &me->expected_capacity);
+        if (rc == 0) { // the expected run has outputs this one does not
+            me->diverged = true;
+            me->divergence = (cmt_digest_divergence_t){.input = expected.input, .output = 0};
+        }
+        rc = rc < 0 ? rc : 0;
+    }
+    if (me->file && fclose(me->file) && !rc) {
+        rc = -errno;
+    }
+    me->file = NULL;
+    digest_release(me);
+    return rc;
+}
+
+int cmt_digest_compare(const char *expected, const char *actual, cmt_digest_divergence_t *divergence) {
+    if (!expected || !actual || !divergence) {
+        return -EINVAL;
+    }
+    FILE *files[2] = {fopen(expected, "rb"), fopen(actual, "rb")};
+    cmt_digest_entry_t entries[2];
+    uint64_t *hashes[2] = {NULL, NULL};
+    uint32_t capacity[2] = {0, 0};
+    int rc = 0;
+    if (!files[0] || !files[1]) {
+        rc = -errno;
+    }
+    for (int i = 0; i < 2 && !rc; ++i) {
+        rc = digest_read_header(files[i]);
+    }
+
+    while (!rc) {
+        int ends[2];
+        for (int i = 0; i < 2 && !rc; ++i) {
+            ends[i] = digest_read_entry(files[i], &entries[i], &hashes[i], &capacity[i]);
+            rc = ends[i] < 0 ? ends[i] : 0;
+        }
+        if (rc || (ends[0] && ends[1])) {
+            break;
+        }
+        if (ends[0] || ends[1]) { // one of them has outputs for more inputs
+            *divergence = (cmt_digest_divergence_t){.input = entries[ends[0] ? 1 : 0].input, .output = 0};
+            rc = 1;
+        } else if (digest_diverges(&entries[0], hashes[0], &entries[1], hashes[1], divergence)) {
+            rc = 1;
+        }
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        if (files[i]) {
+            (void) fclose(files[i]);
+        }
+        free(hashes[i]);
+    }
+    return rc;
+}
@@ -0,0 +1,233 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "libcmt/eip712.h"
+
+#include <errno.h>
+#include <string.h>
+
+// keccak("EIP712Domain(string name,string version,uint256 chainId,address verifyingContract)")
+static const uint8_t domain_type_hash[CMT_KECCAK_LENGTH] = {
+    // clang-format off
+    0x8b, 0x73, 0xc3, 0xc6, 0x9b, 0xb8, 0xfe, 0x3d, 0x51, 0x2e, 0xcc, 0x4c, 0xf7, 0x59, 0xcc, 0x79,
+    0x23, 0x9f, 0x7b, 0x17, 0x9b, 0x0f, 0xfa, 0xca, 0xa9, 0xa7, 0x5d, 0x52, 0x2b, 0x39, 0x40, 0x0f,
+    // clang-format on
+};
+
+static bool is_digits(const char *s, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        if (s[i] < '0' || s[i] > '9') {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool has_prefix(const char *s, size_t n, const char *prefix, size_t *rest) {
+    size_t k = strlen(prefix);
+    if (n < k || strncmp(s, prefix, k) != 0) {
+        return false;
+    }
+    *rest = k;
+    return true;
+}
+
+static bool is_atomic(const char *s, size_t n) {
+    size_t k = 0;
+    if ((n == 7 && strncmp(s, "address", n) == 0) || (n == 4 && strncmp(s, "bool", n) == 0) ||
+        (n == 6 && strncmp(s, "string", n) == 0)) {
+        return true;
+    }
+    if (has_prefix(s, n, "bytes", &k) || has_prefix(s, n, "uint", &k) || has_prefix(s, n, "int", &k)) {
+        return is_digits(s + k, n - k);
+    }
+    return false;
+}
+
+static int find(const cmt_eip712_t *me, const char *s, size_t n) {
+    for (int i = 0; i < me->count; ++i) {
+        if (strlen(me->types[i].name) == n && strncmp(me->types[i].name, s, n) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* collect the struct types referenced by @p members, including the indirect ones */
+static int dependencies(const cmt_eip712_t *me, const char *members, uint32_t *deps) {
+    *deps = 0;
+    for (const char *p = members; *p;) {
+        const char *end = strchr(p, ',');
+        if (!end) {
+            end = p + strlen(p);
+        }
+        const char *space = memchr(p, ' ', end - p);
+        if (!space || space == p || space + 1 == end) {
+            return -EINVAL;
+        }
+        const char *bracket = memchr(p, '[', space - p);
+        size_t n = (bracket ? bracket : space) - p;
+        if (!is_atomic(p, n)) {
+            int i = find(me, p, n);
+            if (i < 0) {
+                return -ENOENT;
+            }
+            *deps |= (UINT32_C(1) << i) | me->types[i].deps;
+        }
+        p = *end ? end + 1 : end;
+    }
+    return 0;
+}
+
+static void absorb_type(cmt_keccak_t *st, const cmt_eip712_type_t *type) {
+    cmt_keccak_update(st, strlen(type->name), type->name);
+    cmt_keccak_update(st, 1, "(");
+    cmt_keccak_update(st, strlen(type->members), type->members);
+    cmt_keccak_update(st, 1, ")");
+}
+
+/* typeHash = keccak(encodeType), primary type first then its dependencies sorted by name */
+static void type_hash(const cmt_eip712_t *me, cmt_eip712_type_t *type) {
+    int sorted[CMT_EIP712_MAX_TYPES];
+    int n = 0;
+    for (int i = 0; i < me->count; ++i) {
+        if (!(type->deps & (UINT32_C(1) << i))) {
+            continue;
+        }
+        int j = n++;
+        for (; j > 0 && strcmp(me->types[sorted[j - 1]].name, me->types[i].name) > 0; --j) {
+            sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = i;
+    }
+
+    cmt_keccak_t st[1];
+    cmt_keccak_init(st);
+    absorb_type(st, type);
+    for (int i = 0; i < n; ++i) {
+        absorb_type(st, &me->types[sorted[i]]);
+    }
+    cmt_keccak_final(st, type->type_hash);
+}
+
+void cmt_eip712_init(cmt_eip712_t *me) {
+    me->count = 0;
+}
+
+int cmt_eip712_register(cmt_eip712_t *me, const char *name, const char *members, const cmt_eip712_type_t **type) {
+    if (!me || !name || !members || !*name) {
+        return -EINVAL;
+    }
+    if (me->count == CMT_EIP712_MAX_TYPES) {
+        return -ENOBUFS;
+    }
+    if (find(me, name, strlen(name)) >= 0) {
+        return -EINVAL;
+    }
+
+    cmt_eip712_type_t *it = &me->types[me->count];
+    int rc = dependencies(me, members, &it->deps);
+    if (rc) {
+        return rc;
+    }
+    it->name = name;
+    it->members = members;
+    type_hash(me, it);
+    me->count++;
+
+    if (type) {
+        *type = it;
+    }
+    return 0;
+}
+
+const cmt_eip712_type_t *cmt_eip712_find(const cmt_eip712_t *me, const char *name) {
+    if (!me || !name) {
+        return NULL;
+    }
+    int i = find(me, name, strlen(name));
+    return i < 0 ? NULL : &me->types[i];
+}
+
+void cmt_eip712_hash_begin(cmt_keccak_t *st, const cmt_eip712_type_t *type) {
+    cmt_keccak_init(st);
+    cmt_keccak_update(st, CMT_KECCAK_LENGTH, type->type_hash);
+}
+
+void cmt_eip712_hash_end(cmt_keccak_t *st, uint8_t hash[CMT_KECCAK_LENGTH]) {
+    cmt_keccak_final(st, hash);
+}
+
+void cmt_eip712_array_begin(cmt_keccak_t *st) {
+    cmt_keccak_init(st);
+}
+
+int cmt_eip712_put_uint(cmt_keccak_t *st, size_t n, const void *data) {
+    uint8_t word[CMT_ABI_U256_LENGTH];
+    int rc = cmt_abi_encode_uint(n, data, word);
+    if (rc) {
+        return rc;
+    }
+    cmt_keccak_update(st, sizeof(word), word);
+    return 0;
+}
+
+void cmt_eip712_put_u256(cmt_keccak_t *st, const cmt_abi_u256_t *value) {
+    cmt_keccak_update(st, sizeof(value->data), value->data);
+}
+
+void cmt_eip712_put_address(cmt_keccak_t *st, const cmt_abi_address_t *address) {
+    static const uint8_t zeros[CMT_ABI_U256_LENGTH - CMT_ABI_ADDRESS_LENGTH] = {0};
+    cmt_keccak_update(st, sizeof(zeros), zeros);
+    cmt_keccak_update(st, sizeof(address->data), address->data);
+}
+
+void cmt_eip712_put_bool(cmt_keccak_t *st, bool value) {
+    uint8_t word[CMT_ABI_U256_LENGTH] = {0};
+    word[CMT_ABI_U256_LENGTH - 1] = !!value;
+    cmt_keccak_update(st, sizeof(word), word);
+}
+
+void cmt_eip712_put_bytes(cmt_keccak_t *st, const cmt_abi_bytes_t *value) {
+    uint8_t hash[CMT_KECCAK_LENGTH];
+    cmt_keccak_data(value->length, value->data, hash);
+    cmt_keccak_update(st, sizeof(hash), hash);
+}
+
+void cmt_eip712_put_hash(cmt_keccak_t *st, const uint8_t hash[CMT_KECCAK_LENGTH]) {
+    cmt_keccak_update(st, CMT_KECCAK_LENGTH, hash);
+}
+
+void cmt_eip712_domain(uint8_t separator[CMT_KECCAK_LENGTH], const cmt_abi_bytes_t *name,
+    const cmt_abi_bytes_t *version, uint64_t chain_id, const cmt_abi_address_t *verifying_contract) {
+    cmt_keccak_t st[1];
+    cmt_keccak_init(st);
+    cmt_keccak_update(st, sizeof(domain_type_hash), domain_type_hash);
+    cmt_eip712_put_bytes(st, name);
+    cmt_eip712_put_bytes(st, version);
+    (void) cmt_eip712_put_uint(st, sizeof(chain_id), &chain_id);
+    cmt_eip712_put_address(st, verifying_contract);
+    cmt_keccak_final(st, separator);
+}
+
+void cmt_eip712_digest(const uint8_t separator[CMT_KECCAK_LENGTH], const uint8_t hash[CMT_KECCAK_LENGTH],
+    uint8_t digest[CMT_KECCAK_LENGTH]) {
+    cmt_keccak_t st[1];
+    cmt_keccak_init(st);
+    cmt_keccak_update(st, 2, "\x19\x01");
+    cmt_keccak_update(st, CMT_KECCAK_LENGTH, separator);
+    cmt_keccak_update(st, CMT_KECCAK_LENGTH, hash);
+    cmt_keccak_final(st, digest);
+}
@@ -0,0 +1,508 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "libcmt/giostore.h"
+#include "libcmt/keccak.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+enum {
+    GIOSTORE_BUCKETS = 4096,     /**< hash table of the cache, a power of two */
+    GIOSTORE_ALIGN = 8,          /**< pack responses are padded to a multiple of this */
+    GIOSTORE_COPY = 64 << 10,    /**< copy buffer of @ref cmt_giostore_pack */
+    GIOSTORE_PATH_LENGTH = 4096, /**< directory and file name */
+};
+
+/** a cached response, linked into its bucket and into the LRU list */
+struct giostore_node {
+    struct giostore_node *prev;  /**< more recently used */
+    struct giostore_node *next;  /**< less recently used */
+    struct giostore_node *chain; /**< next in the same bucket */
+    uint8_t key[CMT_GIOSTORE_KEY_LENGTH];
+    uint16_t domain;
+    size_t length;
+    uint8_t data[];
+};
+
+struct cmt_giostore {
+    /* pack */
+    uint8_t *map;                      /**< the pack, mapped read only, NULL for a directory */
+    size_t map_length;                 /**< size in bytes of @b map */
+    const cmt_giostore_entry_t *index; /**< sorted entries */
+    uint32_t count;                    /**< number of entries */
+    /* directory */
+    char *dir;                      /**< directory path */
+    struct giostore_node *head;     /**< most recently used */
+    struct giostore_node *tail;     /**< least recently used, evicted first */
+    struct giostore_node *uncached; /**< last response larger than the whole cache */
+    size_t used;                    /**< bytes of cached responses */
+    size_t capacity;                /**< limit of @b used */
+    struct giostore_node *buckets[GIOSTORE_BUCKETS];
+    cmt_giostore_stats_t stats;
+};
+
+static void giostore_hex(const uint8_t key[CMT_GIOSTORE_KEY_LENGTH], char *out) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < CMT_GIOSTORE_KEY_LENGTH; ++i) {
+        out[2 * i + 0] = digits[key[i] >> 4];
+        out[2 * i + 1] = digits[key[i] & 0xf];
+    }
+    out[2 * CMT_GIOSTORE_KEY_LENGTH] = '\0';
+}
+
+static void giostore_filename(uint16_t domain, const uint8_t key[CMT_GIOSTORE_KEY_LENGTH], char *name) {
+    char hex[2 * CMT_GIOSTORE_KEY_LENGTH + 1];
+    giostore_hex(key, hex);
+    // NOLINTNEXTLINE(cert-err33-c, clang-analyzer-security.insecureAPI.DeprecatedOrUnsafeBufferHandling)
+    snprintf(name, CMT_GIOSTORE_NAME_LENGTH, "%u-%s.bin", (unsigned) domain, hex);
+}
+
+/* order of the pack index, by domain then key */
+static int giostore_compare(uint16_t domain, const uint8_t *key, const cmt_giostore_entry_t *entry) {
+    if (domain != entry->domain) {
+        return domain < entry->domain ? -1 : 1;
+    }
+    return memcmp(key, entry->key, CMT_GIOSTORE_KEY_LENGTH);
+}
+
+static int giostore_sort(const void *a, const void *b) {
+    const cmt_giostore_entry_t *x = a;
+    return giostore_compare(x->domain, x->key, b);
+}
+
+static int giostore_open_pack(cmt_giostore_t *me, int fd, size_t length) {
+    if (length < sizeof(cmt_giostore_header_t)) {
+        return -EPROTO;
+    }
+    void *p = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+        return -errno;
+    }
+    me->map = p;
+    me->map_length = length;
+
+    const cmt_giostore_header_t *header = p;
+    if (memcmp(header->magic, "CMTGIOP1", sizeof(header->magic)) != 0 || header->version != CMT_GIOSTORE_VERSION ||
+        header->count > (length - sizeof(*header)) / sizeof(cmt_giostore_entry_t)) {
+        return -EPROTO;
+    }
+    me->index = (const cmt_giostore_entry_t *) (header + 1);
+    me->count = header->count;
+
+    // checked once here, so lookups can trust the index
+    for (uint32_t i = 0; i < me->count; ++i) {
+        const cmt_giostore_entry_t *it = &me->index[i];
+        if (it->offset > length || it->length > length - it->offset) {
+            return -EPROTO;
+        }
+        if (i && giostore_compare(it->domain, it->key, &me->index[i - 1]) <= 0) {
+            return -EPROTO;
+        }
+    }
+    return 0;
+}
+
+int cmt_giostore_open(cmt_giostore_t **me, const char *path, size_t cache_length) {
+    if (!me || !path) {
+        return -EINVAL;
+    }
+
+    cmt_giostore_t *it = calloc(1, sizeof(*it));
+    if (!it) {
+        return -ENOMEM;
+    }
+    it->capacity = cache_length;
+
+    int rc = 0;
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st)) {
+        rc = -errno;
+    } else if (S_ISDIR(st.st_mode)) {
+        it->dir = strdup(path);
+        rc = it->dir ? 0 : -ENOMEM;
+    } else {
+        rc = giostore_open_pack(it, fd, st.st_size);
+    }
+    if (fd >= 0) {
+        (void) close(fd);
+    }
+    if (rc) {
+        cmt_giostore_close(it);
+        return rc;
+    }
+    *me = it;
+    return 0;
+}
+
+static const cmt_giostore_entry_t *giostore_search(const cmt_giostore_t *me, uint16_t domain, const uint8_t *key) {
+    size_t lo = 0;
+    size_t hi = me->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int c = giostore_compare(domain, key, &me->index[mid]);
+        if (c == 0) {
+            return &me->index[mid];
+        }
+        if (c < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return NULL;
+}
+
+static struct giostore_node **giostore_bucket(cmt_giostore_t *me, uint16_t domain, const uint8_t *key) {
+    // the key is a hash already
+    uint32_t h = ((uint32_t) key[0] | (uint32_t) key[1] << 8 | (uint32_t) key[2] << 16) ^ domain;
+    return &me->buckets[h & (GIOSTORE_BUCKETS - 1)];
+}
+
+static void giostore_unlink(cmt_giostore_t *me, struct giostore_node *node) {
+    if (node->prev) {
+        node->prev->next = node->next;
+    } else {
+        me->head = node->next;
+    }
+    if (node->next) {
+        node->next->prev = node->prev;
+    } else {
+        me->tail = node->prev;
+    }
+}
+
+static void giostore_push_front(cmt_giostore_t *me, struct giostore_node *node) {
+    node->prev = NULL;
+    node->next = me->head;
+    if (me->head) {
+        me->head->prev = node;
+    } else {
+        me->tail = node;
+    }
+    me->head = node;
+}
+
+static void giostore_evict(cmt_giostore_t *me) {
+    struct giostore_node *node = me->tail;
+    struct giostore_node **p = giostore_bucket(me, node->domain, node->key);
+    while (*p != node) {
+        p = &(*p)->chain;
+    }
+    *p = node->chain;
+    giostore_unlink(me, node);
+    me->used -= node->length;
+    me->stats.evicted++;
+    free(node);
+}
+
+static int giostore_read(cmt_giostore_t *me, uint16_t domain, const uint8_t *key, struct giostore_node **out) {
+    char name[CMT_GIOSTORE_NAME_LENGTH];
+    char path[GIOSTORE_PATH_LENGTH];
+    giostore_filename(domain, key, name);
+    if (snprintf(path, sizeof path, "%s/%s", me->dir, name) >= (int) sizeof path) {
+        return -ENAMETOOLONG;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -errno;
+    }
+    int rc = 0;
+    struct stat st;
+    struct giostore_node *node = NULL;
+    if (fstat(fd, &st)) {
+        rc = -errno;
+    } else if (!(node = malloc(sizeof(*node) + st.st_size))) {
+        rc = -ENOMEM;
+    } else {
+        node->length = st.st_size;
+        for (size_t n = 0; rc == 0 && n < node->length;) {
+            ssize_t k = read(fd, node->data + n, node->length - n);
+            if (k < 0 && errno != EINTR) {
+                rc = -errno;
+            } else if (k == 0) {
+                rc = -EIO;
+            } else if (k > 0) {
+                n += k;
+            }
+        }
+    }
+    (void) close(fd);
+    if (rc) {
+        free(node);
+        return rc;
+    }
+    memcpy(node->key, key, CMT_GIOSTORE_KEY_LENGTH);
+    node->domain = domain;
+    *out = node;
+    return 0;
+}
+
+static int giostore_find_dir(cmt_giostore_t *me, uint16_t domain, const uint8_t *key, struct giostore_node **out) {
+    struct giostore_node **bucket = giostore_bucket(me, domain, key);
+    for (struct giostore_node *it = *bucket; it; it = it->chain) {
+        if (it->domain == domain && memcmp(it->key, key, CMT_GIOSTORE_KEY_LENGTH) == 0) {
+            giostore_unlink(me, it);
+            giostore_push_front(me, it);
+            me->stats.cached++;
+            *out = it;
+            return 0;
+        }
+    }
+
+    struct giostore_node *node = NULL;
+    int rc = giostore_read(me, domain, key, &node);
+    if (rc) {
+        return rc;
+    }
+    free(me->uncached);
+    me->uncached = NULL;
+    if (node->length > me->capacity) { // would flush everything else and still not fit
+        me->uncached = node;
+        *out = node;
+        return 0;
+    }
+    while (me->used + node->length > me->capacity) {
+        giostore_evict(me);
+    }
+    node->chain = *bucket;
+    *bucket = node;
+    giostore_push_front(me, node);
+    me->used += node->length;
+    *out = node;
+    return 0;
+}
+
+int cmt_giostore_find(cmt_giostore_t *me, uint16_t domain, size_t id_length, const void *id, const void **data,
+    size_t *length) {
+    if (!me || (!id && id_length) || !data || !length) {
+        return -EINVAL;
+    }
+    me->stats.lookups++;
+
+    uint8_t key[CMT_KECCAK_LENGTH];
+    cmt_keccak_data(id_length, id, key);
+
+    if (me->map) {
+        const cmt_giostore_entry_t *entry = giostore_search(me, domain, key);
+        if (!entry) {
+            return -ENOENT;
+        }
+        me->stats.found++;
+        *data = me->map + entry->offset;
+        *length = entry->length;
+        return 0;
+    }
+
+    struct giostore_node *node = NULL;
+    int rc = giostore_find_dir(me, domain, key, &node);
+    if (rc) {
+        return rc;
+    }
+    me->stats.found++;
+    *data = node->data;
+    *length = node->length;
+    return 0;
+}
+
+const cmt_giostore_stats_t *cmt_giostore_get_stats(const cmt_giostore_t *me) {
+    return &me->stats;
+}
+
+void cmt_giostore_close(cmt_giostore_t *me) {
+    if (!me) {
+        return;
+    }
+    while (me->tail) {
+        giostore_evict(me);
+    }
+    free(me->uncached);
+    free(me->dir);
+    if (me->map) {
+        munmap(me->map, me->map_length);
+    }
+    free(me);
+}
+
+/* `<domain>-<keccak(id)>.bin`, in the canonical form of @ref giostore_filename */
+static bool giostore_parse(const char *name, cmt_giostore_entry_t *entry) {
+    char *end = NULL;
+    unsigned long domain = strtoul(name, &end, 10);
+    if (end == name || *end != '-' || domain > UINT16_MAX ||
+        strlen(end + 1) != 2 * CMT_GIOSTORE_KEY_LENGTH + strlen(".bin")) {
+        return false;
+    }
+    for (size_t i = 0; i < CMT_GIOSTORE_KEY_LENGTH; ++i) {
+        unsigned byte = 0;
+        // NOLINTNEXTLINE(cert-err34-c)
+        if (sscanf(end + 1 + 2 * i, "%2x", &byte) != 1) {
+            return false;
+        }
+        entry->key[i] = byte;
+    }
+    entry->domain = domain;
+
+    char canonical[CMT_GIOSTORE_NAME_LENGTH];
+    giostore_filename(entry->domain, entry->key, canonical);
+    return strcmp(name, canonical) == 0;
+}
+
+static int giostore_list(const char *dir, cmt_giostore_entry_t **entries, uint32_t *count) {
+    DIR *d = opendir(dir);
+    if (!d) {
+        return -errno;
+    }
+
+    int rc = 0;
+    size_t capacity = 0;
+    *entries = NULL;
+    *count = 0;
+    for (struct dirent *de = readdir(d); de && rc == 0; de = readdir(d)) {
+        cmt_giostore_entry_t entry = {0};
+        if (!giostore_parse(de->d_name, &entry)) {
+            continue;
+        }
+
+        char path[GIOSTORE_PATH_LENGTH];
+        struct stat st;
+        if (snprintf(path, sizeof path, "%s/%s", dir, de->d_name) >= (int) sizeof path) {
+            rc = -ENAMETOOLONG;
+        } else if (stat(path, &st)) {
+            rc = -errno;
+        } else if (*count == UINT32_MAX) {
+            rc = -EFBIG;
+        } else if (*count == capacity) {
+            capacity = capacity ? 2 * capacity : 64;
+            cmt_giostore_entry_t *p = realloc(*entries, capacity * sizeof(*p));
+            if (!p) {
+                rc = -ENOMEM;
+            } else {
+                *entries = p;
+            }
+        }
+        if (rc == 0) {
+            entry.length = st.st_size;
+            (*entries)[(*count)++] = entry;
+        }
+    }
+    (void) closedir(d);
+    if (rc) {
+        free(*entries);
+        *entries = NULL;
+    }
+    return rc;
+}
+
+static int giostore_copy(FILE *out, const char *dir, const cmt_giostore_entry_t *entry, uint8_t *buffer) {
+    char name[CMT_GIOSTORE_NAME_LENGTH];
+    char path[GIOSTORE_PATH_LENGTH];
+    giostore_filename(entry->domain, entry->key, name);
+    if (snprintf(path, sizeof path, "%s/%s", dir, name) >= (int) sizeof path) {
+        return -ENAMETOOLONG;
+    }
+    FILE *in = fopen(path, "rb");
+    if (!in) {
+        return -errno;
+    }
+
+    int rc = 0;
+    uint64_t left = entry->length;
+    while (rc == 0 && left) {
+        size_t n = left < GIOSTORE_COPY ? left : GIOSTORE_COPY;
+        if (fread(buffer, 1, n, in) != n) {
+            rc = -EIO; // changed since it was listed
+        } else if (fwrite(buffer, 1, n, out) != n) {
+            rc = -EIO;
+        }
+        left -= n;
+    }
+    (void) fclose(in);
+
+    static const uint8_t zeros[GIOSTORE_ALIGN] = {0};
+    size_t pad = -entry->length & (GIOSTORE_ALIGN - 1);
+    if (rc == 0 && pad && fwrite(zeros, 1, pad, out) != pad) {
+        rc = -EIO;
+    }
+    return rc;
+}
+
+int cmt_giostore_pack(const char *dir, const char *path) {
+    if (!dir || !path) {
+        return -EINVAL;
+    }
+
+    cmt_giostore_entry_t *entries = NULL;
+    uint32_t count = 0;
+    int rc = giostore_list(dir, &entries, &count);
+    if (rc) {
+        return rc;
+    }
+    if (count) {
+        qsort(entries, count, sizeof(*entries), giostore_sort);
+    }
+
+    uint64_t offset = sizeof(cmt_giostore_header_t) + (uint64_t) count * sizeof(cmt_giostore_entry_t);
+    for (uint32_t i = 0; i < count; ++i) {
+        entries[i].offset = offset;
+        offset += (entries[i].length + GIOSTORE_ALIGN - 1) & ~(uint64_t) (GIOSTORE_ALIGN - 1);
+    }
+
+    uint8_t *buffer = malloc(GIOSTORE_COPY);
+    FILE *out = fopen(path, "wb");
+    if (!buffer) {
+        rc = -ENOMEM;
+    } else if (!out) {
+        rc = -errno;
+    }
+
+    cmt_giostore_header_t header = {
+        .magic = {'C', 'M', 'T', 'G', 'I', 'O', 'P', '1'},
+        .version = CMT_GIOSTORE_VERSION,
+        .count = count,
+    };
+    if (rc == 0 && (fwrite(&header, sizeof(header), 1, out) != 1 ||
+                       (count && fwrite(entries, sizeof(*entries), count, out) != count))) {
+        rc = -EIO;
+    }
+    for (uint32_t i = 0; rc == 0 && i < count; ++i) {
+        rc = giostore_copy(out, dir, &entries[i], buffer);
+    }
+    if (out && fclose(out) && rc == 0) {
+        rc = -EIO;
+    }
+    if (rc && out) {
+        (void) remove(path);
+    }
+    free(buffer);
+    free(entries);
+    return rc;
+}
+
+void cmt_giostore_name(uint16_t domain, size_t id_length, const void *id, char *name) {
+    uint8_t key[CMT_KECCAK_LENGTH];
+    cmt_keccak_data(id_length, id, key);
+    giostore_filename(domain, key, name);
+}
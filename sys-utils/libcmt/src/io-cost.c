@@ -0,0 +1,224 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "io-cost.h"
+#include "io-stats.h"
+#include "libcmt/util.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define COST_SEPARATORS ", ;\t\r\n"
+
+enum {
+    COST_FILE_LENGTH = 64 << 10, /**< largest @p CMT_IO_COST_FILE */
+    COST_ENTRY_LENGTH = 128,     /**< longest `<kind>=<fixed>+<per-byte>` entry */
+};
+
+struct cmt_io_cost {
+    double fixed_ns[CMT_IO_STATS_KINDS]; /**< per yield */
+    double byte_ns[CMT_IO_STATS_KINDS];  /**< per byte sent or received */
+    bool sleep;                          /**< @b cost_sleep, sleep for the modeled cost */
+    FILE *report;                        /**< per input totals, @b cost_report or stderr */
+    bool started;                        /**< an input was loaded */
+    uint64_t input;                      /**< index of the input being processed */
+    uint64_t yields;                     /**< yields of that input so far */
+    uint64_t input_ns;                   /**< and their modeled cost */
+};
+
+/* `<kind>=<fixed>[+<per-byte>]`, in nanoseconds, `yield` sets every kind */
+static int cost_entry(cmt_io_cost_t *me, const char *entry, size_t length) {
+    char s[COST_ENTRY_LENGTH];
+    if (length >= sizeof s) {
+        return -EINVAL;
+    }
+    memcpy(s, entry, length);
+    s[length] = '\0';
+
+    char *eq = strchr(s, '=');
+    if (!eq) {
+        return -EINVAL;
+    }
+    int kind = cmt_io_stats_kind_from_name(s, eq - s);
+    bool all = (size_t) (eq - s) == strlen("yield") && strncmp(s, "yield", eq - s) == 0;
+    if (kind < 0 && !all) {
+        return -EINVAL;
+    }
+
+    char *end = NULL;
+    double byte_ns = 0;
+    double fixed_ns = strtod(eq + 1, &end);
+    if (end == eq + 1) {
+        return -EINVAL;
+    }
+    if (*end == '+') {
+        const char *start = end + 1;
+        byte_ns = strtod(start, &end);
+        if (end == start) {
+            return -EINVAL;
+        }
+    }
+    if (*end || !(fixed_ns >= 0) || !(byte_ns >= 0)) {
+        return -EINVAL;
+    }
+
+    for (int k = 0; k < CMT_IO_STATS_KINDS; ++k) {
+        if (all || k == kind) {
+            me->fixed_ns[k] = fixed_ns;
+            me->byte_ns[k] = byte_ns;
+        }
+    }
+    return 0;
+}
+
+/* entries separated by commas, spaces or lines, `#` comments to the end of the line */
+static int cost_parse(cmt_io_cost_t *me, const char *spec, const char *origin) {
+    for (const char *p = spec; *p;) {
+        if (*p == '#') {
+            p += strcspn(p, "\n");
+            continue;
+        }
+        size_t n = strcspn(p, COST_SEPARATORS "#");
+        if (n == 0) {
+            p++;
+            continue;
+        }
+        if (cost_entry(me, p, n)) {
+            (void) fprintf(stderr, "invalid %s entry \"%.*s\"\n", origin, (int) n, p);
+            return -EINVAL;
+        }
+        p += n;
+    }
+    return 0;
+}
+
+static int cost_load(cmt_io_cost_t *me, const char *filepath) {
+    char *spec = malloc(COST_FILE_LENGTH + 1);
+    if (!spec) {
+        return -ENOMEM;
+    }
+    size_t length = 0;
+    int rc = cmt_util_read_whole_file(filepath, COST_FILE_LENGTH, spec, &length);
+    if (rc) {
+        (void) fprintf(stderr, "failed to read \"%s\". %s\n", filepath, strerror(-rc));
+    } else {
+        spec[length] = '\0';
+        rc = cost_parse(me, spec, filepath);
+    }
+    free(spec);
+    return rc;
+}
+
+int cmt_io_cost_open(cmt_io_cost_t **me, const cmt_io_mock_config_t *config) {
+    const char *filepath = config->cost_file;
+    const char *spec = config->cost;
+    *me = NULL;
+    if (!filepath && !spec) {
+        return 0;
+    }
+
+    cmt_io_cost_t *it = calloc(1, sizeof(*it));
+    if (!it) {
+        return -ENOMEM;
+    }
+    int rc = 0;
+    if (filepath) {
+        rc = cost_load(it, filepath);
+    }
+    if (rc == 0 && spec) { // on top of the file
+        rc = cost_parse(it, spec, "CMT_IO_COST");
+    }
+    if (rc) {
+        free(it);
+        return rc;
+    }
+
+    const char *report = config->cost_report;
+    it->report = stderr;
+    if (report) {
+        it->report = fopen(report, "w");
+        if (!it->report) {
+            rc = -errno;
+            (void) fprintf(stderr, "failed to open \"%s\". %s\n", report, strerror(-rc));
+            free(it);
+            return rc;
+        }
+    }
+    (void) fprintf(it->report, "input,yields,modeled_ns\n");
+    it->sleep = config->cost_sleep;
+    *me = it;
+    return 0;
+}
+
+static void cost_sleep(uint64_t ns) {
+    struct timespec ts = {
+        .tv_sec = (time_t) (ns / 1000000000),
+        .tv_nsec = (long) (ns % 1000000000),
+    };
+    while (clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, &ts) == EINTR) {
+        ;
+    }
+}
+
+/* the input being processed is done, accepted or rejected */
+static void cost_report(cmt_io_cost_t *me) {
+    if (me->started) {
+        (void) fprintf(me->report, "%llu,%llu,%llu\n", (unsigned long long) me->input,
+            (unsigned long long) me->yields, (unsigned long long) me->input_ns);
+        me->input++;
+    }
+    me->started = true;
+    me->yields = 0;
+    me->input_ns = 0;
+}
+
+uint64_t cmt_io_cost_apply(cmt_io_cost_t *me, const cmt_io_yield_t *req, const cmt_io_yield_t *rep, int rc) {
+    int k = cmt_io_stats_kind_of(req);
+    bool finish = k == CMT_IO_STATS_RX_ACCEPTED || k == CMT_IO_STATS_RX_REJECTED;
+
+    // the same bytes as cmt_io_stats_kind_t::tx_bytes and rx_bytes
+    uint64_t bytes = k != CMT_IO_STATS_PROGRESS ? req->data : 0;
+    if (rc == 0 && (finish || k == CMT_IO_STATS_GIO)) {
+        bytes += rep->data;
+    }
+    double ns = me->fixed_ns[k] + me->byte_ns[k] * (double) bytes;
+    uint64_t cost = (uint64_t) (ns + 0.5);
+    if (me->sleep && cost) {
+        cost_sleep(cost);
+    }
+
+    me->yields++;
+    me->input_ns += cost;
+    if (finish) {
+        cost_report(me);
+    }
+    return cost;
+}
+
+void cmt_io_cost_close(cmt_io_cost_t *me) {
+    if (!me) {
+        return;
+    }
+    if (me->started && me->yields) {
+        cost_report(me);
+    }
+    if (me->report != stderr) {
+        (void) fclose(me->report);
+    }
+    free(me);
+}
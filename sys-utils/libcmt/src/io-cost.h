@@ -0,0 +1,40 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* Yield cost model of the host drivers, see @p CMT_IO_COST, not part of the public API */
+#ifndef CMT_IO_COST_H
+#define CMT_IO_COST_H
+#include "libcmt/io.h"
+
+typedef struct cmt_io_cost cmt_io_cost_t;
+
+/** Load the model of @b cost_file and @b cost of @p config, see @p CMT_IO_COST
+ *
+ * @param [out] me     model, release it with @ref cmt_io_cost_close, NULL when neither is set
+ * @param [in]  config the @b cost, @b cost_file, @b cost_report and @b cost_sleep of the instance
+ * @return 0 on success, -EINVAL for a malformed model or a negative errno */
+int cmt_io_cost_open(cmt_io_cost_t **me, const cmt_io_mock_config_t *config);
+
+/** Cost of the yield of request @p req and reply @p rep, that returned @p rc.
+ * Sleeps for it with @b cost_sleep, reports the input total
+ * when @p req accepts or rejects one.
+ *
+ * @return modeled cost in nanoseconds */
+uint64_t cmt_io_cost_apply(cmt_io_cost_t *me, const cmt_io_yield_t *req, const cmt_io_yield_t *rep, int rc);
+
+/** Report the last input, if it has yields of its own, and release @p me */
+void cmt_io_cost_close(cmt_io_cost_t *me);
+
+#endif /* CMT_IO_COST_H */
@@ -0,0 +1,504 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "io-driver.h"
+#include "io-cost.h"
+#include "io-stats.h"
+#include "libcmt/record.h"
+#include "libcmt/trace.h"
+#include "libcmt/util.h"
+#include "probes.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+enum {
+    ALL_FLAGS = CMT_IO_PREFAULT | CMT_IO_WILLNEED | CMT_IO_HUGEPAGE | CMT_IO_ASYNC_OUTPUTS,
+};
+
+#ifdef CMT_IO_MOCK
+static int default_driver(void) {
+    const char *driver = getenv("CMT_IO_DRIVER");
+    if (driver && strcmp(driver, "ioctl") == 0) {
+        return CMT_IO_DRIVER_IOCTL;
+    }
+    if (driver && strcmp(driver, "mock") == 0) {
+        return CMT_IO_DRIVER_MOCK;
+    }
+    if (driver && strcmp(driver, "replay") == 0) {
+        return CMT_IO_DRIVER_REPLAY;
+    }
+    if (driver && strcmp(driver, "socket") == 0) {
+        return CMT_IO_DRIVER_SOCKET;
+    }
+    if (driver && strcmp(driver, "shm") == 0) {
+        return CMT_IO_DRIVER_SHM;
+    }
+    return CMT_IO_DRIVER_MOCK;
+}
+#endif
+
+static int default_flags(void) {
+    const char *env = getenv("CMT_IO_FLAGS");
+    int flags = 0;
+    if (!env) {
+        return 0;
+    }
+    cmt_buf_t left[1] = {{(uint8_t *) env, (uint8_t *) env + strlen(env)}};
+    cmt_buf_t x[1];
+    while (cmt_buf_split_by_comma(x, left)) {
+        size_t n = cmt_buf_length(x);
+        if (n == 8 && strncmp((char *) x->begin, "prefault", n) == 0) {
+            flags |= CMT_IO_PREFAULT;
+        } else if (n == 8 && strncmp((char *) x->begin, "willneed", n) == 0) {
+            flags |= CMT_IO_WILLNEED;
+        } else if (n == 8 && strncmp((char *) x->begin, "hugepage", n) == 0) {
+            flags |= CMT_IO_HUGEPAGE;
+        } else if (n == 5 && strncmp((char *) x->begin, "async", n) == 0) {
+            flags |= CMT_IO_ASYNC_OUTPUTS;
+        }
+    }
+    return flags;
+}
+
+size_t cmt_io_length_from_env(const char *name, size_t fallback) {
+    const char *env = getenv(name);
+    if (!env) {
+        return fallback;
+    }
+    char *end = NULL;
+    unsigned long long n = strtoull(env, &end, 0);
+    if (*end || n == 0 || n > UINT32_MAX) {
+        (void) fprintf(stderr, "ignoring invalid %s=\"%s\"\n", name, env);
+        return fallback;
+    }
+    return n;
+}
+
+#ifndef RUSAGE_THREAD
+#define RUSAGE_THREAD 1 // linux ABI, <sys/resource.h> only names it with _GNU_SOURCE
+#endif
+
+/* of the calling thread, other threads and instances initializing at the same time don't add up */
+static uint64_t minor_faults(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_THREAD, &usage)) {
+        return 0;
+    }
+    return usage.ru_minflt;
+}
+
+/* count the pages of @p buf that are already mapped */
+static void count_pages(const cmt_buf_t *buf, cmt_io_stats_pages_t *pages) {
+    size_t page = sysconf(_SC_PAGESIZE);
+    uintptr_t begin = (uintptr_t) buf->begin & ~(uintptr_t) (page - 1);
+    size_t n = ((uintptr_t) buf->end - begin + page - 1) / page;
+    pages->total += n;
+
+    unsigned char vec[256];
+    for (size_t i = 0; i < n; i += sizeof(vec)) {
+        size_t k = n - i < sizeof(vec) ? n - i : sizeof(vec);
+        if (mincore((void *) (begin + i * page), k * page, vec)) {
+            return;
+        }
+        for (size_t j = 0; j < k; ++j) {
+            pages->resident += vec[j] & 1;
+        }
+    }
+}
+
+void *cmt_io_mmap(void *addr, size_t length, int prot, int map, int fd, int flags) {
+    // populate after the hugepage hint, otherwise it would come too late
+    bool populate = (flags & CMT_IO_PREFAULT) && !(flags & CMT_IO_HUGEPAGE);
+    void *p = mmap(addr, length, prot, map | (populate ? MAP_POPULATE : 0), fd, 0);
+    if (p == MAP_FAILED) {
+        return p;
+    }
+#ifdef MADV_HUGEPAGE
+    if (flags & CMT_IO_HUGEPAGE) {
+        (void) madvise(p, length, MADV_HUGEPAGE);
+    }
+#endif
+    if (flags & CMT_IO_WILLNEED) {
+        (void) madvise(p, length, MADV_WILLNEED);
+    }
+    if ((flags & CMT_IO_PREFAULT) && !populate) {
+        size_t page = sysconf(_SC_PAGESIZE);
+        volatile uint8_t *x = p;
+        for (size_t i = 0; i < length; i += page) {
+            if (prot & PROT_WRITE) {
+                x[i] = x[i];
+            } else {
+                (void) x[i];
+            }
+        }
+    }
+    return p;
+}
+
+int cmt_io_map_anonymous(cmt_buf_t *tx, size_t tx_length, cmt_buf_t *rx, size_t rx_length, int flags) {
+    const int prot = PROT_READ | PROT_WRITE;
+    const int map = MAP_PRIVATE | MAP_ANONYMOUS;
+
+    void *t = cmt_io_mmap(NULL, tx_length, prot, map, -1, flags);
+    if (t == MAP_FAILED) {
+        return -ENOMEM;
+    }
+    void *r = cmt_io_mmap(NULL, rx_length, prot, map, -1, flags);
+    if (r == MAP_FAILED) {
+        munmap(t, tx_length);
+        return -ENOMEM;
+    }
+    cmt_buf_init(tx, tx_length, t);
+    cmt_buf_init(rx, rx_length, r);
+    return 0;
+}
+
+#ifdef CMT_IO_MOCK
+/* the recording and cost model of an instance without a mock config, from the process environment */
+static void sinks_from_env(cmt_io_mock_config_t *sinks) {
+    *sinks = (cmt_io_mock_config_t){
+        .record = getenv("CMT_IO_RECORD"),
+        .record_compress = getenv("CMT_IO_RECORD_COMPRESS") != NULL,
+        .cost = getenv("CMT_IO_COST"),
+        .cost_file = getenv("CMT_IO_COST_FILE"),
+        .cost_report = getenv("CMT_IO_COST_REPORT"),
+        .cost_sleep = getenv("CMT_IO_COST_SLEEP") != NULL,
+    };
+}
+
+/* start recording to @b record of @p sinks, if set */
+static int record_open(cmt_io_driver_t *me, const cmt_io_mock_config_t *sinks) {
+    const char *filepath = sinks->record;
+    me->base.record = NULL;
+    if (!filepath) {
+        return 0;
+    }
+
+    cmt_record_t *record = malloc(sizeof(*record));
+    if (!record) {
+        return -ENOMEM;
+    }
+    int flags = sinks->record_compress ? CMT_RECORD_COMPRESS : 0;
+    int rc = cmt_record_open(record, filepath, flags, cmt_buf_length(me->base.tx), cmt_buf_length(me->base.rx));
+    if (rc) {
+        (void) fprintf(stderr, "failed to open \"%s\". %s\n", filepath, strerror(-rc));
+        free(record);
+        return rc;
+    }
+    me->base.record = record;
+    return 0;
+}
+
+static void record_close(cmt_io_driver_t *me) {
+    if (!me->base.record) {
+        return;
+    }
+    int rc = cmt_record_close(me->base.record);
+    if (rc) {
+        (void) fprintf(stderr, "failed to close the recording. %s\n", strerror(-rc));
+    }
+    free(me->base.record);
+    me->base.record = NULL;
+}
+
+static void record_append(cmt_io_driver_t *me, const cmt_io_yield_t *req, int rc, const cmt_io_yield_t *rr) {
+    if (!me->base.record) {
+        return;
+    }
+    int err = cmt_record_append(me->base.record, req, rc, rr, me->base.rx);
+    if (err) { // keep the application going, the recording is incomplete from here on
+        (void) fprintf(stderr, "stopped recording. %s\n", strerror(-err));
+        record_close(me);
+    }
+}
+
+static int cost_open(cmt_io_driver_t *me, const struct cmt_io_ops *ops, const cmt_io_mock_config_t *sinks) {
+    me->base.cost = NULL;
+    if (strcmp(ops->name, "ioctl") == 0) { // the machine has real costs
+        return 0;
+    }
+    return cmt_io_cost_open(&me->base.cost, sinks);
+}
+
+static uint64_t cost_apply(cmt_io_driver_t *me, const cmt_io_yield_t *req, const cmt_io_yield_t *rr, int rc) {
+    return me->base.cost ? cmt_io_cost_apply(me->base.cost, req, rr, rc) : 0;
+}
+
+static void cost_close(cmt_io_driver_t *me) {
+    cmt_io_cost_close(me->base.cost);
+}
+#else
+/* the guest library has /dev/cmio as its only io source, the environment can't record or model it */
+static void sinks_from_env(cmt_io_mock_config_t *sinks) {
+    *sinks = (cmt_io_mock_config_t){0};
+}
+
+static int record_open(cmt_io_driver_t *me, const cmt_io_mock_config_t *sinks) {
+    (void) sinks;
+    me->base.record = NULL;
+    return 0;
+}
+
+static void record_close(cmt_io_driver_t *me) {
+    (void) me;
+}
+
+static void record_append(cmt_io_driver_t *me, const cmt_io_yield_t *req, int rc, const cmt_io_yield_t *rr) {
+    (void) me;
+    (void) req;
+    (void) rc;
+    (void) rr;
+}
+
+static int cost_open(cmt_io_driver_t *me, const struct cmt_io_ops *ops, const cmt_io_mock_config_t *sinks) {
+    (void) ops;
+    (void) sinks;
+    me->base.cost = NULL;
+    return 0;
+}
+
+static uint64_t cost_apply(cmt_io_driver_t *me, const cmt_io_yield_t *req, const cmt_io_yield_t *rr, int rc) {
+    (void) me;
+    (void) req;
+    (void) rr;
+    (void) rc;
+    return 0;
+}
+
+static void cost_close(cmt_io_driver_t *me) {
+    (void) me;
+}
+#endif
+
+/* @p sinks has the recording and cost model of the instance, NULL for those of the environment */
+static int init(cmt_io_driver_t *me, const struct cmt_io_ops *ops, const void *config, int flags,
+    const cmt_io_mock_config_t *sinks) {
+    cmt_io_mock_config_t env;
+    if (!sinks) {
+        sinks_from_env(&env);
+        sinks = &env;
+    }
+    uint64_t faults = minor_faults();
+    int rc = ops->init(me, config, flags);
+    if (rc) {
+        return rc;
+    }
+    rc = record_open(me, sinks);
+    if (rc) {
+        ops->fini(me);
+        return rc;
+    }
+    rc = cost_open(me, ops, sinks);
+    if (rc) {
+        record_close(me);
+        ops->fini(me);
+        return rc;
+    }
+    me->base.ops = ops;
+    memset(&me->base.stats, 0, sizeof(me->base.stats));
+    me->base.stats.pages.init_faults = minor_faults() - faults;
+    count_pages(me->base.tx, &me->base.stats.pages);
+    count_pages(me->base.rx, &me->base.stats.pages);
+    cmt_trace_init();
+    if (cmt_util_debug_enabled()) {
+        (void) fprintf(stderr, "using the %s io driver\n", ops->name);
+    }
+    return 0;
+}
+
+int cmt_io_init(cmt_io_driver_t *me) {
+    return cmt_io_init_driver(me, CMT_IO_DRIVER_DEFAULT);
+}
+
+int cmt_io_init_driver(cmt_io_driver_t *me, int driver) {
+    return cmt_io_init_ex(me, driver, default_flags());
+}
+
+int cmt_io_init_ex(cmt_io_driver_t *me, int driver, int flags) {
+    if (!me || (flags & ~ALL_FLAGS)) {
+        return -EINVAL;
+    }
+#ifndef CMT_IO_MOCK
+    // the host drivers are only part of the mock build, a rollup can't be pointed away from the device
+    switch (driver) {
+        case CMT_IO_DRIVER_DEFAULT:
+        case CMT_IO_DRIVER_IOCTL:
+            return init(me, &cmt_io_ioctl_ops, NULL, flags, NULL);
+        case CMT_IO_DRIVER_MOCK:
+        case CMT_IO_DRIVER_REPLAY:
+        case CMT_IO_DRIVER_SOCKET:
+        case CMT_IO_DRIVER_SHM:
+            return -ENOSYS;
+        default:
+            return -EINVAL;
+    }
+#else
+    if (driver == CMT_IO_DRIVER_DEFAULT) {
+        driver = default_driver();
+    }
+    const char *socket_path = getenv("CMT_MOCK_SOCKET");
+    const char *shm_path = getenv("CMT_MOCK_SHM");
+
+    switch (driver) {
+        case CMT_IO_DRIVER_IOCTL:
+            return -ENOSYS;
+        case CMT_IO_DRIVER_MOCK:
+            if (socket_path) {
+                return init(me, &cmt_io_socket_ops, socket_path, flags, NULL);
+            }
+            if (shm_path) {
+                return init(me, &cmt_io_shm_ops, shm_path, flags, NULL);
+            }
+            return init(me, &cmt_io_mock_ops, NULL, flags, NULL);
+        case CMT_IO_DRIVER_REPLAY:
+            return cmt_io_init_replay(me, getenv("CMT_IO_REPLAY"), flags);
+        case CMT_IO_DRIVER_SOCKET:
+            if (!socket_path) {
+                return -EINVAL;
+            }
+            return init(me, &cmt_io_socket_ops, socket_path, flags, NULL);
+        case CMT_IO_DRIVER_SHM:
+            if (!shm_path) {
+                return -EINVAL;
+            }
+            return init(me, &cmt_io_shm_ops, shm_path, flags, NULL);
+        default:
+            return -EINVAL;
+    }
+#endif
+}
+
+int cmt_io_init_loopback(cmt_io_driver_t *me, const cmt_io_loopback_t *callbacks) {
+    if (!me || !callbacks || !callbacks->input || (callbacks->flags & ~ALL_FLAGS)) {
+        return -EINVAL;
+    }
+    return init(me, &cmt_io_loopback_ops, callbacks, callbacks->flags, NULL);
+}
+
+int cmt_io_init_mock(cmt_io_driver_t *me, const cmt_io_mock_config_t *config) {
+    if (!me) {
+        return -EINVAL;
+    }
+#ifndef CMT_IO_MOCK
+    (void) config;
+    return -ENOSYS;
+#else
+    if (!config) {
+        return init(me, &cmt_io_mock_ops, NULL, default_flags(), NULL);
+    }
+    if (config->flags & ~ALL_FLAGS) {
+        return -EINVAL;
+    }
+    return init(me, &cmt_io_mock_ops, config, config->flags, config);
+#endif
+}
+
+int cmt_io_init_replay(cmt_io_driver_t *me, const char *filepath, int flags) {
+    if (!me || !filepath || (flags & ~ALL_FLAGS)) {
+        return -EINVAL;
+    }
+#ifndef CMT_IO_MOCK
+    return -ENOSYS;
+#else
+    return init(me, &cmt_io_replay_ops, filepath, flags, NULL);
+#endif
+}
+
+void cmt_io_fini(cmt_io_driver_t *me) {
+    if (!me || !me->base.ops) {
+        return;
+    }
+
+    cmt_io_stats_dump(&me->base.stats);
+    (void) cmt_trace_fini();
+    record_close(me);
+    cost_close(me);
+    me->base.ops->fini(me);
+    memset(me, 0, sizeof(*me));
+}
+
+cmt_buf_t cmt_io_get_tx(cmt_io_driver_t *me) {
+    const cmt_buf_t empty = {NULL, NULL};
+    if (!me) {
+        return empty;
+    }
+    return *me->base.tx;
+}
+
+cmt_buf_t cmt_io_get_rx(cmt_io_driver_t *me) {
+    const cmt_buf_t empty = {NULL, NULL};
+    if (!me) {
+        return empty;
+    }
+    return *me->base.rx;
+}
+
+const cmt_io_stats_t *cmt_io_get_stats(cmt_io_driver_t *me) {
+    if (!me) {
+        return NULL;
+    }
+    return &me->base.stats;
+}
+
+static void debug_yield(const char *direction, const cmt_io_yield_t *rr) {
+    (void) fprintf(stderr,
+        "%s {\n"
+        "\t.dev = %d,\n"
+        "\t.cmd = %d,\n"
+        "\t.reason = %d,\n"
+        "\t.data = %d,\n"
+        "};\n",
+        direction, rr->dev, rr->cmd, rr->reason, rr->data);
+}
+
+int cmt_io_yield(cmt_io_driver_t *me, cmt_io_yield_t *rr) {
+    if (!me || !me->base.ops) {
+        return -EINVAL;
+    }
+    if (!rr) {
+        return -EINVAL;
+    }
+
+    bool debug = cmt_util_debug_enabled() && !cmt_trace_enabled();
+    CMT_PROBE3(yield__entry, rr->cmd, rr->reason, rr->data);
+    cmt_trace(CMT_TRACE_YIELD_TOHOST, rr->cmd, rr->reason, rr->data, 0);
+    if (debug) {
+        debug_yield("tohost", rr);
+    }
+
+    cmt_io_yield_t req = *rr;
+    uint64_t start = cmt_io_stats_now();
+    int rc = me->base.ops->yield(me, rr);
+    uint64_t modeled_ns = cost_apply(me, &req, rr, rc);
+    cmt_io_stats_record(&me->base.stats, &req, rr, rc, cmt_io_stats_now() - start, modeled_ns);
+    cmt_trace(CMT_TRACE_YIELD_FROMHOST, rr->cmd, rr->reason, rr->data, rc);
+    CMT_PROBE4(yield__return, rr->cmd, rr->reason, rr->data, rc);
+    record_append(me, &req, rc, rr);
+    if (rc) {
+        return rc;
+    }
+
+    if (debug) {
+        debug_yield("fromhost", rr);
+    }
+    return 0;
+}
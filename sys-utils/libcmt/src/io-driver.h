@@ -0,0 +1,67 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* Driver interface behind cmt_io_init and friends, not part of the public API */
+#ifndef CMT_IO_DRIVER_H
+#define CMT_IO_DRIVER_H
+#include "libcmt/io.h"
+
+/** Driver implementation, io-driver.c takes care of the arguments checks,
+ * statistics, tracing and debug output common to all of them */
+struct cmt_io_ops {
+    const char *name;
+
+    /** Acquire the resources and set @b base.tx and @b base.rx, @p config is driver specific,
+     * @p flags are @ref CMT_IO_PREFAULT and friends, for @ref cmt_io_mmap */
+    int (*init)(cmt_io_driver_t *me, const void *config, int flags);
+
+    /** Release the resources acquired by @b init */
+    void (*fini)(cmt_io_driver_t *me);
+
+    /** Perform the yield @p rr, leave it untouched on failure */
+    int (*yield)(cmt_io_driver_t *me, cmt_io_yield_t *rr);
+};
+
+/** mmap(2) honouring @p flags (@ref CMT_IO_PREFAULT and friends), hints that fail are ignored
+ * @return same as mmap(2) */
+void *cmt_io_mmap(void *addr, size_t length, int prot, int map, int fd, int flags);
+
+/** Map private anonymous memory for the @p tx and @p rx buffers of the host drivers, see @ref cmt_io_mmap
+ * @return 0 on success or -ENOMEM */
+int cmt_io_map_anonymous(cmt_buf_t *tx, size_t tx_length, cmt_buf_t *rx, size_t rx_length, int flags);
+
+/** Buffer size from the environment variable @p name (@p CMT_TX_LENGTH or
+ * @p CMT_RX_LENGTH) for the host drivers, yields carry 32 bits of length
+ * @return the size or @p fallback if unset or invalid */
+size_t cmt_io_length_from_env(const char *name, size_t fallback);
+
+/** Wait on the shared memory of the shm transport until it is the turn of
+ * @p side (@ref CMT_SHM_APPLICATION or @ref CMT_SHM_HOST), spinning first if
+ * @p spin, then sleeping on the futex or on @p events[side] if there are any
+ * @return 0 on its turn, -ENODATA if the host closed the session or -EPIPE if @p peer hung up */
+int cmt_shm_wait(struct cmt_shm_control *control, uint32_t side, const int events[2], int peer, bool spin);
+
+/** Change the turn of the shm transport from @p from to @p turn and wake the side it belongs to, if it is asleep
+ * @return false if the turn was not @p from, it is left untouched */
+bool cmt_shm_pass(struct cmt_shm_control *control, uint32_t from, uint32_t turn, const int events[2]);
+
+extern const struct cmt_io_ops cmt_io_ioctl_ops;
+extern const struct cmt_io_ops cmt_io_mock_ops;
+extern const struct cmt_io_ops cmt_io_loopback_ops;
+extern const struct cmt_io_ops cmt_io_replay_ops;
+extern const struct cmt_io_ops cmt_io_socket_ops;
+extern const struct cmt_io_ops cmt_io_shm_ops;
+
+#endif /* CMT_IO_DRIVER_H */
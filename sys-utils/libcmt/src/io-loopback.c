@@ -0,0 +1,129 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "io-driver.h"
+
+#include <errno.h>
+
+#include <sys/mman.h>
+
+static int loopback_init(cmt_io_driver_t *_me, const void *config, int flags) {
+    cmt_io_driver_loopback_t *me = &_me->loopback;
+
+    size_t tx_length = 2U << 20; // 2MB, same as the mock
+    size_t rx_length = 2U << 20; // 2MB
+    int rc = cmt_io_map_anonymous(me->base.tx, tx_length, me->base.rx, rx_length, flags);
+    if (rc) {
+        return rc;
+    }
+
+    me->callbacks = *(const cmt_io_loopback_t *) config;
+    me->inputs = 0;
+    me->checksum = UINT64_C(0xcbf29ce484222325); // FNV-1a offset basis
+    me->first = true;
+    return 0;
+}
+
+static void loopback_fini(cmt_io_driver_t *_me) {
+    cmt_io_driver_loopback_t *me = &_me->loopback;
+
+    munmap(me->base.tx->begin, cmt_buf_length(me->base.tx));
+    munmap(me->base.rx->begin, cmt_buf_length(me->base.rx));
+}
+
+static int loopback_send(cmt_io_driver_loopback_t *me, const cmt_io_yield_t *rr) {
+    if (rr->data > cmt_buf_length(me->base.tx)) {
+        return -ENOBUFS;
+    }
+
+    const uint8_t *data = me->base.tx->begin;
+    if (me->callbacks.checksum) {
+        uint64_t h = me->checksum;
+        h = (h ^ rr->reason) * UINT64_C(0x100000001b3);
+        for (uint32_t i = 0; i < rr->data; ++i) {
+            h = (h ^ data[i]) * UINT64_C(0x100000001b3);
+        }
+        me->checksum = h;
+    }
+    if (me->callbacks.output) {
+        return me->callbacks.output(me->callbacks.context, rr, data);
+    }
+    return 0;
+}
+
+static int loopback_receive(cmt_io_driver_loopback_t *me, cmt_io_yield_t *rr) {
+    uint16_t reason = 0;
+    uint32_t length = 0;
+    int rc = me->callbacks.input(me->callbacks.context, *me->base.rx, &reason, &length);
+    if (rc) {
+        return rc;
+    }
+    if (length > cmt_buf_length(me->base.rx)) {
+        return -ENOBUFS;
+    }
+    rr->reason = reason;
+    rr->data = length;
+    me->inputs++;
+    return 0;
+}
+
+/* follow io-mock.c:mock_yield, minus the filesystem */
+static int loopback_yield(cmt_io_driver_t *_me, cmt_io_yield_t *rr) {
+    cmt_io_driver_loopback_t *me = &_me->loopback;
+    int rc = 0;
+
+    if (rr->cmd == HTIF_YIELD_CMD_MANUAL) {
+        switch (rr->reason) {
+            case HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED:
+                if (!me->first) { // outputs root hash of the previous input
+                    rc = loopback_send(me, rr);
+                    if (rc) {
+                        return rc;
+                    }
+                }
+                me->first = false;
+                return loopback_receive(me, rr);
+            case HTIF_YIELD_MANUAL_REASON_RX_REJECTED:
+                me->first = false;
+                return loopback_receive(me, rr);
+            case HTIF_YIELD_MANUAL_REASON_TX_EXCEPTION:
+                return loopback_send(me, rr);
+            default: // gio
+                rc = loopback_send(me, rr);
+                if (rc) {
+                    return rc;
+                }
+                return loopback_receive(me, rr);
+        }
+    } else if (rr->cmd == HTIF_YIELD_CMD_AUTOMATIC) {
+        switch (rr->reason) {
+            case HTIF_YIELD_AUTOMATIC_REASON_PROGRESS:
+                return 0;
+            case HTIF_YIELD_AUTOMATIC_REASON_TX_OUTPUT:
+            case HTIF_YIELD_AUTOMATIC_REASON_TX_REPORT:
+                return loopback_send(me, rr);
+            default:
+                return -EINVAL;
+        }
+    }
+    return -EINVAL;
+}
+
+const struct cmt_io_ops cmt_io_loopback_ops = {
+    .name = "loopback",
+    .init = loopback_init,
+    .fini = loopback_fini,
+    .yield = loopback_yield,
+};
@@ -13,106 +13,373 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
-#include "libcmt/io.h"
+#include "io-driver.h"
+#include "io-writer.h"
+#include "libcmt/digest.h"
+#include "libcmt/giostore.h"
+#include "libcmt/outlog.h"
 #include "libcmt/util.h"
 
 #include <errno.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-/** track the number of open "devices". Mimic the kernel driver behavior by limiting it to 1 */
-static int open_count = 0;
-
-int cmt_io_init(cmt_io_driver_t *_me) {
-    if (!_me) {
-        return -EINVAL;
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+enum {
+    MOCK_PATH_LENGTH = 4096, /**< output file paths */
+};
+
+/* an output of a forked inspect, followed by its file path and payload */
+typedef struct inspect_output {
+    cmt_outlog_record_t record;
+    uint32_t path_length;
+} inspect_output_t;
+
+/* a forked inspect whose outputs were not stored yet */
+typedef struct inspect_child {
+    pid_t pid;
+    uint64_t input;
+    FILE *outputs; /**< written by the child, read back by the parent */
+} inspect_child_t;
+
+/* @p CMT_INSPECT_FORKS, a ring of the running inspects, oldest first */
+struct cmt_io_inspects {
+    uint32_t capacity;
+    uint32_t head;
+    uint32_t count;
+    uint8_t *scratch;    /**< payload of the output being collected, as long as tx */
+    FILE *held;          /**< outputs of the parent waiting on the inspects before them, NULL if none */
+    long held_next;      /**< offset in @b held of the oldest one not stored yet */
+    uint64_t held_count; /**< outputs in @b held not stored yet */
+    inspect_child_t child[];
+};
+
+static int open_inspects(cmt_io_driver_mock_t *me, uint32_t capacity) {
+    struct cmt_io_inspects *it = malloc(sizeof(*it) + (capacity * sizeof(it->child[0])));
+    if (!it) {
+        return -ENOMEM;
     }
-    if (open_count) {
-        return -EBUSY;
+    it->scratch = malloc(cmt_buf_length(me->base.tx));
+    if (!it->scratch) {
+        free(it);
+        return -ENOMEM;
     }
+    it->capacity = capacity;
+    it->head = 0;
+    it->count = 0;
+    it->held = NULL;
+    it->held_next = 0;
+    it->held_count = 0;
+    me->inspects = it;
+    return 0;
+}
 
-    open_count++;
-    cmt_io_driver_mock_t *me = &_me->mock;
-
-    size_t tx_length = 2U << 20; // 2MB
-    size_t rx_length = 2U << 20; // 2MB
-    cmt_buf_init(me->tx, tx_length, malloc(tx_length));
-    cmt_buf_init(me->rx, rx_length, malloc(rx_length));
+static void close_inspects(cmt_io_driver_mock_t *me) {
+    if (me->inspects) {
+        if (me->inspects->held) {
+            (void) fclose(me->inspects->held);
+        }
+        free(me->inspects->scratch);
+        free(me->inspects);
+        me->inspects = NULL;
+    }
+}
 
-    if (!me->tx->begin || !me->rx->begin) {
-        free(me->tx->begin);
-        free(me->rx->begin);
-        return -ENOMEM;
+static void close_inputs_and_log(cmt_io_driver_mock_t *me) {
+    cmt_giostore_close(me->gio_store);
+    me->gio_store = NULL;
+    if (me->inputs_file) {
+        (void) fclose(me->inputs_file);
+        me->inputs_file = NULL;
     }
+    if (me->output_log) {
+        int rc = cmt_outlog_close(me->output_log);
+        if (rc) {
+            (void) fprintf(stderr, "failed to close the output log. %s\n", strerror(-rc));
+        }
+        free(me->output_log);
+        me->output_log = NULL;
+    }
+    if (me->output_digest) {
+        (void) cmt_digest_close(me->output_digest);
+        free(me->output_digest);
+        me->output_digest = NULL;
+    }
+}
+
+static int open_inputs_and_log(cmt_io_driver_mock_t *me, const cmt_io_mock_config_t *config) {
+    me->inputs_file = NULL;
+    me->output_log = NULL;
+    me->gio_store = NULL;
+    me->output_digest = NULL;
 
-    char *inputs = getenv("CMT_INPUTS");
-    if (inputs) {
-        cmt_buf_init(&me->inputs_left, strlen(inputs), inputs);
+    if (config->inputs) {
+        cmt_buf_init(&me->inputs_left, strlen(config->inputs), (void *) config->inputs);
     } else {
         cmt_buf_init(&me->inputs_left, 0, "");
     }
 
+    if (config->inputs_file) {
+        me->inputs_file = fopen(config->inputs_file, "r");
+        if (!me->inputs_file) {
+            int rc = -errno;
+            (void) fprintf(stderr, "failed to open \"%s\". %s\n", config->inputs_file, strerror(-rc));
+            return rc;
+        }
+    }
+
+    if (config->output_log) {
+        me->output_log = malloc(sizeof(*me->output_log));
+        if (!me->output_log) {
+            close_inputs_and_log(me);
+            return -ENOMEM;
+        }
+        int rc = cmt_outlog_open(me->output_log, config->output_log);
+        if (rc) {
+            (void) fprintf(stderr, "failed to open \"%s\". %s\n", config->output_log, strerror(-rc));
+            free(me->output_log);
+            me->output_log = NULL;
+            close_inputs_and_log(me);
+            return rc;
+        }
+    }
+
+    if (config->output_digest || config->expected_digest) {
+        me->output_digest = malloc(sizeof(*me->output_digest));
+        if (!me->output_digest) {
+            close_inputs_and_log(me);
+            return -ENOMEM;
+        }
+        int rc = cmt_digest_open(me->output_digest, config->output_digest, config->expected_digest);
+        if (rc) {
+            const char *filepath = config->output_digest ? config->output_digest : config->expected_digest;
+            (void) fprintf(stderr, "failed to open the output digest \"%s\". %s\n", filepath, strerror(-rc));
+            free(me->output_digest);
+            me->output_digest = NULL;
+            close_inputs_and_log(me);
+            return rc;
+        }
+    }
+
+    if (config->gio_store) {
+        size_t cache_length = config->gio_cache_length ? config->gio_cache_length : 16U << 20; // 16MB
+        int rc = cmt_giostore_open(&me->gio_store, config->gio_store, cache_length);
+        if (rc) {
+            (void) fprintf(stderr, "failed to open \"%s\". %s\n", config->gio_store, strerror(-rc));
+            close_inputs_and_log(me);
+            return rc;
+        }
+    }
+    return 0;
+}
+
+/* the configuration of a plain cmt_io_init, from the process environment */
+static void config_from_env(cmt_io_mock_config_t *config, int flags) {
+    *config = (cmt_io_mock_config_t){
+        .inputs = getenv("CMT_INPUTS"),
+        .inputs_file = getenv("CMT_INPUTS_FILE"),
+        .output_log = getenv("CMT_OUTPUT_LOG"),
+        .output_digest = getenv("CMT_OUTPUT_DIGEST"),
+        .expected_digest = getenv("CMT_OUTPUT_DIGEST_EXPECTED"),
+        .gio_store = getenv("CMT_GIO_STORE"),
+        .gio_cache_length = cmt_io_length_from_env("CMT_GIO_CACHE_LENGTH", 0),
+        .tx_length = cmt_io_length_from_env("CMT_TX_LENGTH", 0),
+        .rx_length = cmt_io_length_from_env("CMT_RX_LENGTH", 0),
+        .inspect_forks = (uint32_t) cmt_io_length_from_env("CMT_INSPECT_FORKS", 0),
+        .flags = flags,
+    };
+}
+
+static int mock_init(cmt_io_driver_t *_me, const void *config, int flags) {
+    cmt_io_driver_mock_t *me = &_me->mock;
+    cmt_io_mock_config_t env;
+    const cmt_io_mock_config_t *it = config;
+    if (!it) {
+        config_from_env(&env, flags);
+        it = &env;
+    }
+
+    size_t tx_length = it->tx_length ? it->tx_length : 2U << 20; // 2MB
+    size_t rx_length = it->rx_length ? it->rx_length : 2U << 20; // 2MB
+    int rc = open_inputs_and_log(me, it);
+    if (rc) {
+        return rc;
+    }
+    rc = cmt_io_map_anonymous(me->base.tx, tx_length, me->base.rx, rx_length, flags);
+    if (rc) {
+        close_inputs_and_log(me);
+        return rc;
+    }
+    me->inspects = NULL;
+    me->inspect_outputs = NULL;
+    if (it->inspect_forks) {
+        rc = open_inspects(me, it->inspect_forks);
+        if (rc) {
+            munmap(me->base.tx->begin, cmt_buf_length(me->base.tx));
+            munmap(me->base.rx->begin, cmt_buf_length(me->base.rx));
+            close_inputs_and_log(me);
+            return rc;
+        }
+    }
+    me->writer = NULL;
+    if ((flags & CMT_IO_ASYNC_OUTPUTS) && !me->output_digest) { // hashing is cheaper than queueing
+        rc = cmt_io_writer_start(&me->writer, me->output_log);
+        if (rc) {
+            close_inspects(me);
+            munmap(me->base.tx->begin, cmt_buf_length(me->base.tx));
+            munmap(me->base.rx->begin, cmt_buf_length(me->base.rx));
+            close_inputs_and_log(me);
+            return rc;
+        }
+    }
+
     // in case the user writes something before loading any input
     strcpy(me->input_filename, "none");
     strcpy(me->input_fileext, ".bin");
 
+    me->output_dir = it->output_dir;
     me->input_seq = 0;
     me->output_seq = 0;
     me->report_seq = 0;
     me->exception_seq = 0;
     me->gio_seq = 0;
-
+    me->input_index = UINT64_MAX;
+    me->flags = flags;
+    me->input_mapped = 0;
     return 0;
 }
 
-void cmt_io_fini(cmt_io_driver_t *_me) {
-    if (!_me) {
-        return;
+/* print the first divergence from @p CMT_OUTPUT_DIGEST_EXPECTED, once */
+static void report_divergence(const cmt_digest_t *digest, bool reported) {
+    if (digest->diverged && !reported) {
+        (void) fprintf(stderr, "outputs diverge from the expected digest at input %" PRIu64 ", output %" PRIu32 "\n",
+            digest->divergence.input, digest->divergence.output);
     }
+}
 
-    if (open_count == 0) {
-        return;
+/* finish the digest of the last input and tell whether the run matched */
+static void close_digest(cmt_io_driver_mock_t *me) {
+    cmt_digest_t *digest = me->output_digest;
+    bool comparing = digest->expected != NULL;
+    bool reported = digest->diverged;
+    int rc = cmt_digest_close(digest);
+    if (rc) {
+        (void) fprintf(stderr, "failed to close the output digest. %s\n", strerror(-rc));
+    } else if (comparing && !digest->diverged) {
+        (void) fprintf(stderr, "outputs match the expected digest\n");
     }
+    report_divergence(digest, reported);
+    free(digest);
+    me->output_digest = NULL;
+}
 
-    open_count--;
-    cmt_io_driver_mock_t *me = &_me->mock;
+/* put anonymous memory back where the previous input file was mapped */
+static int unmap_input(cmt_io_driver_mock_t *me) {
+    if (!me->input_mapped) {
+        return 0;
+    }
+    void *p = mmap(me->base.rx->begin, me->input_mapped, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+    if (p == MAP_FAILED) {
+        return -errno;
+    }
+    me->input_mapped = 0;
+    return 0;
+}
 
-    free(me->tx->begin);
-    free(me->rx->begin);
+/* Map @p filepath over the start of rx, without copying it. Copy what can't
+ * be mapped (pipes, ...). Either way rx keeps its address. */
+static int load_input_file(cmt_io_driver_mock_t *me, const char *filepath, size_t *length) {
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0) {
+        return -errno;
+    }
 
-    memset(_me, 0, sizeof(*_me));
-}
+    struct stat st;
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+        (void) close(fd);
+        int rc = unmap_input(me);
+        if (rc) {
+            return rc;
+        }
+        return cmt_util_read_whole_file(filepath, cmt_buf_length(me->base.rx), me->base.rx->begin, length);
+    }
+    if ((uint64_t) st.st_size > cmt_buf_length(me->base.rx)) {
+        (void) close(fd);
+        return -ENOBUFS;
+    }
 
-cmt_buf_t cmt_io_get_tx(cmt_io_driver_t *me) {
-    cmt_buf_t empty = {NULL, NULL};
-    if (!me) {
-        return empty;
+    int rc = unmap_input(me);
+    if (rc == 0 && st.st_size) {
+        int populate = (me->flags & CMT_IO_PREFAULT) ? MAP_POPULATE : 0;
+        // private: writes into rx stay in memory, as they do with the anonymous mapping
+        void *p = mmap(me->base.rx->begin, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED | populate,
+            fd, 0);
+        if (p == MAP_FAILED) {
+            rc = -errno;
+        } else {
+            me->input_mapped = st.st_size;
+        }
     }
-    return *me->mock.tx;
+    (void) close(fd);
+    if (rc) {
+        return rc;
+    }
+    *length = st.st_size;
+    return 0;
 }
 
-cmt_buf_t cmt_io_get_rx(cmt_io_driver_t *me) {
-    cmt_buf_t empty = {NULL, NULL};
-    if (!me) {
-        return empty;
+/* next `<reason>:<filepath>` entry, from @p CMT_INPUTS_FILE or @p CMT_INPUTS */
+static bool next_entry(cmt_io_driver_mock_t *me, char *entry, size_t size) {
+    if (me->inputs_file) {
+        while (fgets(entry, (int) size, me->inputs_file)) {
+            size_t n = strcspn(entry, "\r\n");
+            if (!entry[n] && !feof(me->inputs_file)) { // line too long, skip it and fail to parse
+                for (int c = 0; c != '\n' && c != EOF; c = fgetc(me->inputs_file)) {
+                    ;
+                }
+                entry[0] = '\0';
+                return true;
+            }
+            entry[n] = '\0';
+            if (entry[0] && entry[0] != '#') {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    cmt_buf_t current_input;
+    if (!cmt_buf_split_by_comma(&current_input, &me->inputs_left)) {
+        return false;
     }
-    return *me->mock.rx;
+    size_t n = cmt_buf_length(&current_input);
+    n = n < size ? n : size - 1;
+    memcpy(entry, current_input.begin, n);
+    entry[n] = '\0';
+    return true;
 }
 
 static int load_next_input(cmt_io_driver_mock_t *me, struct cmt_io_yield *rr) {
-    cmt_buf_t current_input;
+    char entry[256];
     char filepath[128] = {0};
-    if (!cmt_buf_split_by_comma(&current_input, &me->inputs_left)) {
+    if (!next_entry(me, entry, sizeof entry)) {
         return -EINVAL;
     }
     // NOLINTNEXTLINE(cert-err34-c,clang-analyzer-security.insecureAPI.DeprecatedOrUnsafeBufferHandling)
-    if (sscanf((char *) current_input.begin, "%d:%127[^,]", &me->input_type, filepath) != 2) {
+    if (sscanf(entry, "%d:%127[^,]", &me->input_type, filepath) != 2) {
         return -EINVAL;
     }
 
     size_t file_length = 0;
-    int rc = cmt_util_read_whole_file(filepath, cmt_buf_length(me->rx), me->rx->begin, &file_length);
+    int rc = load_input_file(me, filepath, &file_length);
     if (rc) {
         if (cmt_util_debug_enabled()) {
             (void) fprintf(stderr, "failed to load \"%s\". %s\n", filepath, strerror(-rc));
@@ -139,27 +406,282 @@ static int load_next_input(cmt_io_driver_mock_t *me, struct cmt_io_yield *rr) {
     return 0;
 }
 
-static int store_output(cmt_io_driver_mock_t *me, const char *filepath, struct cmt_io_yield *rr) {
-    if (rr->data > cmt_buf_length(me->rx)) {
-        return -ENOBUFS;
+static int store_record(cmt_io_driver_mock_t *me, const cmt_outlog_record_t *record, const char *filepath,
+    const void *data) {
+    int rc = 0;
+    if (me->output_digest) {
+        bool reported = me->output_digest->diverged;
+        rc = cmt_digest_add(me->output_digest, record->input, record->kind, record->length, data);
+        report_divergence(me->output_digest, reported);
+    } else if (me->writer) {
+        rc = cmt_io_writer_push(me->writer, filepath, record, data);
+    } else if (me->output_log) {
+        rc = cmt_outlog_append(me->output_log, record, data);
+    } else {
+        rc = cmt_util_write_whole_file(filepath, record->length, data);
     }
-
-    int rc = cmt_util_write_whole_file(filepath, rr->data, me->tx->begin);
     if (rc) {
         (void) fprintf(stderr, "failed to store \"%s\". %s\n", filepath, strerror(-rc));
         return rc;
     }
     if (cmt_util_debug_enabled()) {
-        (void) fprintf(stderr, "wrote filename: \"%s\" (%u)\n", filepath, rr->data);
+        (void) fprintf(stderr, "wrote filename: \"%s\" (%u)\n", filepath, record->length);
+    }
+    return 0;
+}
+
+/* append an output to @p outputs, flushed in case a forked inspect crashes */
+static int spool_output(FILE *outputs, const cmt_outlog_record_t *record, const char *filepath, const void *data) {
+    inspect_output_t header = {
+        .record = *record,
+        .path_length = strlen(filepath),
+    };
+    if (fwrite(&header, sizeof header, 1, outputs) != 1 ||
+        fwrite(filepath, 1, header.path_length, outputs) != header.path_length ||
+        fwrite(data, 1, record->length, outputs) != record->length || fflush(outputs)) {
+        (void) fprintf(stderr, "failed to spool \"%s\"\n", filepath);
+        return -EIO;
+    }
+    return 0;
+}
+
+/* read the next output of @p outputs back into @b scratch, false at the end or if it was cut short */
+static bool unspool_output(cmt_io_driver_mock_t *me, FILE *outputs, inspect_output_t *header,
+    char filepath[MOCK_PATH_LENGTH]) {
+    if (fread(header, sizeof(*header), 1, outputs) != 1 || header->path_length >= MOCK_PATH_LENGTH ||
+        header->record.length > cmt_buf_length(me->base.tx) ||
+        fread(filepath, 1, header->path_length, outputs) != header->path_length ||
+        fread(me->inspects->scratch, 1, header->record.length, outputs) != header->record.length) {
+        return false;
+    }
+    filepath[header->path_length] = '\0';
+    return true;
+}
+
+/* hold an output of the parent until the inspects forked before it are stored, to keep the input order */
+static int hold_output(cmt_io_driver_mock_t *me, const cmt_outlog_record_t *record, const char *filepath,
+    const void *data) {
+    struct cmt_io_inspects *it = me->inspects;
+    if (!it->held) {
+        it->held = tmpfile();
+        if (!it->held) {
+            return -errno;
+        }
+        it->held_next = 0;
+    }
+    if (fseek(it->held, 0, SEEK_END)) {
+        return -errno;
     }
+    int rc = spool_output(it->held, record, filepath, data);
+    if (rc) {
+        return rc;
+    }
+    it->held_count++;
+    return 0;
+}
+
+/* store the held outputs of the inputs before @p input, oldest first */
+static int release_held(cmt_io_driver_mock_t *me, uint64_t input) {
+    struct cmt_io_inspects *it = me->inspects;
+    inspect_output_t header;
+    char filepath[MOCK_PATH_LENGTH];
+    if (!it->held_count || fseek(it->held, it->held_next, SEEK_SET)) {
+        return it->held_count ? -errno : 0;
+    }
+    while (it->held_count) {
+        if (!unspool_output(me, it->held, &header, filepath)) {
+            return -EIO;
+        }
+        if (header.record.input >= input) {
+            return 0; // held_next still points at it
+        }
+        int rc = store_record(me, &header.record, filepath, it->scratch);
+        if (rc) {
+            return rc;
+        }
+        it->held_count--;
+        it->held_next = ftell(it->held);
+    }
+    (void) fclose(it->held); // all caught up, start over with the next one
+    it->held = NULL;
+    return 0;
+}
+
+static int store_output(cmt_io_driver_mock_t *me, int kind, int seq, const char *filepath,
+    struct cmt_io_yield *rr) {
+    if (rr->data > cmt_buf_length(me->base.tx)) {
+        return -ENOBUFS;
+    }
+
+    cmt_outlog_record_t record = {
+        .input = me->input_index,
+        .kind = kind,
+        .seq = seq,
+        .length = rr->data,
+    };
+    if (me->inspect_outputs) { // a forked inspect, hand it over to the parent
+        return spool_output(me->inspect_outputs, &record, filepath, me->base.tx->begin);
+    }
+    if (me->inspects && me->inspects->count) {
+        return hold_output(me, &record, filepath, me->base.tx->begin);
+    }
+    return store_record(me, &record, filepath, me->base.tx->begin);
+}
+
+/* wait for the oldest forked inspect and store what it emitted, after the held outputs of the inputs before it */
+static int collect_inspect(cmt_io_driver_mock_t *me) {
+    struct cmt_io_inspects *it = me->inspects;
+    inspect_child_t child = it->child[it->head];
+    it->head = (it->head + 1) % it->capacity;
+    it->count--;
+
+    int status = 0;
+    while (waitpid(child.pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            int rc = -errno;
+            (void) fclose(child.outputs);
+            return rc;
+        }
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+        (void) fprintf(stderr, "the inspect of input %" PRIu64 " did not finish\n", child.input);
+    }
+
+    inspect_output_t header;
+    char filepath[MOCK_PATH_LENGTH];
+    int rc = release_held(me, child.input);
+    rewind(child.outputs);
+    while (rc == 0 && unspool_output(me, child.outputs, &header, filepath)) { // or cut short by a crash
+        rc = store_record(me, &header.record, filepath, it->scratch);
+    }
+    (void) fclose(child.outputs);
+    if (rc == 0 && it->count == 0) {
+        rc = release_held(me, UINT64_MAX);
+    }
+    return rc;
+}
+
+/* wait for every forked inspect, before the application is told there are no more inputs */
+static void collect_inspects(cmt_io_driver_mock_t *me) {
+    while (me->inspects && me->inspects->count) {
+        int rc = collect_inspect(me);
+        if (rc) {
+            (void) fprintf(stderr, "failed to collect an inspect. %s\n", strerror(-rc));
+        }
+    }
+}
+
+/* Run the inspect just loaded in a copy on write child. Returns 1 in the
+ * child, which processes it, and 0 in the parent, which skips it. */
+static int fork_inspect(cmt_io_driver_mock_t *me) {
+    struct cmt_io_inspects *it = me->inspects;
+    if (it->count == it->capacity) {
+        int rc = collect_inspect(me);
+        if (rc) {
+            return rc;
+        }
+    }
+    FILE *outputs = tmpfile();
+    if (!outputs) {
+        return -errno;
+    }
+    (void) fflush(NULL); // or the child flushes what the parent buffered a second time
+    pid_t pid = fork();
+    if (pid < 0) {
+        int rc = -errno;
+        (void) fclose(outputs);
+        return rc;
+    }
+    if (pid == 0) { // the parent owns all of these, the child only forwards its outputs and never closes them
+        me->inspect_outputs = outputs;
+        me->inspects = NULL;
+        me->writer = NULL;
+        me->base.record = NULL;
+        me->base.cost = NULL;
+        return 1;
+    }
+    it->child[(it->head + it->count++) % it->capacity] = (inspect_child_t){
+        .pid = pid,
+        .input = me->input_index,
+        .outputs = outputs,
+    };
     return 0;
 }
 
-static int store_next_output(cmt_io_driver_mock_t *me, char *ns, int *seq, struct cmt_io_yield *rr) {
-    char filepath[128 + 32 + 8 + 16];
+/* the inspect of a forked child is done, its outputs are already with the parent.
+ * Only stdout is flushed: the log, digest and inputs the child inherited belong
+ * to the parent, and may even be locked by its writer thread */
+static void finish_inspect(void) {
+    (void) fflush(stdout);
+    _exit(0);
+}
+
+/* next input for the application, forking the inspects on the way with @p CMT_INSPECT_FORKS */
+static int next_input(cmt_io_driver_mock_t *me, struct cmt_io_yield *rr) {
+    for (;;) {
+        int rc = load_next_input(me, rr);
+        if (rc) {
+            return rc;
+        }
+        me->input_index++;
+        if (!me->inspects || rr->reason != HTIF_YIELD_REASON_INSPECT) {
+            return 0;
+        }
+        rc = fork_inspect(me);
+        if (rc) {
+            return rc > 0 ? 0 : rc;
+        }
+    }
+}
+
+/* `<input name>.<suffix><input extension>`, in @b output_dir when set */
+static void output_filepath(cmt_io_driver_mock_t *me, const char *suffix, char *filepath, size_t size) {
+    const char *name = me->input_filename;
+    if (me->output_dir) {
+        const char *slash = strrchr(name, '/');
+        name = slash ? slash + 1 : name;
+        // NOLINTNEXTLINE(cert-err33-c, clang-analyzer-security.insecureAPI.DeprecatedOrUnsafeBufferHandling)
+        snprintf(filepath, size, "%s/%s.%s%s", me->output_dir, name, suffix, me->input_fileext);
+        return;
+    }
+    // NOLINTNEXTLINE(cert-err33-c, clang-analyzer-security.insecureAPI.DeprecatedOrUnsafeBufferHandling)
+    snprintf(filepath, size, "%s.%s%s", name, suffix, me->input_fileext);
+}
+
+static int store_next_output(cmt_io_driver_mock_t *me, char *ns, int kind, int *seq, struct cmt_io_yield *rr) {
+    char suffix[32];
+    char filepath[MOCK_PATH_LENGTH];
+    int n = (*seq)++;
+    if (me->output_digest) { // nothing is written, skip naming the file
+        return store_output(me, kind, n, "digest", rr);
+    }
     // NOLINTNEXTLINE(cert-err33-c, clang-analyzer-security.insecureAPI.DeprecatedOrUnsafeBufferHandling)
-    snprintf(filepath, sizeof filepath, "%s.%s%d%s", me->input_filename, ns, (*seq)++, me->input_fileext);
-    return store_output(me, filepath, rr);
+    snprintf(suffix, sizeof suffix, "%s%d", ns, n);
+    output_filepath(me, suffix, filepath, sizeof filepath);
+    return store_output(me, kind, n, filepath, rr);
+}
+
+static void mock_fini(cmt_io_driver_t *_me) {
+    cmt_io_driver_mock_t *me = &_me->mock;
+    if (me->inspect_outputs) { // a forked inspect quitting early
+        finish_inspect();
+    }
+    collect_inspects(me); // the application quit before running out of inputs
+    close_inspects(me);
+    if (me->output_digest) {
+        close_digest(me);
+    }
+    if (me->writer) { // drains the queue, before the log is closed
+        int rc = cmt_io_writer_stop(me->writer);
+        if (rc) {
+            (void) fprintf(stderr, "failed to write the outputs. %s\n", strerror(-rc));
+        }
+        me->writer = NULL;
+    }
+    close_inputs_and_log(me);
+
+    munmap(me->base.tx->begin, cmt_buf_length(me->base.tx));
+    munmap(me->base.rx->begin, cmt_buf_length(me->base.rx));
 }
 
 static int mock_progress(cmt_io_driver_mock_t *me, struct cmt_io_yield *rr) {
@@ -178,15 +700,18 @@ static int mock_rx_accepted(cmt_io_driver_mock_t *me, struct cmt_io_yield *rr) {
         return -EINVAL;
     }
     if (me->input_seq++) { // skip the first
-        char filepath[128 + 32 + 8 + 16];
-        // NOLINTNEXTLINE(cert-err33-c, clang-analyzer-security.insecureAPI.DeprecatedOrUnsafeBufferHandling)
-        snprintf(filepath, sizeof filepath, "%s.outputs_root_hash%s", me->input_filename, me->input_fileext);
-        int rc = store_output(me, filepath, rr);
+        char filepath[MOCK_PATH_LENGTH];
+        output_filepath(me, "outputs_root_hash", filepath, sizeof filepath);
+        int rc = store_output(me, CMT_OUTLOG_OUTPUTS_ROOT_HASH, 0, filepath, rr);
         if (rc) {
             return rc;
         }
     }
-    if (load_next_input(me, rr)) {
+    if (me->inspect_outputs) {
+        finish_inspect();
+    }
+    if (next_input(me, rr)) {
+        collect_inspects(me);
         return -ENODATA;
     }
     return 0;
@@ -197,8 +722,12 @@ static int mock_rx_rejected(cmt_io_driver_mock_t *me, struct cmt_io_yield *rr) {
         (void) fprintf(stderr, "Expected cmd to be MANUAL\n");
         return -EINVAL;
     }
+    if (me->inspect_outputs) { // nothing to revert either
+        finish_inspect();
+    }
     (void) fprintf(stderr, "%s:%d no revert for the mock implementation\n", __FILE__, __LINE__);
-    if (load_next_input(me, rr)) {
+    if (next_input(me, rr)) {
+        collect_inspects(me);
         return -ENOSYS;
     }
     return 0;
@@ -209,7 +738,7 @@ static int mock_tx_output(cmt_io_driver_mock_t *me, struct cmt_io_yield *rr) {
         (void) fprintf(stderr, "Expected cmd to be AUTOMATIC\n");
         return -EINVAL;
     }
-    return store_next_output(me, "output-", &me->output_seq, rr);
+    return store_next_output(me, "output-", CMT_OUTLOG_OUTPUT, &me->output_seq, rr);
 }
 
 static int mock_tx_report(cmt_io_driver_mock_t *me, struct cmt_io_yield *rr) {
@@ -217,7 +746,7 @@ static int mock_tx_report(cmt_io_driver_mock_t *me, struct cmt_io_yield *rr) {
         (void) fprintf(stderr, "Expected cmd to be AUTOMATIC\n");
         return -EINVAL;
     }
-    return store_next_output(me, "report-", &me->report_seq, rr);
+    return store_next_output(me, "report-", CMT_OUTLOG_REPORT, &me->report_seq, rr);
 }
 
 static int mock_tx_exception(cmt_io_driver_mock_t *me, struct cmt_io_yield *rr) {
@@ -225,7 +754,36 @@ static int mock_tx_exception(cmt_io_driver_mock_t *me, struct cmt_io_yield *rr)
         (void) fprintf(stderr, "Expected cmd to be MANUAL\n");
         return -EINVAL;
     }
-    return store_next_output(me, "exception-", &me->exception_seq, rr);
+    int rc = store_next_output(me, "exception-", CMT_OUTLOG_EXCEPTION, &me->exception_seq, rr);
+    if (me->inspect_outputs && rc == 0) { // the exception halts a forked inspect, as it does the machine
+        finish_inspect();
+    }
+    return rc;
+}
+
+/* answer from @p CMT_GIO_STORE, -ENOENT to fall back to the inputs */
+static int find_gio_response(cmt_io_driver_mock_t *me, struct cmt_io_yield *rr) {
+    const void *data = NULL;
+    size_t length = 0;
+    int rc = cmt_giostore_find(me->gio_store, rr->reason, rr->data, me->base.tx->begin, &data, &length);
+    if (rc) {
+        if (rc != -ENOENT) {
+            (void) fprintf(stderr, "failed to look up the gio response. %s\n", strerror(-rc));
+        }
+        return rc;
+    }
+    if (length > cmt_buf_length(me->base.rx)) {
+        return -ENOBUFS;
+    }
+    // rx may still map an input file, privately, so this does not write through to it
+    memcpy(me->base.rx->begin, data, length);
+    rr->reason = 0;
+    rr->data = length;
+
+    if (cmt_util_debug_enabled()) {
+        (void) fprintf(stderr, "gio response from the store (%zu)\n", length);
+    }
+    return 0;
 }
 
 static int mock_tx_gio(cmt_io_driver_mock_t *me, struct cmt_io_yield *rr) {
@@ -235,11 +793,21 @@ static int mock_tx_gio(cmt_io_driver_mock_t *me, struct cmt_io_yield *rr) {
         return -EINVAL;
     }
 
-    rc = store_next_output(me, "gio-", &me->gio_seq, rr);
+    rc = store_next_output(me, "gio-", CMT_OUTLOG_GIO, &me->gio_seq, rr);
     if (rc) {
         return rc;
     }
 
+    if (me->gio_store) {
+        rc = find_gio_response(me, rr);
+        if (rc != -ENOENT) {
+            return rc;
+        }
+    }
+    if (me->inspect_outputs) { // the inputs belong to the parent
+        return -ENODATA;
+    }
+
     rc = load_next_input(me, rr);
     if (rc) {
         return rc;
@@ -247,21 +815,29 @@ static int mock_tx_gio(cmt_io_driver_mock_t *me, struct cmt_io_yield *rr) {
     return 0;
 }
 
-/* These behaviours are defined by the cartesi-machine emulator */
-static int cmt_io_yield_inner(cmt_io_driver_t *_me, struct cmt_io_yield *rr) {
+/* These behaviours are defined by the cartesi-machine emulator,
+ * emulate io.c:ioctl_yield behavior (go and check it does if you change it) */
+static int mock_yield(cmt_io_driver_t *_me, struct cmt_io_yield *rr) {
     cmt_io_driver_mock_t *me = &_me->mock;
 
     if (rr->cmd == HTIF_YIELD_CMD_MANUAL) {
+        int rc = 0;
         switch (rr->reason) {
             case HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED:
-                return mock_rx_accepted(me, rr);
+                rc = mock_rx_accepted(me, rr);
+                break;
             case HTIF_YIELD_MANUAL_REASON_RX_REJECTED:
-                return mock_rx_rejected(me, rr);
+                rc = mock_rx_rejected(me, rr);
+                break;
             case HTIF_YIELD_MANUAL_REASON_TX_EXCEPTION:
-                return mock_tx_exception(me, rr);
+                rc = mock_tx_exception(me, rr);
+                break;
             default:
-                return mock_tx_gio(me, rr);
+                rc = mock_tx_gio(me, rr);
+                break;
         }
+        cmt_io_writer_kick(me->writer); // the input is done or we block on a response, write what is queued
+        return rc;
     } else if (rr->cmd == HTIF_YIELD_CMD_AUTOMATIC) {
         switch (rr->reason) {
             case HTIF_YIELD_AUTOMATIC_REASON_PROGRESS:
@@ -280,40 +856,9 @@ static int cmt_io_yield_inner(cmt_io_driver_t *_me, struct cmt_io_yield *rr) {
     return 0;
 }
 
-/* emulate io.c:cmt_io_yield behavior (go and check it does if you change it) */
-int cmt_io_yield(cmt_io_driver_t *_me, struct cmt_io_yield *rr) {
-    if (!_me) {
-        return -EINVAL;
-    }
-    if (!rr) {
-        return -EINVAL;
-    }
-
-    bool debug = cmt_util_debug_enabled();
-    if (debug) {
-        (void) fprintf(stderr,
-            "tohost {\n"
-            "\t.dev = %d,\n"
-            "\t.cmd = %d,\n"
-            "\t.reason = %d,\n"
-            "\t.data = %d,\n"
-            "};\n",
-            rr->dev, rr->cmd, rr->reason, rr->data);
-    }
-    int rc = cmt_io_yield_inner(_me, rr);
-    if (rc) {
-        return rc;
-    }
-
-    if (debug) {
-        (void) fprintf(stderr,
-            "fromhost {\n"
-            "\t.dev = %d,\n"
-            "\t.cmd = %d,\n"
-            "\t.reason = %d,\n"
-            "\t.data = %d,\n"
-            "};\n",
-            rr->dev, rr->cmd, rr->reason, rr->data);
-    }
-    return rc;
-}
+const struct cmt_io_ops cmt_io_mock_ops = {
+    .name = "mock",
+    .init = mock_init,
+    .fini = mock_fini,
+    .yield = mock_yield,
+};
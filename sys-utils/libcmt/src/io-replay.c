@@ -0,0 +1,182 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "io-driver.h"
+#include "libcmt/record.h"
+#include "libcmt/util.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static bool get_varint(const uint8_t **p, const uint8_t *end, uint64_t *x) {
+    uint64_t v = 0;
+    for (unsigned shift = 0; *p < end && shift < 64; shift += 7) {
+        uint8_t b = *(*p)++;
+        v |= (uint64_t) (b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *x = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+static int64_t unzigzag(uint64_t x) {
+    return (int64_t) (x >> 1) ^ -(int64_t) (x & 1);
+}
+
+static bool get_payload(cmt_io_driver_replay_t *me, const uint8_t **p, size_t length, uint8_t *out) {
+    if (!(me->flags & CMT_RECORD_COMPRESS)) {
+        if ((size_t) (me->end - *p) < length) {
+            return false;
+        }
+        memcpy(out, *p, length);
+        *p += length;
+        return true;
+    }
+
+    for (size_t i = 0; i < length;) {
+        uint64_t literals = 0;
+        uint64_t zeros = 0;
+        if (!get_varint(p, me->end, &literals) || literals > length - i || (uint64_t) (me->end - *p) < literals) {
+            return false;
+        }
+        memcpy(out + i, *p, literals);
+        *p += literals;
+        i += literals;
+        if (!get_varint(p, me->end, &zeros) || zeros > length - i) {
+            return false;
+        }
+        memset(out + i, 0, zeros);
+        i += zeros;
+    }
+    return true;
+}
+
+static int replay_init(cmt_io_driver_t *_me, const void *config, int flags) {
+    cmt_io_driver_replay_t *me = &_me->replay;
+    const char *filepath = config;
+
+    int fd = open(filepath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -errno;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int rc = -errno;
+        (void) close(fd);
+        return rc;
+    }
+    if ((size_t) st.st_size < sizeof(cmt_record_header_t)) {
+        (void) close(fd);
+        return -EINVAL;
+    }
+    void *p = cmt_io_mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, flags);
+    (void) close(fd);
+    if (p == MAP_FAILED) {
+        return -ENOMEM;
+    }
+
+    cmt_record_header_t header;
+    memcpy(&header, p, sizeof(header));
+    if (memcmp(header.magic, "CMTRCRD1", sizeof(header.magic)) != 0 || header.version != CMT_RECORD_VERSION ||
+        (header.flags & ~CMT_RECORD_COMPRESS) || header.tx_length == 0 || header.rx_length == 0) {
+        munmap(p, st.st_size);
+        return -EINVAL;
+    }
+
+    // same buffer sizes as the recorded session
+    int rc = cmt_io_map_anonymous(me->base.tx, header.tx_length, me->base.rx, header.rx_length, flags);
+    if (rc) {
+        munmap(p, st.st_size);
+        return rc;
+    }
+
+    me->begin = p;
+    me->next = me->begin + sizeof(header);
+    me->end = me->begin + st.st_size;
+    me->flags = (int) header.flags;
+    me->events = 0;
+    me->mismatches = 0;
+    return 0;
+}
+
+static void replay_fini(cmt_io_driver_t *_me) {
+    cmt_io_driver_replay_t *me = &_me->replay;
+
+    if (cmt_util_debug_enabled() || me->mismatches) {
+        (void) fprintf(stderr, "replayed %llu events, %llu with a different request length\n",
+            (unsigned long long) me->events, (unsigned long long) me->mismatches);
+    }
+    munmap((void *) me->begin, me->end - me->begin);
+    munmap(me->base.tx->begin, cmt_buf_length(me->base.tx));
+    munmap(me->base.rx->begin, cmt_buf_length(me->base.rx));
+}
+
+static int replay_yield(cmt_io_driver_t *_me, cmt_io_yield_t *rr) {
+    cmt_io_driver_replay_t *me = &_me->replay;
+    if (me->next == me->end) {
+        return -ENODATA;
+    }
+
+    const uint8_t *p = me->next;
+    uint8_t cmd = *p++;
+    uint64_t reason = 0;
+    uint64_t data = 0;
+    uint64_t rc = 0;
+    if (!get_varint(&p, me->end, &reason) || !get_varint(&p, me->end, &data) || !get_varint(&p, me->end, &rc)) {
+        return -EPROTO;
+    }
+    if (cmd != rr->cmd || reason != rr->reason) {
+        (void) fprintf(stderr, "replay diverged at event %llu, recorded cmd=%u reason=%u, got cmd=%u reason=%u\n",
+            (unsigned long long) me->events, cmd, (unsigned) reason, rr->cmd, rr->reason);
+        return -EPROTO;
+    }
+    if (unzigzag(rc)) {
+        me->next = p;
+        me->events++;
+        me->mismatches += data != rr->data;
+        return (int) unzigzag(rc);
+    }
+
+    uint64_t reply_reason = 0;
+    uint64_t reply_data = 0;
+    uint64_t length = 0;
+    if (!get_varint(&p, me->end, &reply_reason) || !get_varint(&p, me->end, &reply_data) ||
+        !get_varint(&p, me->end, &length) || length > cmt_buf_length(me->base.rx) ||
+        !get_payload(me, &p, length, me->base.rx->begin)) {
+        return -EPROTO;
+    }
+
+    me->next = p;
+    me->events++;
+    me->mismatches += data != rr->data;
+    rr->reason = reply_reason;
+    rr->data = reply_data;
+    return 0;
+}
+
+const struct cmt_io_ops cmt_io_replay_ops = {
+    .name = "replay",
+    .init = replay_init,
+    .fini = replay_fini,
+    .yield = replay_yield,
+};
@@ -0,0 +1,180 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "io-driver.h"
+#include "libcmt/shm.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* the memfd and eventfds the host passes along with a single byte */
+static int shm_receive_fds(int fd, int fds[3], size_t *n) {
+    union {
+        char buf[CMSG_SPACE(3 * sizeof(int))];
+        struct cmsghdr align;
+    } u;
+    char byte = 0;
+    struct iovec iov = {.iov_base = &byte, .iov_len = 1};
+    struct msghdr msg = {.msg_iov = &iov, .msg_iovlen = 1, .msg_control = u.buf, .msg_controllen = sizeof(u.buf)};
+    ssize_t rc = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+    if (rc < 0) {
+        return -errno;
+    }
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (rc != 1 || !cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+        return -EPROTO;
+    }
+    *n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    memcpy(fds, CMSG_DATA(cmsg), *n * sizeof(int));
+    if ((msg.msg_flags & MSG_CTRUNC) || *n == 0) {
+        for (size_t i = 0; i < *n; ++i) {
+            (void) close(fds[i]);
+        }
+        return -EPROTO;
+    }
+    return 0;
+}
+
+static bool shm_valid(const cmt_shm_control_t *control, size_t length, size_t n) {
+    static const char magic[8] = {'C', 'M', 'T', 'S', 'H', 'M', '0', '1'};
+    return memcmp(control->magic, magic, sizeof(magic)) == 0 && control->version == CMT_SHM_VERSION &&
+        control->tx_offset >= CMT_SHM_CONTROL_LENGTH && control->tx_offset + control->tx_length <= length &&
+        control->rx_offset >= control->tx_offset + control->tx_length &&
+        control->rx_offset + control->rx_length <= length &&
+        n == ((control->flags & CMT_SHM_EVENTFD) ? 3U : 1U);
+}
+
+static void shm_close_fds(int *fds, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        if (fds[i] >= 0) {
+            (void) close(fds[i]);
+        }
+    }
+}
+
+static int shm_init(cmt_io_driver_t *_me, const void *config, int flags) {
+    cmt_io_driver_shm_t *me = &_me->shm;
+    const char *path = config;
+
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        return -ENAMETOOLONG;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -errno;
+    }
+    int fds[3] = {-1, -1, -1};
+    size_t n = 0;
+    int rc = connect(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 ? -errno : shm_receive_fds(fd, fds, &n);
+    if (rc) {
+        (void) close(fd);
+        return rc;
+    }
+
+    struct stat st;
+    void *p = MAP_FAILED;
+    if (fstat(fds[0], &st) == 0 && st.st_size >= CMT_SHM_CONTROL_LENGTH) {
+        p = cmt_io_mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], flags);
+    }
+    (void) close(fds[0]); // the mapping keeps the memory
+    if (p == MAP_FAILED || !shm_valid(p, st.st_size, n)) {
+        rc = p == MAP_FAILED ? -ENOMEM : -EPROTO;
+        if (p != MAP_FAILED) {
+            munmap(p, st.st_size);
+        }
+        shm_close_fds(fds + 1, n - 1);
+        (void) close(fd);
+        return rc;
+    }
+
+    me->fd = fd;
+    me->events[0] = n == 3 ? fds[1] : -1;
+    me->events[1] = n == 3 ? fds[2] : -1;
+    me->control = p;
+    me->length = st.st_size;
+    me->spin = sysconf(_SC_NPROCESSORS_ONLN) > 1;
+    cmt_buf_init(me->base.tx, me->control->tx_length, (uint8_t *) p + me->control->tx_offset);
+    cmt_buf_init(me->base.rx, me->control->rx_length, (uint8_t *) p + me->control->rx_offset);
+    return 0;
+}
+
+static void shm_fini(cmt_io_driver_t *_me) {
+    cmt_io_driver_shm_t *me = &_me->shm;
+
+    shm_close_fds(me->events, 2);
+    (void) close(me->fd);
+    munmap(me->control, me->length);
+}
+
+/* These behaviours are defined by the cartesi-machine emulator,
+ * emulate io.c:ioctl_yield behavior (go and check it does if you change it) */
+static int shm_yield(cmt_io_driver_t *_me, cmt_io_yield_t *rr) {
+    cmt_io_driver_shm_t *me = &_me->shm;
+
+    uint32_t length = rr->data;
+    if (rr->cmd == HTIF_YIELD_CMD_AUTOMATIC) {
+        switch (rr->reason) {
+            case HTIF_YIELD_AUTOMATIC_REASON_PROGRESS:
+                length = 0;
+                break;
+            case HTIF_YIELD_AUTOMATIC_REASON_TX_OUTPUT:
+            case HTIF_YIELD_AUTOMATIC_REASON_TX_REPORT:
+                break;
+            default:
+                return -EINVAL;
+        }
+    } else if (rr->cmd != HTIF_YIELD_CMD_MANUAL) {
+        return -EINVAL;
+    }
+    if (length > cmt_buf_length(me->base.tx)) {
+        return -ENOBUFS;
+    }
+
+    // tx is already in place, the request goes with the turn
+    me->control->request = *rr;
+    if (!cmt_shm_pass(me->control, CMT_SHM_APPLICATION, CMT_SHM_HOST, me->events)) {
+        return -ENODATA; // the host closed the session
+    }
+    int rc = cmt_shm_wait(me->control, CMT_SHM_APPLICATION, me->events, me->fd, me->spin);
+    if (rc) {
+        return rc;
+    }
+    if (rr->cmd == HTIF_YIELD_CMD_AUTOMATIC) {
+        return 0;
+    }
+    cmt_io_yield_t reply = me->control->reply;
+    if (reply.data > cmt_buf_length(me->base.rx)) {
+        return -EPROTO;
+    }
+    rr->reason = reply.reason;
+    rr->data = reply.data;
+    return 0;
+}
+
+const struct cmt_io_ops cmt_io_shm_ops = {
+    .name = "shm",
+    .init = shm_init,
+    .fini = shm_fini,
+    .yield = shm_yield,
+};
@@ -0,0 +1,218 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "io-driver.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+enum {
+    SOCKET_BUFFER_LENGTH = 1 << 20, /**< read and write buffers, frames are batched up to 1MB */
+};
+
+static int socket_init(cmt_io_driver_t *_me, const void *config, int flags) {
+    cmt_io_driver_socket_t *me = &_me->socket;
+    const char *path = config;
+
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        return -ENAMETOOLONG;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -errno;
+    }
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        int rc = -errno;
+        (void) close(fd);
+        return rc;
+    }
+
+    uint8_t *buffers = malloc(2 * SOCKET_BUFFER_LENGTH);
+    if (!buffers) {
+        (void) close(fd);
+        return -ENOMEM;
+    }
+
+    size_t tx_length = cmt_io_length_from_env("CMT_TX_LENGTH", 2U << 20); // 2MB, same as the mock
+    size_t rx_length = cmt_io_length_from_env("CMT_RX_LENGTH", 2U << 20); // 2MB
+    int rc = cmt_io_map_anonymous(me->base.tx, tx_length, me->base.rx, rx_length, flags);
+    if (rc) {
+        free(buffers);
+        (void) close(fd);
+        return rc;
+    }
+
+    me->fd = fd;
+    me->in = buffers;
+    me->in_begin = 0;
+    me->in_end = 0;
+    me->out = buffers + SOCKET_BUFFER_LENGTH;
+    me->out_length = 0;
+    return 0;
+}
+
+static int socket_send_all(cmt_io_driver_socket_t *me, const uint8_t *data, size_t length) {
+    while (length) {
+        ssize_t n = send(me->fd, data, length, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        data += n;
+        length -= n;
+    }
+    return 0;
+}
+
+static int socket_flush(cmt_io_driver_socket_t *me) {
+    int rc = socket_send_all(me, me->out, me->out_length);
+    me->out_length = 0;
+    return rc;
+}
+
+/* queue @p request and its payload, frames larger than the buffer go out directly */
+static int socket_send_frame(cmt_io_driver_socket_t *me, const cmt_io_socket_request_t *request,
+    const uint8_t *payload) {
+    size_t n = sizeof(*request) + request->length;
+    if (me->out_length + n > SOCKET_BUFFER_LENGTH) {
+        int rc = socket_flush(me);
+        if (rc) {
+            return rc;
+        }
+    }
+    memcpy(me->out + me->out_length, request, sizeof(*request));
+    me->out_length += sizeof(*request);
+    if (n > SOCKET_BUFFER_LENGTH) {
+        int rc = socket_flush(me);
+        return rc ? rc : socket_send_all(me, payload, request->length);
+    }
+    memcpy(me->out + me->out_length, payload, request->length);
+    me->out_length += request->length;
+    return 0;
+}
+
+/* @return 0, -ENODATA if the peer closed the connection or a negative errno */
+static int socket_receive(cmt_io_driver_socket_t *me, uint8_t *data, size_t length) {
+    while (length) {
+        if (me->in_begin == me->in_end) {
+            // refill, or read large payloads straight into place
+            bool direct = length >= SOCKET_BUFFER_LENGTH;
+            ssize_t n = recv(me->fd, direct ? data : me->in, direct ? length : SOCKET_BUFFER_LENGTH, 0);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return n == 0 ? -ENODATA : -errno;
+            }
+            if (direct) {
+                data += n;
+                length -= n;
+                continue;
+            }
+            me->in_begin = 0;
+            me->in_end = n;
+        }
+        size_t k = me->in_end - me->in_begin;
+        k = k < length ? k : length;
+        memcpy(data, me->in + me->in_begin, k);
+        me->in_begin += k;
+        data += k;
+        length -= k;
+    }
+    return 0;
+}
+
+static void socket_fini(cmt_io_driver_t *_me) {
+    cmt_io_driver_socket_t *me = &_me->socket;
+
+    (void) socket_flush(me);
+    (void) close(me->fd);
+    free(me->in);
+    munmap(me->base.tx->begin, cmt_buf_length(me->base.tx));
+    munmap(me->base.rx->begin, cmt_buf_length(me->base.rx));
+}
+
+/* These behaviours are defined by the cartesi-machine emulator,
+ * emulate io.c:ioctl_yield behavior (go and check it does if you change it) */
+static int socket_yield(cmt_io_driver_t *_me, cmt_io_yield_t *rr) {
+    cmt_io_driver_socket_t *me = &_me->socket;
+
+    cmt_io_socket_request_t request = {
+        .cmd = rr->cmd,
+        .reason = rr->reason,
+        .data = rr->data,
+        .length = rr->data,
+    };
+    if (rr->cmd == HTIF_YIELD_CMD_AUTOMATIC) {
+        switch (rr->reason) {
+            case HTIF_YIELD_AUTOMATIC_REASON_PROGRESS:
+                request.length = 0;
+                break;
+            case HTIF_YIELD_AUTOMATIC_REASON_TX_OUTPUT:
+            case HTIF_YIELD_AUTOMATIC_REASON_TX_REPORT:
+                break;
+            default:
+                return -EINVAL;
+        }
+    } else if (rr->cmd != HTIF_YIELD_CMD_MANUAL) {
+        return -EINVAL;
+    }
+    if (request.length > cmt_buf_length(me->base.tx)) {
+        return -ENOBUFS;
+    }
+
+    int rc = socket_send_frame(me, &request, me->base.tx->begin);
+    if (rc || rr->cmd == HTIF_YIELD_CMD_AUTOMATIC) {
+        return rc; // automatic yields get no reply, they are sent with the next manual one
+    }
+    rc = socket_flush(me);
+    if (rc) {
+        return rc;
+    }
+
+    cmt_io_socket_reply_t reply;
+    rc = socket_receive(me, (uint8_t *) &reply, sizeof(reply));
+    if (rc) {
+        return rc; // -ENODATA, the generator is done
+    }
+    if (reply.data > cmt_buf_length(me->base.rx)) {
+        return -EPROTO;
+    }
+    rc = socket_receive(me, me->base.rx->begin, reply.data);
+    if (rc) {
+        return rc == -ENODATA ? -EPROTO : rc;
+    }
+    rr->reason = reply.reason;
+    rr->data = reply.data;
+    return 0;
+}
+
+const struct cmt_io_ops cmt_io_socket_ops = {
+    .name = "socket",
+    .init = socket_init,
+    .fini = socket_fini,
+    .yield = socket_yield,
+};
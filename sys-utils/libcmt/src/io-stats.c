@@ -0,0 +1,138 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "io-stats.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char *const kind_names[CMT_IO_STATS_KINDS] = {
+    [CMT_IO_STATS_PROGRESS] = "progress",
+    [CMT_IO_STATS_TX_OUTPUT] = "tx-output",
+    [CMT_IO_STATS_TX_REPORT] = "tx-report",
+    [CMT_IO_STATS_RX_ACCEPTED] = "rx-accepted",
+    [CMT_IO_STATS_RX_REJECTED] = "rx-rejected",
+    [CMT_IO_STATS_TX_EXCEPTION] = "tx-exception",
+    [CMT_IO_STATS_GIO] = "gio",
+    [CMT_IO_STATS_OTHER] = "other",
+};
+
+uint64_t cmt_io_stats_now(void) {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts)) {
+        return 0;
+    }
+    return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+}
+
+int cmt_io_stats_kind_of(const cmt_io_yield_t *req) {
+    if (req->cmd == HTIF_YIELD_CMD_AUTOMATIC) {
+        switch (req->reason) {
+            case HTIF_YIELD_AUTOMATIC_REASON_PROGRESS:
+                return CMT_IO_STATS_PROGRESS;
+            case HTIF_YIELD_AUTOMATIC_REASON_TX_OUTPUT:
+                return CMT_IO_STATS_TX_OUTPUT;
+            case HTIF_YIELD_AUTOMATIC_REASON_TX_REPORT:
+                return CMT_IO_STATS_TX_REPORT;
+            default:
+                return CMT_IO_STATS_OTHER;
+        }
+    }
+    if (req->cmd == HTIF_YIELD_CMD_MANUAL) {
+        switch (req->reason) {
+            case HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED:
+                return CMT_IO_STATS_RX_ACCEPTED;
+            case HTIF_YIELD_MANUAL_REASON_RX_REJECTED:
+                return CMT_IO_STATS_RX_REJECTED;
+            case HTIF_YIELD_MANUAL_REASON_TX_EXCEPTION:
+                return CMT_IO_STATS_TX_EXCEPTION;
+            default:
+                return CMT_IO_STATS_GIO;
+        }
+    }
+    return CMT_IO_STATS_OTHER;
+}
+
+int cmt_io_stats_kind_from_name(const char *name, size_t length) {
+    for (int k = 0; k < CMT_IO_STATS_KINDS; ++k) {
+        if (strlen(kind_names[k]) == length && strncmp(kind_names[k], name, length) == 0) {
+            return k;
+        }
+    }
+    return -1;
+}
+
+static int bucket_of(uint64_t ns) {
+    int i = ns ? 64 - __builtin_clzll(ns) : 0;
+    return i < CMT_IO_STATS_BUCKETS ? i : CMT_IO_STATS_BUCKETS - 1;
+}
+
+void cmt_io_stats_record(cmt_io_stats_t *me, const cmt_io_yield_t *req, const cmt_io_yield_t *rep, int rc,
+    uint64_t elapsed_ns, uint64_t modeled_ns) {
+    int k = cmt_io_stats_kind_of(req);
+    cmt_io_stats_kind_t *it = &me->kind[k];
+
+    it->count++;
+    it->elapsed_ns += elapsed_ns;
+    it->modeled_ns += modeled_ns;
+    if (elapsed_ns > it->max_ns) {
+        it->max_ns = elapsed_ns;
+    }
+    it->histogram[bucket_of(elapsed_ns)]++;
+    if (k != CMT_IO_STATS_PROGRESS) {
+        it->tx_bytes += req->data;
+    }
+    if (rc) {
+        it->errors++;
+        return;
+    }
+    if (k == CMT_IO_STATS_RX_ACCEPTED || k == CMT_IO_STATS_RX_REJECTED || k == CMT_IO_STATS_GIO) {
+        it->rx_bytes += rep->data;
+    }
+}
+
+void cmt_io_stats_dump(const cmt_io_stats_t *me) {
+    const char *env = getenv("CMT_STATS");
+    if (!env || !*env || strcmp(env, "0") == 0) {
+        return;
+    }
+
+    (void) fprintf(stderr, "%-12s %10s %8s %14s %14s %14s %12s %14s\n", "yield", "count", "errors", "tx-bytes",
+        "rx-bytes", "total-ns", "max-ns", "modeled-ns");
+    for (int k = 0; k < CMT_IO_STATS_KINDS; ++k) {
+        const cmt_io_stats_kind_t *it = &me->kind[k];
+        if (!it->count) {
+            continue;
+        }
+        (void) fprintf(stderr, "%-12s %10llu %8llu %14llu %14llu %14llu %12llu %14llu\n", kind_names[k],
+            (unsigned long long) it->count, (unsigned long long) it->errors, (unsigned long long) it->tx_bytes,
+            (unsigned long long) it->rx_bytes, (unsigned long long) it->elapsed_ns, (unsigned long long) it->max_ns,
+            (unsigned long long) it->modeled_ns);
+        for (int i = 0; i < CMT_IO_STATS_BUCKETS; ++i) {
+            if (!it->histogram[i]) {
+                continue;
+            }
+            bool last = i == CMT_IO_STATS_BUCKETS - 1;
+            (void) fprintf(stderr, "%12s %s 2^%-2d ns %10llu\n", "", last ? ">=" : " <", last ? i - 1 : i,
+                (unsigned long long) it->histogram[i]);
+        }
+    }
+    (void) fprintf(stderr, "%-12s %10llu total %10llu resident %10llu init-faults\n", "pages",
+        (unsigned long long) me->pages.total, (unsigned long long) me->pages.resident,
+        (unsigned long long) me->pages.init_faults);
+}
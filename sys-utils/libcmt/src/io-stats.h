@@ -0,0 +1,38 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* Yield statistics shared by the ioctl and mock drivers, not part of the public API */
+#ifndef CMT_IO_STATS_H
+#define CMT_IO_STATS_H
+#include "libcmt/io.h"
+
+/** Monotonic time in nanoseconds */
+uint64_t cmt_io_stats_now(void);
+
+/** Kind of the yield request @p req, @ref CMT_IO_STATS_PROGRESS and friends */
+int cmt_io_stats_kind_of(const cmt_io_yield_t *req);
+
+/** Kind named @p name (`tx-output`, ...), as printed by @ref cmt_io_stats_dump, or -1 */
+int cmt_io_stats_kind_from_name(const char *name, size_t length);
+
+/** Account a yield of request @p req and reply @p rep, that returned @p rc after @p elapsed_ns,
+ * @p modeled_ns by the cost model */
+void cmt_io_stats_record(cmt_io_stats_t *me, const cmt_io_yield_t *req, const cmt_io_yield_t *rep, int rc,
+    uint64_t elapsed_ns, uint64_t modeled_ns);
+
+/** Print @p me to stderr if @p CMT_STATS is set */
+void cmt_io_stats_dump(const cmt_io_stats_t *me);
+
+#endif /* CMT_IO_STATS_H */
@@ -0,0 +1,217 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "io-writer.h"
+#include "libcmt/util.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Single producer (the yield path) single consumer (the writer thread) ring.
+ * Each side only advances its own counter, and only takes the lock to sleep
+ * when the ring is full (producer) or empty (consumer), or to wake the other
+ * one up. */
+
+typedef struct {
+    uint8_t *data;
+    size_t capacity;
+    cmt_outlog_record_t record;
+    char filepath[256];
+} slot_t;
+
+struct cmt_io_writer {
+    slot_t slots[CMT_IO_WRITER_SLOTS];
+    atomic_size_t head; /* next slot to fill, written by the producer */
+    atomic_size_t tail; /* next slot to write, written by the consumer */
+    atomic_int error;   /* first write error */
+    atomic_bool stop;
+    atomic_bool producer_waiting;
+    atomic_bool consumer_waiting;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_t thread;
+    cmt_outlog_t *log;
+};
+
+static bool not_full(cmt_io_writer_t *me) {
+    return atomic_load(&me->head) - atomic_load(&me->tail) < CMT_IO_WRITER_SLOTS;
+}
+
+static bool not_empty_or_stop(cmt_io_writer_t *me) {
+    return atomic_load(&me->head) != atomic_load(&me->tail) || atomic_load(&me->stop);
+}
+
+/* the other side stores its counter before checking @p waiting, we set @p
+ * waiting before checking @p ready: one of us sees the other's store */
+static void wait_for(cmt_io_writer_t *me, atomic_bool *waiting, bool (*ready)(cmt_io_writer_t *)) {
+    (void) pthread_mutex_lock(&me->lock);
+    atomic_store(waiting, true);
+    while (!ready(me)) {
+        (void) pthread_cond_wait(&me->wake, &me->lock);
+    }
+    atomic_store(waiting, false);
+    (void) pthread_mutex_unlock(&me->lock);
+}
+
+static void wake_up(cmt_io_writer_t *me, atomic_bool *waiting) {
+    if (atomic_load(waiting)) {
+        (void) pthread_mutex_lock(&me->lock);
+        (void) pthread_cond_signal(&me->wake);
+        (void) pthread_mutex_unlock(&me->lock);
+    }
+}
+
+static int write_slot(cmt_io_writer_t *me, const slot_t *slot) {
+    if (me->log) {
+        return cmt_outlog_append(me->log, &slot->record, slot->data);
+    }
+    return cmt_util_write_whole_file(slot->filepath, slot->record.length, slot->data);
+}
+
+static void *run(void *arg) {
+    cmt_io_writer_t *me = arg;
+    for (;;) {
+        size_t tail = atomic_load_explicit(&me->tail, memory_order_relaxed);
+        if (tail == atomic_load(&me->head)) {
+            // stop is set after the last push, look at head once more
+            if (atomic_load(&me->stop) && tail == atomic_load(&me->head)) {
+                break;
+            }
+            wait_for(me, &me->consumer_waiting, not_empty_or_stop);
+            continue;
+        }
+
+        int rc = write_slot(me, &me->slots[tail % CMT_IO_WRITER_SLOTS]);
+        int expected = 0;
+        if (rc) {
+            (void) atomic_compare_exchange_strong(&me->error, &expected, rc);
+        }
+        atomic_store(&me->tail, tail + 1);
+        wake_up(me, &me->producer_waiting);
+    }
+    return NULL;
+}
+
+int cmt_io_writer_start(cmt_io_writer_t **me, cmt_outlog_t *log) {
+    if (!me) {
+        return -EINVAL;
+    }
+    cmt_io_writer_t *it = calloc(1, sizeof(*it));
+    if (!it) {
+        return -ENOMEM;
+    }
+    atomic_init(&it->head, 0);
+    atomic_init(&it->tail, 0);
+    atomic_init(&it->error, 0);
+    atomic_init(&it->stop, false);
+    atomic_init(&it->producer_waiting, false);
+    atomic_init(&it->consumer_waiting, false);
+    it->log = log;
+
+    int rc = pthread_mutex_init(&it->lock, NULL);
+    if (rc) {
+        free(it);
+        return -rc;
+    }
+    rc = pthread_cond_init(&it->wake, NULL);
+    if (rc) {
+        (void) pthread_mutex_destroy(&it->lock);
+        free(it);
+        return -rc;
+    }
+    rc = pthread_create(&it->thread, NULL, run, it);
+    if (rc) {
+        (void) pthread_cond_destroy(&it->wake);
+        (void) pthread_mutex_destroy(&it->lock);
+        free(it);
+        return -rc;
+    }
+    *me = it;
+    return 0;
+}
+
+int cmt_io_writer_push(cmt_io_writer_t *me, const char *filepath, const cmt_outlog_record_t *record,
+    const void *data) {
+    if (!me || !record || (!data && record->length)) {
+        return -EINVAL;
+    }
+    int rc = atomic_load(&me->error);
+    if (rc) {
+        return rc;
+    }
+
+    size_t head = atomic_load_explicit(&me->head, memory_order_relaxed);
+    if (!not_full(me)) { // back-pressure, every buffer is in flight
+        wait_for(me, &me->producer_waiting, not_full);
+    }
+
+    // buffers grow to the largest output seen and are reused from then on
+    slot_t *slot = &me->slots[head % CMT_IO_WRITER_SLOTS];
+    if (slot->capacity < record->length) {
+        uint8_t *p = realloc(slot->data, record->length);
+        if (!p) {
+            return -ENOMEM;
+        }
+        slot->data = p;
+        slot->capacity = record->length;
+    }
+    if (record->length) {
+        memcpy(slot->data, data, record->length);
+    }
+    slot->record = *record;
+    slot->filepath[0] = '\0';
+    if (filepath) {
+        // NOLINTNEXTLINE(cert-err33-c, clang-analyzer-security.insecureAPI.DeprecatedOrUnsafeBufferHandling)
+        snprintf(slot->filepath, sizeof slot->filepath, "%s", filepath);
+    }
+
+    // wake the writer up for batches rather than every output, see cmt_io_writer_kick
+    atomic_store(&me->head, head + 1);
+    if (head + 1 - atomic_load(&me->tail) >= CMT_IO_WRITER_SLOTS / 2) {
+        wake_up(me, &me->consumer_waiting);
+    }
+    return 0;
+}
+
+void cmt_io_writer_kick(cmt_io_writer_t *me) {
+    if (me) {
+        wake_up(me, &me->consumer_waiting);
+    }
+}
+
+int cmt_io_writer_stop(cmt_io_writer_t *me) {
+    if (!me) {
+        return -EINVAL;
+    }
+    (void) pthread_mutex_lock(&me->lock);
+    atomic_store(&me->stop, true);
+    (void) pthread_cond_signal(&me->wake);
+    (void) pthread_mutex_unlock(&me->lock);
+    (void) pthread_join(me->thread, NULL);
+
+    int rc = atomic_load(&me->error);
+    for (size_t i = 0; i < CMT_IO_WRITER_SLOTS; ++i) {
+        free(me->slots[i].data);
+    }
+    (void) pthread_cond_destroy(&me->wake);
+    (void) pthread_mutex_destroy(&me->lock);
+    free(me);
+    return rc;
+}
@@ -0,0 +1,51 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* Background writer of the mock outputs, see @ref CMT_IO_ASYNC_OUTPUTS, not part of the public API */
+#ifndef CMT_IO_WRITER_H
+#define CMT_IO_WRITER_H
+#include "libcmt/outlog.h"
+
+enum {
+    CMT_IO_WRITER_SLOTS = 16, /**< outputs in flight before the producer blocks, a power of two */
+};
+
+typedef struct cmt_io_writer cmt_io_writer_t;
+
+/** Start the writer thread
+ *
+ * @param [out] me  writer, release it with @ref cmt_io_writer_stop
+ * @param [in]  log records go to @p log if not NULL, owned by the thread until stopped, files otherwise
+ * @return 0 on success or a negative errno */
+int cmt_io_writer_start(cmt_io_writer_t **me, cmt_outlog_t *log);
+
+/** Copy @b record->length bytes of @p data into a pooled buffer and queue it,
+ * blocks while every buffer is in flight
+ *
+ * @param [in] filepath destination when writing a file per output
+ * @param [in] record   destination framing when writing to the log
+ * @return 0 on success, -ENOMEM or the error of an earlier write */
+int cmt_io_writer_push(cmt_io_writer_t *me, const char *filepath, const cmt_outlog_record_t *record,
+    const void *data);
+
+/** Have the thread write what is queued now, instead of waiting for a batch
+ * of @ref CMT_IO_WRITER_SLOTS / 2 outputs */
+void cmt_io_writer_kick(cmt_io_writer_t *me);
+
+/** Write everything queued, in order, then join the thread and release @p me
+ * @return 0 on success or the first write error */
+int cmt_io_writer_stop(cmt_io_writer_t *me);
+
+#endif /* CMT_IO_WRITER_H */
@@ -13,13 +13,7 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
-#include "libcmt/io.h"
-#include "libcmt/util.h"
-
-#include <stdbool.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
+#include "io-driver.h"
 
 #include <errno.h>
 #include <fcntl.h>
@@ -29,12 +23,10 @@
 
 #include <linux/cartesi/cmio.h>
 
-int cmt_io_init(cmt_io_driver_t *_me) {
+static int ioctl_init(cmt_io_driver_t *_me, const void *config, int flags) {
+    (void) config;
     int rc = 0;
 
-    if (!_me) {
-        return -EINVAL;
-    }
     cmt_io_driver_ioctl_t *me = &_me->ioctl;
     me->fd = open("/dev/cmio", O_RDWR);
 
@@ -49,20 +41,21 @@ int cmt_io_init(cmt_io_driver_t *_me) {
         goto do_close;
     }
 
-    void *tx = mmap((void *) setup.tx.data, setup.tx.length, PROT_READ | PROT_WRITE, MAP_SHARED, me->fd, 0);
+    void *tx =
+        cmt_io_mmap((void *) setup.tx.data, setup.tx.length, PROT_READ | PROT_WRITE, MAP_SHARED, me->fd, flags);
     if (tx == MAP_FAILED) {
         rc = -errno;
         goto do_close;
     }
 
-    void *rx = mmap((void *) setup.rx.data, setup.rx.length, PROT_READ, MAP_SHARED, me->fd, 0);
+    void *rx = cmt_io_mmap((void *) setup.rx.data, setup.rx.length, PROT_READ, MAP_SHARED, me->fd, flags);
     if (rx == MAP_FAILED) {
         rc = -errno;
         goto do_unmap;
     }
 
-    cmt_buf_init(me->tx, setup.tx.length, tx);
-    cmt_buf_init(me->rx, setup.rx.length, rx);
+    cmt_buf_init(me->base.tx, setup.tx.length, tx);
+    cmt_buf_init(me->base.rx, setup.rx.length, rx);
     return 0;
 
 do_unmap:
@@ -72,36 +65,15 @@ do_close:
     return rc;
 }
 
-void cmt_io_fini(cmt_io_driver_t *_me) {
-    if (!_me) {
-        return;
-    }
+static void ioctl_fini(cmt_io_driver_t *_me) {
     cmt_io_driver_ioctl_t *me = &_me->ioctl;
 
-    munmap(me->tx->begin, cmt_buf_length(me->tx));
-    munmap(me->rx->begin, cmt_buf_length(me->rx));
+    munmap(me->base.tx->begin, cmt_buf_length(me->base.tx));
+    munmap(me->base.rx->begin, cmt_buf_length(me->base.rx));
     close(me->fd);
-
-    memset(me, 0, sizeof(*me));
     me->fd = -1;
 }
 
-cmt_buf_t cmt_io_get_tx(cmt_io_driver_t *me) {
-    const cmt_buf_t empty = {NULL, NULL};
-    if (!me) {
-        return empty;
-    }
-    return *me->ioctl.tx;
-}
-
-cmt_buf_t cmt_io_get_rx(cmt_io_driver_t *me) {
-    const cmt_buf_t empty = {NULL, NULL};
-    if (!me) {
-        return empty;
-    }
-    return *me->ioctl.rx;
-}
-
 static uint64_t pack(struct cmt_io_yield *rr) {
     // clang-format off
     return ((uint64_t) rr->dev    << 56)
@@ -123,42 +95,21 @@ static struct cmt_io_yield unpack(uint64_t x) {
     return out;
 }
 
-/* io-mock.c:cmt_io_yield emulates this behavior (go and check it does if you change it) */
-int cmt_io_yield(cmt_io_driver_t *_me, struct cmt_io_yield *rr) {
-    if (!_me) {
-        return -EINVAL;
-    }
-    if (!rr) {
-        return -EINVAL;
-    }
+/* io-mock.c:mock_yield emulates this behavior (go and check it does if you change it) */
+static int ioctl_yield(cmt_io_driver_t *_me, struct cmt_io_yield *rr) {
     cmt_io_driver_ioctl_t *me = &_me->ioctl;
 
-    bool debug = cmt_util_debug_enabled();
-    if (debug) {
-        (void) fprintf(stderr,
-            "tohost {\n"
-            "\t.dev = %d,\n"
-            "\t.cmd = %d,\n"
-            "\t.reason = %d,\n"
-            "\t.data = %d,\n"
-            "};\n",
-            rr->dev, rr->cmd, rr->reason, rr->data);
-    }
     uint64_t req = pack(rr);
     if (ioctl(me->fd, IOCTL_CMIO_YIELD, &req)) {
         return -errno;
     }
     *rr = unpack(req);
-
-    if (debug) {
-        (void) fprintf(stderr,
-            "fromhost {\n"
-            "\t.dev = %d,\n"
-            "\t.cmd = %d,\n"
-            "\t.reason = %d,\n"
-            "\t.data = %d,\n"
-            "};\n",
-            rr->dev, rr->cmd, rr->reason, rr->data);
-    }
     return 0;
 }
+
+const struct cmt_io_ops cmt_io_ioctl_ops = {
+    .name = "ioctl",
+    .init = ioctl_init,
+    .fini = ioctl_fini,
+    .yield = ioctl_yield,
+};
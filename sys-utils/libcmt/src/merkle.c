@@ -15,6 +15,7 @@
  */
 #include "libcmt/merkle.h"
 #include "libcmt/util.h"
+#include "probes.h"
 
 #include <errno.h>
 #include <stdbool.h>
@@ -154,7 +155,9 @@ uint64_t cmt_merkle_get_leaf_count(cmt_merkle_t *me) {
 int cmt_merkle_push_back(cmt_merkle_t *me, const uint8_t hash[CMT_KECCAK_LENGTH]) {
     const uint64_t max_count =
         (CMT_MERKLE_TREE_HEIGHT < 8 * sizeof(uint64_t)) ? (UINT64_C(1) << CMT_MERKLE_TREE_HEIGHT) : UINT64_MAX;
+    CMT_PROBE1(merkle__entry, me->leaf_count);
     if (me->leaf_count == max_count) {
+        CMT_PROBE2(merkle__return, me->leaf_count, -ENOBUFS);
         return -ENOBUFS;
     }
     uint8_t right[CMT_KECCAK_LENGTH];
@@ -173,6 +176,7 @@ int cmt_merkle_push_back(cmt_merkle_t *me, const uint8_t hash[CMT_KECCAK_LENGTH]
         }
     }
     ++me->leaf_count;
+    CMT_PROBE2(merkle__return, me->leaf_count, 0);
     return 0;
 }
 
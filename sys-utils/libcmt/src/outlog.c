@@ -0,0 +1,114 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "libcmt/outlog.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    BUFFER_LENGTH = 1 << 20, /**< stdio buffer, writes reach the file in 1MB batches */
+};
+
+static int put(cmt_outlog_t *me, size_t length, const void *data) {
+    if (length && fwrite(data, 1, length, me->file) != length) {
+        return -EIO;
+    }
+    me->offset += length;
+    return 0;
+}
+
+int cmt_outlog_open(cmt_outlog_t *me, const char *filepath) {
+    if (!me || !filepath) {
+        return -EINVAL;
+    }
+
+    memset(me, 0, sizeof(*me));
+    FILE *file = fopen(filepath, "wb");
+    if (!file) {
+        return -errno;
+    }
+    (void) setvbuf(file, NULL, _IOFBF, BUFFER_LENGTH);
+    me->file = file;
+
+    cmt_outlog_header_t header = {
+        .magic = {'C', 'M', 'T', 'O', 'L', 'O', 'G', '1'},
+        .version = CMT_OUTLOG_VERSION,
+    };
+    int rc = put(me, sizeof(header), &header);
+    if (rc) {
+        (void) fclose(file);
+        me->file = NULL;
+    }
+    return rc;
+}
+
+int cmt_outlog_append(cmt_outlog_t *me, const cmt_outlog_record_t *record, const void *data) {
+    static const uint8_t zeros[CMT_OUTLOG_ALIGN] = {0};
+    if (!me || !me->file || !record || (!data && record->length)) {
+        return -EINVAL;
+    }
+
+    if (me->count == me->capacity) {
+        uint64_t capacity = me->capacity ? 2 * me->capacity : 1024;
+        uint64_t *index = realloc(me->index, capacity * sizeof(*index));
+        if (!index) {
+            return -ENOMEM;
+        }
+        me->index = index;
+        me->capacity = capacity;
+    }
+
+    uint64_t offset = me->offset;
+    cmt_outlog_record_t it = *record;
+    it.pad = 0;
+    size_t padding = -(size_t) it.length & (CMT_OUTLOG_ALIGN - 1);
+
+    // clang-format off
+    int rc = put(me, sizeof(it), &it);
+    if (!rc) rc = put(me, it.length, data);
+    if (!rc) rc = put(me, padding, zeros);
+    // clang-format on
+    if (rc) {
+        return rc;
+    }
+    me->index[me->count++] = offset;
+    return 0;
+}
+
+int cmt_outlog_close(cmt_outlog_t *me) {
+    if (!me || !me->file) {
+        return -EINVAL;
+    }
+
+    cmt_outlog_footer_t footer = {
+        .index = me->offset,
+        .count = me->count,
+        .magic = {'C', 'M', 'T', 'O', 'L', 'O', 'G', 'X'},
+    };
+
+    // clang-format off
+    int rc = put(me, me->count * sizeof(*me->index), me->index);
+    if (!rc) rc = put(me, sizeof(footer), &footer);
+    // clang-format on
+    if (fclose(me->file) && !rc) {
+        rc = -errno;
+    }
+    free(me->index);
+    memset(me, 0, sizeof(*me));
+    return rc;
+}
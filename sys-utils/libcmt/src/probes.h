@@ -0,0 +1,50 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* USDT probes, compiled in with `make USDT=1` (requires <sys/sdt.h>), otherwise nothing.
+ *
+ * Every probe is in the `libcmt` provider, list them with:
+ *     bpftrace -l 'usdt:/path/to/libcmt.so:libcmt:*'
+ *
+ * | probe            | arguments                                      |
+ * |------------------|------------------------------------------------|
+ * | yield__entry     | cmd, reason, data                              |
+ * | yield__return    | cmd, reason, data (the reply), rc              |
+ * | emit__entry      | kind (CMT_TRACE_EMIT_*), payload length        |
+ * | emit__return     | kind, rc, output index (vouchers and notices)  |
+ * | finish__entry    | accept_previous_request                        |
+ * | finish__return   | rc, next request type, next payload length     |
+ * | gio__entry       | domain, id length                              |
+ * | gio__return      | rc, response code, response length             |
+ * | merkle__entry    | leaf count                                     |
+ * | merkle__return   | leaf count, rc                                 |
+ */
+#ifndef CMT_PROBES_H
+#define CMT_PROBES_H
+
+#ifdef CMT_USDT
+#include <sys/sdt.h>
+#define CMT_PROBE1(name, a) DTRACE_PROBE1(libcmt, name, a)
+#define CMT_PROBE2(name, a, b) DTRACE_PROBE2(libcmt, name, a, b)
+#define CMT_PROBE3(name, a, b, c) DTRACE_PROBE3(libcmt, name, a, b, c)
+#define CMT_PROBE4(name, a, b, c, d) DTRACE_PROBE4(libcmt, name, a, b, c, d)
+#else
+#define CMT_PROBE1(name, a) ((void) 0)
+#define CMT_PROBE2(name, a, b) ((void) 0)
+#define CMT_PROBE3(name, a, b, c) ((void) 0)
+#define CMT_PROBE4(name, a, b, c, d) ((void) 0)
+#endif
+
+#endif /* CMT_PROBES_H */
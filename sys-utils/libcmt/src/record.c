@@ -0,0 +1,158 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "libcmt/record.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+enum {
+    RECORD_BUFFER_LENGTH = 1 << 20, /**< stdio buffer, events reach the file in 1MB batches */
+    RECORD_MIN_ZEROS = 4,           /**< shorter runs of zeros stay in the literals */
+};
+
+static size_t put_varint(uint8_t *p, uint64_t x) {
+    size_t n = 0;
+    for (; x >= 0x80; x >>= 7) {
+        p[n++] = (uint8_t) (x | 0x80);
+    }
+    p[n++] = (uint8_t) x;
+    return n;
+}
+
+static uint64_t zigzag(int64_t x) {
+    return ((uint64_t) x << 1) ^ (uint64_t) (x >> 63);
+}
+
+static int record_put(cmt_record_t *me, size_t length, const void *data) {
+    if (length && fwrite(data, 1, length, me->file) != length) {
+        return -EIO;
+    }
+    return 0;
+}
+
+/* literal count, literals, zero count, ... until @p length bytes are covered */
+static int record_put_compressed(cmt_record_t *me, size_t length, const uint8_t *data) {
+    uint8_t counts[10];
+    size_t i = 0;
+    while (i < length) {
+        // the literals end where a long enough run of zeros starts
+        size_t literals = i;
+        size_t zeros = 0;
+        for (; literals < length; ++literals) {
+            for (zeros = 0; literals + zeros < length && data[literals + zeros] == 0; ++zeros) {
+                ;
+            }
+            if (zeros >= RECORD_MIN_ZEROS || literals + zeros == length) {
+                break;
+            }
+            literals += zeros;
+            zeros = 0;
+        }
+
+        int rc = record_put(me, put_varint(counts, literals - i), counts);
+        if (!rc) {
+            rc = record_put(me, literals - i, data + i);
+        }
+        if (!rc) {
+            rc = record_put(me, put_varint(counts, zeros), counts);
+        }
+        if (rc) {
+            return rc;
+        }
+        i = literals + zeros;
+    }
+    return 0;
+}
+
+int cmt_record_open(cmt_record_t *me, const char *filepath, int flags, size_t tx_length, size_t rx_length) {
+    if (!me || !filepath || (flags & ~CMT_RECORD_COMPRESS)) {
+        return -EINVAL;
+    }
+
+    memset(me, 0, sizeof(*me));
+    FILE *file = fopen(filepath, "wb");
+    if (!file) {
+        return -errno;
+    }
+    (void) setvbuf(file, NULL, _IOFBF, RECORD_BUFFER_LENGTH);
+    me->file = file;
+    me->flags = flags;
+
+    cmt_record_header_t header = {
+        .magic = {'C', 'M', 'T', 'R', 'C', 'R', 'D', '1'},
+        .version = CMT_RECORD_VERSION,
+        .flags = flags,
+        .tx_length = tx_length,
+        .rx_length = rx_length,
+    };
+    int rc = record_put(me, sizeof(header), &header);
+    if (rc) {
+        (void) fclose(file);
+        me->file = NULL;
+    }
+    return rc;
+}
+
+int cmt_record_append(cmt_record_t *me, const cmt_io_yield_t *request, int rc, const cmt_io_yield_t *reply,
+    const cmt_buf_t *rx) {
+    if (!me || !me->file || !request || !reply || !rx) {
+        return -EINVAL;
+    }
+
+    uint32_t length = 0;
+    if (!rc && request->cmd == HTIF_YIELD_CMD_MANUAL) {
+        if (reply->data > cmt_buf_length(rx)) {
+            return -ENOBUFS;
+        }
+        length = reply->data;
+    }
+
+    uint8_t event[1 + (6 * 10)];
+    size_t n = 0;
+    event[n++] = request->cmd;
+    n += put_varint(event + n, request->reason);
+    n += put_varint(event + n, request->data);
+    n += put_varint(event + n, zigzag(rc));
+    if (!rc) {
+        n += put_varint(event + n, reply->reason);
+        n += put_varint(event + n, reply->data);
+        n += put_varint(event + n, length);
+    }
+
+    int err = record_put(me, n, event);
+    if (!err && length) {
+        err = (me->flags & CMT_RECORD_COMPRESS) ? record_put_compressed(me, length, rx->begin) :
+                                                   record_put(me, length, rx->begin);
+    }
+    if (err) {
+        return err;
+    }
+    me->events++;
+    return 0;
+}
+
+int cmt_record_close(cmt_record_t *me) {
+    if (!me || !me->file) {
+        return -EINVAL;
+    }
+    int rc = 0;
+    if (fclose(me->file)) {
+        rc = -errno;
+    }
+    memset(me, 0, sizeof(*me));
+    return rc;
+}
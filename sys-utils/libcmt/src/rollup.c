@@ -16,7 +16,9 @@
 #include "libcmt/rollup.h"
 #include "libcmt/abi.h"
 #include "libcmt/merkle.h"
+#include "libcmt/trace.h"
 #include "libcmt/util.h"
+#include "probes.h"
 
 #include <errno.h>
 #include <stdio.h>
@@ -34,18 +36,31 @@
 // EvmAdvance(uint256,address,address,uint256,uint256,uint256,uint256,bytes)
 #define EVM_ADVANCE CMT_ABI_FUNSEL(0x41, 0x5b, 0xf3, 0x63)
 
+enum {
+    EMIT_CHUNK_LENGTH = 16 << 10, /**< payload copied and then hashed at a time, fits in L1 */
+};
+
 #define DBG(X) debug(X, #X, __FILE__, __LINE__)
 static int debug(int rc, const char *expr, const char *file, int line) {
     if (rc == 0) {
         return 0;
     }
 
-    if (cmt_util_debug_enabled()) {
+    cmt_trace(CMT_TRACE_ERROR, 0, 0, line, rc);
+    if (cmt_util_debug_enabled() && !cmt_trace_enabled()) {
         (void) fprintf(stderr, "%s:%d Error %s on `%s'\n", file, line, expr, strerror(-rc));
     }
     return rc;
 }
 
+/* yield @p req, that sends an output of @p kind (@ref CMT_TRACE_EMIT_VOUCHER, ...) */
+static int yield_output(union cmt_io_driver *io, uint8_t kind, struct cmt_io_yield *req) {
+    uint32_t size = req->data;
+    int rc = DBG(cmt_io_yield(io, req));
+    cmt_trace(CMT_TRACE_EMIT, kind, 0, size, rc);
+    return rc;
+}
+
 int cmt_rollup_init(cmt_rollup_t *me) {
     if (!me) {
         return -EINVAL;
@@ -57,6 +72,40 @@ int cmt_rollup_init(cmt_rollup_t *me) {
     }
 
     cmt_merkle_init(me->merkle);
+    me->arena = NULL;
+    me->reserved.kind = 0;
+    return 0;
+}
+
+int cmt_rollup_init_loopback(cmt_rollup_t *me, const cmt_io_loopback_t *callbacks) {
+    if (!me) {
+        return -EINVAL;
+    }
+
+    int rc = DBG(cmt_io_init_loopback(me->io, callbacks));
+    if (rc) {
+        return rc;
+    }
+
+    cmt_merkle_init(me->merkle);
+    me->arena = NULL;
+    me->reserved.kind = 0;
+    return 0;
+}
+
+int cmt_rollup_init_mock(cmt_rollup_t *me, const cmt_io_mock_config_t *config) {
+    if (!me) {
+        return -EINVAL;
+    }
+
+    int rc = DBG(cmt_io_init_mock(me->io, config));
+    if (rc) {
+        return rc;
+    }
+
+    cmt_merkle_init(me->merkle);
+    me->arena = NULL;
+    me->reserved.kind = 0;
     return 0;
 }
 
@@ -69,46 +118,70 @@ void cmt_rollup_fini(cmt_rollup_t *me) {
     cmt_merkle_fini(me->merkle);
 }
 
-int cmt_rollup_emit_voucher(cmt_rollup_t *me, const cmt_abi_address_t *address,
-    const cmt_abi_u256_t *value, const cmt_abi_bytes_t *payload, uint64_t *index) {
-    if (!me) {
+/* tx is about to be overwritten, a pending reservation can't be committed anymore */
+static void drop_reservation(cmt_rollup_t *me) {
+    me->reserved.kind = 0;
+}
+
+static int check_iov(const cmt_abi_bytes_iov_t *payload) {
+    if (!payload || (!payload->iov && payload->count)) {
         return -EINVAL;
     }
-    if (!payload || (!payload->data && payload->length)) {
-        return -EINVAL;
+    for (size_t i = 0; i < payload->count; ++i) {
+        if (!payload->iov[i].data && payload->iov[i].length) {
+            return -EINVAL;
+        }
     }
+    return 0;
+}
 
-    cmt_buf_t tx[1] = {cmt_io_get_tx(me->io)};
-    cmt_buf_t wr[1] = {*tx};
-    cmt_buf_t of[1];
-    cmt_buf_t frame[1];
-
-    // clang-format off
-    if (DBG(cmt_abi_put_funsel(wr, VOUCHER))
-    ||  DBG(cmt_abi_mark_frame(wr, frame))
-    ||  DBG(cmt_abi_put_address(wr, address))
-    ||  DBG(cmt_abi_put_uint256(wr, value))
-    ||  DBG(cmt_abi_put_bytes_s(wr, of))
-    ||  DBG(cmt_abi_put_bytes_d(wr, of, frame, payload))) {
-        return -ENOBUFS;
+/* Encode the dynamic part of @p payload, copying each fragment once and
+ * absorbing it into @p st right after the copy, a chunk at a time so large
+ * fragments are still in L1 when hashed. Everything written to @p tx before
+ * the payload is absorbed first. */
+static int put_bytes_d_iov_hashed(const cmt_buf_t *tx, cmt_buf_t *wr, cmt_buf_t *of, const cmt_buf_t *frame,
+    const cmt_abi_bytes_iov_t *payload, cmt_keccak_t *st) {
+    cmt_buf_t res[1];
+    int rc = cmt_abi_reserve_bytes_d(wr, of, cmt_abi_bytes_iov_length(payload), res, frame->begin);
+    if (rc) {
+        return rc;
     }
-    // clang-format on
 
-    size_t used_space = wr->begin - tx->begin;
+    cmt_keccak_init(st);
+    cmt_keccak_update(st, res->begin - tx->begin, tx->begin);
+    uint8_t *p = res->begin;
+    for (size_t i = 0; i < payload->count; ++i) {
+        const uint8_t *data = payload->iov[i].data;
+        for (size_t left = payload->iov[i].length; left;) {
+            size_t n = left < EMIT_CHUNK_LENGTH ? left : EMIT_CHUNK_LENGTH;
+            memcpy(p, data, n);
+            cmt_keccak_update(st, n, p);
+            data += n;
+            p += n;
+            left -= n;
+        }
+    }
+    cmt_keccak_update(st, res->end - p, p); // padding
+    return 0;
+}
+
+/* yield an output whose leaf hash is being computed in @p st */
+static int emit_output_hashed(cmt_rollup_t *me, uint8_t kind, size_t used_space, cmt_keccak_t *st, uint64_t *index) {
     struct cmt_io_yield req[1] = {{
         .dev = HTIF_DEVICE_YIELD,
         .cmd = HTIF_YIELD_CMD_AUTOMATIC,
         .reason = HTIF_YIELD_AUTOMATIC_REASON_TX_OUTPUT,
         .data = used_space,
     }};
-    int rc = DBG(cmt_io_yield(me->io, req));
+    int rc = yield_output(me->io, kind, req);
     if (rc) {
         return rc;
     }
 
     uint64_t count = cmt_merkle_get_leaf_count(me->merkle);
-
-    rc = cmt_merkle_push_back_data(me->merkle, used_space, tx->begin);
+    uint8_t hash[CMT_KECCAK_LENGTH];
+    cmt_keccak_final(st, hash);
+    rc = cmt_merkle_push_back(me->merkle, hash);
     if (rc) {
         return rc;
     }
@@ -116,16 +189,16 @@ int cmt_rollup_emit_voucher(cmt_rollup_t *me, const cmt_abi_address_t *address,
     if (index) {
         *index = count;
     }
-
     return 0;
 }
 
-int cmt_rollup_emit_delegate_call_voucher(cmt_rollup_t *me,
-    const cmt_abi_address_t *address, const cmt_abi_bytes_t *payload, uint64_t *index) {
+static int emit_voucher_iov(cmt_rollup_t *me, const cmt_abi_address_t *address, const cmt_abi_u256_t *value,
+    const cmt_abi_bytes_iov_t *payload, uint64_t *index) {
     if (!me) {
         return -EINVAL;
     }
-    if (!payload || (!payload->data && payload->length)) {
+    drop_reservation(me);
+    if (check_iov(payload)) {
         return -EINVAL;
     }
 
@@ -133,48 +206,74 @@ int cmt_rollup_emit_delegate_call_voucher(cmt_rollup_t *me,
     cmt_buf_t wr[1] = {*tx};
     cmt_buf_t of[1];
     cmt_buf_t frame[1];
+    cmt_keccak_t st[1];
 
     // clang-format off
-    if (DBG(cmt_abi_put_funsel(wr, DELEGATE_CALL_VOUCHER))
+    if (DBG(cmt_abi_put_funsel(wr, VOUCHER))
     ||  DBG(cmt_abi_mark_frame(wr, frame))
     ||  DBG(cmt_abi_put_address(wr, address))
+    ||  DBG(cmt_abi_put_uint256(wr, value))
     ||  DBG(cmt_abi_put_bytes_s(wr, of))
-    ||  DBG(cmt_abi_put_bytes_d(wr, of, frame, payload))) {
+    ||  DBG(put_bytes_d_iov_hashed(tx, wr, of, frame, payload, st))) {
         return -ENOBUFS;
     }
     // clang-format on
 
-    size_t used_space = wr->begin - tx->begin;
-    struct cmt_io_yield req[1] = {{
-        .dev = HTIF_DEVICE_YIELD,
-        .cmd = HTIF_YIELD_CMD_AUTOMATIC,
-        .reason = HTIF_YIELD_AUTOMATIC_REASON_TX_OUTPUT,
-        .data = used_space,
-    }};
-    int rc = DBG(cmt_io_yield(me->io, req));
-    if (rc) {
-        return rc;
-    }
+    return emit_output_hashed(me, CMT_TRACE_EMIT_VOUCHER, wr->begin - tx->begin, st, index);
+}
 
-    uint64_t count = cmt_merkle_get_leaf_count(me->merkle);
+int cmt_rollup_emit_voucher_iov(cmt_rollup_t *me, const cmt_abi_address_t *address, const cmt_abi_u256_t *value,
+    const cmt_abi_bytes_iov_t *payload, uint64_t *index) {
+    CMT_PROBE2(emit__entry, CMT_TRACE_EMIT_VOUCHER, check_iov(payload) ? 0 : cmt_abi_bytes_iov_length(payload));
+    int rc = emit_voucher_iov(me, address, value, payload, index);
+    CMT_PROBE3(emit__return, CMT_TRACE_EMIT_VOUCHER, rc, rc == 0 && index ? *index : 0);
+    return rc;
+}
 
-    rc = cmt_merkle_push_back_data(me->merkle, used_space, tx->begin);
-    if (rc) {
-        return rc;
+static int emit_delegate_call_voucher_iov(cmt_rollup_t *me, const cmt_abi_address_t *address,
+    const cmt_abi_bytes_iov_t *payload, uint64_t *index) {
+    if (!me) {
+        return -EINVAL;
+    }
+    drop_reservation(me);
+    if (check_iov(payload)) {
+        return -EINVAL;
     }
 
-    if (index) {
-        *index = count;
+    cmt_buf_t tx[1] = {cmt_io_get_tx(me->io)};
+    cmt_buf_t wr[1] = {*tx};
+    cmt_buf_t of[1];
+    cmt_buf_t frame[1];
+    cmt_keccak_t st[1];
+
+    // clang-format off
+    if (DBG(cmt_abi_put_funsel(wr, DELEGATE_CALL_VOUCHER))
+    ||  DBG(cmt_abi_mark_frame(wr, frame))
+    ||  DBG(cmt_abi_put_address(wr, address))
+    ||  DBG(cmt_abi_put_bytes_s(wr, of))
+    ||  DBG(put_bytes_d_iov_hashed(tx, wr, of, frame, payload, st))) {
+        return -ENOBUFS;
     }
+    // clang-format on
 
-    return 0;
+    return emit_output_hashed(me, CMT_TRACE_EMIT_DELEGATE_CALL_VOUCHER, wr->begin - tx->begin, st, index);
 }
 
-int cmt_rollup_emit_notice(cmt_rollup_t *me, const cmt_abi_bytes_t *payload, uint64_t *index) {
+int cmt_rollup_emit_delegate_call_voucher_iov(cmt_rollup_t *me, const cmt_abi_address_t *address,
+    const cmt_abi_bytes_iov_t *payload, uint64_t *index) {
+    CMT_PROBE2(emit__entry, CMT_TRACE_EMIT_DELEGATE_CALL_VOUCHER,
+        check_iov(payload) ? 0 : cmt_abi_bytes_iov_length(payload));
+    int rc = emit_delegate_call_voucher_iov(me, address, payload, index);
+    CMT_PROBE3(emit__return, CMT_TRACE_EMIT_DELEGATE_CALL_VOUCHER, rc, rc == 0 && index ? *index : 0);
+    return rc;
+}
+
+static int emit_notice_iov(cmt_rollup_t *me, const cmt_abi_bytes_iov_t *payload, uint64_t *index) {
     if (!me) {
         return -EINVAL;
     }
-    if (!payload || (!payload->data && payload->length)) {
+    drop_reservation(me);
+    if (check_iov(payload)) {
         return -EINVAL;
     }
 
@@ -182,46 +281,91 @@ int cmt_rollup_emit_notice(cmt_rollup_t *me, const cmt_abi_bytes_t *payload, uin
     cmt_buf_t wr[1] = {*tx};
     cmt_buf_t of[1];
     cmt_buf_t frame[1];
+    cmt_keccak_t st[1];
 
     // clang-format off
     if (DBG(cmt_abi_put_funsel(wr, NOTICE))
     ||  DBG(cmt_abi_mark_frame(wr, frame))
     ||  DBG(cmt_abi_put_bytes_s(wr, of))
-    ||  DBG(cmt_abi_put_bytes_d(wr, of, frame, payload))) {
+    ||  DBG(put_bytes_d_iov_hashed(tx, wr, of, frame, payload, st))) {
         return -ENOBUFS;
     }
     // clang-format on
 
-    size_t used_space = wr->begin - tx->begin;
-    struct cmt_io_yield req[1] = {{
-        .dev = HTIF_DEVICE_YIELD,
-        .cmd = HTIF_YIELD_CMD_AUTOMATIC,
-        .reason = HTIF_YIELD_AUTOMATIC_REASON_TX_OUTPUT,
-        .data = used_space,
-    }};
-    int rc = DBG(cmt_io_yield(me->io, req));
-    if (rc) {
-        return rc;
+    return emit_output_hashed(me, CMT_TRACE_EMIT_NOTICE, wr->begin - tx->begin, st, index);
+}
+
+int cmt_rollup_emit_notice_iov(cmt_rollup_t *me, const cmt_abi_bytes_iov_t *payload, uint64_t *index) {
+    CMT_PROBE2(emit__entry, CMT_TRACE_EMIT_NOTICE, check_iov(payload) ? 0 : cmt_abi_bytes_iov_length(payload));
+    int rc = emit_notice_iov(me, payload, index);
+    CMT_PROBE3(emit__return, CMT_TRACE_EMIT_NOTICE, rc, rc == 0 && index ? *index : 0);
+    return rc;
+}
+
+/* a contiguous payload is a single fragment, copied and hashed in the same pass */
+static int single_fragment(const cmt_abi_bytes_t *payload, cmt_abi_bytes_iov_t *iov) {
+    if (!payload || (!payload->data && payload->length)) {
+        return -EINVAL;
     }
+    iov->count = 1;
+    iov->iov = payload;
+    return 0;
+}
 
-    uint64_t count = cmt_merkle_get_leaf_count(me->merkle);
+static int emit_voucher(cmt_rollup_t *me, const cmt_abi_address_t *address, const cmt_abi_u256_t *value,
+    const cmt_abi_bytes_t *payload, uint64_t *index) {
+    cmt_abi_bytes_iov_t iov;
+    if (single_fragment(payload, &iov)) {
+        return -EINVAL;
+    }
+    return emit_voucher_iov(me, address, value, &iov, index);
+}
 
-    rc = cmt_merkle_push_back_data(me->merkle, used_space, tx->begin);
-    if (rc) {
-        return rc;
+int cmt_rollup_emit_voucher(cmt_rollup_t *me, const cmt_abi_address_t *address, const cmt_abi_u256_t *value,
+    const cmt_abi_bytes_t *payload, uint64_t *index) {
+    CMT_PROBE2(emit__entry, CMT_TRACE_EMIT_VOUCHER, payload ? payload->length : 0);
+    int rc = emit_voucher(me, address, value, payload, index);
+    CMT_PROBE3(emit__return, CMT_TRACE_EMIT_VOUCHER, rc, rc == 0 && index ? *index : 0);
+    return rc;
+}
+
+static int emit_delegate_call_voucher(cmt_rollup_t *me, const cmt_abi_address_t *address,
+    const cmt_abi_bytes_t *payload, uint64_t *index) {
+    cmt_abi_bytes_iov_t iov;
+    if (single_fragment(payload, &iov)) {
+        return -EINVAL;
     }
+    return emit_delegate_call_voucher_iov(me, address, &iov, index);
+}
 
-    if (index) {
-        *index = count;
+int cmt_rollup_emit_delegate_call_voucher(cmt_rollup_t *me, const cmt_abi_address_t *address, const cmt_abi_bytes_t *payload,
+    uint64_t *index) {
+    CMT_PROBE2(emit__entry, CMT_TRACE_EMIT_DELEGATE_CALL_VOUCHER, payload ? payload->length : 0);
+    int rc = emit_delegate_call_voucher(me, address, payload, index);
+    CMT_PROBE3(emit__return, CMT_TRACE_EMIT_DELEGATE_CALL_VOUCHER, rc, rc == 0 && index ? *index : 0);
+    return rc;
+}
+
+static int emit_notice(cmt_rollup_t *me, const cmt_abi_bytes_t *payload, uint64_t *index) {
+    cmt_abi_bytes_iov_t iov;
+    if (single_fragment(payload, &iov)) {
+        return -EINVAL;
     }
+    return emit_notice_iov(me, &iov, index);
+}
 
-    return 0;
+int cmt_rollup_emit_notice(cmt_rollup_t *me, const cmt_abi_bytes_t *payload, uint64_t *index) {
+    CMT_PROBE2(emit__entry, CMT_TRACE_EMIT_NOTICE, payload ? payload->length : 0);
+    int rc = emit_notice(me, payload, index);
+    CMT_PROBE3(emit__return, CMT_TRACE_EMIT_NOTICE, rc, rc == 0 && index ? *index : 0);
+    return rc;
 }
 
-int cmt_rollup_emit_report(cmt_rollup_t *me, const cmt_abi_bytes_t *payload) {
+static int emit_report(cmt_rollup_t *me, const cmt_abi_bytes_t *payload) {
     if (!me) {
         return -EINVAL;
     }
+    drop_reservation(me);
     if (!payload || (!payload->data && payload->length)) {
         return -EINVAL;
     }
@@ -241,13 +385,234 @@ int cmt_rollup_emit_report(cmt_rollup_t *me, const cmt_abi_bytes_t *payload) {
         .reason = HTIF_YIELD_AUTOMATIC_REASON_TX_REPORT,
         .data = payload->length,
     }};
-    return DBG(cmt_io_yield(me->io, req));
+    return yield_output(me->io, CMT_TRACE_EMIT_REPORT, req);
 }
 
-int cmt_rollup_emit_exception(cmt_rollup_t *me, const cmt_abi_bytes_t *payload) {
+int cmt_rollup_emit_report(cmt_rollup_t *me, const cmt_abi_bytes_t *payload) {
+    CMT_PROBE2(emit__entry, CMT_TRACE_EMIT_REPORT, payload ? payload->length : 0);
+    int rc = emit_report(me, payload);
+    CMT_PROBE3(emit__return, CMT_TRACE_EMIT_REPORT, rc, 0);
+    return rc;
+}
+
+static int emit_report_iov(cmt_rollup_t *me, const cmt_abi_bytes_iov_t *payload) {
+    if (!me) {
+        return -EINVAL;
+    }
+    drop_reservation(me);
+    if (check_iov(payload)) {
+        return -EINVAL;
+    }
+
+    size_t length = cmt_abi_bytes_iov_length(payload);
+    cmt_buf_t tx[1] = {cmt_io_get_tx(me->io)};
+    cmt_buf_t wr[1] = {*tx};
+    if (cmt_buf_split(tx, length, wr, tx)) {
+        return -ENOBUFS;
+    }
+
+    uint8_t *p = wr->begin;
+    for (size_t i = 0; i < payload->count; ++i) {
+        if (payload->iov[i].length) {
+            memcpy(p, payload->iov[i].data, payload->iov[i].length);
+            p += payload->iov[i].length;
+        }
+    }
+    struct cmt_io_yield req[1] = {{
+        .dev = HTIF_DEVICE_YIELD,
+        .cmd = HTIF_YIELD_CMD_AUTOMATIC,
+        .reason = HTIF_YIELD_AUTOMATIC_REASON_TX_REPORT,
+        .data = length,
+    }};
+    return yield_output(me->io, CMT_TRACE_EMIT_REPORT, req);
+}
+
+int cmt_rollup_emit_report_iov(cmt_rollup_t *me, const cmt_abi_bytes_iov_t *payload) {
+    CMT_PROBE2(emit__entry, CMT_TRACE_EMIT_REPORT, check_iov(payload) ? 0 : cmt_abi_bytes_iov_length(payload));
+    int rc = emit_report_iov(me, payload);
+    CMT_PROBE3(emit__return, CMT_TRACE_EMIT_REPORT, rc, 0);
+    return rc;
+}
+
+/* Reserve @p max_length bytes of payload after the encoded head in @p wr, to be written in place */
+static int reserve_payload(cmt_rollup_t *me, int kind, const cmt_buf_t *tx, cmt_buf_t *wr, cmt_buf_t *of,
+    const cmt_buf_t *frame, size_t max_length, cmt_abi_bytes_t *span) {
+    cmt_buf_t res[1];
+    if (DBG(cmt_abi_reserve_bytes_d(wr, of, max_length, res, frame->begin))) {
+        return -ENOBUFS;
+    }
+    me->reserved = (cmt_rollup_reservation_t){
+        .kind = kind,
+        .offset = res->begin - tx->begin,
+        .max_length = max_length,
+    };
+    span->data = res->begin;
+    span->length = max_length;
+    return 0;
+}
+
+int cmt_rollup_reserve_voucher(cmt_rollup_t *me, const cmt_abi_address_t *address, const cmt_abi_u256_t *value,
+    size_t max_length, cmt_abi_bytes_t *span) {
+    if (!me || !span) {
+        return -EINVAL;
+    }
+    drop_reservation(me);
+
+    cmt_buf_t tx[1] = {cmt_io_get_tx(me->io)};
+    cmt_buf_t wr[1] = {*tx};
+    cmt_buf_t of[1];
+    cmt_buf_t frame[1];
+
+    // clang-format off
+    if (DBG(cmt_abi_put_funsel(wr, VOUCHER))
+    ||  DBG(cmt_abi_mark_frame(wr, frame))
+    ||  DBG(cmt_abi_put_address(wr, address))
+    ||  DBG(cmt_abi_put_uint256(wr, value))
+    ||  DBG(cmt_abi_put_bytes_s(wr, of))) {
+        return -ENOBUFS;
+    }
+    // clang-format on
+
+    return reserve_payload(me, CMT_TRACE_EMIT_VOUCHER, tx, wr, of, frame, max_length, span);
+}
+
+int cmt_rollup_reserve_delegate_call_voucher(cmt_rollup_t *me, const cmt_abi_address_t *address, size_t max_length,
+    cmt_abi_bytes_t *span) {
+    if (!me || !span) {
+        return -EINVAL;
+    }
+    drop_reservation(me);
+
+    cmt_buf_t tx[1] = {cmt_io_get_tx(me->io)};
+    cmt_buf_t wr[1] = {*tx};
+    cmt_buf_t of[1];
+    cmt_buf_t frame[1];
+
+    // clang-format off
+    if (DBG(cmt_abi_put_funsel(wr, DELEGATE_CALL_VOUCHER))
+    ||  DBG(cmt_abi_mark_frame(wr, frame))
+    ||  DBG(cmt_abi_put_address(wr, address))
+    ||  DBG(cmt_abi_put_bytes_s(wr, of))) {
+        return -ENOBUFS;
+    }
+    // clang-format on
+
+    return reserve_payload(me, CMT_TRACE_EMIT_DELEGATE_CALL_VOUCHER, tx, wr, of, frame, max_length, span);
+}
+
+int cmt_rollup_reserve_notice(cmt_rollup_t *me, size_t max_length, cmt_abi_bytes_t *span) {
+    if (!me || !span) {
+        return -EINVAL;
+    }
+    drop_reservation(me);
+
+    cmt_buf_t tx[1] = {cmt_io_get_tx(me->io)};
+    cmt_buf_t wr[1] = {*tx};
+    cmt_buf_t of[1];
+    cmt_buf_t frame[1];
+
+    // clang-format off
+    if (DBG(cmt_abi_put_funsel(wr, NOTICE))
+    ||  DBG(cmt_abi_mark_frame(wr, frame))
+    ||  DBG(cmt_abi_put_bytes_s(wr, of))) {
+        return -ENOBUFS;
+    }
+    // clang-format on
+
+    return reserve_payload(me, CMT_TRACE_EMIT_NOTICE, tx, wr, of, frame, max_length, span);
+}
+
+int cmt_rollup_reserve_report(cmt_rollup_t *me, size_t max_length, cmt_abi_bytes_t *span) {
+    if (!me || !span) {
+        return -EINVAL;
+    }
+    drop_reservation(me);
+
+    cmt_buf_t tx[1] = {cmt_io_get_tx(me->io)};
+    if (max_length > cmt_buf_length(tx)) {
+        return -ENOBUFS;
+    }
+    me->reserved = (cmt_rollup_reservation_t){
+        .kind = CMT_TRACE_EMIT_REPORT,
+        .offset = 0,
+        .max_length = max_length,
+    };
+    span->data = tx->begin;
+    span->length = max_length;
+    return 0;
+}
+
+/* Fix the length of the reserved payload to @p length, zero its padding and emit it */
+static int commit_output(cmt_rollup_t *me, int kind, size_t length, uint64_t *index) {
+    if (!me) {
+        return -EINVAL;
+    }
+    if (me->reserved.kind != kind || length > me->reserved.max_length) {
+        return -EINVAL;
+    }
+    me->reserved.kind = 0;
+
+    cmt_buf_t tx[1] = {cmt_io_get_tx(me->io)};
+    uint8_t *payload = tx->begin + me->reserved.offset;
+    if (kind == CMT_TRACE_EMIT_REPORT) {
+        struct cmt_io_yield req[1] = {{
+            .dev = HTIF_DEVICE_YIELD,
+            .cmd = HTIF_YIELD_CMD_AUTOMATIC,
+            .reason = HTIF_YIELD_AUTOMATIC_REASON_TX_REPORT,
+            .data = length,
+        }};
+        return yield_output(me->io, CMT_TRACE_EMIT_REPORT, req);
+    }
+
+    // the reservation wrote the maximum length and zeroed the padding after it
+    int rc = DBG(cmt_abi_encode_uint(sizeof(length), &length, payload - CMT_ABI_U256_LENGTH));
+    if (rc) {
+        return rc;
+    }
+    size_t length32 = (length + CMT_ABI_U256_LENGTH - 1) & ~(size_t) (CMT_ABI_U256_LENGTH - 1);
+    // NOLINTNEXTLINE(clang-analyzer-security.insecureAPI.DeprecatedOrUnsafeBufferHandling)
+    memset(payload + length, 0, length32 - length);
+
+    cmt_keccak_t st[1];
+    size_t used_space = me->reserved.offset + length32;
+    cmt_keccak_init(st);
+    cmt_keccak_update(st, used_space, tx->begin);
+    return emit_output_hashed(me, kind, used_space, st, index);
+}
+
+int cmt_rollup_commit_voucher(cmt_rollup_t *me, size_t length, uint64_t *index) {
+    CMT_PROBE2(emit__entry, CMT_TRACE_EMIT_VOUCHER, length);
+    int rc = commit_output(me, CMT_TRACE_EMIT_VOUCHER, length, index);
+    CMT_PROBE3(emit__return, CMT_TRACE_EMIT_VOUCHER, rc, rc == 0 && index ? *index : 0);
+    return rc;
+}
+
+int cmt_rollup_commit_delegate_call_voucher(cmt_rollup_t *me, size_t length, uint64_t *index) {
+    CMT_PROBE2(emit__entry, CMT_TRACE_EMIT_DELEGATE_CALL_VOUCHER, length);
+    int rc = commit_output(me, CMT_TRACE_EMIT_DELEGATE_CALL_VOUCHER, length, index);
+    CMT_PROBE3(emit__return, CMT_TRACE_EMIT_DELEGATE_CALL_VOUCHER, rc, rc == 0 && index ? *index : 0);
+    return rc;
+}
+
+int cmt_rollup_commit_notice(cmt_rollup_t *me, size_t length, uint64_t *index) {
+    CMT_PROBE2(emit__entry, CMT_TRACE_EMIT_NOTICE, length);
+    int rc = commit_output(me, CMT_TRACE_EMIT_NOTICE, length, index);
+    CMT_PROBE3(emit__return, CMT_TRACE_EMIT_NOTICE, rc, rc == 0 && index ? *index : 0);
+    return rc;
+}
+
+int cmt_rollup_commit_report(cmt_rollup_t *me, size_t length) {
+    CMT_PROBE2(emit__entry, CMT_TRACE_EMIT_REPORT, length);
+    int rc = commit_output(me, CMT_TRACE_EMIT_REPORT, length, NULL);
+    CMT_PROBE3(emit__return, CMT_TRACE_EMIT_REPORT, rc, 0);
+    return rc;
+}
+
+static int emit_exception(cmt_rollup_t *me, const cmt_abi_bytes_t *payload) {
     if (!me) {
         return -EINVAL;
     }
+    drop_reservation(me);
     if (!payload || (!payload->data && payload->length)) {
         return -EINVAL;
     }
@@ -268,7 +633,14 @@ int cmt_rollup_emit_exception(cmt_rollup_t *me, const cmt_abi_bytes_t *payload)
         .reason = HTIF_YIELD_MANUAL_REASON_TX_EXCEPTION,
         .data = payload->length,
     }};
-    return DBG(cmt_io_yield(me->io, req));
+    return yield_output(me->io, CMT_TRACE_EMIT_EXCEPTION, req);
+}
+
+int cmt_rollup_emit_exception(cmt_rollup_t *me, const cmt_abi_bytes_t *payload) {
+    CMT_PROBE2(emit__entry, CMT_TRACE_EMIT_EXCEPTION, payload ? payload->length : 0);
+    int rc = emit_exception(me, payload);
+    CMT_PROBE3(emit__return, CMT_TRACE_EMIT_EXCEPTION, rc, 0);
+    return rc;
 }
 
 static int cmt_rollup_get_rx(cmt_rollup_t *me, cmt_buf_t *lhs) {
@@ -355,14 +727,19 @@ static int revert(union cmt_io_driver *io) {
     return DBG(cmt_io_yield(io, req));
 }
 
-int cmt_rollup_finish(cmt_rollup_t *me, cmt_rollup_finish_t *finish) {
+static int finish_request(cmt_rollup_t *me, cmt_rollup_finish_t *finish) {
     if (!me) {
         return -EINVAL;
     }
+    drop_reservation(me);
     if (!finish) {
         return -EINVAL;
     }
 
+    /* the drivers on the host do return from revert with the next input */
+    if (me->arena) {
+        cmt_arena_reset(me->arena);
+    }
     if (!finish->accept_previous_request) {
         return revert(me->io); /* revert should not return! */
     }
@@ -370,6 +747,7 @@ int cmt_rollup_finish(cmt_rollup_t *me, cmt_rollup_finish_t *finish) {
     cmt_merkle_get_root_hash(me->merkle, cmt_io_get_tx(me->io).begin);
     me->fromhost_data = CMT_ABI_U256_LENGTH;
     int reason = accepted(me->io, &me->fromhost_data);
+    cmt_trace(CMT_TRACE_FINISH, 0, reason < 0 ? 0 : reason, me->fromhost_data, reason < 0 ? reason : 0);
     if (reason < 0) {
         return reason;
     }
@@ -378,10 +756,26 @@ int cmt_rollup_finish(cmt_rollup_t *me, cmt_rollup_finish_t *finish) {
     return 0;
 }
 
-int cmt_gio_request(cmt_rollup_t *me, cmt_gio_t *req) {
+int cmt_rollup_finish(cmt_rollup_t *me, cmt_rollup_finish_t *finish) {
+    CMT_PROBE1(finish__entry, finish ? finish->accept_previous_request : 0);
+    int rc = finish_request(me, finish);
+    CMT_PROBE3(finish__return, rc, rc == 0 ? finish->next_request_type : 0,
+        rc == 0 ? finish->next_request_payload_length : 0);
+    return rc;
+}
+
+void cmt_rollup_set_arena(cmt_rollup_t *me, cmt_arena_t *arena) {
+    if (!me) {
+        return;
+    }
+    me->arena = arena;
+}
+
+static int gio_request(cmt_rollup_t *me, cmt_gio_t *req) {
     if (!me) {
         return -EINVAL;
     }
+    drop_reservation(me);
     if (!req) {
         return -EINVAL;
     }
@@ -407,7 +801,7 @@ int cmt_gio_request(cmt_rollup_t *me, cmt_gio_t *req) {
         .data = req->id_length,
     }};
 
-    int rc = DBG(cmt_io_yield(me->io, rr));
+    int rc = yield_output(me->io, CMT_TRACE_EMIT_GIO, rr);
     if (rc != 0) {
         return rc;
     }
@@ -424,6 +818,13 @@ int cmt_gio_request(cmt_rollup_t *me, cmt_gio_t *req) {
     return 0;
 }
 
+int cmt_gio_request(cmt_rollup_t *me, cmt_gio_t *req) {
+    CMT_PROBE2(gio__entry, req ? req->domain : 0, req ? req->id_length : 0);
+    int rc = gio_request(me, req);
+    CMT_PROBE3(gio__return, rc, rc == 0 ? req->response_code : 0, rc == 0 ? req->response_data_length : 0);
+    return rc;
+}
+
 int cmt_rollup_progress(cmt_rollup_t *me, uint32_t progress) {
     cmt_io_yield_t req[1] = {{
         .dev = HTIF_DEVICE_YIELD,
@@ -0,0 +1,320 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "io-driver.h"
+#include "libcmt/shm.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <linux/futex.h>
+#include <linux/memfd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+enum {
+    SHM_SPINS = 4096,                  /**< checks of the turn before sleeping, a few microseconds */
+    SHM_TIMEOUT_MS = 100,              /**< check that the peer is still there this often, while asleep */
+    SHM_DEFAULT_LENGTH = 2U << 20,     /**< tx and rx, same as the mock */
+    SHM_PAGE = CMT_SHM_CONTROL_LENGTH, /**< alignment of rx */
+};
+
+struct cmt_shm_host {
+    int listener;               /**< socket the application connects to */
+    int fd;                     /**< connection to the application, -1 before @ref cmt_shm_host_accept */
+    int memfd;                  /**< the shared memory */
+    int events[2];              /**< eventfds with @ref CMT_SHM_EVENTFD, -1 otherwise */
+    cmt_shm_control_t *control; /**< start of the shared memory */
+    size_t length;              /**< size in bytes of the shared memory */
+    cmt_buf_t tx[1];            /**< what the application wrote */
+    cmt_buf_t rx[1];            /**< where the replies go */
+    bool spin;                  /**< spin before sleeping, there is more than one cpu */
+    bool pending;               /**< a yield waits for its reply */
+    char path[sizeof(((struct sockaddr_un *) 0)->sun_path)];
+};
+
+static void shm_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ volatile("yield");
+#endif
+}
+
+/* sleep on the futex while the turn is @p other, a while at most to check on @p peer */
+static int shm_sleep_futex(uint32_t *turn, uint32_t other, int peer) {
+    struct timespec timeout = {.tv_sec = 0, .tv_nsec = SHM_TIMEOUT_MS * 1000000L};
+    if (syscall(SYS_futex, turn, FUTEX_WAIT, other, &timeout, NULL, 0) == 0 || errno != ETIMEDOUT) {
+        return 0; // woken up, the turn changed already (EAGAIN) or a signal, the caller checks again
+    }
+    struct pollfd p = {.fd = peer, .events = POLLIN};
+    if (poll(&p, 1, 0) > 0) { // nothing is sent after the handshake, readable means closed
+        return -EPIPE;
+    }
+    return 0;
+}
+
+/* sleep on @p event until it is signaled or @p peer hangs up */
+static int shm_sleep_event(int event, int peer) {
+    struct pollfd p[2] = {{.fd = event, .events = POLLIN}, {.fd = peer, .events = POLLIN}};
+    if (poll(p, 2, -1) < 0) {
+        return errno == EINTR ? 0 : -errno;
+    }
+    if (p[0].revents & POLLIN) {
+        uint64_t count = 0;
+        (void) !read(event, &count, sizeof(count));
+        return 0;
+    }
+    return p[1].revents ? -EPIPE : 0;
+}
+
+int cmt_shm_wait(cmt_shm_control_t *control, uint32_t side, const int events[2], int peer, bool spin) {
+    uint32_t other = side ^ 1;
+    uint32_t turn = __atomic_load_n(&control->turn, __ATOMIC_ACQUIRE);
+    for (int i = 0; spin && turn == other && i < SHM_SPINS; ++i) {
+        shm_relax();
+        turn = __atomic_load_n(&control->turn, __ATOMIC_ACQUIRE);
+    }
+    if (turn == other) {
+        // either the other side sees us asleep, or we see the turn it passed, both are sequentially consistent
+        __atomic_store_n(&control->asleep[side], 1, __ATOMIC_SEQ_CST);
+        while ((turn = __atomic_load_n(&control->turn, __ATOMIC_SEQ_CST)) == other) {
+            int rc = events[0] >= 0 ? shm_sleep_event(events[side], peer)
+                                    : shm_sleep_futex(&control->turn, other, peer);
+            if (rc) {
+                __atomic_store_n(&control->asleep[side], 0, __ATOMIC_RELAXED);
+                return rc;
+            }
+        }
+        __atomic_store_n(&control->asleep[side], 0, __ATOMIC_RELAXED);
+    }
+    return turn == side ? 0 : -ENODATA;
+}
+
+bool cmt_shm_pass(cmt_shm_control_t *control, uint32_t from, uint32_t turn, const int events[2]) {
+    uint32_t side = turn == CMT_SHM_HOST ? CMT_SHM_HOST : CMT_SHM_APPLICATION;
+    if (!__atomic_compare_exchange_n(&control->turn, &from, turn, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+        return false;
+    }
+    if (!__atomic_load_n(&control->asleep[side], __ATOMIC_SEQ_CST)) {
+        return true; // spinning or busy, it will see the turn without a system call
+    }
+    if (events[0] >= 0) {
+        uint64_t one = 1;
+        (void) !write(events[side], &one, sizeof(one));
+    } else {
+        (void) syscall(SYS_futex, &control->turn, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    }
+    return true;
+}
+
+static void shm_host_release(cmt_shm_host_t *me) {
+    if (me->control) {
+        munmap(me->control, me->length);
+    }
+    int fds[] = {me->fd, me->memfd, me->events[0], me->events[1]};
+    for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); ++i) {
+        if (fds[i] >= 0) {
+            (void) close(fds[i]);
+        }
+    }
+    if (me->listener >= 0) {
+        (void) close(me->listener);
+        (void) unlink(me->path);
+    }
+    free(me);
+}
+
+/* the memfd with the control page, tx and rx */
+static int shm_host_map(cmt_shm_host_t *me, uint32_t tx_length, uint32_t rx_length, int flags) {
+    uint64_t rx_offset = CMT_SHM_CONTROL_LENGTH + (((uint64_t) tx_length + SHM_PAGE - 1) & ~(uint64_t) (SHM_PAGE - 1));
+    me->length = rx_offset + rx_length;
+    me->memfd = (int) syscall(SYS_memfd_create, "cmt-shm", MFD_CLOEXEC);
+    if (me->memfd < 0) {
+        return -errno;
+    }
+    if (ftruncate(me->memfd, (off_t) me->length) != 0) {
+        return -errno;
+    }
+    void *p = mmap(NULL, me->length, PROT_READ | PROT_WRITE, MAP_SHARED, me->memfd, 0);
+    if (p == MAP_FAILED) {
+        return -errno;
+    }
+    me->control = p;
+    *me->control = (cmt_shm_control_t){
+        .magic = {'C', 'M', 'T', 'S', 'H', 'M', '0', '1'},
+        .version = CMT_SHM_VERSION,
+        .flags = flags,
+        .tx_offset = CMT_SHM_CONTROL_LENGTH,
+        .rx_offset = rx_offset,
+        .tx_length = tx_length,
+        .rx_length = rx_length,
+        .turn = CMT_SHM_APPLICATION,
+    };
+    cmt_buf_init(me->tx, tx_length, (uint8_t *) p + CMT_SHM_CONTROL_LENGTH);
+    cmt_buf_init(me->rx, rx_length, (uint8_t *) p + rx_offset);
+
+    if (flags & CMT_SHM_EVENTFD) {
+        for (int i = 0; i < 2; ++i) {
+            me->events[i] = eventfd(0, EFD_CLOEXEC);
+            if (me->events[i] < 0) {
+                return -errno;
+            }
+        }
+    }
+    return 0;
+}
+
+int cmt_shm_host_open(cmt_shm_host_t **me, const char *path, uint32_t tx_length, uint32_t rx_length, int flags) {
+    if (!me || !path || (flags & ~CMT_SHM_EVENTFD)) {
+        return -EINVAL;
+    }
+    cmt_shm_host_t *it = calloc(1, sizeof(*it));
+    if (!it) {
+        return -ENOMEM;
+    }
+    it->listener = -1;
+    it->fd = -1;
+    it->memfd = -1;
+    it->events[0] = -1;
+    it->events[1] = -1;
+    it->spin = sysconf(_SC_NPROCESSORS_ONLN) > 1;
+    if (strlen(path) >= sizeof(it->path)) {
+        shm_host_release(it);
+        return -ENAMETOOLONG;
+    }
+    strcpy(it->path, path);
+
+    int rc = shm_host_map(it, tx_length ? tx_length : SHM_DEFAULT_LENGTH, rx_length ? rx_length : SHM_DEFAULT_LENGTH,
+        flags);
+    if (rc) {
+        shm_host_release(it);
+        return rc;
+    }
+
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    strcpy(addr.sun_path, path);
+    (void) unlink(path);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        rc = -errno;
+        shm_host_release(it);
+        return rc;
+    }
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(fd, 1) != 0) {
+        rc = -errno;
+        (void) close(fd);
+        shm_host_release(it);
+        return rc;
+    }
+    it->listener = fd;
+    *me = it;
+    return 0;
+}
+
+int cmt_shm_host_accept(cmt_shm_host_t *me) {
+    if (!me || me->fd >= 0) {
+        return -EINVAL;
+    }
+    int fd = accept(me->listener, NULL, NULL);
+    if (fd < 0) {
+        return -errno;
+    }
+
+    // the memfd, and the eventfds if any, go with a single byte
+    int fds[3] = {me->memfd, me->events[0], me->events[1]};
+    size_t n = me->events[0] >= 0 ? 3 : 1;
+    union {
+        char buf[CMSG_SPACE(sizeof(fds))];
+        struct cmsghdr align;
+    } u;
+    memset(&u, 0, sizeof(u));
+    char byte = 'S';
+    struct iovec iov = {.iov_base = &byte, .iov_len = 1};
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = u.buf,
+        .msg_controllen = CMSG_SPACE(n * sizeof(int)),
+    };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(n * sizeof(int));
+    memcpy(CMSG_DATA(cmsg), fds, n * sizeof(int));
+    if (sendmsg(fd, &msg, MSG_NOSIGNAL) != 1) {
+        int rc = -errno;
+        (void) close(fd);
+        return rc;
+    }
+    me->fd = fd;
+    return 0;
+}
+
+int cmt_shm_host_wait(cmt_shm_host_t *me, cmt_io_yield_t *request) {
+    if (!me || !request || me->fd < 0 || me->pending) {
+        return -EINVAL;
+    }
+    int rc = cmt_shm_wait(me->control, CMT_SHM_HOST, me->events, me->fd, me->spin);
+    if (rc) {
+        return rc;
+    }
+    *request = me->control->request;
+    me->pending = true;
+    return 0;
+}
+
+int cmt_shm_host_reply(cmt_shm_host_t *me, uint16_t reason, uint32_t length) {
+    if (!me || !me->pending) {
+        return -EINVAL;
+    }
+    if (length > cmt_buf_length(me->rx)) {
+        return -ENOBUFS;
+    }
+    me->control->reply = (cmt_io_yield_t){.reason = reason, .data = length};
+    me->pending = false;
+    (void) cmt_shm_pass(me->control, CMT_SHM_HOST, CMT_SHM_APPLICATION, me->events);
+    return 0;
+}
+
+cmt_buf_t cmt_shm_host_get_tx(cmt_shm_host_t *me) {
+    const cmt_buf_t empty = {NULL, NULL};
+    return me ? *me->tx : empty;
+}
+
+cmt_buf_t cmt_shm_host_get_rx(cmt_shm_host_t *me) {
+    const cmt_buf_t empty = {NULL, NULL};
+    return me ? *me->rx : empty;
+}
+
+void cmt_shm_host_close(cmt_shm_host_t *me) {
+    if (!me) {
+        return;
+    }
+    // the application may be taking its turn meanwhile
+    uint32_t turn = CMT_SHM_HOST;
+    while (me->fd >= 0 && turn != CMT_SHM_CLOSED && !cmt_shm_pass(me->control, turn, CMT_SHM_CLOSED, me->events)) {
+        turn = __atomic_load_n(&me->control->turn, __ATOMIC_SEQ_CST);
+    }
+    shm_host_release(me);
+}
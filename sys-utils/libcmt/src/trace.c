@@ -0,0 +1,165 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "libcmt/trace.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__riscv)
+#define TRACE_CLOCK CMT_TRACE_CLOCK_RDTIME
+#else
+#define TRACE_CLOCK CMT_TRACE_CLOCK_NS
+#endif
+
+static cmt_trace_event_t ring[CMT_TRACE_CAPACITY];
+static atomic_uint_least64_t head = 0; /* claimed with a fetch add, instances may yield from many threads */
+static atomic_int users = 0;          /* io drivers between init and fini, the last one writes the trace */
+static volatile sig_atomic_t enabled = 0;
+static char path[256];
+
+static uint64_t now(void) {
+#if defined(__riscv)
+    uint64_t t = 0;
+    __asm__ volatile("rdtime %0" : "=r"(t));
+    return t;
+#else
+    struct timespec ts;
+    (void) clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+#endif
+}
+
+static int write_all(int fd, const void *data, size_t length) {
+    const uint8_t *p = data;
+    while (length) {
+        ssize_t n = write(fd, p, length);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        p += n;
+        length -= n;
+    }
+    return 0;
+}
+
+/* only async-signal-safe calls, this also runs from the signal handler */
+static int write_trace(void) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -errno;
+    }
+
+    uint64_t total = atomic_load(&head);
+    uint64_t count = total < CMT_TRACE_CAPACITY ? total : CMT_TRACE_CAPACITY;
+    size_t start = total < CMT_TRACE_CAPACITY ? 0 : total % CMT_TRACE_CAPACITY;
+    cmt_trace_header_t header = {
+        .magic = {'C', 'M', 'T', 'T', 'R', 'A', 'C', 'E'},
+        .version = CMT_TRACE_VERSION,
+        .clock = TRACE_CLOCK,
+        .total = total,
+        .count = count,
+    };
+
+    // clang-format off
+    int rc = write_all(fd, &header, sizeof(header));
+    if (!rc) rc = write_all(fd, ring + start, (count - start) * sizeof(*ring));
+    if (!rc) rc = write_all(fd, ring, start * sizeof(*ring));
+    // clang-format on
+
+    if (close(fd) && !rc) {
+        rc = -errno;
+    }
+    return rc;
+}
+
+static void on_signal(int sig) {
+    if (enabled) {
+        enabled = 0;
+        (void) write_trace();
+    }
+    // the handler was installed with SA_RESETHAND, die with the default action
+    (void) raise(sig);
+}
+
+static void install(int sig) {
+    struct sigaction old;
+    if (sigaction(sig, NULL, &old) || old.sa_handler != SIG_DFL) {
+        return; // leave the application handlers alone
+    }
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sa.sa_flags = SA_RESETHAND;
+    (void) sigemptyset(&sa.sa_mask);
+    (void) sigaction(sig, &sa, NULL);
+}
+
+void cmt_trace_init(void) {
+    if (atomic_fetch_add(&users, 1) != 0) {
+        return; // shared with the drivers already open
+    }
+    const char *name = getenv("CMT_TRACE");
+    if (!name || !*name || strlen(name) >= sizeof(path)) {
+        return;
+    }
+    strcpy(path, name);
+    atomic_store(&head, 0);
+    enabled = 1;
+
+    install(SIGINT);
+    install(SIGTERM);
+    install(SIGABRT);
+}
+
+int cmt_trace_fini(void) {
+    int n = atomic_load(&users);
+    while (n > 0 && !atomic_compare_exchange_weak(&users, &n, n - 1)) {
+        ;
+    }
+    if (n != 1 || !enabled) { // still in use, or fini without an init
+        return 0;
+    }
+    enabled = 0;
+    return write_trace();
+}
+
+bool cmt_trace_enabled(void) {
+    return enabled;
+}
+
+void cmt_trace(uint8_t type, uint8_t cmd, uint16_t reason, uint32_t data, int32_t rc) {
+    if (!enabled) {
+        return;
+    }
+    uint64_t i = atomic_fetch_add_explicit(&head, 1, memory_order_relaxed);
+    cmt_trace_event_t *it = &ring[i % CMT_TRACE_CAPACITY];
+    it->time = now();
+    it->type = type;
+    it->cmd = cmd;
+    it->reason = reason;
+    it->data = data;
+    it->rc = rc;
+    it->pad = 0;
+}
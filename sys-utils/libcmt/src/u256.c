@@ -0,0 +1,300 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "libcmt/u256.h"
+
+#include <errno.h>
+#include <string.h>
+
+__extension__ typedef unsigned __int128 u128;
+__extension__ typedef __int128 i128;
+
+static uint64_t load_be64(const uint8_t *p) {
+    uint64_t x = 0;
+    memcpy(&x, p, sizeof(x));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    x = __builtin_bswap64(x);
+#endif
+    return x;
+}
+
+static void store_be64(uint8_t *p, uint64_t x) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    x = __builtin_bswap64(x);
+#endif
+    memcpy(p, &x, sizeof(x));
+}
+
+static void decode(const uint8_t be[CMT_ABI_U256_LENGTH], cmt_u256_t *me) {
+    for (int i = 0; i < CMT_U256_LIMBS; ++i) {
+        me->limb[i] = load_be64(be + 8 * (CMT_U256_LIMBS - 1 - i));
+    }
+}
+
+static void encode(const cmt_u256_t *me, uint8_t be[CMT_ABI_U256_LENGTH]) {
+    for (int i = 0; i < CMT_U256_LIMBS; ++i) {
+        store_be64(be + 8 * (CMT_U256_LIMBS - 1 - i), me->limb[i]);
+    }
+}
+
+void cmt_u256_from_u64(cmt_u256_t *me, uint64_t x) {
+    me->limb[0] = x;
+    me->limb[1] = 0;
+    me->limb[2] = 0;
+    me->limb[3] = 0;
+}
+
+int cmt_u256_to_u64(const cmt_u256_t *me, uint64_t *x) {
+    if (me->limb[1] | me->limb[2] | me->limb[3]) {
+        return -EDOM;
+    }
+    *x = me->limb[0];
+    return 0;
+}
+
+void cmt_u256_from_abi(cmt_u256_t *me, const cmt_abi_u256_t *abi) {
+    decode(abi->data, me);
+}
+
+void cmt_u256_to_abi(const cmt_u256_t *me, cmt_abi_u256_t *abi) {
+    encode(me, abi->data);
+}
+
+int cmt_u256_get(cmt_buf_t *me, cmt_u256_t *value) {
+    cmt_buf_t x[1];
+    if (cmt_buf_split(me, CMT_ABI_U256_LENGTH, x, me)) {
+        return -ENOBUFS;
+    }
+    decode(x->begin, value);
+    return 0;
+}
+
+int cmt_u256_put(cmt_buf_t *me, const cmt_u256_t *value) {
+    cmt_buf_t x[1];
+    if (cmt_buf_split(me, CMT_ABI_U256_LENGTH, x, me)) {
+        return -ENOBUFS;
+    }
+    encode(value, x->begin);
+    return 0;
+}
+
+bool cmt_u256_is_zero(const cmt_u256_t *me) {
+    return (me->limb[0] | me->limb[1] | me->limb[2] | me->limb[3]) == 0;
+}
+
+int cmt_u256_cmp(const cmt_u256_t *a, const cmt_u256_t *b) {
+    for (int i = CMT_U256_LIMBS - 1; i >= 0; --i) {
+        if (a->limb[i] != b->limb[i]) {
+            return a->limb[i] < b->limb[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+bool cmt_u256_add(cmt_u256_t *r, const cmt_u256_t *a, const cmt_u256_t *b) {
+    uint64_t carry = 0;
+    for (int i = 0; i < CMT_U256_LIMBS; ++i) {
+        u128 t = (u128) a->limb[i] + b->limb[i] + carry;
+        r->limb[i] = (uint64_t) t;
+        carry = (uint64_t) (t >> 64);
+    }
+    return carry;
+}
+
+bool cmt_u256_sub(cmt_u256_t *r, const cmt_u256_t *a, const cmt_u256_t *b) {
+    uint64_t borrow = 0;
+    for (int i = 0; i < CMT_U256_LIMBS; ++i) {
+        u128 t = (u128) a->limb[i] - b->limb[i] - borrow;
+        r->limb[i] = (uint64_t) t;
+        borrow = (uint64_t) (t >> 64) & 1;
+    }
+    return borrow;
+}
+
+/* full product of @p m by @p n limbs into @p out (m + n limbs) */
+static void mul_full(uint64_t *out, const uint64_t *a, int m, const uint64_t *b, int n) {
+    memset(out, 0, (m + n) * sizeof(*out));
+    for (int i = 0; i < m; ++i) {
+        uint64_t carry = 0;
+        for (int j = 0; j < n; ++j) {
+            u128 t = (u128) a[i] * b[j] + out[i + j] + carry;
+            out[i + j] = (uint64_t) t;
+            carry = (uint64_t) (t >> 64);
+        }
+        out[i + n] = carry;
+    }
+}
+
+bool cmt_u256_mul(cmt_u256_t *r, const cmt_u256_t *a, const cmt_u256_t *b) {
+    uint64_t p[2 * CMT_U256_LIMBS];
+    mul_full(p, a->limb, CMT_U256_LIMBS, b->limb, CMT_U256_LIMBS);
+    memcpy(r->limb, p, sizeof(r->limb));
+    return (p[4] | p[5] | p[6] | p[7]) != 0;
+}
+
+static int significant_limbs(const uint64_t *x, int n) {
+    while (n > 0 && x[n - 1] == 0) {
+        --n;
+    }
+    return n;
+}
+
+/* Knuth's algorithm D (TAOCP vol. 2, 4.3.1) in the form of Hacker's Delight divmnu.
+ * Divide @p u (m limbs) by @p v (n limbs, v[n-1] != 0, m >= n), writing m - n + 1
+ * quotient limbs to @p q and n remainder limbs to @p r. */
+static void divmnu(uint64_t *q, uint64_t *r, const uint64_t *u, int m, const uint64_t *v, int n) {
+    if (n == 1) {
+        uint64_t k = 0;
+        for (int j = m - 1; j >= 0; --j) {
+            u128 t = ((u128) k << 64) | u[j];
+            q[j] = (uint64_t) (t / v[0]);
+            k = (uint64_t) (t - (u128) q[j] * v[0]);
+        }
+        r[0] = k;
+        return;
+    }
+
+    uint64_t un[2 * CMT_U256_LIMBS + 1];
+    uint64_t vn[CMT_U256_LIMBS];
+    int s = __builtin_clzll(v[n - 1]);
+
+    // normalize so that the divisor most significant bit is set
+    for (int i = n - 1; i > 0; --i) {
+        vn[i] = s ? (v[i] << s) | (v[i - 1] >> (64 - s)) : v[i];
+    }
+    vn[0] = v[0] << s;
+    un[m] = s ? u[m - 1] >> (64 - s) : 0;
+    for (int i = m - 1; i > 0; --i) {
+        un[i] = s ? (u[i] << s) | (u[i - 1] >> (64 - s)) : u[i];
+    }
+    un[0] = u[0] << s;
+
+    for (int j = m - n; j >= 0; --j) {
+        u128 num = ((u128) un[j + n] << 64) | un[j + n - 1];
+        u128 qhat = num / vn[n - 1];
+        u128 rhat = num - qhat * vn[n - 1];
+        while ((qhat >> 64) || qhat * vn[n - 2] > ((rhat << 64) | un[j + n - 2])) {
+            qhat -= 1;
+            rhat += vn[n - 1];
+            if (rhat >> 64) {
+                break;
+            }
+        }
+
+        // multiply and subtract
+        i128 k = 0;
+        i128 t = 0;
+        for (int i = 0; i < n; ++i) {
+            u128 p = qhat * vn[i];
+            t = (i128) un[i + j] - k - (i128) (uint64_t) p;
+            un[i + j] = (uint64_t) t;
+            k = (i128) (uint64_t) (p >> 64) - (t >> 64);
+        }
+        t = (i128) un[j + n] - k;
+        un[j + n] = (uint64_t) t;
+
+        q[j] = (uint64_t) qhat;
+        if (t < 0) { // subtracted too much, add back
+            uint64_t carry = 0;
+            q[j] -= 1;
+            for (int i = 0; i < n; ++i) {
+                u128 a = (u128) un[i + j] + vn[i] + carry;
+                un[i + j] = (uint64_t) a;
+                carry = (uint64_t) (a >> 64);
+            }
+            un[j + n] += carry;
+        }
+    }
+
+    // unnormalize the remainder
+    for (int i = 0; i < n; ++i) {
+        r[i] = s ? (un[i] >> s) | (un[i + 1] << (64 - s)) : un[i];
+    }
+}
+
+/* q has room for m limbs, r for n limbs, both zero filled beyond the result */
+static int divide(uint64_t *q, int qn, uint64_t *r, const uint64_t *u, int un, const uint64_t *v) {
+    int m = significant_limbs(u, un);
+    int n = significant_limbs(v, CMT_U256_LIMBS);
+    if (n == 0) {
+        return -EDOM;
+    }
+    memset(q, 0, qn * sizeof(*q));
+    memset(r, 0, CMT_U256_LIMBS * sizeof(*r));
+    if (m < n) {
+        memcpy(r, u, m * sizeof(*r));
+        return 0;
+    }
+    divmnu(q, r, u, m, v, n);
+    return 0;
+}
+
+int cmt_u256_divmod(cmt_u256_t *q, cmt_u256_t *r, const cmt_u256_t *a, const cmt_u256_t *b) {
+    uint64_t qq[CMT_U256_LIMBS];
+    uint64_t rr[CMT_U256_LIMBS];
+    int rc = divide(qq, CMT_U256_LIMBS, rr, a->limb, CMT_U256_LIMBS, b->limb);
+    if (rc) {
+        return rc;
+    }
+    if (q) {
+        memcpy(q->limb, qq, sizeof(qq));
+    }
+    if (r) {
+        memcpy(r->limb, rr, sizeof(rr));
+    }
+    return 0;
+}
+
+int cmt_u256_muldiv(cmt_u256_t *r, const cmt_u256_t *a, const cmt_u256_t *b, const cmt_u256_t *d) {
+    uint64_t p[2 * CMT_U256_LIMBS];
+    uint64_t qq[2 * CMT_U256_LIMBS];
+    uint64_t rr[CMT_U256_LIMBS];
+    mul_full(p, a->limb, CMT_U256_LIMBS, b->limb, CMT_U256_LIMBS);
+    int rc = divide(qq, 2 * CMT_U256_LIMBS, rr, p, 2 * CMT_U256_LIMBS, d->limb);
+    if (rc) {
+        return rc;
+    }
+    if (qq[4] | qq[5] | qq[6] | qq[7]) {
+        return -EOVERFLOW;
+    }
+    memcpy(r->limb, qq, sizeof(r->limb));
+    return 0;
+}
+
+void cmt_u256_shl(cmt_u256_t *r, const cmt_u256_t *a, unsigned n) {
+    uint64_t x[CMT_U256_LIMBS];
+    unsigned limbs = n / 64;
+    unsigned bits = n % 64;
+    for (int i = CMT_U256_LIMBS - 1; i >= 0; --i) {
+        int src = i - (int) limbs;
+        uint64_t hi = src >= 0 ? a->limb[src] : 0;
+        uint64_t lo = src >= 1 ? a->limb[src - 1] : 0;
+        x[i] = bits ? (hi << bits) | (lo >> (64 - bits)) : hi;
+    }
+    memcpy(r->limb, x, sizeof(x));
+}
+
+void cmt_u256_shr(cmt_u256_t *r, const cmt_u256_t *a, unsigned n) {
+    uint64_t x[CMT_U256_LIMBS];
+    unsigned limbs = n / 64;
+    unsigned bits = n % 64;
+    for (int i = 0; i < CMT_U256_LIMBS; ++i) {
+        unsigned src = i + limbs;
+        uint64_t lo = src < CMT_U256_LIMBS ? a->limb[src] : 0;
+        uint64_t hi = src + 1 < CMT_U256_LIMBS ? a->limb[src + 1] : 0;
+        x[i] = bits ? (lo >> bits) | (hi << (64 - bits)) : lo;
+    }
+    memcpy(r->limb, x, sizeof(x));
+}
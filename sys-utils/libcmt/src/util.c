@@ -1,19 +1,23 @@
 #include <errno.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 bool cmt_util_debug_enabled(void) {
-    static bool checked = false;
-    static bool enabled = false;
+    static atomic_int enabled = -1; // not checked yet, mock instances may ask from many threads
 
-    if (!checked) {
-        enabled = getenv("CMT_DEBUG") != NULL;
-        checked = true;
+    int it = atomic_load_explicit(&enabled, memory_order_relaxed);
+    if (it < 0) {
+        it = getenv("CMT_DEBUG") != NULL;
+        atomic_store_explicit(&enabled, it, memory_order_relaxed);
     }
-
-    return enabled;
+    return it;
 }
 
 int cmt_util_read_whole_file(const char *name, size_t max, void *data, size_t *length) {
@@ -37,15 +41,26 @@ int cmt_util_read_whole_file(const char *name, size_t max, void *data, size_t *l
 int cmt_util_write_whole_file(const char *name, size_t length, const void *data) {
     int rc = 0;
 
-    FILE *file = fopen(name, "wb");
-    if (!file) {
+    int fd = open(name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) {
         return -errno;
     }
 
-    if (fwrite(data, 1, length, file) != length) {
-        rc = -EIO;
+    // straight from the caller memory, without staging it in a stdio buffer
+    const uint8_t *p = data;
+    while (length) {
+        ssize_t n = write(fd, p, length);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            rc = n < 0 ? -errno : -EIO;
+            break;
+        }
+        p += n;
+        length -= n;
     }
-    if (fclose(file) != 0) {
+    if (close(fd) != 0 && rc == 0) {
         rc = -errno;
     }
     return rc;
@@ -0,0 +1,122 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "libcmt/arena.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+static _Alignas(CMT_ARENA_ALIGN) uint8_t scratch[256];
+
+static void alloc_and_alignment(void) {
+    cmt_arena_t arena[1];
+    cmt_arena_init(arena, sizeof scratch, scratch);
+
+    uint8_t *a = cmt_arena_alloc(arena, 1, 1);
+    assert(a == scratch);
+    uint8_t *b = cmt_arena_alloc(arena, 8, 8);
+    assert(b == scratch + 8);
+    uint8_t *c = cmt_arena_alloc(arena, 1, 0);
+    assert(c == scratch + CMT_ARENA_ALIGN);
+    assert(cmt_arena_used(arena) == CMT_ARENA_ALIGN + 1);
+
+    assert(cmt_arena_alloc(arena, 1, 3) == NULL);
+    assert(cmt_arena_alloc(arena, sizeof scratch, 1) == NULL);
+    assert(cmt_arena_alloc(arena, SIZE_MAX, 1) == NULL);
+    assert(cmt_arena_alloc(NULL, 1, 1) == NULL);
+
+    // exactly the space left
+    size_t left = sizeof scratch - cmt_arena_used(arena);
+    assert(cmt_arena_alloc(arena, left, 1) != NULL);
+    assert(cmt_arena_alloc(arena, 0, 1) != NULL);
+    assert(cmt_arena_alloc(arena, 1, 1) == NULL);
+    printf("test_arena_alloc_and_alignment passed!\n");
+}
+
+static void mark_rewind_and_reset(void) {
+    cmt_arena_t arena[1];
+    cmt_arena_init(arena, sizeof scratch, scratch);
+
+    assert(cmt_arena_alloc(arena, 16, 1) != NULL);
+    cmt_arena_mark_t mark = cmt_arena_mark(arena);
+    uint8_t *p = cmt_arena_alloc(arena, 100, 1);
+    assert(p != NULL);
+    assert(cmt_arena_used(arena) == 116);
+
+    cmt_arena_rewind(arena, mark);
+    assert(cmt_arena_used(arena) == 16);
+    assert(cmt_arena_alloc(arena, 1, 1) == p);
+
+    cmt_arena_reset(arena);
+    assert(cmt_arena_used(arena) == 0);
+    assert(cmt_arena_peak(arena) == 116);
+
+    // rewinding forward is ignored
+    cmt_arena_rewind(arena, mark);
+    assert(cmt_arena_used(arena) == 0);
+    printf("test_arena_mark_rewind_and_reset passed!\n");
+}
+
+static void buf_and_dup(void) {
+    cmt_arena_t arena[1];
+    cmt_buf_t buf[1];
+    cmt_arena_init(arena, sizeof scratch, scratch);
+
+    assert(cmt_arena_alloc_buf(arena, 32, buf) == 0);
+    assert(cmt_buf_length(buf) == 32);
+    assert(cmt_arena_alloc_buf(arena, sizeof scratch, buf) == -ENOBUFS);
+    assert(cmt_arena_alloc_buf(NULL, 32, buf) == -EINVAL);
+
+    char *s = cmt_arena_dup(arena, 5, "hello world");
+    assert(s != NULL && strcmp(s, "hello") == 0);
+    assert(cmt_arena_dup(arena, sizeof scratch, scratch) == NULL);
+    printf("test_arena_buf_and_dup passed!\n");
+}
+
+static void get_bytes_d(void) {
+    uint8_t data[3 * CMT_ABI_U256_LENGTH];
+    cmt_buf_t wr[1] = {{data, data + sizeof data}};
+    cmt_buf_t of[1];
+    cmt_buf_t frame[1];
+    assert(cmt_abi_mark_frame(wr, frame) == 0);
+    assert(cmt_abi_put_bytes_s(wr, of) == 0);
+    assert(cmt_abi_put_bytes_d(wr, of, frame, &(cmt_abi_bytes_t){5, "hello"}) == 0);
+
+    cmt_arena_t arena[1];
+    cmt_abi_bytes_t out;
+    cmt_buf_t start[1] = {{data, data + sizeof data}};
+    cmt_buf_t rd[1] = {*start};
+    cmt_arena_init(arena, sizeof scratch, scratch);
+    assert(cmt_abi_get_bytes_s(rd, of) == 0);
+
+    cmt_buf_t of_copy[1] = {*of};
+    assert(cmt_arena_get_bytes_d(arena, start, of, &out) == 0);
+    assert(out.length == 5 && strcmp(out.data, "hello") == 0);
+    assert((uint8_t *) out.data >= scratch && (uint8_t *) out.data < scratch + sizeof scratch);
+
+    cmt_arena_init(arena, 5, scratch);
+    assert(cmt_arena_get_bytes_d(arena, start, of_copy, &out) == -ENOBUFS);
+    printf("test_arena_get_bytes_d passed!\n");
+}
+
+int main(void) {
+    alloc_and_alignment();
+    mark_rewind_and_reset();
+    buf_and_dup();
+    get_bytes_d();
+    return 0;
+}
@@ -0,0 +1,110 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "libcmt/io.h"
+#include "libcmt/util.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int yield(cmt_io_driver_t *io, uint8_t cmd, uint16_t reason, uint32_t data) {
+    cmt_io_yield_t rr = {.dev = HTIF_DEVICE_YIELD, .cmd = cmd, .reason = reason, .data = data};
+    memset(cmt_io_get_tx(io).begin, 0xaa, data);
+    return cmt_io_yield(io, &rr);
+}
+
+static void modeled_costs(void) {
+    uint8_t input[32] = {0};
+    assert(cmt_util_write_whole_file("cost-0.bin", 32, input) == 0);
+    assert(cmt_util_write_whole_file("cost-1.bin", 16, input) == 0);
+    assert(cmt_util_write_whole_file("cost.model", 37, "# outputs\ntx-output=1000+2\ngio=5000\n") == 0);
+    assert(setenv("CMT_INPUTS", "0:cost-0.bin,0:cost-1.bin", 1) == 0);
+    assert(setenv("CMT_IO_COST_FILE", "cost.model", 1) == 0);
+    assert(setenv("CMT_IO_COST", "yield=100, tx-output=1000+2", 1) == 0);
+    assert(setenv("CMT_IO_COST_REPORT", "cost.csv", 1) == 0);
+
+    cmt_io_driver_t io[1];
+    assert(cmt_io_init_driver(io, CMT_IO_DRIVER_MOCK) == 0);
+    assert(yield(io, HTIF_YIELD_CMD_MANUAL, HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED, 0) == 0);
+    assert(yield(io, HTIF_YIELD_CMD_AUTOMATIC, HTIF_YIELD_AUTOMATIC_REASON_TX_OUTPUT, 10) == 0); // 1000 + 2 * 10
+    assert(yield(io, HTIF_YIELD_CMD_AUTOMATIC, HTIF_YIELD_AUTOMATIC_REASON_TX_OUTPUT, 6) == 0);  // 1000 + 2 * 6
+    assert(yield(io, HTIF_YIELD_CMD_MANUAL, HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED, 32) == 0);
+    assert(yield(io, HTIF_YIELD_CMD_AUTOMATIC, HTIF_YIELD_AUTOMATIC_REASON_TX_REPORT, 4) == 0);
+    assert(yield(io, HTIF_YIELD_CMD_MANUAL, HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED, 32) == -ENODATA);
+
+    const cmt_io_stats_t *stats = cmt_io_get_stats(io);
+    assert(stats->kind[CMT_IO_STATS_TX_OUTPUT].modeled_ns == 2032);
+    assert(stats->kind[CMT_IO_STATS_TX_REPORT].modeled_ns == 100);
+    assert(stats->kind[CMT_IO_STATS_RX_ACCEPTED].modeled_ns == 300);
+    cmt_io_fini(io);
+
+    char report[256];
+    size_t length = 0;
+    const char expected[] = "input,yields,modeled_ns\n0,3,2132\n1,2,200\n";
+    assert(cmt_util_read_whole_file("cost.csv", sizeof report, report, &length) == 0);
+    assert(length == strlen(expected) && memcmp(report, expected, length) == 0);
+
+    assert(unsetenv("CMT_IO_COST_FILE") == 0);
+    assert(unsetenv("CMT_IO_COST_REPORT") == 0);
+    (void) remove("cost-0.bin");
+    (void) remove("cost-1.bin");
+    (void) remove("cost-0.output-0.bin");
+    (void) remove("cost-0.output-1.bin");
+    (void) remove("cost-0.outputs_root_hash.bin");
+    (void) remove("cost-1.report-0.bin");
+    (void) remove("cost-1.outputs_root_hash.bin");
+    (void) remove("cost.model");
+    (void) remove("cost.csv");
+    printf("test_cost_modeled_costs passed!\n");
+}
+
+static void sleeps(void) {
+    assert(setenv("CMT_IO_COST", "tx-report=2000000", 1) == 0);
+    assert(setenv("CMT_IO_COST_SLEEP", "yes", 1) == 0);
+    assert(setenv("CMT_IO_COST_REPORT", "/dev/null", 1) == 0);
+
+    cmt_io_driver_t io[1];
+    assert(cmt_io_init_driver(io, CMT_IO_DRIVER_MOCK) == 0);
+    assert(yield(io, HTIF_YIELD_CMD_AUTOMATIC, HTIF_YIELD_AUTOMATIC_REASON_TX_REPORT, 4) == 0);
+    assert(cmt_io_get_stats(io)->kind[CMT_IO_STATS_TX_REPORT].elapsed_ns >= 2000000);
+    cmt_io_fini(io);
+
+    assert(unsetenv("CMT_IO_COST_SLEEP") == 0);
+    assert(unsetenv("CMT_IO_COST_REPORT") == 0);
+    (void) remove("none.report-0.bin");
+    printf("test_cost_sleeps passed!\n");
+}
+
+static void invalid_models(void) {
+    static const char *const models[] = {"tx-output", "tx-output=", "tx-output=abc", "tx-output=1+", "bogus=1",
+        "gio=-1", "gio=1+2x"};
+    for (size_t i = 0; i < sizeof models / sizeof models[0]; ++i) {
+        cmt_io_driver_t io[1];
+        assert(setenv("CMT_IO_COST", models[i], 1) == 0);
+        assert(cmt_io_init_driver(io, CMT_IO_DRIVER_MOCK) == -EINVAL);
+    }
+    assert(unsetenv("CMT_IO_COST") == 0);
+    printf("test_cost_invalid_models passed!\n");
+}
+
+int main(void) {
+    modeled_costs();
+    sleeps();
+    invalid_models();
+    return 0;
+}
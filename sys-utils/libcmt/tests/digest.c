@@ -0,0 +1,178 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "libcmt/digest.h"
+#include "libcmt/io.h"
+#include "libcmt/outlog.h"
+#include "libcmt/util.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <unistd.h>
+
+#define INPUTS 500
+#define OUTPUTS 4
+#define OUTPUT_LENGTH 1024
+#define UNCHANGED (UINT64_MAX - 1) // no input has this index
+
+/* outputs of a run, the ones of @p changed_input differ from @p changed_output on */
+static void write_run(const char *filepath, const char *expected, uint64_t changed_input, uint32_t changed_output,
+    bool skip_last, cmt_digest_t *digest) {
+    static const uint64_t inputs[] = {UINT64_MAX, 0, 1, 3};
+    assert(cmt_digest_open(digest, filepath, expected) == 0);
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]) - skip_last; ++i) {
+        for (uint32_t j = 0; j < 3; ++j) {
+            char data[32];
+            bool changed = inputs[i] == changed_input && j >= changed_output;
+            int n = snprintf(data, sizeof data, "output %d of %d%s", (int) j, (int) i, changed ? "!" : "");
+            assert(cmt_digest_add(digest, inputs[i], CMT_OUTLOG_OUTPUT, n, data) == 0);
+        }
+    }
+}
+
+static void api(void) {
+    cmt_digest_t digest[1];
+    cmt_digest_divergence_t divergence;
+
+    write_run("digest-a.digest", NULL, UNCHANGED, 0, false, digest);
+    assert(cmt_digest_close(digest) == 0);
+    assert(!digest->diverged);
+
+    // same outputs, compared as they are produced and afterwards
+    write_run("digest-b.digest", "digest-a.digest", UNCHANGED, 0, false, digest);
+    assert(cmt_digest_close(digest) == 0);
+    assert(!digest->diverged);
+    assert(cmt_digest_compare("digest-a.digest", "digest-b.digest", &divergence) == 0);
+
+    write_run("digest-b.digest", "digest-a.digest", 1, 2, false, digest);
+    assert(cmt_digest_close(digest) == 0);
+    assert(digest->diverged && digest->divergence.input == 1 && digest->divergence.output == 2);
+    assert(cmt_digest_compare("digest-a.digest", "digest-b.digest", &divergence) == 1);
+    assert(divergence.input == 1 && divergence.output == 2);
+
+    // the last input emitted nothing
+    write_run("digest-b.digest", "digest-a.digest", UNCHANGED, 0, true, digest);
+    assert(cmt_digest_close(digest) == 0);
+    assert(digest->diverged && digest->divergence.input == 3 && digest->divergence.output == 0);
+    assert(cmt_digest_compare("digest-a.digest", "digest-b.digest", &divergence) == 1);
+    assert(divergence.input == 3 && divergence.output == 0);
+    assert(cmt_digest_compare("digest-b.digest", "digest-a.digest", &divergence) == 1);
+    assert(divergence.input == 3 && divergence.output == 0);
+
+    // compare only, no log
+    write_run(NULL, "digest-a.digest", UINT64_MAX, 1, false, digest);
+    assert(cmt_digest_close(digest) == 0);
+    assert(digest->diverged && digest->divergence.input == UINT64_MAX && digest->divergence.output == 1);
+
+    assert(cmt_util_write_whole_file("digest-bad.digest", 16, "CMTOLOG1\1\0\0\0\0\0\0\0") == 0);
+    assert(cmt_digest_open(digest, NULL, "digest-bad.digest") == -EPROTO);
+    assert(cmt_digest_open(digest, NULL, "digest-missing.digest") == -ENOENT);
+    assert(cmt_digest_compare("digest-a.digest", "digest-bad.digest", &divergence) == -EPROTO);
+
+    (void) remove("digest-a.digest");
+    (void) remove("digest-b.digest");
+    (void) remove("digest-bad.digest");
+    printf("test_digest_api passed!\n");
+}
+
+static int yield(cmt_io_driver_t *io, cmt_io_yield_t *rr, uint8_t cmd, uint16_t reason, uint32_t data) {
+    *rr = (cmt_io_yield_t){.dev = HTIF_DEVICE_YIELD, .cmd = cmd, .reason = reason, .data = data};
+    return cmt_io_yield(io, rr);
+}
+
+static double now(void) {
+    struct timespec ts;
+    (void) clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+/* OUTPUTS outputs and a report per input, the ones of @p changed_input differ from @p changed_output on */
+static double run_mock(const cmt_io_mock_config_t *config, int changed_input, int changed_output) {
+    cmt_io_driver_t io[1];
+    cmt_io_yield_t rr;
+    assert(cmt_io_init_mock(io, config) == 0);
+
+    double start = now();
+    for (int i = 0; yield(io, &rr, HTIF_YIELD_CMD_MANUAL, HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED, 0) == 0; ++i) {
+        uint8_t *tx = cmt_io_get_tx(io).begin;
+        for (int j = 0; j < OUTPUTS; ++j) {
+            memset(tx, i + j, OUTPUT_LENGTH);
+            tx[0] ^= i == changed_input && j >= changed_output;
+            assert(yield(io, &rr, HTIF_YIELD_CMD_AUTOMATIC, HTIF_YIELD_AUTOMATIC_REASON_TX_OUTPUT, OUTPUT_LENGTH) == 0);
+        }
+        assert(yield(io, &rr, HTIF_YIELD_CMD_AUTOMATIC, HTIF_YIELD_AUTOMATIC_REASON_TX_REPORT, 8) == 0);
+    }
+    double elapsed = now() - start;
+    cmt_io_fini(io);
+    return elapsed;
+}
+
+static void mock(void) {
+    cmt_digest_divergence_t divergence;
+    assert(cmt_util_write_whole_file("digest-input.bin", 4, "abcd") == 0);
+    FILE *f = fopen("digest-inputs.txt", "w");
+    assert(f);
+    for (int i = 0; i < INPUTS; ++i) {
+        (void) fprintf(f, "0:digest-input.bin\n");
+    }
+    assert(fclose(f) == 0);
+
+    cmt_io_mock_config_t files = {.inputs_file = "digest-inputs.txt"};
+    cmt_io_mock_config_t golden = {.inputs_file = "digest-inputs.txt", .output_digest = "digest-golden.digest"};
+    cmt_io_mock_config_t changed = {
+        .inputs_file = "digest-inputs.txt",
+        .output_digest = "digest-changed.digest",
+        .expected_digest = "digest-golden.digest",
+    };
+    double written = run_mock(&files, -1, 0);
+    double hashed = run_mock(&golden, -1, 0);
+    (void) fprintf(stderr, "%d inputs of %d outputs, %.3fs written to files, %.3fs hashed\n", INPUTS, OUTPUTS,
+        written, hashed);
+    assert(access("digest-input.output-0.bin", F_OK) == 0);
+    assert(remove("digest-input.output-0.bin") == 0);
+
+    // nothing but the digest is written
+    (void) run_mock(&changed, 7, 2);
+    assert(access("digest-input.output-0.bin", F_OK) != 0);
+    assert(cmt_digest_compare("digest-golden.digest", "digest-changed.digest", &divergence) == 1);
+    assert(divergence.input == 7 && divergence.output == 2);
+
+    (void) run_mock(&changed, -1, 0);
+    assert(cmt_digest_compare("digest-golden.digest", "digest-changed.digest", &divergence) == 0);
+
+    for (int i = 0; i < OUTPUTS; ++i) {
+        char filepath[64];
+        (void) snprintf(filepath, sizeof filepath, "digest-input.output-%d.bin", i);
+        (void) remove(filepath);
+    }
+    (void) remove("digest-input.report-0.bin");
+    (void) remove("digest-input.outputs_root_hash.bin");
+    (void) remove("digest-input.bin");
+    (void) remove("digest-inputs.txt");
+    (void) remove("digest-golden.digest");
+    (void) remove("digest-changed.digest");
+    printf("test_digest_mock passed!\n");
+}
+
+int main(void) {
+    api();
+    mock();
+    return 0;
+}
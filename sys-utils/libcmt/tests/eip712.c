@@ -0,0 +1,148 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "libcmt/eip712.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+/* the `Mail` example from the EIP-712 specification */
+
+// clang-format off
+static const uint8_t expected_mail_type_hash[CMT_KECCAK_LENGTH] = {
+    0xa0, 0xce, 0xde, 0xb2, 0xdc, 0x28, 0x0b, 0xa3, 0x9b, 0x85, 0x75, 0x46, 0xd7, 0x4f, 0x55, 0x49,
+    0xc3, 0xa1, 0xd7, 0xbd, 0xc2, 0xdd, 0x96, 0xbf, 0x88, 0x1f, 0x76, 0x10, 0x8e, 0x23, 0xda, 0xc2,
+};
+static const uint8_t expected_domain_separator[CMT_KECCAK_LENGTH] = {
+    0xf2, 0xce, 0xe3, 0x75, 0xfa, 0x42, 0xb4, 0x21, 0x43, 0x80, 0x40, 0x25, 0xfc, 0x44, 0x9d, 0xea,
+    0xfd, 0x50, 0xcc, 0x03, 0x1c, 0xa2, 0x57, 0xe0, 0xb1, 0x94, 0xa6, 0x50, 0xa9, 0x12, 0x09, 0x0f,
+};
+static const uint8_t expected_mail_hash[CMT_KECCAK_LENGTH] = {
+    0xc5, 0x2c, 0x0e, 0xe5, 0xd8, 0x42, 0x64, 0x47, 0x18, 0x06, 0x29, 0x0a, 0x3f, 0x2c, 0x4c, 0xec,
+    0xfc, 0x54, 0x90, 0x62, 0x6b, 0xf9, 0x12, 0xd0, 0x1f, 0x24, 0x0d, 0x7a, 0x27, 0x4b, 0x37, 0x1e,
+};
+static const uint8_t expected_digest[CMT_KECCAK_LENGTH] = {
+    0xbe, 0x60, 0x9a, 0xee, 0x34, 0x3f, 0xb3, 0xc4, 0xb2, 0x8e, 0x1d, 0xf9, 0xe6, 0x32, 0xfc, 0xa6,
+    0x4f, 0xcf, 0xae, 0xde, 0x20, 0xf0, 0x2e, 0x86, 0x24, 0x4e, 0xfd, 0xdf, 0x30, 0x95, 0x7b, 0xd2,
+};
+static const cmt_abi_address_t verifying_contract = {{
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+}};
+static const cmt_abi_address_t cow = {{
+    0xcd, 0x2a, 0x3d, 0x9f, 0x93, 0x8e, 0x13, 0xcd, 0x94, 0x7e,
+    0xc0, 0x5a, 0xbc, 0x7f, 0xe7, 0x34, 0xdf, 0x8d, 0xd8, 0x26,
+}};
+static const cmt_abi_address_t bob = {{
+    0xbb, 0xbb, 0xbb, 0xbb, 0xbb, 0xbb, 0xbb, 0xbb, 0xbb, 0xbb,
+    0xbb, 0xbb, 0xbb, 0xbb, 0xbb, 0xbb, 0xbb, 0xbb, 0xbb, 0xbb,
+}};
+// clang-format on
+
+static void hash_person(const cmt_eip712_type_t *person, const char *name, const cmt_abi_address_t *wallet,
+    uint8_t hash[CMT_KECCAK_LENGTH]) {
+    cmt_keccak_t st[1];
+    cmt_eip712_hash_begin(st, person);
+    cmt_eip712_put_bytes(st, &(cmt_abi_bytes_t){strlen(name), (void *) name});
+    cmt_eip712_put_address(st, wallet);
+    cmt_eip712_hash_end(st, hash);
+}
+
+static void mail_example(void) {
+    cmt_eip712_t types[1];
+    const cmt_eip712_type_t *person = NULL;
+    const cmt_eip712_type_t *mail = NULL;
+
+    cmt_eip712_init(types);
+    assert(cmt_eip712_register(types, "Person", "string name,address wallet", &person) == 0);
+    assert(cmt_eip712_register(types, "Mail", "Person from,Person to,string contents", &mail) == 0);
+    assert(memcmp(mail->type_hash, expected_mail_type_hash, CMT_KECCAK_LENGTH) == 0);
+    assert(cmt_eip712_find(types, "Person") == person);
+
+    uint8_t separator[CMT_KECCAK_LENGTH];
+    cmt_eip712_domain(separator, &(cmt_abi_bytes_t){10, "Ether Mail"}, &(cmt_abi_bytes_t){1, "1"}, 1,
+        &verifying_contract);
+    assert(memcmp(separator, expected_domain_separator, CMT_KECCAK_LENGTH) == 0);
+
+    uint8_t from[CMT_KECCAK_LENGTH];
+    uint8_t to[CMT_KECCAK_LENGTH];
+    uint8_t hash[CMT_KECCAK_LENGTH];
+    uint8_t digest[CMT_KECCAK_LENGTH];
+    hash_person(person, "Cow", &cow, from);
+    hash_person(person, "Bob", &bob, to);
+
+    cmt_keccak_t st[1];
+    cmt_eip712_hash_begin(st, mail);
+    cmt_eip712_put_hash(st, from);
+    cmt_eip712_put_hash(st, to);
+    cmt_eip712_put_bytes(st, &(cmt_abi_bytes_t){11, "Hello, Bob!"});
+    cmt_eip712_hash_end(st, hash);
+    assert(memcmp(hash, expected_mail_hash, CMT_KECCAK_LENGTH) == 0);
+
+    cmt_eip712_digest(separator, hash, digest);
+    assert(memcmp(digest, expected_digest, CMT_KECCAK_LENGTH) == 0);
+    printf("test_eip712_mail_example passed!\n");
+}
+
+static void encode_type_order(void) {
+    cmt_eip712_t types[1];
+    const cmt_eip712_type_t *order = NULL;
+    uint8_t expected[CMT_KECCAK_LENGTH];
+    const char encoded[] = "Order(Asset give,Fee[] fees,uint256 nonce)Asset(address token,uint256 amount)"
+                           "Fee(Asset asset,address to)";
+
+    cmt_eip712_init(types);
+    assert(cmt_eip712_register(types, "Asset", "address token,uint256 amount", NULL) == 0);
+    assert(cmt_eip712_register(types, "Fee", "Asset asset,address to", NULL) == 0);
+    assert(cmt_eip712_register(types, "Order", "Asset give,Fee[] fees,uint256 nonce", &order) == 0);
+    cmt_keccak_data(strlen(encoded), encoded, expected);
+    assert(memcmp(order->type_hash, expected, CMT_KECCAK_LENGTH) == 0);
+
+    // array of atomic values: keccak of the concatenated encodings
+    cmt_keccak_t st[1];
+    uint8_t hash[CMT_KECCAK_LENGTH];
+    uint8_t words[2 * CMT_ABI_U256_LENGTH] = {0};
+    words[CMT_ABI_U256_LENGTH - 1] = 1;
+    words[2 * CMT_ABI_U256_LENGTH - 1] = 2;
+    cmt_eip712_array_begin(st);
+    for (uint64_t i = 1; i <= 2; ++i) {
+        assert(cmt_eip712_put_uint(st, sizeof(i), &i) == 0);
+    }
+    cmt_eip712_hash_end(st, hash);
+    cmt_keccak_data(sizeof(words), words, expected);
+    assert(memcmp(hash, expected, CMT_KECCAK_LENGTH) == 0);
+    printf("test_eip712_encode_type_order passed!\n");
+}
+
+static void invalid_registrations(void) {
+    cmt_eip712_t types[1];
+    cmt_eip712_init(types);
+    assert(cmt_eip712_register(NULL, "A", "uint256 a", NULL) == -EINVAL);
+    assert(cmt_eip712_register(types, "A", "Missing m", NULL) == -ENOENT);
+    assert(cmt_eip712_register(types, "A", "uint256", NULL) == -EINVAL);
+    assert(cmt_eip712_register(types, "A", "uint256 a", NULL) == 0);
+    assert(cmt_eip712_register(types, "A", "uint256 a", NULL) == -EINVAL);
+    assert(cmt_eip712_find(types, "B") == NULL);
+    printf("test_eip712_invalid_registrations passed!\n");
+}
+
+int main(void) {
+    mail_example();
+    encode_type_order();
+    invalid_registrations();
+    return 0;
+}
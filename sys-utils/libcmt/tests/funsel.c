@@ -0,0 +1,239 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* Exercises the header `funsel -j tests/funsel.abi.json` generates. */
+#include "funsel-app.h"
+#include "libcmt/keccak.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+static const struct {
+    const char *decl;
+    uint32_t funsel;
+    int method;
+} methods[] = {
+    {"transfer(address,uint256)", APP_TRANSFER_FUNSEL, APP_TRANSFER},
+    {"transfer(address,uint256,bytes)", APP_TRANSFER_2_FUNSEL, APP_TRANSFER_2},
+    {"configure((uint32,address),bool)", APP_CONFIGURE_FUNSEL, APP_CONFIGURE},
+    {"store(bytes,string)", APP_STORE_FUNSEL, APP_STORE},
+    {"widths(uint8,uint16,uint32,uint64,uint128,bool)", APP_WIDTHS_FUNSEL, APP_WIDTHS},
+    {"ping()", APP_PING_FUNSEL, APP_PING},
+    {"transfer_1(uint8)", APP_TRANSFER_1_FUNSEL, APP_TRANSFER_1},
+    {"keywords(uint32,bool,address,uint8,uint64)", APP_KEYWORDS_FUNSEL, APP_KEYWORDS},
+    {"unnamed(uint8,uint16,uint32)", APP_UNNAMED_FUNSEL, APP_UNNAMED},
+};
+
+static void test_funsel_dispatch(void) {
+    assert(sizeof methods / sizeof methods[0] == APP_METHOD_COUNT);
+    for (size_t i = 0; i < APP_METHOD_COUNT; ++i) {
+        uint32_t funsel = cmt_keccak_funsel(methods[i].decl);
+        assert(funsel == methods[i].funsel);
+        assert(app_dispatch(funsel) == methods[i].method);
+    }
+
+    // events and constructors are not methods
+    assert(app_dispatch(cmt_keccak_funsel("Transfer(address)")) == -1);
+    assert(app_dispatch(cmt_keccak_funsel("transfer(address,uint128)")) == -1);
+    assert(app_dispatch(0) == -1);
+
+    // every slot of the table must reject a near miss of its own selector
+    for (size_t i = 0; i < APP_METHOD_COUNT; ++i) {
+        assert(app_dispatch(methods[i].funsel ^ 1) == -1);
+    }
+    printf("test_funsel_dispatch passed!\n");
+}
+
+static void test_funsel_decode_transfer(void) {
+    uint8_t mem[512];
+    cmt_buf_t bb[1] = {{mem, mem + sizeof mem}};
+    cmt_buf_t wr[1] = {*bb};
+    cmt_buf_t of[1];
+    cmt_buf_t frame[1];
+    cmt_abi_address_t to = {{0}};
+    cmt_abi_u256_t amount = {{0}};
+    uint8_t data[] = {0xde, 0xad, 0xbe, 0xef, 0x01};
+
+    memset(to.data, 0xaa, sizeof to.data);
+    amount.data[CMT_ABI_U256_LENGTH - 1] = 0x42;
+    assert(cmt_abi_put_funsel(wr, cmt_keccak_funsel("transfer(address,uint256,bytes)")) == 0);
+    assert(cmt_abi_mark_frame(wr, frame) == 0);
+    assert(cmt_abi_put_address(wr, &to) == 0);
+    assert(cmt_abi_put_uint256(wr, &amount) == 0);
+    assert(cmt_abi_put_bytes_s(wr, of) == 0);
+    assert(cmt_abi_put_bytes_d(wr, of, frame, &(cmt_abi_bytes_t){sizeof data, data}) == 0);
+
+    cmt_buf_t rd[1] = {{bb->begin, wr->begin}};
+    assert(app_dispatch(cmt_abi_peek_funsel(rd)) == APP_TRANSFER_2);
+
+    // the overload with a different selector must refuse it
+    app_transfer_args_t other;
+    cmt_buf_t it[1] = {*rd};
+    assert(app_decode_transfer(it, &other) == -EBADMSG);
+
+    app_transfer_2_args_t args;
+    assert(app_decode_transfer_2(rd, &args) == 0);
+    assert(memcmp(args.to.data, to.data, sizeof to.data) == 0);
+    assert(memcmp(args.amount.data, amount.data, sizeof amount.data) == 0);
+    assert(args.data.length == sizeof data);
+    assert(memcmp(args.data.data, data, sizeof data) == 0);
+    printf("test_funsel_decode_transfer passed!\n");
+}
+
+static void test_funsel_decode_store(void) {
+    uint8_t mem[512];
+    cmt_buf_t bb[1] = {{mem, mem + sizeof mem}};
+    cmt_buf_t wr[1] = {*bb};
+    cmt_buf_t of[2];
+    cmt_buf_t frame[1];
+    char key[] = "key";
+    char value[] = "a value longer than one thirty-two byte word";
+
+    assert(cmt_abi_put_funsel(wr, cmt_keccak_funsel("store(bytes,string)")) == 0);
+    assert(cmt_abi_mark_frame(wr, frame) == 0);
+    assert(cmt_abi_put_bytes_s(wr, &of[0]) == 0);
+    assert(cmt_abi_put_bytes_s(wr, &of[1]) == 0);
+    assert(cmt_abi_put_bytes_d(wr, &of[0], frame, &(cmt_abi_bytes_t){strlen(key), key}) == 0);
+    assert(cmt_abi_put_bytes_d(wr, &of[1], frame, &(cmt_abi_bytes_t){strlen(value), value}) == 0);
+
+    cmt_buf_t rd[1] = {{bb->begin, wr->begin}};
+    app_store_args_t args;
+    assert(app_decode_store(rd, &args) == 0);
+    assert(args.key.length == strlen(key));
+    assert(memcmp(args.key.data, key, strlen(key)) == 0);
+    assert(args.value.length == strlen(value));
+    assert(memcmp(args.value.data, value, strlen(value)) == 0);
+    printf("test_funsel_decode_store passed!\n");
+}
+
+static void test_funsel_decode_widths(void) {
+    uint8_t mem[512];
+    cmt_buf_t bb[1] = {{mem, mem + sizeof mem}};
+    cmt_buf_t wr[1] = {*bb};
+    uint8_t a = UINT8_MAX;
+    uint16_t b = 0x1234;
+    uint32_t c = UINT32_C(0xdeadbeef);
+    uint64_t d = UINT64_C(0x0123456789abcdef);
+    cmt_abi_u256_t e = {{0}};
+
+    memset(e.data + CMT_ABI_U256_LENGTH - 16, 0xff, 16); // uint128 max
+    assert(cmt_abi_put_funsel(wr, cmt_keccak_funsel("widths(uint8,uint16,uint32,uint64,uint128,bool)")) == 0);
+    assert(cmt_abi_put_uint(wr, sizeof a, &a) == 0);
+    assert(cmt_abi_put_uint(wr, sizeof b, &b) == 0);
+    assert(cmt_abi_put_uint(wr, sizeof c, &c) == 0);
+    assert(cmt_abi_put_uint(wr, sizeof d, &d) == 0);
+    assert(cmt_abi_put_uint256(wr, &e) == 0);
+    assert(cmt_abi_put_bool(wr, true) == 0);
+
+    cmt_buf_t rd[1] = {{bb->begin, wr->begin}};
+    app_widths_args_t args;
+    assert(app_decode_widths(rd, &args) == 0);
+    assert(args.a == a);
+    assert(args.b == b);
+    assert(args.c == c);
+    assert(args.d == d);
+    assert(memcmp(args.e.data, e.data, sizeof e.data) == 0);
+    assert(args.f == true);
+
+    // a value wider than the field must not be truncated silently
+    cmt_buf_t big[1] = {*bb};
+    uint16_t wide = 0x100;
+    assert(cmt_abi_put_funsel(big, APP_WIDTHS_FUNSEL) == 0);
+    assert(cmt_abi_put_uint(big, sizeof wide, &wide) == 0);
+    cmt_buf_t rd_big[1] = {{bb->begin, big->begin}};
+    assert(app_decode_widths(rd_big, &args) != 0);
+    printf("test_funsel_decode_widths passed!\n");
+}
+
+/* parameters named after C keywords and reserved identifiers are mangled */
+static void test_funsel_decode_keywords(void) {
+    uint8_t mem[512];
+    cmt_buf_t bb[1] = {{mem, mem + sizeof mem}};
+    cmt_buf_t wr[1] = {*bb};
+    cmt_abi_address_t address = {{0}};
+    uint32_t i = 7;
+    uint8_t v = 9;
+    uint64_t e = 11;
+
+    memset(address.data, 0x55, sizeof address.data);
+    assert(cmt_abi_put_funsel(wr, cmt_keccak_funsel("keywords(uint32,bool,address,uint8,uint64)")) == 0);
+    assert(cmt_abi_put_uint(wr, sizeof i, &i) == 0);
+    assert(cmt_abi_put_bool(wr, true) == 0);
+    assert(cmt_abi_put_address(wr, &address) == 0);
+    assert(cmt_abi_put_uint(wr, sizeof v, &v) == 0);
+    assert(cmt_abi_put_uint(wr, sizeof e, &e) == 0);
+
+    cmt_buf_t rd[1] = {{bb->begin, wr->begin}};
+    app_keywords_args_t args;
+    assert(app_decode_keywords(rd, &args) == 0);
+    assert(args.int_ == i);
+    assert(args.default_ == true);
+    assert(memcmp(args.register_.data, address.data, sizeof address.data) == 0);
+    assert(args.arg_Value == v);
+    assert(args.errno_ == e);
+    printf("test_funsel_decode_keywords passed!\n");
+}
+
+/* unnamed parameters are named after their position, without taking a real name */
+static void test_funsel_decode_unnamed(void) {
+    uint8_t mem[512];
+    cmt_buf_t bb[1] = {{mem, mem + sizeof mem}};
+    cmt_buf_t wr[1] = {*bb};
+    uint8_t a = 1;
+    uint16_t b = 2;
+    uint32_t c = 3;
+
+    assert(cmt_abi_put_funsel(wr, cmt_keccak_funsel("unnamed(uint8,uint16,uint32)")) == 0);
+    assert(cmt_abi_put_uint(wr, sizeof a, &a) == 0);
+    assert(cmt_abi_put_uint(wr, sizeof b, &b) == 0);
+    assert(cmt_abi_put_uint(wr, sizeof c, &c) == 0);
+
+    cmt_buf_t rd[1] = {{bb->begin, wr->begin}};
+    app_unnamed_args_t args;
+    assert(app_decode_unnamed(rd, &args) == 0);
+    assert(args.arg0_ == a);
+    assert(args.arg0 == b);
+    assert(args.arg2 == c);
+    printf("test_funsel_decode_unnamed passed!\n");
+}
+
+static void test_funsel_decode_ping(void) {
+    uint8_t mem[4];
+    cmt_buf_t bb[1] = {{mem, mem + sizeof mem}};
+    cmt_buf_t wr[1] = {*bb};
+    app_ping_args_t args;
+
+    assert(cmt_abi_put_funsel(wr, cmt_keccak_funsel("ping()")) == 0);
+    cmt_buf_t rd[1] = {*bb};
+    assert(app_decode_ping(rd, &args) == 0);
+
+    // short input
+    cmt_buf_t empty[1] = {{mem, mem}};
+    assert(app_decode_ping(empty, &args) == -ENOBUFS);
+    printf("test_funsel_decode_ping passed!\n");
+}
+
+int main(void) {
+    test_funsel_dispatch();
+    test_funsel_decode_transfer();
+    test_funsel_decode_store();
+    test_funsel_decode_widths();
+    test_funsel_decode_keywords();
+    test_funsel_decode_unnamed();
+    test_funsel_decode_ping();
+    return 0;
+}
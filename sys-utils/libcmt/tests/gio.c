@@ -31,6 +31,11 @@ int main(void) {
     assert(req.response_data_length == strlen(reply));
     assert(memcmp(req.response_data, reply, req.response_data_length) == 0);
 
+    const cmt_io_stats_kind_t *gio = &cmt_io_get_stats(rollup.io)->kind[CMT_IO_STATS_GIO];
+    assert(gio->count == 1);
+    assert(gio->tx_bytes == buffer_length);
+    assert(gio->rx_bytes == strlen(reply));
+
     cmt_rollup_fini(&rollup);
     printf("test_gio_request passed!\n");
     return 0;
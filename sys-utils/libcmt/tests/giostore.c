@@ -0,0 +1,177 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "libcmt/giostore.h"
+#include "libcmt/rollup.h"
+#include "libcmt/util.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define DIR "giostore.d"
+#define PACK "giostore.pack"
+#define QUERIES 20000
+#define DOMAIN 0x10 // 0 to 2 are the manual yield reasons of the mock
+
+static const char id_a[] = "preimage-a";
+static const char id_b[] = "preimage-b";
+static const char response_a[] = "0123456789";
+static const char response_b[] = "abcdefghij";
+
+static void put_response(uint16_t domain, const char *id, const char *response) {
+    char name[CMT_GIOSTORE_NAME_LENGTH];
+    char path[sizeof(DIR) + sizeof name];
+    cmt_giostore_name(domain, strlen(id), id, name);
+    (void) snprintf(path, sizeof path, DIR "/%s", name);
+    assert(cmt_util_write_whole_file(path, strlen(response), response) == 0);
+}
+
+static void remove_responses(void) {
+    char name[CMT_GIOSTORE_NAME_LENGTH];
+    char path[sizeof(DIR) + sizeof name];
+    cmt_giostore_name(DOMAIN, strlen(id_a), id_a, name);
+    (void) snprintf(path, sizeof path, DIR "/%s", name);
+    (void) remove(path);
+    cmt_giostore_name(DOMAIN, strlen(id_b), id_b, name);
+    (void) snprintf(path, sizeof path, DIR "/%s", name);
+    (void) remove(path);
+    (void) remove(DIR "/ignored.txt");
+    (void) rmdir(DIR);
+}
+
+static void expect(cmt_giostore_t *store, uint16_t domain, const char *id, const char *response) {
+    const void *data = NULL;
+    size_t length = 0;
+    assert(cmt_giostore_find(store, domain, strlen(id), id, &data, &length) == 0);
+    assert(length == strlen(response));
+    assert(memcmp(data, response, length) == 0);
+}
+
+static void expect_missing(cmt_giostore_t *store, uint16_t domain, const char *id) {
+    const void *data = NULL;
+    size_t length = 0;
+    assert(cmt_giostore_find(store, domain, strlen(id), id, &data, &length) == -ENOENT);
+}
+
+/* room for one response in the cache, the other evicts it */
+static void directory_lru(void) {
+    cmt_giostore_t *store = NULL;
+    assert(cmt_giostore_open(&store, DIR, 16) == 0);
+    expect(store, DOMAIN, id_a, response_a);
+    expect(store, DOMAIN, id_a, response_a);
+    expect(store, DOMAIN, id_b, response_b);
+    expect(store, DOMAIN, id_a, response_a);
+    expect_missing(store, DOMAIN + 1, id_a);
+    expect_missing(store, DOMAIN, "preimage-c");
+
+    const cmt_giostore_stats_t *stats = cmt_giostore_get_stats(store);
+    assert(stats->lookups == 6);
+    assert(stats->found == 4);
+    assert(stats->cached == 1);
+    assert(stats->evicted == 2);
+    cmt_giostore_close(store);
+
+    // larger than the whole cache, still answered
+    assert(cmt_giostore_open(&store, DIR, 0) == 0);
+    expect(store, DOMAIN, id_a, response_a);
+    expect(store, DOMAIN, id_b, response_b);
+    assert(cmt_giostore_get_stats(store)->cached == 0);
+    cmt_giostore_close(store);
+    printf("test_giostore_directory_lru passed!\n");
+}
+
+static void pack(void) {
+    cmt_giostore_t *store = NULL;
+    assert(cmt_giostore_pack(DIR, PACK) == 0);
+    assert(cmt_giostore_open(&store, PACK, 0) == 0);
+    expect(store, DOMAIN, id_b, response_b);
+    expect(store, DOMAIN, id_a, response_a);
+    expect_missing(store, DOMAIN + 1, id_a);
+    assert(cmt_giostore_get_stats(store)->found == 2);
+    cmt_giostore_close(store);
+
+    assert(cmt_util_write_whole_file("giostore-bad.pack", 16, "CMTGIOP1\1\0\0\0\xff\0\0\0") == 0);
+    assert(cmt_giostore_open(&store, "giostore-bad.pack", 0) == -EPROTO);
+    assert(cmt_giostore_open(&store, "giostore-missing.pack", 0) == -ENOENT);
+    (void) remove("giostore-bad.pack");
+    printf("test_giostore_pack passed!\n");
+}
+
+static double now(void) {
+    struct timespec ts;
+    (void) clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+/* the mock answers from the store, and from the inputs when it is not there */
+static void mock(void) {
+    cmt_rollup_t rollup;
+    assert(cmt_util_write_whole_file("giostore-fallback.bin", 8, "fallback") == 0);
+    assert(setenv("CMT_GIO_STORE", PACK, 1) == 0);
+    assert(setenv("CMT_INPUTS", "42:giostore-fallback.bin", 1) == 0);
+    assert(setenv("CMT_OUTPUT_LOG", "giostore.log", 1) == 0);
+    assert(cmt_rollup_init(&rollup) == 0);
+
+    cmt_gio_t req = {.domain = DOMAIN, .id = (void *) id_a, .id_length = strlen(id_a)};
+    assert(cmt_gio_request(&rollup, &req) == 0);
+    assert(req.response_code == 0);
+    assert(req.response_data_length == strlen(response_a));
+    assert(memcmp(req.response_data, response_a, req.response_data_length) == 0);
+
+    req = (cmt_gio_t){.domain = DOMAIN, .id = "preimage-c", .id_length = 10};
+    assert(cmt_gio_request(&rollup, &req) == 0);
+    assert(req.response_code == 42);
+    assert(req.response_data_length == 8);
+    assert(memcmp(req.response_data, "fallback", 8) == 0);
+
+    double start = now();
+    for (int i = 0; i < QUERIES; ++i) {
+        req = (cmt_gio_t){.domain = DOMAIN, .id = (void *) (i & 1 ? id_a : id_b), .id_length = strlen(id_a)};
+        assert(cmt_gio_request(&rollup, &req) == 0);
+        assert(req.response_code == 0);
+    }
+    double elapsed = now() - start;
+    (void) fprintf(stderr, "%d gio requests from the pack in %.3fs, %.0f requests/s\n", QUERIES, elapsed,
+        QUERIES / elapsed);
+
+    cmt_rollup_fini(&rollup);
+    assert(unsetenv("CMT_GIO_STORE") == 0);
+    assert(unsetenv("CMT_OUTPUT_LOG") == 0);
+    (void) remove("giostore-fallback.bin");
+    (void) remove("giostore.log");
+    printf("test_giostore_mock passed!\n");
+}
+
+int main(void) {
+    (void) mkdir(DIR, 0755);
+    put_response(DOMAIN, id_a, response_a);
+    put_response(DOMAIN, id_b, response_b);
+    assert(cmt_util_write_whole_file(DIR "/ignored.txt", 3, "abc") == 0);
+
+    directory_lru();
+    pack();
+    mock();
+
+    remove_responses();
+    (void) remove(PACK);
+    return 0;
+}
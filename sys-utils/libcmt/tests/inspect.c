@@ -0,0 +1,286 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "libcmt/io.h"
+#include "libcmt/digest.h"
+#include "libcmt/outlog.h"
+#include "libcmt/util.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <unistd.h>
+
+#define INPUTS 60
+#define KILLED 10     // this inspect exits without finishing
+#define SPIN_NS 2e6   // work per inspect
+#define MUTATION 1000 // what each inspect adds to the state
+
+static int yield(cmt_io_driver_t *io, cmt_io_yield_t *rr, uint8_t cmd, uint16_t reason, uint32_t data) {
+    *rr = (cmt_io_yield_t){.dev = HTIF_DEVICE_YIELD, .cmd = cmd, .reason = reason, .data = data};
+    return cmt_io_yield(io, rr);
+}
+
+static double now(void) {
+    struct timespec ts;
+    (void) clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+/* every third input is an advance, the rest are inspects */
+static void write_inputs(void) {
+    assert(cmt_util_write_whole_file("inspect-advance.bin", 4, "step") == 0);
+    assert(cmt_util_write_whole_file("inspect-query.bin", 4, "look") == 0);
+    assert(cmt_util_write_whole_file("inspect-kill.bin", 4, "kill") == 0);
+    FILE *f = fopen("inspect-inputs.txt", "w");
+    assert(f);
+    for (int i = 0; i < INPUTS; ++i) {
+        if (i % 3 == 0) {
+            (void) fprintf(f, "0:inspect-advance.bin\n");
+        } else {
+            (void) fprintf(f, "1:%s\n", i == KILLED ? "inspect-kill.bin" : "inspect-query.bin");
+        }
+    }
+    assert(fclose(f) == 0);
+}
+
+/* report @p state, raise an exception for a `fail` input, and shut the io down.
+ * Only ever reached by a forked inspect, which must not come back from either */
+static void quit(cmt_io_driver_t *io, uint64_t state) {
+    cmt_io_yield_t rr;
+    memcpy(cmt_io_get_tx(io).begin, &state, sizeof state);
+    assert(yield(io, &rr, HTIF_YIELD_CMD_AUTOMATIC, HTIF_YIELD_AUTOMATIC_REASON_TX_REPORT, sizeof state) == 0);
+    if (memcmp(cmt_io_get_rx(io).begin, "fail", 4) == 0) {
+        memcpy(cmt_io_get_tx(io).begin, "fail", 4);
+        (void) yield(io, &rr, HTIF_YIELD_CMD_MANUAL, HTIF_YIELD_MANUAL_REASON_TX_EXCEPTION, 4);
+    }
+    cmt_io_fini(io);
+    _exit(5);
+}
+
+/* advances count themselves in the state, inspects wrongly change it by @p mutation, both report it */
+static double run(const cmt_io_mock_config_t *config, uint64_t mutation) {
+    cmt_io_driver_t io[1];
+    cmt_io_yield_t rr;
+    assert(cmt_io_init_mock(io, config) == 0);
+
+    uint64_t state = 0;
+    double start = now();
+    while (yield(io, &rr, HTIF_YIELD_CMD_MANUAL, HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED, 0) == 0) {
+        if (rr.reason == HTIF_YIELD_REASON_ADVANCE) {
+            state += 1;
+        } else {
+            if (memcmp(cmt_io_get_rx(io).begin, "kill", 4) == 0) {
+                _exit(3);
+            }
+            if (memcmp(cmt_io_get_rx(io).begin, "fail", 4) == 0 || memcmp(cmt_io_get_rx(io).begin, "quit", 4) == 0) {
+                quit(io, state);
+            }
+            for (double end = now() + (SPIN_NS * 1e-9); now() < end;) {
+                ;
+            }
+            state += mutation;
+        }
+        memcpy(cmt_io_get_tx(io).begin, &state, sizeof state);
+        assert(yield(io, &rr, HTIF_YIELD_CMD_AUTOMATIC, HTIF_YIELD_AUTOMATIC_REASON_TX_REPORT, sizeof state) == 0);
+    }
+    double elapsed = now() - start;
+    cmt_io_fini(io);
+    return elapsed;
+}
+
+/* the reported state of each input, UINT64_MAX for none, and the number of outputs roots hashes */
+static int read_reports(const char *filepath, uint64_t reports[INPUTS]) {
+    size_t length = 0;
+    static uint8_t log[1 << 16];
+    assert(cmt_util_read_whole_file(filepath, sizeof log, log, &length) == 0);
+    cmt_outlog_footer_t footer;
+    memcpy(&footer, log + length - sizeof footer, sizeof footer);
+
+    int hashes = 0;
+    uint64_t input = 0;
+    for (int i = 0; i < INPUTS; ++i) {
+        reports[i] = UINT64_MAX;
+    }
+    for (size_t offset = sizeof(cmt_outlog_header_t); offset < footer.index;) {
+        cmt_outlog_record_t record;
+        memcpy(&record, log + offset, sizeof record);
+        offset += sizeof record;
+        assert(record.input < INPUTS && record.input >= input); // in input order
+        input = record.input;
+        if (record.kind == CMT_OUTLOG_REPORT) {
+            assert(record.seq == 0 && record.length == sizeof(uint64_t));
+            memcpy(&reports[record.input], log + offset, sizeof(uint64_t));
+        } else {
+            assert(record.kind == CMT_OUTLOG_OUTPUTS_ROOT_HASH);
+            hashes++;
+        }
+        offset += (record.length + CMT_OUTLOG_ALIGN - 1) & ~(CMT_OUTLOG_ALIGN - 1);
+    }
+    return hashes;
+}
+
+static void test_inspect_in_process(void) {
+    uint64_t reports[INPUTS];
+    cmt_io_mock_config_t config = {.inputs_file = "inspect-inputs.txt", .output_log = "inspect-serial.log"};
+    assert(cmt_util_write_whole_file("inspect-kill.bin", 4, "look") == 0); // it would end the run
+    double elapsed = run(&config, MUTATION);
+    assert(cmt_util_write_whole_file("inspect-kill.bin", 4, "kill") == 0);
+
+    assert(read_reports("inspect-serial.log", reports) == INPUTS);
+    // the changes of the inspects leak into the following inputs
+    assert(reports[0] == 1 && reports[1] == 1 + MUTATION && reports[3] == 2 + (2 * MUTATION));
+    (void) fprintf(stderr, "%d inputs, %.3fs with the inspects in process\n", INPUTS, elapsed);
+    (void) remove("inspect-serial.log");
+    printf("test_inspect_in_process passed!\n");
+}
+
+static void test_inspect_forked(uint32_t forks, int flags) {
+    uint64_t reports[INPUTS];
+    cmt_io_mock_config_t config = {
+        .inputs_file = "inspect-inputs.txt",
+        .output_log = "inspect-forked.log",
+        .inspect_forks = forks,
+        .flags = flags,
+    };
+    double elapsed = run(&config, MUTATION);
+
+    // every input but the killed inspect finished
+    assert(read_reports("inspect-forked.log", reports) == INPUTS - 1);
+    uint64_t advances = 0;
+    for (int i = 0; i < INPUTS; ++i) {
+        if (i % 3 == 0) {
+            assert(reports[i] == ++advances);
+        } else if (i == KILLED) {
+            assert(reports[i] == UINT64_MAX);
+        } else { // the state of the previous advance, and the change is gone
+            assert(reports[i] == advances + MUTATION);
+        }
+    }
+    (void) fprintf(stderr, "%d inputs, %.3fs with %u forked inspects at once\n", INPUTS, elapsed, forks);
+    (void) remove("inspect-forked.log");
+    printf("test_inspect_forked passed!\n");
+}
+
+/* inspects that leave the state alone have the same outputs, in the same order, forked or not */
+static void test_inspect_digest(uint32_t forks) {
+    cmt_digest_divergence_t divergence;
+    cmt_io_mock_config_t serial = {.inputs_file = "inspect-inputs.txt", .output_digest = "inspect-serial.digest"};
+    cmt_io_mock_config_t forked = {
+        .inputs_file = "inspect-inputs.txt",
+        .output_digest = "inspect-forked.digest",
+        .inspect_forks = forks,
+    };
+    assert(cmt_util_write_whole_file("inspect-kill.bin", 4, "look") == 0);
+    (void) run(&serial, 0);
+    (void) run(&forked, 0);
+    assert(cmt_util_write_whole_file("inspect-kill.bin", 4, "kill") == 0);
+
+    assert(cmt_digest_compare("inspect-serial.digest", "inspect-forked.digest", &divergence) == 0);
+    (void) remove("inspect-serial.digest");
+    (void) remove("inspect-forked.digest");
+    printf("test_inspect_digest passed!\n");
+}
+
+/* a forked inspect that raises an exception, or calls fini, leaves the log and digest of the parent alone */
+static void test_inspect_quit(uint32_t forks) {
+    enum { N = 12, FAIL = 4, QUIT = 7 };
+    assert(cmt_util_write_whole_file("inspect-fail.bin", 4, "fail") == 0);
+    assert(cmt_util_write_whole_file("inspect-quit.bin", 4, "quit") == 0);
+    FILE *f = fopen("inspect-quit.txt", "w");
+    assert(f);
+    for (int i = 0; i < N; ++i) {
+        const char *name = i == FAIL ? "1:inspect-fail.bin" : i == QUIT ? "1:inspect-quit.bin" : "1:inspect-query.bin";
+        (void) fprintf(f, "%s\n", i % 3 == 0 ? "0:inspect-advance.bin" : name);
+    }
+    assert(fclose(f) == 0);
+
+    cmt_io_mock_config_t logged = {
+        .inputs_file = "inspect-quit.txt",
+        .output_log = "inspect-quit.log",
+        .inspect_forks = forks,
+        .flags = CMT_IO_ASYNC_OUTPUTS,
+    };
+    cmt_io_mock_config_t digested = {
+        .inputs_file = "inspect-quit.txt",
+        .output_digest = "inspect-quit.digest",
+        .inspect_forks = forks,
+    };
+    (void) run(&logged, 0);
+    (void) run(&digested, 0);
+
+    // the log holds every input, in order, and the digest hashes the same records
+    size_t length = 0;
+    static uint8_t log[1 << 16];
+    assert(cmt_util_read_whole_file("inspect-quit.log", sizeof log, log, &length) == 0);
+    cmt_outlog_footer_t footer;
+    memcpy(&footer, log + length - sizeof footer, sizeof footer);
+    cmt_digest_t reference[1];
+    assert(cmt_digest_open(reference, "inspect-quit.expected", NULL) == 0);
+
+    int reports = 0;
+    int hashes = 0;
+    int exceptions = 0;
+    uint64_t input = 0;
+    for (size_t offset = sizeof(cmt_outlog_header_t); offset < footer.index;) {
+        cmt_outlog_record_t record;
+        memcpy(&record, log + offset, sizeof record);
+        offset += sizeof record;
+        assert(record.input < N && record.input >= input);
+        input = record.input;
+        if (record.kind == CMT_OUTLOG_REPORT) {
+            reports++;
+        } else if (record.kind == CMT_OUTLOG_EXCEPTION) {
+            assert(record.input == FAIL && memcmp(log + offset, "fail", 4) == 0);
+            exceptions++;
+        } else {
+            assert(record.kind == CMT_OUTLOG_OUTPUTS_ROOT_HASH);
+            assert(record.input != FAIL && record.input != QUIT);
+            hashes++;
+        }
+        assert(cmt_digest_add(reference, record.input, record.kind, record.length, log + offset) == 0);
+        offset += (record.length + CMT_OUTLOG_ALIGN - 1) & ~(CMT_OUTLOG_ALIGN - 1);
+    }
+    assert(cmt_digest_close(reference) == 0);
+    assert(reports == N && exceptions == 1 && hashes == N - 2);
+
+    cmt_digest_divergence_t divergence;
+    assert(cmt_digest_compare("inspect-quit.expected", "inspect-quit.digest", &divergence) == 0);
+    (void) remove("inspect-quit.log");
+    (void) remove("inspect-quit.digest");
+    (void) remove("inspect-quit.expected");
+    (void) remove("inspect-quit.txt");
+    (void) remove("inspect-fail.bin");
+    (void) remove("inspect-quit.bin");
+    printf("test_inspect_quit passed!\n");
+}
+
+int main(void) {
+    write_inputs();
+    test_inspect_in_process();
+    test_inspect_forked(1, 0);
+    test_inspect_forked(4, CMT_IO_ASYNC_OUTPUTS);
+    test_inspect_digest(2);
+    test_inspect_digest(4);
+    test_inspect_quit(2);
+    (void) remove("inspect-advance.bin");
+    (void) remove("inspect-query.bin");
+    (void) remove("inspect-kill.bin");
+    (void) remove("inspect-inputs.txt");
+    return 0;
+}
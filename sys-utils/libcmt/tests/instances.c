@@ -0,0 +1,201 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "libcmt/io.h"
+#include "libcmt/outlog.h"
+#include "libcmt/util.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define THREADS 4
+#define INPUTS 200
+
+typedef struct {
+    int id;
+    char input[64];
+    char inputs_file[64];
+    char output_log[64];
+    char record[64];
+    char cost_report[64];
+    int processed;
+} instance_t;
+
+static int yield(cmt_io_driver_t *io, cmt_io_yield_t *rr, uint8_t cmd, uint16_t reason, uint32_t data) {
+    *rr = (cmt_io_yield_t){.dev = HTIF_DEVICE_YIELD, .cmd = cmd, .reason = reason, .data = data};
+    return cmt_io_yield(io, rr);
+}
+
+/* every input carries the instance id, echo it back in an output */
+static void serve(cmt_io_driver_t *io, instance_t *it) {
+    cmt_io_yield_t rr;
+    uint32_t length = 0;
+    while (yield(io, &rr, HTIF_YIELD_CMD_MANUAL, HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED, length) == 0) {
+        uint8_t *rx = cmt_io_get_rx(io).begin;
+        uint8_t *tx = cmt_io_get_tx(io).begin;
+        assert(rr.data == (uint32_t) (64 + it->id) && rx[0] == it->id);
+        memset(tx, it->id, it->id + 1);
+        assert(yield(io, &rr, HTIF_YIELD_CMD_AUTOMATIC, HTIF_YIELD_AUTOMATIC_REASON_TX_OUTPUT, it->id + 1) == 0);
+        it->processed++;
+        length = 32;
+    }
+}
+
+static void *run(void *arg) {
+    instance_t *it = arg;
+    cmt_io_mock_config_t config = {
+        .inputs_file = it->inputs_file,
+        .output_log = it->output_log,
+        .tx_length = 64 << 10,
+        .rx_length = 64 << 10,
+        .record = it->record,
+        .cost = "yield=1000",
+        .cost_report = it->cost_report,
+    };
+    cmt_io_driver_t io[1];
+    assert(cmt_io_init_mock(io, &config) == 0);
+    serve(io, it);
+    cmt_io_fini(io);
+    return NULL;
+}
+
+/* lines of the cost report, the header and one per input */
+static int report_lines(const char *filepath) {
+    char line[128];
+    int lines = 0;
+    FILE *f = fopen(filepath, "r");
+    assert(f);
+    while (fgets(line, sizeof line, f)) {
+        lines++;
+    }
+    assert(fclose(f) == 0);
+    return lines;
+}
+
+static uint64_t log_records(const char *filepath) {
+    uint8_t data[64 << 10];
+    size_t length = 0;
+    cmt_outlog_footer_t footer;
+    assert(cmt_util_read_whole_file(filepath, sizeof data, data, &length) == 0);
+    assert(length >= sizeof footer);
+    memcpy(&footer, data + length - sizeof footer, sizeof footer);
+    assert(memcmp(footer.magic, "CMTOLOGX", sizeof footer.magic) == 0);
+    return footer.count;
+}
+
+static void threads(void) {
+    static instance_t instances[THREADS];
+    pthread_t threads[THREADS];
+
+    for (int i = 0; i < THREADS; ++i) {
+        instance_t *it = &instances[i];
+        uint8_t input[64 + THREADS];
+        it->id = i;
+        (void) snprintf(it->input, sizeof it->input, "instances-%d.bin", i);
+        (void) snprintf(it->inputs_file, sizeof it->inputs_file, "instances-%d.txt", i);
+        (void) snprintf(it->output_log, sizeof it->output_log, "instances-%d.log", i);
+        (void) snprintf(it->record, sizeof it->record, "instances-%d.rec", i);
+        (void) snprintf(it->cost_report, sizeof it->cost_report, "instances-%d.csv", i);
+        memset(input, i, sizeof input);
+        assert(cmt_util_write_whole_file(it->input, 64 + i, input) == 0);
+
+        FILE *f = fopen(it->inputs_file, "w");
+        assert(f);
+        for (int j = 0; j < INPUTS; ++j) {
+            (void) fprintf(f, "0:%s\n", it->input);
+        }
+        assert(fclose(f) == 0);
+    }
+
+    for (int i = 0; i < THREADS; ++i) {
+        assert(pthread_create(&threads[i], NULL, run, &instances[i]) == 0);
+    }
+    for (int i = 0; i < THREADS; ++i) {
+        assert(pthread_join(threads[i], NULL) == 0);
+    }
+
+    for (int i = 0; i < THREADS; ++i) {
+        instance_t *it = &instances[i];
+        assert(it->processed == INPUTS);
+        assert(log_records(it->output_log) == 2 * INPUTS); // an output and the outputs root hash each
+        assert(report_lines(it->cost_report) == 1 + INPUTS);
+
+        // a recording of this instance alone, replays with its own inputs only
+        cmt_io_driver_t io[1];
+        it->processed = 0;
+        assert(cmt_io_init_replay(io, it->record, 0) == 0);
+        serve(io, it);
+        cmt_io_fini(io);
+        assert(it->processed == INPUTS);
+
+        (void) remove(it->record);
+        (void) remove(it->cost_report);
+        (void) remove(it->input);
+        (void) remove(it->inputs_file);
+        (void) remove(it->output_log);
+    }
+    printf("test_instances_threads passed!\n");
+}
+
+/* same inputs, outputs kept apart */
+static void output_dirs(void) {
+    cmt_io_mock_config_t a = {.inputs = "0:instances.bin", .output_dir = "instances-a.d"};
+    cmt_io_mock_config_t b = {.inputs = "0:instances.bin", .output_dir = "instances-b.d"};
+    cmt_io_driver_t io[2];
+    cmt_io_yield_t rr;
+    uint8_t data[8];
+    size_t length = 0;
+
+    assert(cmt_util_write_whole_file("instances.bin", 4, "abcd") == 0);
+    assert(mkdir("instances-a.d", 0755) == 0 || errno == EEXIST);
+    assert(mkdir("instances-b.d", 0755) == 0 || errno == EEXIST);
+    assert(cmt_io_init_mock(&io[0], &a) == 0);
+    assert(cmt_io_init_mock(&io[1], &b) == 0);
+    for (int i = 0; i < 2; ++i) {
+        assert(yield(&io[i], &rr, HTIF_YIELD_CMD_MANUAL, HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED, 0) == 0);
+        memset(cmt_io_get_tx(&io[i]).begin, 'a' + i, 3);
+        assert(yield(&io[i], &rr, HTIF_YIELD_CMD_AUTOMATIC, HTIF_YIELD_AUTOMATIC_REASON_TX_OUTPUT, 3) == 0);
+    }
+    cmt_io_fini(&io[0]);
+    cmt_io_fini(&io[1]);
+
+    assert(cmt_util_read_whole_file("instances-a.d/instances.output-0.bin", sizeof data, data, &length) == 0);
+    assert(length == 3 && memcmp(data, "aaa", 3) == 0);
+    assert(cmt_util_read_whole_file("instances-b.d/instances.output-0.bin", sizeof data, data, &length) == 0);
+    assert(length == 3 && memcmp(data, "bbb", 3) == 0);
+
+    cmt_io_mock_config_t bad = {.flags = -1};
+    assert(cmt_io_init_mock(&io[0], &bad) == -EINVAL);
+
+    (void) remove("instances.bin");
+    (void) remove("instances-a.d/instances.output-0.bin");
+    (void) remove("instances-b.d/instances.output-0.bin");
+    (void) rmdir("instances-a.d");
+    (void) rmdir("instances-b.d");
+    printf("test_instances_output_dirs passed!\n");
+}
+
+int main(void) {
+    threads();
+    output_dirs();
+    return 0;
+}
@@ -0,0 +1,145 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "libcmt/rollup.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define INPUTS 4096
+
+typedef struct {
+    uint32_t left;
+    uint64_t notices;
+    uint64_t reports;
+    uint64_t root_hashes;
+} session_t;
+
+static int input(void *context, cmt_buf_t rx, uint16_t *reason, uint32_t *length) {
+    session_t *session = context;
+    if (session->left == 0) {
+        return -ENODATA;
+    }
+    session->left--;
+    memcpy(rx.begin, &session->left, sizeof(session->left));
+    *reason = session->left % 2 ? HTIF_YIELD_REASON_INSPECT : HTIF_YIELD_REASON_ADVANCE;
+    *length = sizeof(session->left);
+    return 0;
+}
+
+static int output(void *context, const cmt_io_yield_t *rr, const void *data) {
+    session_t *session = context;
+    (void) data;
+    if (rr->cmd == HTIF_YIELD_CMD_MANUAL && rr->reason == HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED) {
+        assert(rr->data == CMT_ABI_U256_LENGTH);
+        session->root_hashes++;
+    } else if (rr->reason == HTIF_YIELD_AUTOMATIC_REASON_TX_OUTPUT) {
+        session->notices++;
+    } else if (rr->reason == HTIF_YIELD_AUTOMATIC_REASON_TX_REPORT) {
+        session->reports++;
+    }
+    return 0;
+}
+
+static void invalid_parameters(void) {
+    cmt_io_driver_t io[1];
+    assert(cmt_io_init_loopback(NULL, &(cmt_io_loopback_t){.input = input}) == -EINVAL);
+    assert(cmt_io_init_loopback(io, NULL) == -EINVAL);
+    assert(cmt_io_init_loopback(io, &(cmt_io_loopback_t){.output = output}) == -EINVAL);
+    assert(cmt_io_init_driver(io, CMT_IO_DRIVER_LOOPBACK) == -EINVAL);
+    assert(cmt_io_init_driver(io, CMT_IO_DRIVER_IOCTL) == -ENOSYS);
+    assert(cmt_io_init_driver(io, 42) == -EINVAL);
+    printf("test_loopback_invalid_parameters passed!\n");
+}
+
+static void drivers_side_by_side(void) {
+    session_t session = {.left = 1};
+    cmt_io_driver_t mock[1];
+    cmt_io_driver_t loopback[1];
+    assert(cmt_io_init_driver(mock, CMT_IO_DRIVER_MOCK) == 0);
+    assert(cmt_io_init_loopback(loopback, &(cmt_io_loopback_t){.input = input, .context = &session}) == 0);
+
+    cmt_io_yield_t rr[1] = {{
+        .dev = HTIF_DEVICE_YIELD,
+        .cmd = HTIF_YIELD_CMD_MANUAL,
+        .reason = HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED,
+    }};
+    assert(cmt_io_yield(loopback, rr) == 0);
+    assert(rr->reason == HTIF_YIELD_REASON_ADVANCE && rr->data == sizeof(uint32_t));
+    assert(cmt_io_get_stats(loopback)->kind[CMT_IO_STATS_RX_ACCEPTED].count == 1);
+    assert(cmt_io_get_stats(mock)->kind[CMT_IO_STATS_RX_ACCEPTED].count == 0);
+
+    cmt_io_fini(loopback);
+    cmt_io_fini(mock);
+    printf("test_loopback_drivers_side_by_side passed!\n");
+}
+
+static uint64_t run(session_t *session, double *seconds) {
+    cmt_rollup_t rollup[1];
+    cmt_io_loopback_t callbacks = {
+        .input = input,
+        .output = output,
+        .context = session,
+        .checksum = true,
+    };
+    assert(cmt_rollup_init_loopback(rollup, &callbacks) == 0);
+
+    struct timespec start;
+    struct timespec end;
+    (void) clock_gettime(CLOCK_MONOTONIC, &start);
+
+    cmt_rollup_finish_t finish = {.accept_previous_request = true};
+    int rc = 0;
+    while ((rc = cmt_rollup_finish(rollup, &finish)) == 0) {
+        cmt_buf_t rx = cmt_io_get_rx(rollup->io);
+        cmt_abi_bytes_t payload = {finish.next_request_payload_length, rx.begin};
+        if (finish.next_request_type == HTIF_YIELD_REASON_ADVANCE) {
+            assert(cmt_rollup_emit_notice(rollup, &payload, NULL) == 0);
+        } else {
+            assert(cmt_rollup_emit_report(rollup, &payload) == 0);
+        }
+    }
+    assert(rc == -ENODATA);
+
+    (void) clock_gettime(CLOCK_MONOTONIC, &end);
+    *seconds = (double) (end.tv_sec - start.tv_sec) + (double) (end.tv_nsec - start.tv_nsec) * 1e-9;
+
+    uint64_t checksum = rollup->io->loopback.checksum;
+    assert(rollup->io->loopback.inputs == INPUTS);
+    cmt_rollup_fini(rollup);
+    return checksum;
+}
+
+static void rollup_session(void) {
+    double seconds = 0;
+    session_t a = {.left = INPUTS};
+    session_t b = {.left = INPUTS};
+
+    uint64_t checksum = run(&a, &seconds);
+    assert(a.notices == INPUTS / 2 && a.reports == INPUTS / 2);
+    assert(a.root_hashes == INPUTS);
+    assert(run(&b, &seconds) == checksum);
+    printf("test_loopback_rollup_session passed! (%.0f inputs/s)\n", INPUTS / seconds);
+}
+
+int main(void) {
+    invalid_parameters();
+    drivers_side_by_side();
+    rollup_session();
+    return 0;
+}
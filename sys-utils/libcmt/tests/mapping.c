@@ -0,0 +1,133 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "libcmt/io.h"
+#include "libcmt/util.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void prefault(int flags) {
+    cmt_io_driver_t io[1];
+    assert(cmt_io_init_ex(io, CMT_IO_DRIVER_MOCK, flags) == 0);
+    const cmt_io_stats_pages_t *pages = &cmt_io_get_stats(io)->pages;
+    assert(pages->total > 0);
+    assert(pages->resident == pages->total);
+    assert(pages->init_faults > 0 || (flags & CMT_IO_HUGEPAGE));
+
+    // nothing left to fault in
+    cmt_buf_t tx = cmt_io_get_tx(io);
+    tx.begin[0] = 1;
+    tx.end[-1] = 1;
+    cmt_io_fini(io);
+}
+
+static void mapping_flags(void) {
+    cmt_io_driver_t io[1];
+    assert(cmt_io_init_ex(NULL, CMT_IO_DRIVER_MOCK, 0) == -EINVAL);
+    assert(cmt_io_init_ex(io, CMT_IO_DRIVER_MOCK, 1 << 30) == -EINVAL);
+
+    // untouched anonymous memory, faulted in on demand
+    assert(cmt_io_init_ex(io, CMT_IO_DRIVER_MOCK, 0) == 0);
+    const cmt_io_stats_pages_t *pages = &cmt_io_get_stats(io)->pages;
+    assert(pages->resident < pages->total);
+    cmt_io_fini(io);
+
+    prefault(CMT_IO_PREFAULT);
+    prefault(CMT_IO_PREFAULT | CMT_IO_WILLNEED);
+    prefault(CMT_IO_PREFAULT | CMT_IO_HUGEPAGE);
+    printf("test_mapping_flags passed!\n");
+}
+
+static void mapping_flags_from_env(void) {
+    cmt_io_driver_t io[1];
+    setenv("CMT_IO_FLAGS", "willneed,prefault,unknown", 1);
+    assert(cmt_io_init(io) == 0);
+    const cmt_io_stats_pages_t *pages = &cmt_io_get_stats(io)->pages;
+    assert(pages->resident == pages->total);
+    cmt_io_fini(io);
+    unsetenv("CMT_IO_FLAGS");
+    printf("test_mapping_flags_from_env passed!\n");
+}
+
+static int accept(cmt_io_driver_t *io, cmt_io_yield_t *rr) {
+    *rr = (cmt_io_yield_t){
+        .dev = HTIF_DEVICE_YIELD,
+        .cmd = HTIF_YIELD_CMD_MANUAL,
+        .reason = HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED,
+    };
+    return cmt_io_yield(io, rr);
+}
+
+static void mapped_inputs(void) {
+    static uint8_t big[3 << 20];
+    for (size_t i = 0; i < sizeof big; ++i) {
+        big[i] = i * 7;
+    }
+    assert(cmt_util_write_whole_file("mapping-big.bin", sizeof big, big) == 0);
+    assert(cmt_util_write_whole_file("mapping-small.bin", 3, "abc") == 0);
+    setenv("CMT_INPUTS", "0:mapping-big.bin,1:mapping-small.bin,0:mapping-big.bin", 1);
+    setenv("CMT_TX_LENGTH", "4096", 1);
+    setenv("CMT_RX_LENGTH", "0x400000", 1);
+
+    cmt_io_driver_t io[1];
+    cmt_io_yield_t rr[1];
+    assert(cmt_io_init(io) == 0);
+    cmt_buf_t tx = cmt_io_get_tx(io);
+    cmt_buf_t rx = cmt_io_get_rx(io);
+    assert(cmt_buf_length(&tx) == 4096);
+    assert(cmt_buf_length(&rx) == 4 << 20);
+
+    assert(accept(io, rr) == 0);
+    assert(rr->reason == HTIF_YIELD_REASON_ADVANCE && rr->data == sizeof big);
+    assert(cmt_io_get_rx(io).begin == rx.begin);
+    assert(memcmp(rx.begin, big, sizeof big) == 0);
+    rx.begin[0] = 0xff; // private, the file is left alone
+
+    assert(accept(io, rr) == 0);
+    assert(rr->reason == HTIF_YIELD_REASON_INSPECT && rr->data == 3);
+    assert(memcmp(rx.begin, "abc", 3) == 0);
+    rx.begin[sizeof big - 1] = 0; // anonymous memory again, not the previous input
+
+    assert(accept(io, rr) == 0);
+    assert(rr->data == sizeof big && memcmp(rx.begin, big, sizeof big) == 0);
+    assert(accept(io, rr) == -ENODATA);
+    cmt_io_fini(io);
+
+    // does not fit
+    setenv("CMT_INPUTS", "0:mapping-big.bin", 1);
+    setenv("CMT_RX_LENGTH", "4096", 1);
+    assert(cmt_io_init(io) == 0);
+    assert(accept(io, rr) == -ENODATA);
+    cmt_io_fini(io);
+
+    unsetenv("CMT_TX_LENGTH");
+    unsetenv("CMT_RX_LENGTH");
+    (void) remove("mapping-big.bin");
+    (void) remove("mapping-big.outputs_root_hash.bin");
+    (void) remove("mapping-small.bin");
+    (void) remove("mapping-small.outputs_root_hash.bin");
+    printf("test_mapping_mapped_inputs passed!\n");
+}
+
+int main(void) {
+    mapping_flags();
+    mapping_flags_from_env();
+    mapped_inputs();
+    return 0;
+}
@@ -0,0 +1,166 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "libcmt/abi.h"
+#include "libcmt/io.h"
+#include "libcmt/outlog.h"
+#include "libcmt/util.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char manifest[] = "# comment\n"
+                               "0:outlog-0.bin\n"
+                               "\n"
+                               "1:outlog-1.bin\r\n";
+
+static int yield(cmt_io_driver_t *io, uint8_t cmd, uint16_t reason, size_t length, char fill) {
+    cmt_buf_t tx = cmt_io_get_tx(io);
+    memset(tx.begin, fill, length);
+    cmt_io_yield_t rr[1] = {{
+        .dev = HTIF_DEVICE_YIELD,
+        .cmd = cmd,
+        .reason = reason,
+        .data = length,
+    }};
+    return cmt_io_yield(io, rr);
+}
+
+static void check_record(FILE *file, uint64_t input, uint32_t kind, uint32_t seq, uint32_t length, char fill) {
+    cmt_outlog_record_t record;
+    uint8_t payload[64];
+    assert(fread(&record, sizeof(record), 1, file) == 1);
+    assert(record.input == input);
+    assert(record.kind == kind);
+    assert(record.seq == seq);
+    assert(record.length == length);
+    size_t padded = (length + CMT_OUTLOG_ALIGN - 1) & ~(size_t) (CMT_OUTLOG_ALIGN - 1);
+    assert(padded <= sizeof payload);
+    assert(fread(payload, 1, padded, file) == padded);
+    for (size_t i = 0; i < length; ++i) {
+        assert(payload[i] == (uint8_t) fill);
+    }
+}
+
+static void manifest_and_log(void) {
+    assert(cmt_util_write_whole_file("outlog-inputs.txt", strlen(manifest), manifest) == 0);
+    assert(cmt_util_write_whole_file("outlog-0.bin", 4, "in-0") == 0);
+    assert(cmt_util_write_whole_file("outlog-1.bin", 4, "in-1") == 0);
+    setenv("CMT_INPUTS_FILE", "outlog-inputs.txt", 1);
+    setenv("CMT_OUTPUT_LOG", "outlog.log", 1);
+
+    cmt_io_driver_t io[1];
+    assert(cmt_io_init(io) == 0);
+    assert(yield(io, HTIF_YIELD_CMD_MANUAL, HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED, 0, 0) == 0);
+    assert(memcmp(cmt_io_get_rx(io).begin, "in-0", 4) == 0);
+    assert(yield(io, HTIF_YIELD_CMD_AUTOMATIC, HTIF_YIELD_AUTOMATIC_REASON_TX_OUTPUT, 3, 'a') == 0);
+    assert(yield(io, HTIF_YIELD_CMD_AUTOMATIC, HTIF_YIELD_AUTOMATIC_REASON_TX_REPORT, 10, 'b') == 0);
+    assert(yield(io, HTIF_YIELD_CMD_AUTOMATIC, HTIF_YIELD_AUTOMATIC_REASON_TX_REPORT, 8, 'c') == 0);
+    assert(yield(io, HTIF_YIELD_CMD_MANUAL, HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED, CMT_ABI_U256_LENGTH, 'd') == 0);
+    assert(memcmp(cmt_io_get_rx(io).begin, "in-1", 4) == 0);
+    assert(yield(io, HTIF_YIELD_CMD_AUTOMATIC, HTIF_YIELD_AUTOMATIC_REASON_TX_REPORT, 1, 'e') == 0);
+    assert(yield(io, HTIF_YIELD_CMD_MANUAL, HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED, CMT_ABI_U256_LENGTH, 'f') ==
+        -ENODATA);
+    cmt_io_fini(io);
+    unsetenv("CMT_INPUTS_FILE");
+    unsetenv("CMT_OUTPUT_LOG");
+
+    // no per output files were written
+    FILE *file = fopen("outlog-0.report-0.bin", "rb");
+    assert(file == NULL);
+
+    file = fopen("outlog.log", "rb");
+    assert(file != NULL);
+    cmt_outlog_header_t header;
+    assert(fread(&header, sizeof(header), 1, file) == 1);
+    assert(memcmp(header.magic, "CMTOLOG1", sizeof(header.magic)) == 0);
+    assert(header.version == CMT_OUTLOG_VERSION);
+
+    check_record(file, 0, CMT_OUTLOG_OUTPUT, 0, 3, 'a');
+    check_record(file, 0, CMT_OUTLOG_REPORT, 0, 10, 'b');
+    check_record(file, 0, CMT_OUTLOG_REPORT, 1, 8, 'c');
+    check_record(file, 0, CMT_OUTLOG_OUTPUTS_ROOT_HASH, 0, CMT_ABI_U256_LENGTH, 'd');
+    check_record(file, 1, CMT_OUTLOG_REPORT, 0, 1, 'e');
+    check_record(file, 1, CMT_OUTLOG_OUTPUTS_ROOT_HASH, 0, CMT_ABI_U256_LENGTH, 'f');
+
+    // index then footer
+    long index_offset = ftell(file);
+    uint64_t index[6];
+    cmt_outlog_footer_t footer;
+    assert(fread(index, sizeof(index), 1, file) == 1);
+    assert(fread(&footer, sizeof(footer), 1, file) == 1);
+    assert(fgetc(file) == EOF);
+    assert(memcmp(footer.magic, "CMTOLOGX", sizeof(footer.magic)) == 0);
+    assert(footer.count == 6);
+    assert(footer.index == (uint64_t) index_offset);
+    assert(index[0] == sizeof(header));
+    assert(index[1] == index[0] + sizeof(cmt_outlog_record_t) + 8);
+    assert(index[2] == index[1] + sizeof(cmt_outlog_record_t) + 16);
+    (void) fclose(file);
+
+    (void) remove("outlog-inputs.txt");
+    (void) remove("outlog-0.bin");
+    (void) remove("outlog-1.bin");
+    (void) remove("outlog.log");
+    printf("test_outlog_manifest_and_log passed!\n");
+}
+
+static void invalid_manifest(void) {
+    cmt_io_driver_t io[1];
+    setenv("CMT_INPUTS_FILE", "outlog-missing.txt", 1);
+    assert(cmt_io_init(io) == -ENOENT);
+
+    // an entry too long for the mock is rejected rather than truncated
+    char line[512];
+    memset(line, 'x', sizeof line);
+    memcpy(line, "0:", 2);
+    line[sizeof line - 1] = '\n';
+    assert(cmt_util_write_whole_file("outlog-inputs.txt", sizeof line, line) == 0);
+    setenv("CMT_INPUTS_FILE", "outlog-inputs.txt", 1);
+    assert(cmt_io_init(io) == 0);
+    assert(yield(io, HTIF_YIELD_CMD_MANUAL, HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED, 0, 0) == -ENODATA);
+    cmt_io_fini(io);
+    unsetenv("CMT_INPUTS_FILE");
+    (void) remove("outlog-inputs.txt");
+    printf("test_outlog_invalid_manifest passed!\n");
+}
+
+static void append_and_close(void) {
+    cmt_outlog_t log[1];
+    assert(cmt_outlog_open(NULL, "outlog.log") == -EINVAL);
+    assert(cmt_outlog_open(log, "outlog-missing/outlog.log") == -ENOENT);
+    assert(cmt_outlog_open(log, "outlog.log") == 0);
+    cmt_outlog_record_t record = {.input = UINT64_MAX, .kind = CMT_OUTLOG_REPORT, .length = 4};
+    assert(cmt_outlog_append(log, &record, NULL) == -EINVAL);
+    for (int i = 0; i < 3000; ++i) { // grow the index past its first allocation
+        record.seq = i;
+        assert(cmt_outlog_append(log, &record, "data") == 0);
+    }
+    assert(log->count == 3000);
+    assert(cmt_outlog_close(log) == 0);
+    assert(cmt_outlog_close(log) == -EINVAL);
+    (void) remove("outlog.log");
+    printf("test_outlog_append_and_close passed!\n");
+}
+
+int main(void) {
+    manifest_and_log();
+    invalid_manifest();
+    append_and_close();
+    return 0;
+}
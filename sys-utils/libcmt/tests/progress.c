@@ -2,6 +2,31 @@
 #include <assert.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* bytes cmt_rollup_fini prints to stderr with CMT_STATS set to @p value */
+static long stats_printed(const char *value) {
+    cmt_rollup_t rollup;
+    FILE *err = tmpfile();
+    int saved = dup(STDERR_FILENO);
+
+    assert(err && saved >= 0);
+    assert(cmt_rollup_init(&rollup) == 0);
+    assert(cmt_rollup_progress(&rollup, 1) == 0);
+    setenv("CMT_STATS", value, 1);
+    (void) fflush(stderr);
+    assert(dup2(fileno(err), STDERR_FILENO) >= 0);
+    cmt_rollup_fini(&rollup);
+    (void) fflush(stderr);
+    assert(dup2(saved, STDERR_FILENO) >= 0);
+    (void) close(saved);
+    unsetenv("CMT_STATS");
+
+    long n = lseek(fileno(err), 0, SEEK_END);
+    (void) fclose(err);
+    return n;
+}
 
 int main(void) {
     cmt_rollup_t rollup;
@@ -12,7 +37,30 @@ int main(void) {
     assert(cmt_rollup_progress(&rollup, 100) == 0);
     assert(cmt_rollup_progress(&rollup, 1000) == 0);
     assert(cmt_rollup_progress(&rollup, UINT32_MAX) == 0);
+
+    const cmt_io_stats_t *stats = cmt_io_get_stats(rollup.io);
+    const cmt_io_stats_kind_t *progress = &stats->kind[CMT_IO_STATS_PROGRESS];
+    uint64_t total = 0;
+    assert(progress->count == 5);
+    assert(progress->errors == 0);
+    assert(progress->tx_bytes == 0 && progress->rx_bytes == 0);
+    for (int i = 0; i < CMT_IO_STATS_BUCKETS; ++i) {
+        total += progress->histogram[i];
+    }
+    assert(total == 5);
+    assert(progress->max_ns <= progress->elapsed_ns);
+    assert(stats->kind[CMT_IO_STATS_TX_OUTPUT].count == 0);
+    assert(cmt_io_get_stats(NULL) == NULL);
+
+    setenv("CMT_STATS", "yes", 1);
     cmt_rollup_fini(&rollup);
+    unsetenv("CMT_STATS");
+
+    // only a non-empty value other than 0 turns the dump on
+    assert(stats_printed("yes") > 0);
+    assert(stats_printed("1") > 0);
+    assert(stats_printed("0") == 0);
+    assert(stats_printed("") == 0);
 
     printf("test_rollup_progress passed!\n");
     return 0;
@@ -0,0 +1,167 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "libcmt/io.h"
+#include "libcmt/record.h"
+#include "libcmt/util.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/stat.h>
+
+#define STEPS 5
+
+typedef struct {
+    int rc[STEPS];
+    cmt_io_yield_t reply[STEPS];
+    uint8_t rx[STEPS][4096];
+} session_t;
+
+static int step(cmt_io_driver_t *io, session_t *s, int i, uint8_t cmd, uint16_t reason, uint32_t data) {
+    cmt_buf_t tx = cmt_io_get_tx(io);
+    cmt_buf_t rx = cmt_io_get_rx(io);
+    memset(tx.begin, i + 1, data);
+    s->reply[i] = (cmt_io_yield_t){.dev = HTIF_DEVICE_YIELD, .cmd = cmd, .reason = reason, .data = data};
+    s->rc[i] = cmt_io_yield(io, &s->reply[i]);
+    memcpy(s->rx[i], rx.begin, sizeof(s->rx[i]));
+    return s->rc[i];
+}
+
+/* advance, output, gio, reject and load an inspect, run out of inputs */
+static void run(cmt_io_driver_t *io, session_t *s) {
+    assert(step(io, s, 0, HTIF_YIELD_CMD_MANUAL, HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED, 0) == 0);
+    assert(step(io, s, 1, HTIF_YIELD_CMD_AUTOMATIC, HTIF_YIELD_AUTOMATIC_REASON_TX_OUTPUT, 64) == 0);
+    assert(step(io, s, 2, HTIF_YIELD_CMD_MANUAL, 0x10, 8) == 0);
+    assert(step(io, s, 3, HTIF_YIELD_CMD_MANUAL, HTIF_YIELD_MANUAL_REASON_RX_REJECTED, 0) == 0);
+    assert(step(io, s, 4, HTIF_YIELD_CMD_MANUAL, HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED, 32) == -ENODATA);
+}
+
+static void write_inputs(void) {
+    // mostly zeros, like ABI encoded data
+    uint8_t advance[4096] = {0};
+    for (size_t i = 31; i < sizeof advance; i += 64) {
+        advance[i] = (uint8_t) i;
+    }
+    assert(cmt_util_write_whole_file("replay-0.bin", sizeof advance, advance) == 0);
+    assert(cmt_util_write_whole_file("replay-gio.bin", 11, "gio-reply-1") == 0);
+    assert(cmt_util_write_whole_file("replay-1.bin", 7, "inspect") == 0);
+    setenv("CMT_INPUTS", "0:replay-0.bin,42:replay-gio.bin,1:replay-1.bin", 1);
+}
+
+static void remove_inputs(void) {
+    unsetenv("CMT_INPUTS");
+    (void) remove("replay-0.bin");
+    (void) remove("replay-gio.bin");
+    (void) remove("replay-1.bin");
+    (void) remove("replay-0.output-0.bin");
+    (void) remove("replay-0.gio-0.bin");
+}
+
+static long record(const char *filepath, bool compress, session_t *s) {
+    write_inputs();
+    setenv("CMT_IO_RECORD", filepath, 1);
+    if (compress) {
+        setenv("CMT_IO_RECORD_COMPRESS", "yes", 1);
+    }
+
+    cmt_io_driver_t io[1];
+    assert(cmt_io_init_driver(io, CMT_IO_DRIVER_MOCK) == 0);
+    run(io, s);
+    assert(io->base.record->events == STEPS);
+    cmt_io_fini(io);
+    unsetenv("CMT_IO_RECORD");
+    unsetenv("CMT_IO_RECORD_COMPRESS");
+    remove_inputs();
+
+    struct stat st;
+    assert(stat(filepath, &st) == 0);
+    return st.st_size;
+}
+
+static void replay(const char *filepath, const session_t *recorded) {
+    static session_t s;
+    cmt_io_driver_t io[1];
+    assert(cmt_io_init_replay(io, filepath, 0) == 0);
+    run(io, &s);
+    for (int i = 0; i < STEPS; ++i) {
+        assert(s.rc[i] == recorded->rc[i]);
+        assert(memcmp(&s.reply[i], &recorded->reply[i], sizeof(s.reply[i])) == 0);
+    }
+    // rx holds what the manual yields delivered
+    assert(memcmp(s.rx[0], recorded->rx[0], recorded->reply[0].data) == 0);
+    assert(memcmp(s.rx[2], recorded->rx[2], recorded->reply[2].data) == 0);
+    assert(memcmp(s.rx[3], recorded->rx[3], recorded->reply[3].data) == 0);
+    assert(io->replay.events == STEPS && io->replay.mismatches == 0);
+    cmt_io_fini(io);
+}
+
+static void record_and_replay(void) {
+    static session_t raw;
+    static session_t compressed;
+    long raw_size = record("replay-raw.rec", false, &raw);
+    long compressed_size = record("replay-compressed.rec", true, &compressed);
+    assert(compressed_size < raw_size / 4);
+    assert(raw.reply[2].reason == 42 && raw.reply[3].reason == HTIF_YIELD_REASON_INSPECT);
+
+    // the inputs are gone, everything comes from the recording
+    replay("replay-raw.rec", &raw);
+    replay("replay-compressed.rec", &raw);
+
+    // same through the environment
+    static session_t s;
+    cmt_io_driver_t io[1];
+    setenv("CMT_IO_DRIVER", "replay", 1);
+    setenv("CMT_IO_REPLAY", "replay-compressed.rec", 1);
+    assert(cmt_io_init(io) == 0);
+    run(io, &s);
+    cmt_io_fini(io);
+    unsetenv("CMT_IO_DRIVER");
+    unsetenv("CMT_IO_REPLAY");
+
+    (void) remove("replay-raw.rec");
+    (void) remove("replay-compressed.rec");
+    printf("test_replay_record_and_replay passed! (%ld bytes raw, %ld compressed)\n", raw_size, compressed_size);
+}
+
+static void divergence(void) {
+    static session_t s;
+    record("replay-raw.rec", false, &s);
+
+    cmt_io_driver_t io[1];
+    assert(cmt_io_init_replay(io, "replay-raw.rec", 0) == 0);
+    assert(step(io, &s, 0, HTIF_YIELD_CMD_MANUAL, HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED, 0) == 0);
+    // a different length is tolerated and counted, a different request is not
+    assert(step(io, &s, 1, HTIF_YIELD_CMD_AUTOMATIC, HTIF_YIELD_AUTOMATIC_REASON_TX_OUTPUT, 65) == 0);
+    assert(io->replay.mismatches == 1);
+    assert(step(io, &s, 2, HTIF_YIELD_CMD_AUTOMATIC, HTIF_YIELD_AUTOMATIC_REASON_TX_REPORT, 8) == -EPROTO);
+    cmt_io_fini(io);
+
+    assert(cmt_io_init_replay(io, NULL, 0) == -EINVAL);
+    assert(cmt_io_init_replay(io, "replay-missing.rec", 0) == -ENOENT);
+    assert(cmt_util_write_whole_file("replay-raw.rec", 32, "not a recording, not a recording") == 0);
+    assert(cmt_io_init_replay(io, "replay-raw.rec", 0) == -EINVAL);
+    (void) remove("replay-raw.rec");
+    printf("test_replay_divergence passed!\n");
+}
+
+int main(void) {
+    record_and_replay();
+    divergence();
+    return 0;
+}
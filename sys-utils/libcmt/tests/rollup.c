@@ -18,6 +18,7 @@
 #include "data.h"
 #include <assert.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -26,9 +27,11 @@
 void test_rollup_init_and_fini(void) {
     cmt_rollup_t rollup;
 
-    // init twice returns failure, same as when using the kernel driver
+    // every state gets a mock instance of its own
+    cmt_rollup_t other;
     assert(cmt_rollup_init(&rollup) == 0);
-    assert(cmt_rollup_init(&rollup) == -EBUSY);
+    assert(cmt_rollup_init(&other) == 0);
+    cmt_rollup_fini(&other);
     cmt_rollup_fini(&rollup);
 
     // and should reset when closed
@@ -107,11 +110,19 @@ void test_rollup_parse_inputs(void) {
     assert(truncate("2.bin", 3 << 20) == 0);
     assert(setenv("CMT_INPUTS", "0:0.bin,1:1.bin,0:2.bin", 1) == 0);
 
+    uint8_t scratch[64];
+    cmt_arena_t arena[1];
+    cmt_arena_init(arena, sizeof scratch, scratch);
+
     assert(cmt_rollup_init(&rollup) == 0);
+    cmt_rollup_set_arena(&rollup, arena);
     assert(cmt_rollup_finish(&rollup, &finish) == 0);
     check_first_input(&rollup);
 
+    // scratch memory of the previous input is released by finish
+    assert(cmt_arena_alloc(arena, 32, 0) != NULL);
     assert(cmt_rollup_finish(&rollup, &finish) == 0);
+    assert(cmt_arena_used(arena) == 0);
     check_second_input(&rollup);
 
     assert(cmt_rollup_finish(&rollup, &finish) == -ENODATA);
@@ -123,6 +134,40 @@ void test_rollup_parse_inputs(void) {
     printf("test_rollup_parse_inputs passed!\n");
 }
 
+void test_rollup_reject_resets_arena(void) {
+    cmt_rollup_t rollup;
+    cmt_rollup_finish_t finish = {.accept_previous_request = true};
+
+    assert(cmt_util_write_whole_file("0.bin", sizeof valid_advance_0, valid_advance_0) == 0);
+    assert(setenv("CMT_INPUTS", "0:0.bin,0:0.bin,0:0.bin", 1) == 0);
+
+    uint8_t scratch[64];
+    cmt_arena_t arena[1];
+    cmt_arena_init(arena, sizeof scratch, scratch);
+
+    assert(cmt_rollup_init(&rollup) == 0);
+    cmt_rollup_set_arena(&rollup, arena);
+    assert(cmt_rollup_finish(&rollup, &finish) == 0);
+    check_first_input(&rollup);
+
+    // rejecting the input releases its scratch memory too
+    assert(cmt_arena_alloc(arena, 32, 0) != NULL);
+    finish.accept_previous_request = false;
+    assert(cmt_rollup_finish(&rollup, &finish) == 0);
+    assert(cmt_arena_used(arena) == 0);
+    check_first_input(&rollup);
+
+    // and the next input, accepted, starts from an empty arena as well
+    assert(cmt_arena_alloc(arena, 48, 0) != NULL);
+    finish.accept_previous_request = true;
+    assert(cmt_rollup_finish(&rollup, &finish) == 0);
+    assert(cmt_arena_used(arena) == 0);
+    check_first_input(&rollup);
+
+    cmt_rollup_fini(&rollup);
+    printf("test_rollup_reject_resets_arena passed!\n");
+}
+
 void test_rollup_outputs_reports_and_exceptions(void) {
     cmt_rollup_t rollup;
     uint64_t index = 0;
@@ -217,10 +262,271 @@ void test_rollup_outputs_reports_and_exceptions(void) {
     printf("test_rollup_outputs_reports_and_exceptions passed!\n");
 }
 
+/* outputs root of the first @p n outputs written by the mock, each one hashed as a whole */
+static void outputs_root(uint64_t n, uint8_t root[CMT_KECCAK_LENGTH]) {
+    static uint8_t buffer[64 << 10];
+    static cmt_merkle_t merkle;
+    cmt_merkle_init(&merkle);
+    for (uint64_t i = 0; i < n; ++i) {
+        char filepath[64];
+        size_t read_size = 0;
+        (void) snprintf(filepath, sizeof filepath, "none.output-%" PRIu64 ".bin", i);
+        assert(cmt_util_read_whole_file(filepath, sizeof buffer, buffer, &read_size) == 0);
+        assert(cmt_merkle_push_back_data(&merkle, read_size, buffer) == 0);
+    }
+    cmt_merkle_get_root_hash(&merkle, root);
+    cmt_merkle_fini(&merkle);
+}
+
+void test_rollup_outputs_iov(void) {
+    cmt_rollup_t rollup;
+    uint64_t index = 0;
+    uint8_t buffer[1024];
+    size_t read_size = 0;
+    uint8_t root[CMT_KECCAK_LENGTH];
+    uint8_t expected_root[CMT_KECCAK_LENGTH];
+
+    // clang-format off
+    cmt_abi_address_t address = {{
+        0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x01
+    }};
+    cmt_abi_u256_t value = {{
+        0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00,
+        0xde, 0xad, 0xbe, 0xef
+    }};
+    // clang-format on
+
+    assert(cmt_rollup_init(&rollup) == 0);
+
+    // voucher, payload split in fragments, including an empty one
+    cmt_abi_bytes_t voucher_iov[] = {{4, "vouc"}, {0, NULL}, {5, "her-0"}};
+    assert(cmt_rollup_emit_voucher_iov(&rollup, &address, &value, &(cmt_abi_bytes_iov_t){3, voucher_iov}, &index) ==
+        0);
+    assert(index == 0);
+    assert(cmt_util_read_whole_file("none.output-0.bin", sizeof buffer, buffer, &read_size) == 0);
+    assert(sizeof valid_voucher_0 == read_size);
+    assert(memcmp(valid_voucher_0, buffer, sizeof valid_voucher_0) == 0);
+
+    // notice
+    cmt_abi_bytes_t notice_iov[] = {{1, "n"}, {6, "otice-"}, {1, "0"}};
+    assert(cmt_rollup_emit_notice_iov(&rollup, &(cmt_abi_bytes_iov_t){3, notice_iov}, &index) == 0);
+    assert(index == 1);
+    assert(cmt_util_read_whole_file("none.output-1.bin", sizeof buffer, buffer, &read_size) == 0);
+    assert(sizeof valid_notice_0 == read_size);
+    assert(memcmp(valid_notice_0, buffer, sizeof valid_notice_0) == 0);
+
+    // report
+    cmt_abi_bytes_t report_iov[] = {{7, "report-"}, {1, "0"}};
+    assert(cmt_rollup_emit_report_iov(&rollup, &(cmt_abi_bytes_iov_t){2, report_iov}) == 0);
+    assert(cmt_util_read_whole_file("none.report-0.bin", sizeof buffer, buffer, &read_size) == 0);
+    assert(sizeof valid_report_0 == read_size);
+    assert(memcmp(valid_report_0, buffer, sizeof valid_report_0) == 0);
+
+    // delegate voucher
+    cmt_abi_bytes_t delegate_iov[] = {{14, "delegate-call-"}, {9, "voucher-0"}};
+    assert(cmt_rollup_emit_delegate_call_voucher_iov(&rollup, &address, &(cmt_abi_bytes_iov_t){2, delegate_iov},
+               &index) == 0);
+    assert(index == 2);
+    assert(cmt_util_read_whole_file("none.output-2.bin", sizeof buffer, buffer, &read_size) == 0);
+    assert(sizeof valid_delegate_call_voucher_0 == read_size);
+    assert(memcmp(valid_delegate_call_voucher_0, buffer, sizeof valid_delegate_call_voucher_0) == 0);
+
+    // leaves hashed during the copy match the ones hashed from the outputs as written
+    outputs_root(3, expected_root);
+    cmt_merkle_get_root_hash(rollup.merkle, root);
+    assert(memcmp(root, expected_root, sizeof root) == 0);
+
+    // invalid
+    cmt_abi_bytes_t bad_iov[] = {{4, "vouc"}, {5, NULL}};
+    cmt_abi_bytes_t huge_iov[] = {{UINT32_MAX, "vouc"}, {UINT32_MAX, "her-0"}};
+    assert(cmt_rollup_emit_notice_iov(NULL, &(cmt_abi_bytes_iov_t){3, notice_iov}, &index) == -EINVAL);
+    assert(cmt_rollup_emit_notice_iov(&rollup, NULL, &index) == -EINVAL);
+    assert(cmt_rollup_emit_notice_iov(&rollup, &(cmt_abi_bytes_iov_t){1, NULL}, &index) == -EINVAL);
+    assert(cmt_rollup_emit_notice_iov(&rollup, &(cmt_abi_bytes_iov_t){2, bad_iov}, &index) == -EINVAL);
+    assert(cmt_rollup_emit_voucher_iov(&rollup, &address, &value, &(cmt_abi_bytes_iov_t){2, huge_iov}, &index) ==
+        -ENOBUFS);
+    assert(cmt_rollup_emit_report_iov(&rollup, &(cmt_abi_bytes_iov_t){2, bad_iov}) == -EINVAL);
+    assert(cmt_rollup_emit_voucher_iov(&rollup, &address, &value, NULL, &index) == -EINVAL);
+    assert(cmt_rollup_emit_delegate_call_voucher_iov(&rollup, &address, NULL, &index) == -EINVAL);
+    assert(cmt_rollup_emit_report_iov(&rollup, NULL) == -EINVAL);
+    assert(cmt_rollup_emit_report_iov(&rollup, &(cmt_abi_bytes_iov_t){1, NULL}) == -EINVAL);
+    assert(cmt_rollup_emit_report_iov(&rollup, &(cmt_abi_bytes_iov_t){2, huge_iov}) == -ENOBUFS);
+    assert(cmt_merkle_get_leaf_count(rollup.merkle) == 3);
+
+    cmt_rollup_fini(&rollup);
+    printf("test_rollup_outputs_iov passed!\n");
+}
+
+void test_rollup_reserve_and_commit(void) {
+    cmt_rollup_t rollup;
+    uint64_t index = 0;
+    uint8_t buffer[1024];
+    size_t read_size = 0;
+    uint8_t root[CMT_KECCAK_LENGTH];
+    uint8_t expected_root[CMT_KECCAK_LENGTH];
+    cmt_abi_bytes_t span;
+    cmt_abi_address_t address = {{[19] = 0x01}};
+    cmt_abi_u256_t value = {{[28] = 0xde, [29] = 0xad, [30] = 0xbe, [31] = 0xef}};
+
+    // same outputs through the copying API, for the reference outputs root
+    assert(cmt_rollup_init(&rollup) == 0);
+    assert(cmt_rollup_emit_voucher(&rollup, &address, &value, &(cmt_abi_bytes_t){9, "voucher-0"}, &index) == 0);
+    assert(cmt_rollup_emit_notice(&rollup, &(cmt_abi_bytes_t){8, "notice-0"}, &index) == 0);
+    assert(cmt_rollup_emit_delegate_call_voucher(&rollup, &address, &(cmt_abi_bytes_t){23, "delegate-call-voucher-0"},
+               &index) == 0);
+    cmt_merkle_get_root_hash(rollup.merkle, expected_root);
+    cmt_rollup_fini(&rollup);
+
+    assert(cmt_rollup_init(&rollup) == 0);
+
+    // voucher, reserved larger than it turns out to be, the leftover must not leak into the output
+    assert(cmt_rollup_reserve_voucher(&rollup, &address, &value, 100, &span) == 0);
+    assert(span.length == 100);
+    memset(span.data, 0xff, span.length);
+    memcpy(span.data, "voucher-0", 9);
+    assert(cmt_rollup_commit_voucher(&rollup, 9, &index) == 0);
+    assert(index == 0);
+    assert(cmt_util_read_whole_file("none.output-0.bin", sizeof buffer, buffer, &read_size) == 0);
+    assert(sizeof valid_voucher_0 == read_size);
+    assert(memcmp(valid_voucher_0, buffer, sizeof valid_voucher_0) == 0);
+
+    // notice, exactly as reserved
+    assert(cmt_rollup_reserve_notice(&rollup, 8, &span) == 0);
+    memcpy(span.data, "notice-0", 8);
+    assert(cmt_rollup_commit_notice(&rollup, 8, &index) == 0);
+    assert(index == 1);
+    assert(cmt_util_read_whole_file("none.output-1.bin", sizeof buffer, buffer, &read_size) == 0);
+    assert(sizeof valid_notice_0 == read_size);
+    assert(memcmp(valid_notice_0, buffer, sizeof valid_notice_0) == 0);
+
+    // report
+    assert(cmt_rollup_reserve_report(&rollup, 64, &span) == 0);
+    memcpy(span.data, "report-0", 8);
+    assert(cmt_rollup_commit_report(&rollup, 8) == 0);
+    assert(cmt_util_read_whole_file("none.report-0.bin", sizeof buffer, buffer, &read_size) == 0);
+    assert(sizeof valid_report_0 == read_size);
+    assert(memcmp(valid_report_0, buffer, sizeof valid_report_0) == 0);
+
+    // delegate call voucher
+    assert(cmt_rollup_reserve_delegate_call_voucher(&rollup, &address, 33, &span) == 0);
+    memcpy(span.data, "delegate-call-voucher-0", 23);
+    assert(cmt_rollup_commit_delegate_call_voucher(&rollup, 23, &index) == 0);
+    assert(index == 2);
+    assert(cmt_util_read_whole_file("none.output-2.bin", sizeof buffer, buffer, &read_size) == 0);
+    assert(sizeof valid_delegate_call_voucher_0 == read_size);
+    assert(memcmp(valid_delegate_call_voucher_0, buffer, sizeof valid_delegate_call_voucher_0) == 0);
+
+    cmt_merkle_get_root_hash(rollup.merkle, root);
+    assert(memcmp(root, expected_root, sizeof root) == 0);
+
+    // invalid
+    assert(cmt_rollup_commit_notice(&rollup, 0, &index) == -EINVAL); // nothing reserved
+    assert(cmt_rollup_reserve_notice(NULL, 8, &span) == -EINVAL);
+    assert(cmt_rollup_reserve_notice(&rollup, 8, NULL) == -EINVAL);
+    assert(cmt_rollup_reserve_notice(&rollup, SIZE_MAX, &span) == -ENOBUFS);
+    assert(cmt_rollup_reserve_report(&rollup, SIZE_MAX, &span) == -ENOBUFS);
+    assert(cmt_rollup_reserve_notice(&rollup, 8, &span) == 0);
+    assert(cmt_rollup_commit_notice(&rollup, 9, &index) == -EINVAL);  // past the reservation
+    assert(cmt_rollup_commit_voucher(&rollup, 8, &index) == -EINVAL); // of another kind
+    assert(cmt_rollup_commit_notice(&rollup, 8, &index) == 0);
+    assert(cmt_rollup_commit_notice(&rollup, 8, &index) == -EINVAL); // only once
+    assert(cmt_merkle_get_leaf_count(rollup.merkle) == 4);
+
+    cmt_rollup_fini(&rollup);
+    printf("test_rollup_reserve_and_commit passed!\n");
+}
+
+// anything else written to tx in between drops the reservation, its commit must not emit the overwritten buffer
+void test_rollup_reserve_dropped(void) {
+    cmt_rollup_t rollup;
+    cmt_rollup_finish_t finish = {.accept_previous_request = true};
+    uint64_t index = 0;
+    cmt_abi_bytes_t span;
+
+    assert(setenv("CMT_INPUTS", "0:0.bin", 1) == 0);
+    assert(cmt_rollup_init(&rollup) == 0);
+
+    // reserve, emit, commit
+    assert(cmt_rollup_reserve_notice(&rollup, 8, &span) == 0);
+    memcpy(span.data, "notice-0", 8);
+    assert(cmt_rollup_emit_notice(&rollup, &(cmt_abi_bytes_t){8, "notice-1"}, &index) == 0);
+    assert(cmt_rollup_commit_notice(&rollup, 8, &index) == -EINVAL);
+    assert(cmt_rollup_reserve_report(&rollup, 8, &span) == 0);
+    assert(cmt_rollup_emit_report(&rollup, &(cmt_abi_bytes_t){8, "report-0"}) == 0);
+    assert(cmt_rollup_commit_report(&rollup, 8) == -EINVAL);
+    assert(cmt_merkle_get_leaf_count(rollup.merkle) == 1);
+
+    // reserve, finish, commit, tx holds the outputs root hash by now
+    assert(cmt_rollup_reserve_voucher(&rollup, &(cmt_abi_address_t){{0}}, &(cmt_abi_u256_t){{0}}, 8, &span) == 0);
+    assert(cmt_rollup_finish(&rollup, &finish) == 0);
+    assert(cmt_rollup_commit_voucher(&rollup, 8, &index) == -EINVAL);
+    assert(cmt_merkle_get_leaf_count(rollup.merkle) == 1);
+
+    cmt_rollup_fini(&rollup);
+    printf("test_rollup_reserve_dropped passed!\n");
+}
+
+// payloads over several copy and hash chunks, of a length that is not a multiple of 32
+void test_rollup_outputs_chunked(void) {
+    enum { LENGTH = 40001 };
+    static uint8_t payload[LENGTH];
+    static uint8_t buffer[64 << 10];
+    cmt_rollup_t rollup;
+    uint64_t index = 0;
+    size_t read_size = 0;
+    uint8_t root[CMT_KECCAK_LENGTH];
+    uint8_t expected_root[CMT_KECCAK_LENGTH];
+    cmt_abi_address_t address = {{[19] = 0x01}};
+    cmt_abi_u256_t value = {{[31] = 0x01}};
+
+    for (size_t i = 0; i < LENGTH; ++i) {
+        payload[i] = (uint8_t) (i * 31 + 7);
+    }
+    assert(cmt_rollup_init(&rollup) == 0);
+
+    assert(cmt_rollup_emit_notice(&rollup, &(cmt_abi_bytes_t){LENGTH, payload}, &index) == 0);
+    assert(cmt_util_read_whole_file("none.output-0.bin", sizeof buffer, buffer, &read_size) == 0);
+    // funsel, offset, length and the payload padded to 32 bytes
+    assert(read_size == 4 + 32 + 32 + ((LENGTH + 31) & ~31));
+    assert(buffer[4 + 32 + 30] == (LENGTH >> 8) && buffer[4 + 32 + 31] == (LENGTH & 0xff));
+    assert(memcmp(buffer + 4 + 64, payload, LENGTH) == 0);
+    assert(buffer[read_size - 1] == 0);
+
+    // fragments ending and starting in the middle of chunks
+    cmt_abi_bytes_t voucher_iov[] = {{1, payload}, {20000, payload + 1}, {LENGTH - 20001, payload + 20001}};
+    assert(cmt_rollup_emit_voucher_iov(&rollup, &address, &value, &(cmt_abi_bytes_iov_t){3, voucher_iov}, &index) ==
+        0);
+    assert(cmt_rollup_emit_delegate_call_voucher(&rollup, &address, &(cmt_abi_bytes_t){LENGTH - 1, payload}, &index) ==
+        0);
+    assert(index == 2);
+
+    outputs_root(3, expected_root);
+    cmt_merkle_get_root_hash(rollup.merkle, root);
+    assert(memcmp(root, expected_root, sizeof root) == 0);
+
+    cmt_rollup_fini(&rollup);
+    printf("test_rollup_outputs_chunked passed!\n");
+}
+
 int main(void) {
     setenv("CMT_DEBUG", "yes", 1);
     test_rollup_init_and_fini();
     test_rollup_parse_inputs();
+    test_rollup_reject_resets_arena();
     test_rollup_outputs_reports_and_exceptions();
+    test_rollup_outputs_iov();
+    test_rollup_outputs_chunked();
+    test_rollup_reserve_and_commit();
+    test_rollup_reserve_dropped();
     return 0;
 }
@@ -0,0 +1,204 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "libcmt/io.h"
+#include "libcmt/shm.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define INPUTS 20000
+#define SHM_PATH "shm-test.sock"
+
+static double now(void) {
+    struct timespec ts;
+    (void) clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + ((double) ts.tv_nsec * 1e-9);
+}
+
+/* stand in for the node, in its own process: streams inputs and checks the outputs */
+static int serve(cmt_shm_host_t *host) {
+    uint64_t outputs = 0;
+    uint64_t reports = 0;
+    uint64_t gios = 0;
+    uint32_t sent = 0;
+    cmt_io_yield_t request;
+    uint8_t *tx = cmt_shm_host_get_tx(host).begin;
+    uint8_t *rx = cmt_shm_host_get_rx(host).begin;
+
+    while (cmt_shm_host_wait(host, &request) == 0) {
+        uint16_t reason = 0;
+        uint32_t length = 0;
+        if (request.cmd == HTIF_YIELD_CMD_AUTOMATIC) {
+            outputs += request.reason == HTIF_YIELD_AUTOMATIC_REASON_TX_OUTPUT;
+            reports += request.reason == HTIF_YIELD_AUTOMATIC_REASON_TX_REPORT;
+            if (tx[0] != 0xab || tx[request.data - 1] != 0xab) {
+                return 1;
+            }
+        } else if (request.reason == HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED) {
+            if (sent == INPUTS) {
+                break; // closing the session ends it
+            }
+            reason = sent % 4 == 3 ? HTIF_YIELD_REASON_INSPECT : HTIF_YIELD_REASON_ADVANCE;
+            length = sizeof(sent);
+            memcpy(rx, &sent, sizeof(sent));
+            sent++;
+        } else { // gio, echo the request back
+            gios++;
+            reason = 42;
+            length = request.data;
+            memcpy(rx, tx, length);
+        }
+        if (cmt_shm_host_reply(host, reason, length)) {
+            return 1;
+        }
+    }
+    cmt_shm_host_close(host);
+    return outputs == INPUTS - INPUTS / 4 && reports == INPUTS && gios == INPUTS / 100 ? 0 : 1;
+}
+
+/* run @p serve in a child process once it listens, with the host of @p flags */
+static pid_t spawn_host(int flags, int (*serve)(cmt_shm_host_t *)) {
+    int ready[2];
+    assert(pipe(ready) == 0);
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        cmt_shm_host_t *host = NULL;
+        (void) close(ready[0]);
+        if (cmt_shm_host_open(&host, SHM_PATH, 64 << 10, 64 << 10, flags) != 0) {
+            _exit(1);
+        }
+        (void) !write(ready[1], "", 1);
+        if (cmt_shm_host_accept(host) != 0) {
+            _exit(1);
+        }
+        _exit(serve(host));
+    }
+    char byte = 0;
+    (void) close(ready[1]);
+    assert(read(ready[0], &byte, 1) == 1);
+    (void) close(ready[0]);
+    return pid;
+}
+
+static int yield(cmt_io_driver_t *io, uint8_t cmd, uint16_t reason, uint32_t data, cmt_io_yield_t *rr) {
+    memset(cmt_io_get_tx(io).begin, 0xab, data);
+    *rr = (cmt_io_yield_t){.dev = HTIF_DEVICE_YIELD, .cmd = cmd, .reason = reason, .data = data};
+    return cmt_io_yield(io, rr);
+}
+
+static int compare(const void *a, const void *b) {
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+static void sustained_load(int flags, const char *name) {
+    static double latency[4 * INPUTS];
+    size_t yields = 0;
+    pid_t pid = spawn_host(flags, serve);
+
+    cmt_io_driver_t io[1];
+    cmt_io_yield_t rr[1];
+    assert(setenv("CMT_MOCK_SHM", SHM_PATH, 1) == 0);
+    assert(cmt_io_init(io) == 0);
+    cmt_buf_t tx = cmt_io_get_tx(io);
+    assert(cmt_buf_length(&tx) == 64 << 10);
+    double t0 = now();
+    for (uint32_t i = 0;; ++i) {
+        double t = now();
+        int rc = yield(io, HTIF_YIELD_CMD_MANUAL, HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED, i ? 32 : 0, rr);
+        if (rc == -ENODATA) {
+            assert(i == INPUTS);
+            break;
+        }
+        latency[yields++] = now() - t;
+        assert(rc == 0 && rr->data == sizeof(i));
+        assert(memcmp(cmt_io_get_rx(io).begin, &i, sizeof(i)) == 0);
+        if (rr->reason == HTIF_YIELD_REASON_ADVANCE) {
+            t = now();
+            assert(yield(io, HTIF_YIELD_CMD_AUTOMATIC, HTIF_YIELD_AUTOMATIC_REASON_TX_OUTPUT, 64, rr) == 0);
+            latency[yields++] = now() - t;
+        }
+        t = now();
+        assert(yield(io, HTIF_YIELD_CMD_AUTOMATIC, HTIF_YIELD_AUTOMATIC_REASON_TX_REPORT, 16, rr) == 0);
+        latency[yields++] = now() - t;
+        if (i % 100 == 0) {
+            t = now();
+            assert(yield(io, HTIF_YIELD_CMD_MANUAL, 0x20, 8, rr) == 0);
+            latency[yields++] = now() - t;
+            assert(rr->reason == 42 && rr->data == 8);
+            assert(memcmp(cmt_io_get_rx(io).begin, cmt_io_get_tx(io).begin, 8) == 0);
+        }
+    }
+    double dt = now() - t0;
+    cmt_io_fini(io);
+    assert(unsetenv("CMT_MOCK_SHM") == 0);
+
+    int status = 0;
+    assert(waitpid(pid, &status, 0) == pid);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    qsort(latency, yields, sizeof(latency[0]), compare);
+    printf("test_shm_sustained_load_%s passed! (%.0f yields/s, p50 %.1fus, p99 %.1fus)\n", name, yields / dt,
+        latency[yields / 2] * 1e6, latency[yields * 99 / 100] * 1e6);
+}
+
+static int leave(cmt_shm_host_t *host) {
+    (void) host;
+    return 0; // exits without answering, nor closing the session
+}
+
+static void host_gone(void) {
+    cmt_io_driver_t io[1];
+    cmt_io_yield_t rr[1];
+    assert(setenv("CMT_MOCK_SHM", SHM_PATH, 1) == 0);
+    pid_t pid = spawn_host(0, leave);
+    assert(cmt_io_init_driver(io, CMT_IO_DRIVER_SHM) == 0);
+    assert(yield(io, HTIF_YIELD_CMD_MANUAL, HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED, 0, rr) == -EPIPE);
+    cmt_io_fini(io);
+    assert(unsetenv("CMT_MOCK_SHM") == 0);
+    assert(waitpid(pid, NULL, 0) == pid);
+    (void) unlink(SHM_PATH);
+    printf("test_shm_host_gone passed!\n");
+}
+
+static void no_host(void) {
+    cmt_io_driver_t io[1];
+    cmt_shm_host_t *host = NULL;
+    assert(cmt_io_init_driver(io, CMT_IO_DRIVER_SHM) == -EINVAL);
+    (void) unlink(SHM_PATH);
+    assert(setenv("CMT_MOCK_SHM", SHM_PATH, 1) == 0);
+    assert(cmt_io_init_driver(io, CMT_IO_DRIVER_MOCK) == -ENOENT);
+    assert(cmt_io_init_driver(io, CMT_IO_DRIVER_SHM) == -ENOENT);
+    assert(unsetenv("CMT_MOCK_SHM") == 0);
+    assert(cmt_shm_host_open(&host, SHM_PATH, 0, 0, 1 << 7) == -EINVAL);
+    printf("test_shm_no_host passed!\n");
+}
+
+int main(void) {
+    no_host();
+    host_gone();
+    sustained_load(0, "futex");
+    sustained_load(CMT_SHM_EVENTFD, "eventfd");
+    return 0;
+}
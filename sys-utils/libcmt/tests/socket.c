@@ -0,0 +1,171 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "libcmt/io.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define INPUTS 20000
+#define SOCKET_PATH "socket-test.sock"
+
+/* stand in for the node: streams inputs and consumes the outputs */
+typedef struct {
+    int listener;
+    uint32_t sent;
+    uint64_t outputs;
+    uint64_t reports;
+    uint64_t gios;
+    double latency[INPUTS]; /* from sending an input until the application asks for the next one */
+} generator_t;
+
+static double now(void) {
+    struct timespec ts;
+    (void) clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + ((double) ts.tv_nsec * 1e-9);
+}
+
+static void *generate(void *arg) {
+    generator_t *g = arg;
+    int fd = accept(g->listener, NULL, NULL);
+    assert(fd >= 0);
+    FILE *in = fdopen(fd, "rb");
+    FILE *out = fdopen(dup(fd), "wb");
+    assert(in && out);
+
+    static uint8_t payload[4096];
+    double t = 0;
+    cmt_io_socket_request_t request;
+    while (fread(&request, sizeof(request), 1, in) == 1) {
+        assert(request.length <= sizeof payload);
+        assert(fread(payload, 1, request.length, in) == request.length);
+        if (request.cmd == HTIF_YIELD_CMD_AUTOMATIC) {
+            g->outputs += request.reason == HTIF_YIELD_AUTOMATIC_REASON_TX_OUTPUT;
+            g->reports += request.reason == HTIF_YIELD_AUTOMATIC_REASON_TX_REPORT;
+            continue;
+        }
+
+        cmt_io_socket_reply_t reply = {0};
+        if (request.reason == HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED) {
+            if (g->sent) {
+                g->latency[g->sent - 1] = now() - t;
+            }
+            if (g->sent == INPUTS) {
+                break; // closing the connection ends the session
+            }
+            reply.reason = g->sent % 4 == 3 ? HTIF_YIELD_REASON_INSPECT : HTIF_YIELD_REASON_ADVANCE;
+            reply.data = sizeof(g->sent);
+            memcpy(payload, &g->sent, sizeof(g->sent));
+            g->sent++;
+            t = now();
+        } else { // gio, echo the request back
+            g->gios++;
+            reply.reason = 42;
+            reply.data = request.length;
+        }
+        assert(fwrite(&reply, sizeof(reply), 1, out) == 1);
+        assert(fwrite(payload, 1, reply.data, out) == reply.data);
+        assert(fflush(out) == 0);
+    }
+    (void) fclose(in);
+    (void) fclose(out);
+    return NULL;
+}
+
+static int yield(cmt_io_driver_t *io, uint8_t cmd, uint16_t reason, uint32_t data, cmt_io_yield_t *rr) {
+    memset(cmt_io_get_tx(io).begin, 0xab, data);
+    *rr = (cmt_io_yield_t){.dev = HTIF_DEVICE_YIELD, .cmd = cmd, .reason = reason, .data = data};
+    return cmt_io_yield(io, rr);
+}
+
+static int compare(const void *a, const void *b) {
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+static void sustained_load(void) {
+    static generator_t g;
+    struct sockaddr_un addr = {.sun_family = AF_UNIX, .sun_path = SOCKET_PATH};
+    (void) unlink(SOCKET_PATH);
+    g.listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    assert(g.listener >= 0);
+    assert(bind(g.listener, (struct sockaddr *) &addr, sizeof(addr)) == 0);
+    assert(listen(g.listener, 1) == 0);
+    pthread_t thread;
+    assert(pthread_create(&thread, NULL, generate, &g) == 0);
+
+    cmt_io_driver_t io[1];
+    cmt_io_yield_t rr[1];
+    setenv("CMT_MOCK_SOCKET", SOCKET_PATH, 1);
+    assert(cmt_io_init(io) == 0);
+    double t0 = now();
+    for (uint32_t i = 0;; ++i) {
+        int rc = yield(io, HTIF_YIELD_CMD_MANUAL, HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED, i ? 32 : 0, rr);
+        if (rc == -ENODATA) {
+            assert(i == INPUTS);
+            break;
+        }
+        assert(rc == 0 && rr->data == sizeof(i));
+        assert(memcmp(cmt_io_get_rx(io).begin, &i, sizeof(i)) == 0);
+        if (rr->reason == HTIF_YIELD_REASON_ADVANCE) {
+            assert(yield(io, HTIF_YIELD_CMD_AUTOMATIC, HTIF_YIELD_AUTOMATIC_REASON_TX_OUTPUT, 64, rr) == 0);
+        }
+        assert(yield(io, HTIF_YIELD_CMD_AUTOMATIC, HTIF_YIELD_AUTOMATIC_REASON_TX_REPORT, 16, rr) == 0);
+        if (i % 100 == 0) {
+            assert(yield(io, HTIF_YIELD_CMD_MANUAL, 0x20, 8, rr) == 0);
+            assert(rr->reason == 42 && rr->data == 8);
+        }
+    }
+    double dt = now() - t0;
+    cmt_io_fini(io);
+    unsetenv("CMT_MOCK_SOCKET");
+    assert(pthread_join(thread, NULL) == 0);
+    (void) close(g.listener);
+    (void) unlink(SOCKET_PATH);
+
+    assert(g.outputs == INPUTS - INPUTS / 4);
+    assert(g.reports == INPUTS);
+    assert(g.gios == INPUTS / 100);
+    qsort(g.latency, INPUTS, sizeof(g.latency[0]), compare);
+    printf("test_socket_sustained_load passed! (%.0f inputs/s, p50 %.1fus, p99 %.1fus)\n", INPUTS / dt,
+        g.latency[INPUTS / 2] * 1e6, g.latency[INPUTS * 99 / 100] * 1e6);
+}
+
+static void no_generator(void) {
+    cmt_io_driver_t io[1];
+    assert(cmt_io_init_driver(io, CMT_IO_DRIVER_SOCKET) == -EINVAL);
+    (void) unlink(SOCKET_PATH);
+    setenv("CMT_MOCK_SOCKET", SOCKET_PATH, 1);
+    assert(cmt_io_init_driver(io, CMT_IO_DRIVER_MOCK) == -ENOENT);
+    assert(cmt_io_init_driver(io, CMT_IO_DRIVER_SOCKET) == -ENOENT);
+    unsetenv("CMT_MOCK_SOCKET");
+    printf("test_socket_no_generator passed!\n");
+}
+
+int main(void) {
+    no_generator();
+    sustained_load();
+    return 0;
+}
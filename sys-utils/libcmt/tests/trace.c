@@ -0,0 +1,114 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "libcmt/rollup.h"
+#include "libcmt/trace.h"
+#include "libcmt/util.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void check_event(const cmt_trace_event_t *e, uint8_t type, uint8_t cmd, uint16_t reason, uint32_t data,
+    int32_t rc) {
+    assert(e->type == type);
+    assert(e->cmd == cmd);
+    assert(e->reason == reason);
+    assert(e->data == data);
+    assert(e->rc == rc);
+}
+
+void test_trace_events(void) {
+    cmt_rollup_t rollup;
+    cmt_abi_address_t address = {{0}};
+    cmt_abi_u256_t value = {{0}};
+    uint64_t index = 0;
+
+    assert(setenv("CMT_TRACE", "trace-test.trace", 1) == 0);
+    assert(cmt_rollup_init(&rollup) == 0);
+    assert(cmt_trace_enabled());
+    assert(cmt_rollup_progress(&rollup, 10) == 0);
+    assert(cmt_rollup_emit_notice(&rollup, &(cmt_abi_bytes_t){5, "hello"}, &index) == 0);
+    assert(cmt_rollup_emit_voucher(&rollup, &address, &value, &(cmt_abi_bytes_t){UINT32_MAX, "hello"}, &index) ==
+        -ENOBUFS);
+    cmt_rollup_fini(&rollup);
+    assert(!cmt_trace_enabled());
+
+    struct {
+        cmt_trace_header_t header;
+        cmt_trace_event_t events[8];
+    } file;
+    size_t length = 0;
+    assert(cmt_util_read_whole_file("trace-test.trace", sizeof file, &file, &length) == 0);
+    assert(memcmp(file.header.magic, "CMTTRACE", 8) == 0);
+    assert(file.header.version == CMT_TRACE_VERSION);
+    assert(file.header.total == 6 && file.header.count == 6);
+    assert(length == sizeof file.header + 6 * sizeof(cmt_trace_event_t));
+
+    // notice: funsel + offset + length + one word of payload
+    uint32_t notice_size = 4 + 3 * 32;
+    cmt_trace_event_t *e = file.events;
+    check_event(e++, CMT_TRACE_YIELD_TOHOST, HTIF_YIELD_CMD_AUTOMATIC, HTIF_YIELD_AUTOMATIC_REASON_PROGRESS, 10, 0);
+    check_event(e++, CMT_TRACE_YIELD_FROMHOST, HTIF_YIELD_CMD_AUTOMATIC, HTIF_YIELD_AUTOMATIC_REASON_PROGRESS, 10, 0);
+    check_event(e++, CMT_TRACE_YIELD_TOHOST, HTIF_YIELD_CMD_AUTOMATIC, HTIF_YIELD_AUTOMATIC_REASON_TX_OUTPUT,
+        notice_size, 0);
+    check_event(e++, CMT_TRACE_YIELD_FROMHOST, HTIF_YIELD_CMD_AUTOMATIC, HTIF_YIELD_AUTOMATIC_REASON_TX_OUTPUT,
+        notice_size, 0);
+    check_event(e++, CMT_TRACE_EMIT, CMT_TRACE_EMIT_NOTICE, 0, notice_size, 0);
+    assert(e->type == CMT_TRACE_ERROR && e->rc == -ENOBUFS);
+    for (int i = 1; i < 6; ++i) {
+        assert(file.events[i].time >= file.events[i - 1].time);
+    }
+
+    assert(unsetenv("CMT_TRACE") == 0);
+    printf("test_trace_events passed!\n");
+}
+
+void test_trace_wraps(void) {
+    cmt_rollup_t rollup;
+
+    assert(setenv("CMT_TRACE", "trace-wraps.trace", 1) == 0);
+    assert(cmt_rollup_init(&rollup) == 0);
+    for (uint32_t i = 0; i < CMT_TRACE_CAPACITY; ++i) {
+        assert(cmt_rollup_progress(&rollup, i) == 0);
+    }
+    cmt_rollup_fini(&rollup);
+
+    static struct {
+        cmt_trace_header_t header;
+        cmt_trace_event_t events[CMT_TRACE_CAPACITY];
+    } file;
+    size_t length = 0;
+    assert(cmt_util_read_whole_file("trace-wraps.trace", sizeof file, &file, &length) == 0);
+    assert(file.header.total == 2 * CMT_TRACE_CAPACITY);
+    assert(file.header.count == CMT_TRACE_CAPACITY);
+
+    // only the second half of the progress yields is left, oldest first
+    for (uint32_t i = 0; i < CMT_TRACE_CAPACITY; ++i) {
+        assert(file.events[i].data == CMT_TRACE_CAPACITY / 2 + i / 2);
+        assert(file.events[i].type == (i % 2 ? CMT_TRACE_YIELD_FROMHOST : CMT_TRACE_YIELD_TOHOST));
+    }
+
+    assert(unsetenv("CMT_TRACE") == 0);
+    printf("test_trace_wraps passed!\n");
+}
+
+int main(void) {
+    test_trace_events();
+    test_trace_wraps();
+    return 0;
+}
@@ -0,0 +1,189 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "libcmt/u256.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+static uint64_t xorshift(uint64_t *x) {
+    *x ^= *x << 13;
+    *x ^= *x >> 7;
+    *x ^= *x << 17;
+    return *x;
+}
+
+/* random values with a random number of significant limbs, to exercise every divmnu path */
+static void random_u256(uint64_t *seed, cmt_u256_t *x) {
+    int n = (int) (xorshift(seed) % (CMT_U256_LIMBS + 1));
+    for (int i = 0; i < CMT_U256_LIMBS; ++i) {
+        x->limb[i] = i < n ? xorshift(seed) : 0;
+    }
+    if (n && (xorshift(seed) & 1)) {
+        x->limb[n - 1] >>= xorshift(seed) % 64;
+    }
+}
+
+static void abi_conversions(void) {
+    cmt_abi_u256_t abi = {{
+        // clang-format off
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+        0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+        // clang-format on
+    }};
+    cmt_u256_t x;
+    cmt_abi_u256_t back;
+
+    cmt_u256_from_abi(&x, &abi);
+    assert(x.limb[0] == UINT64_C(0x18191a1b1c1d1e1f));
+    assert(x.limb[3] == UINT64_C(0x0001020304050607));
+    cmt_u256_to_abi(&x, &back);
+    assert(memcmp(abi.data, back.data, sizeof(abi.data)) == 0);
+
+    uint8_t data[CMT_ABI_U256_LENGTH];
+    cmt_buf_t wr = {data, data + sizeof(data)};
+    cmt_buf_t rd = wr;
+    cmt_u256_t y;
+    assert(cmt_u256_put(&wr, &x) == 0);
+    assert(cmt_u256_put(&wr, &x) == -ENOBUFS);
+    assert(memcmp(abi.data, data, sizeof(data)) == 0);
+    assert(cmt_u256_get(&rd, &y) == 0);
+    assert(cmt_u256_get(&rd, &y) == -ENOBUFS);
+    assert(cmt_u256_cmp(&x, &y) == 0);
+
+    uint64_t u = 0;
+    assert(cmt_u256_to_u64(&x, &u) == -EDOM);
+    cmt_u256_from_u64(&x, 42);
+    assert(cmt_u256_to_u64(&x, &u) == 0 && u == 42);
+    printf("test_u256_abi_conversions passed!\n");
+}
+
+static void add_sub_carry(void) {
+    cmt_u256_t max = {{UINT64_MAX, UINT64_MAX, UINT64_MAX, UINT64_MAX}};
+    cmt_u256_t one;
+    cmt_u256_t r;
+    cmt_u256_from_u64(&one, 1);
+
+    assert(cmt_u256_add(&r, &max, &one) == true);
+    assert(cmt_u256_is_zero(&r));
+    assert(cmt_u256_sub(&r, &r, &one) == true);
+    assert(cmt_u256_cmp(&r, &max) == 0);
+    assert(cmt_u256_sub(&r, &max, &one) == false);
+    assert(cmt_u256_cmp(&r, &max) == -1);
+    assert(cmt_u256_cmp(&max, &r) == 1);
+    printf("test_u256_add_sub_carry passed!\n");
+}
+
+static void mul_overflow(void) {
+    cmt_u256_t a = {{0, 0, 1, 0}}; // 2^128
+    cmt_u256_t r;
+    assert(cmt_u256_mul(&r, &a, &a) == true);
+    assert(cmt_u256_is_zero(&r));
+
+    cmt_u256_t b = {{0, 1, 0, 0}}; // 2^64
+    assert(cmt_u256_mul(&r, &a, &b) == false);
+    assert(r.limb[3] == 1 && r.limb[0] == 0 && r.limb[1] == 0 && r.limb[2] == 0);
+    printf("test_u256_mul_overflow passed!\n");
+}
+
+static void divmod_random(void) {
+    uint64_t seed = UINT64_C(0x9e3779b97f4a7c15);
+    cmt_u256_t zero;
+    cmt_u256_from_u64(&zero, 0);
+    for (int i = 0; i < 100000; ++i) {
+        cmt_u256_t a;
+        cmt_u256_t b;
+        cmt_u256_t q;
+        cmt_u256_t r;
+        cmt_u256_t check;
+        random_u256(&seed, &a);
+        random_u256(&seed, &b);
+        if (cmt_u256_is_zero(&b)) {
+            assert(cmt_u256_divmod(&q, &r, &a, &b) == -EDOM);
+            continue;
+        }
+        assert(cmt_u256_divmod(&q, &r, &a, &b) == 0);
+        assert(cmt_u256_cmp(&r, &b) < 0);
+        // a == q * b + r, without overflow
+        assert(cmt_u256_mul(&check, &q, &b) == false);
+        assert(cmt_u256_add(&check, &check, &r) == false);
+        assert(cmt_u256_cmp(&check, &a) == 0);
+    }
+    printf("test_u256_divmod_random passed!\n");
+}
+
+static void muldiv(void) {
+    cmt_u256_t max = {{UINT64_MAX, UINT64_MAX, UINT64_MAX, UINT64_MAX}};
+    cmt_u256_t r;
+    cmt_u256_t zero;
+    cmt_u256_t two;
+    cmt_u256_from_u64(&zero, 0);
+    cmt_u256_from_u64(&two, 2);
+
+    // max * max / max == max, the intermediate needs all 512 bits
+    assert(cmt_u256_muldiv(&r, &max, &max, &max) == 0);
+    assert(cmt_u256_cmp(&r, &max) == 0);
+    assert(cmt_u256_muldiv(&r, &max, &two, &two) == 0);
+    assert(cmt_u256_cmp(&r, &max) == 0);
+    assert(cmt_u256_muldiv(&r, &max, &two, &max) == 0);
+    assert(cmt_u256_cmp(&r, &two) == 0);
+    assert(cmt_u256_muldiv(&r, &max, &max, &two) == -EOVERFLOW);
+    assert(cmt_u256_muldiv(&r, &max, &max, &zero) == -EDOM);
+
+    // agrees with mul + divmod when the product fits
+    uint64_t seed = 1;
+    for (int i = 0; i < 10000; ++i) {
+        cmt_u256_t a = {{xorshift(&seed), xorshift(&seed), 0, 0}};
+        cmt_u256_t b = {{xorshift(&seed), xorshift(&seed) >> 1, 0, 0}};
+        cmt_u256_t d = {{xorshift(&seed), 0, 0, 0}};
+        cmt_u256_t p;
+        cmt_u256_t q;
+        assert(cmt_u256_mul(&p, &a, &b) == false);
+        assert(cmt_u256_divmod(&q, NULL, &p, &d) == 0);
+        assert(cmt_u256_muldiv(&r, &a, &b, &d) == 0);
+        assert(cmt_u256_cmp(&r, &q) == 0);
+    }
+    printf("test_u256_muldiv passed!\n");
+}
+
+static void shifts(void) {
+    cmt_u256_t one;
+    cmt_u256_t r;
+    cmt_u256_from_u64(&one, 1);
+
+    for (unsigned n = 0; n < 256; ++n) {
+        cmt_u256_shl(&r, &one, n);
+        assert(r.limb[n / 64] == UINT64_C(1) << (n % 64));
+        cmt_u256_shr(&r, &r, n);
+        assert(cmt_u256_cmp(&r, &one) == 0);
+    }
+    cmt_u256_shl(&r, &one, 256);
+    assert(cmt_u256_is_zero(&r));
+    cmt_u256_shr(&r, &one, 1);
+    assert(cmt_u256_is_zero(&r));
+    printf("test_u256_shifts passed!\n");
+}
+
+int main(void) {
+    abi_conversions();
+    add_sub_carry();
+    mul_overflow();
+    divmod_random();
+    muldiv();
+    shifts();
+    return 0;
+}
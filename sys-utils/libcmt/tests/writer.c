@@ -0,0 +1,181 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "libcmt/io.h"
+#include "libcmt/keccak.h"
+#include "libcmt/outlog.h"
+#include "libcmt/util.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <sys/stat.h>
+
+#define FILES 1000
+#define OUTPUTS 20000
+
+static int emit(cmt_io_driver_t *io, uint16_t reason, size_t length, int fill) {
+    cmt_buf_t tx = cmt_io_get_tx(io);
+    memset(tx.begin, fill, length);
+    cmt_io_yield_t rr[1] = {{
+        .dev = HTIF_DEVICE_YIELD,
+        .cmd = HTIF_YIELD_CMD_AUTOMATIC,
+        .reason = reason,
+        .data = length,
+    }};
+    return cmt_io_yield(io, rr);
+}
+
+static int next_input(cmt_io_driver_t *io) {
+    cmt_io_yield_t rr[1] = {{
+        .dev = HTIF_DEVICE_YIELD,
+        .cmd = HTIF_YIELD_CMD_MANUAL,
+        .reason = HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED,
+    }};
+    return cmt_io_yield(io, rr);
+}
+
+static double now(void) {
+    struct timespec ts;
+    (void) clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + ((double) ts.tv_nsec * 1e-9);
+}
+
+/* stand in for the application computing the next output */
+static void work(int i) {
+    static uint8_t data[8192];
+    uint8_t hash[CMT_KECCAK_LENGTH];
+    data[0] = (uint8_t) i;
+    cmt_keccak_data(sizeof data, data, hash);
+    data[1] = hash[0];
+}
+
+static double files(int flags) {
+    assert(cmt_util_write_whole_file("writer-0.bin", 4, "in-0") == 0);
+    setenv("CMT_INPUTS", "0:writer-0.bin", 1);
+
+    cmt_io_driver_t io[1];
+    assert(cmt_io_init_ex(io, CMT_IO_DRIVER_MOCK, flags) == 0);
+    assert(next_input(io) == 0);
+    double t0 = now();
+    for (int i = 0; i < FILES; ++i) {
+        work(i);
+        assert(emit(io, HTIF_YIELD_AUTOMATIC_REASON_TX_REPORT, 1 + (i * 97) % 4096, i) == 0);
+    }
+    cmt_io_fini(io);
+    double dt = now() - t0;
+    unsetenv("CMT_INPUTS");
+
+    // everything is on disk once fini returns
+    for (int i = 0; i < FILES; ++i) {
+        char filepath[64];
+        uint8_t data[4096];
+        size_t length = 0;
+        (void) snprintf(filepath, sizeof filepath, "writer-0.report-%d.bin", i);
+        assert(cmt_util_read_whole_file(filepath, sizeof data, data, &length) == 0);
+        assert(length == (size_t) 1 + (i * 97) % 4096);
+        assert(data[0] == (uint8_t) i && data[length - 1] == (uint8_t) i);
+        (void) remove(filepath);
+    }
+    (void) remove("writer-0.bin");
+    return dt;
+}
+
+static void files_in_order(void) {
+    double sync = files(0);
+    double async = files(CMT_IO_ASYNC_OUTPUTS);
+    printf("test_writer_files_in_order passed! (%.0f files/s sync, %.0f files/s async)\n", FILES / sync,
+        FILES / async);
+}
+
+static void log_outputs(int flags) {
+    assert(cmt_util_write_whole_file("writer-0.bin", 4, "in-0") == 0);
+    setenv("CMT_INPUTS", "0:writer-0.bin", 1);
+    setenv("CMT_OUTPUT_LOG", "writer.log", 1);
+
+    cmt_io_driver_t io[1];
+    assert(cmt_io_init_ex(io, CMT_IO_DRIVER_MOCK, flags) == 0);
+    assert(next_input(io) == 0);
+    for (int i = 0; i < OUTPUTS; ++i) { // many more than the pool, exercises the back-pressure
+        assert(emit(io, HTIF_YIELD_AUTOMATIC_REASON_TX_OUTPUT, 256, i) == 0);
+    }
+    cmt_io_fini(io);
+    unsetenv("CMT_INPUTS");
+    unsetenv("CMT_OUTPUT_LOG");
+
+    FILE *file = fopen("writer.log", "rb");
+    assert(file != NULL);
+    assert(fseek(file, sizeof(cmt_outlog_header_t), SEEK_SET) == 0);
+    for (int i = 0; i < OUTPUTS; ++i) {
+        cmt_outlog_record_t record;
+        uint8_t data[256];
+        assert(fread(&record, sizeof(record), 1, file) == 1);
+        assert(record.input == 0 && record.kind == CMT_OUTLOG_OUTPUT);
+        assert(record.seq == (uint32_t) i && record.length == sizeof data);
+        assert(fread(data, sizeof data, 1, file) == 1);
+        assert(data[0] == (uint8_t) i && data[sizeof data - 1] == (uint8_t) i);
+    }
+    cmt_outlog_footer_t footer;
+    assert(fseek(file, -(long) sizeof(footer), SEEK_END) == 0);
+    assert(fread(&footer, sizeof(footer), 1, file) == 1);
+    assert(footer.count == OUTPUTS);
+    (void) fclose(file);
+
+    (void) remove("writer.log");
+    (void) remove("writer-0.bin");
+}
+
+static void log_in_order(void) {
+    log_outputs(0);
+    log_outputs(CMT_IO_ASYNC_OUTPUTS);
+    printf("test_writer_log_in_order passed!\n");
+}
+
+static void write_errors(void) {
+    assert(mkdir("writer-dir", 0755) == 0 || errno == EEXIST);
+    assert(cmt_util_write_whole_file("writer-dir/in.bin", 4, "in-0") == 0);
+    setenv("CMT_INPUTS", "0:writer-dir/in.bin", 1);
+
+    cmt_io_driver_t io[1];
+    assert(cmt_io_init_ex(io, CMT_IO_DRIVER_MOCK, CMT_IO_ASYNC_OUTPUTS) == 0);
+    assert(next_input(io) == 0);
+    assert(remove("writer-dir/in.bin") == 0);
+    assert(remove("writer-dir") == 0);
+
+    // the first write fails in the background, a later yield reports it
+    int rc = 0;
+    for (int i = 0; i < 1000 && rc == 0; ++i) {
+        rc = emit(io, HTIF_YIELD_AUTOMATIC_REASON_TX_REPORT, 8, i);
+        if (rc == 0) {
+            struct timespec ts = {0, 100000};
+            (void) nanosleep(&ts, NULL);
+        }
+    }
+    assert(rc == -ENOENT);
+    cmt_io_fini(io);
+    unsetenv("CMT_INPUTS");
+    printf("test_writer_write_errors passed!\n");
+}
+
+int main(void) {
+    files_in_order();
+    log_in_order();
+    write_errors();
+    return 0;
+}
@@ -0,0 +1,85 @@
+#!/bin/sh
+# Copyright Cartesi and individual authors (see AUTHORS)
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# Concatenate the libcmt headers and sources into a single header.
+#
+# usage: amalgamate.sh <headers...> -- <sources...> -- <host drivers...> -- <ioctl driver>
+#
+# Headers must be listed in dependency order, local includes are commented
+# out. `#line` markers keep compiler diagnostics pointing at the original files.
+
+emit() {
+	printf '#line 1 "%s"\n' "$1"
+	sed -e 's|^#include "\(.*\)"$|/* #include "\1" */|' "$1"
+}
+
+cat <<'EOF'
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* libcmt amalgamation, generated by tools/amalgamate.sh, do not edit.
+ *
+ * Include it anywhere for the declarations. In exactly one translation unit
+ * of the application define CMT_IMPLEMENTATION before including it to also
+ * compile the library in, so the compiler can inline across libcmt and the
+ * application code:
+ *
+ *     #define CMT_IMPLEMENTATION
+ *     #include "libcmt.h"
+ *
+ * Define CMT_IO_MOCK as well to compile the host drivers in place of the
+ * /dev/cmio one and default to the mock. */
+#ifndef CMT_LIBCMT_H
+#define CMT_LIBCMT_H
+EOF
+
+while [ $# -gt 0 ] && [ "$1" != "--" ]; do
+	emit "$1"
+	shift
+done
+shift
+
+echo '#endif /* CMT_LIBCMT_H */'
+echo '#if defined(CMT_IMPLEMENTATION) && !defined(CMT_LIBCMT_IMPLEMENTED)'
+echo '#define CMT_LIBCMT_IMPLEMENTED'
+while [ $# -gt 0 ] && [ "$1" != "--" ]; do
+	emit "$1"
+	shift
+done
+shift
+
+echo '#ifdef CMT_IO_MOCK'
+while [ $# -gt 0 ] && [ "$1" != "--" ]; do
+	emit "$1"
+	shift
+done
+shift
+echo '#else'
+emit "$1"
+echo '#endif /* CMT_IO_MOCK */'
+echo '#endif /* CMT_IMPLEMENTATION */'
@@ -0,0 +1,114 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* Inspect and compare CMT_OUTPUT_DIGEST logs, see @ref libcmt_digest */
+#include "libcmt/digest.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(const char *progname) {
+    (void) fprintf(stderr,
+        "usage: %s list <file>\n"
+        "       %s diff <expected> <actual>\n"
+        "\n"
+        "  list: print the digest of every input, then the hash of each of its outputs\n"
+        "  diff: print the first input and output that differ, exit with 1 if any does\n",
+        progname, progname);
+    exit(2);
+}
+
+static void print_hex(const uint8_t *data, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        printf("%02x", data[i]);
+    }
+}
+
+static int list(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        (void) fprintf(stderr, "failed to open \"%s\". %s\n", path, strerror(errno));
+        return 2;
+    }
+    cmt_digest_header_t header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, "CMTDGST1", sizeof(header.magic)) != 0) {
+        (void) fprintf(stderr, "\"%s\" is not a digest log\n", path);
+        (void) fclose(file);
+        return 2;
+    }
+
+    int rc = 0;
+    cmt_digest_entry_t entry;
+    while (fread(&entry, sizeof(entry), 1, file) == 1) {
+        if (entry.input == UINT64_MAX) {
+            printf("none");
+        } else {
+            printf("%" PRIu64, entry.input);
+        }
+        printf(" %" PRIu32 " ", entry.count);
+        print_hex(entry.digest, sizeof(entry.digest));
+        printf(" ");
+        print_hex(entry.running, sizeof(entry.running));
+        printf("\n");
+        for (uint32_t i = 0; i < entry.count; ++i) {
+            uint64_t hash = 0;
+            if (fread(&hash, sizeof(hash), 1, file) != 1) {
+                (void) fprintf(stderr, "\"%s\" is truncated\n", path);
+                rc = 2;
+                break;
+            }
+            printf("  %" PRIu32 " ", i);
+            print_hex((const uint8_t *) &hash, sizeof(hash));
+            printf("\n");
+        }
+        if (rc) {
+            break;
+        }
+    }
+    (void) fclose(file);
+    return rc;
+}
+
+static int diff(const char *expected, const char *actual) {
+    cmt_digest_divergence_t divergence;
+    int rc = cmt_digest_compare(expected, actual, &divergence);
+    if (rc < 0) {
+        (void) fprintf(stderr, "failed to compare \"%s\" and \"%s\". %s\n", expected, actual, strerror(-rc));
+        return 2;
+    }
+    if (rc == 0) {
+        return 0;
+    }
+    if (divergence.input == UINT64_MAX) {
+        printf("outputs differ before the first input, output %" PRIu32 "\n", divergence.output);
+    } else {
+        printf("outputs differ at input %" PRIu64 ", output %" PRIu32 "\n", divergence.input, divergence.output);
+    }
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc == 3 && strcmp(argv[1], "list") == 0) {
+        return list(argv[2]);
+    }
+    if (argc == 4 && strcmp(argv[1], "diff") == 0) {
+        return diff(argv[2], argv[3]);
+    }
+    usage(argv[0]);
+    return 2;
+}
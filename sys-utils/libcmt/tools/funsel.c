@@ -15,19 +15,734 @@
  */
 #include "libcmt/keccak.h"
 
+#include <ctype.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+enum {
+    MAX_METHODS = 4096,
+    MAX_PARAMS = 64,
+    MAX_DECL = 4096,
+    MAX_NAME = 128,
+    MAX_SEED_TRIES = 1 << 16,
+};
+
+static void usage(const char *progname) {
+    (void) fprintf(stderr,
+        "usage: %s \"<declaration>\"\n"
+        "       %s -j <abi.json> [-p <prefix>]\n"
+        "\n"
+        "  -j <abi.json>  generate a dispatch header from a solidity ABI JSON file\n"
+        "                 (either the bare ABI array or an artifact with an \"abi\" member)\n"
+        "  -p <prefix>    identifier prefix for the generated code (default: app)\n",
+        progname, progname);
+    exit(1);
+}
+
+static void die(const char *msg, const char *arg) {
+    (void) fprintf(stderr, "funsel: %s%s%s\n", msg, arg ? ": " : "", arg ? arg : "");
+    exit(1);
+}
+
+// json ---------------------------------------------------------------------
+
+enum {
+    JSON_NULL,
+    JSON_BOOL,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT,
+};
+
+/** A node of the parsed document. Strings point into the input text and are
+ * not unescaped, ABI identifiers and types never contain escapes. */
+typedef struct json {
+    int type;
+    const char *key; /**< member name when inside an object */
+    size_t key_length;
+    const char *str; /**< string contents */
+    size_t str_length;
+    struct json *child; /**< first element or member */
+    struct json *next;  /**< next sibling */
+} json_t;
+
+typedef struct json_parser {
+    const char *p;
+    const char *end;
+} json_parser_t;
+
+static void json_ws(json_parser_t *me) {
+    while (me->p < me->end && isspace((unsigned char) *me->p)) {
+        ++me->p;
+    }
+}
+
+static int json_string(json_parser_t *me, const char **s, size_t *n) {
+    if (me->p >= me->end || *me->p != '"') {
+        return -1;
+    }
+    const char *begin = ++me->p;
+    for (; me->p < me->end && *me->p != '"'; ++me->p) {
+        if (*me->p == '\\') {
+            ++me->p;
+        }
+    }
+    if (me->p >= me->end) {
+        return -1;
+    }
+    *s = begin;
+    *n = me->p++ - begin;
+    return 0;
+}
+
+static json_t *json_value(json_parser_t *me, int depth);
+
+static json_t *json_children(json_parser_t *me, json_t *node, char close, bool keyed, int depth) {
+    json_t **tail = &node->child;
+    ++me->p;
+    json_ws(me);
+    if (me->p < me->end && *me->p == close) {
+        ++me->p;
+        return node;
+    }
+    for (;;) {
+        const char *key = NULL;
+        size_t key_length = 0;
+        json_ws(me);
+        if (keyed) {
+            if (json_string(me, &key, &key_length)) {
+                return NULL;
+            }
+            json_ws(me);
+            if (me->p >= me->end || *me->p++ != ':') {
+                return NULL;
+            }
+        }
+        json_t *child = json_value(me, depth + 1);
+        if (!child) {
+            return NULL;
+        }
+        child->key = key;
+        child->key_length = key_length;
+        *tail = child;
+        tail = &child->next;
+
+        json_ws(me);
+        if (me->p >= me->end) {
+            return NULL;
+        }
+        if (*me->p == ',') {
+            ++me->p;
+            continue;
+        }
+        if (*me->p++ == close) {
+            return node;
+        }
+        return NULL;
+    }
+}
+
+static json_t *json_value(json_parser_t *me, int depth) {
+    if (depth > 64) {
+        return NULL;
+    }
+    json_ws(me);
+    if (me->p >= me->end) {
+        return NULL;
+    }
+    json_t *node = calloc(1, sizeof(*node));
+    if (!node) {
+        die("out of memory", NULL);
+    }
+    switch (*me->p) {
+        case '{':
+            node->type = JSON_OBJECT;
+            return json_children(me, node, '}', true, depth);
+        case '[':
+            node->type = JSON_ARRAY;
+            return json_children(me, node, ']', false, depth);
+        case '"':
+            node->type = JSON_STRING;
+            return json_string(me, &node->str, &node->str_length) ? NULL : node;
+        default:
+            break;
+    }
+    const char *begin = me->p;
+    while (me->p < me->end && (isalnum((unsigned char) *me->p) || strchr("+-.", *me->p))) {
+        ++me->p;
+    }
+    size_t n = me->p - begin;
+    if (n == 4 && strncmp(begin, "null", n) == 0) {
+        node->type = JSON_NULL;
+    } else if ((n == 4 && strncmp(begin, "true", n) == 0) || (n == 5 && strncmp(begin, "false", n) == 0)) {
+        node->type = JSON_BOOL;
+    } else if (n > 0) {
+        node->type = JSON_NUMBER;
+    } else {
+        return NULL;
+    }
+    node->str = begin;
+    node->str_length = n;
+    return node;
+}
+
+static const json_t *json_get(const json_t *obj, const char *key) {
+    if (!obj || obj->type != JSON_OBJECT) {
+        return NULL;
+    }
+    size_t n = strlen(key);
+    for (const json_t *it = obj->child; it; it = it->next) {
+        if (it->key_length == n && strncmp(it->key, key, n) == 0) {
+            return it;
+        }
+    }
+    return NULL;
+}
+
+static bool json_str_eq(const json_t *node, const char *s) {
+    return node && node->type == JSON_STRING && node->str_length == strlen(s) &&
+        strncmp(node->str, s, node->str_length) == 0;
+}
+
+static char *read_file(const char *path, size_t *length) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        die("failed to open", path);
+    }
+    size_t capacity = 1 << 16;
+    char *data = malloc(capacity);
+    *length = 0;
+    for (size_t n = 0; data && (n = fread(data + *length, 1, capacity - *length, file)) > 0;) {
+        *length += n;
+        if (*length == capacity) {
+            capacity *= 2;
+            char *tmp = realloc(data, capacity);
+            if (!tmp) {
+                free(data);
+            }
+            data = tmp;
+        }
+    }
+    if (!data) {
+        die("out of memory", NULL);
+    }
+    if (ferror(file)) {
+        die("failed to read", path);
+    }
+    (void) fclose(file);
+    return data;
+}
+
+// abi ----------------------------------------------------------------------
+
+typedef struct param {
+    char name[MAX_NAME];
+    const char *ctype; /**< NULL when there is no decode support for this type */
+    int kind;
+} param_t;
+
+enum {
+    KIND_UINT,    /**< native integer, cmt_abi_get_uint */
+    KIND_U256,    /**< raw 32 byte word, cmt_abi_get_uint256 */
+    KIND_ADDRESS, /**< cmt_abi_get_address */
+    KIND_BOOL,    /**< cmt_abi_get_bool */
+    KIND_BYTES,   /**< bytes and string, cmt_abi_get_bytes_s + cmt_abi_get_bytes_d */
+};
+
+typedef struct method {
+    char base[MAX_NAME]; /**< solidity name */
+    char name[MAX_NAME]; /**< unique C identifier */
+    char decl[MAX_DECL];
+    uint32_t funsel;
+    int params_count;
+    bool decodable;
+    param_t params[MAX_PARAMS];
+} method_t;
+
+static void append(char *dst, size_t max, const char *src, size_t n) {
+    size_t len = strlen(dst);
+    if (len + n + 1 > max) {
+        die("declaration too long", dst);
+    }
+    memcpy(dst + len, src, n);
+    dst[len + n] = '\0';
+}
+
+/* canonical type, with tuples expanded into their components */
+static void canonical_type(char *dst, size_t max, const json_t *param) {
+    const json_t *type = json_get(param, "type");
+    if (!type || type->type != JSON_STRING) {
+        die("parameter without a type", NULL);
+    }
+    if (type->str_length >= 5 && strncmp(type->str, "tuple", 5) == 0) {
+        const json_t *components = json_get(param, "components");
+        append(dst, max, "(", 1);
+        for (const json_t *it = components ? components->child : NULL; it; it = it->next) {
+            canonical_type(dst, max, it);
+            if (it->next) {
+                append(dst, max, ",", 1);
+            }
+        }
+        append(dst, max, ")", 1);
+        append(dst, max, type->str + 5, type->str_length - 5);
+        return;
+    }
+    append(dst, max, type->str, type->str_length);
+}
+
+static bool type_is(const json_t *type, const char *s) {
+    return json_str_eq(type, s);
+}
+
+/* decode support is limited to the types with a direct @ref libcmt_abi getter */
+static void classify(param_t *p, const json_t *param) {
+    const json_t *type = json_get(param, "type");
+    char buf[MAX_NAME] = {0};
+    size_t n = type->str_length < sizeof(buf) - 1 ? type->str_length : sizeof(buf) - 1;
+    memcpy(buf, type->str, n);
+
+    p->ctype = NULL;
+    if (strchr(buf, '[') || strncmp(buf, "tuple", 5) == 0) {
+        return;
+    }
+    if (type_is(type, "address")) {
+        p->kind = KIND_ADDRESS;
+        p->ctype = "cmt_abi_address_t";
+    } else if (type_is(type, "bool")) {
+        p->kind = KIND_BOOL;
+        p->ctype = "bool";
+    } else if (type_is(type, "bytes") || type_is(type, "string")) {
+        p->kind = KIND_BYTES;
+        p->ctype = "cmt_abi_bytes_t";
+    } else if (strncmp(buf, "uint", 4) == 0) {
+        int bits = buf[4] ? atoi(buf + 4) : 256;
+        p->kind = bits <= 64 ? KIND_UINT : KIND_U256;
+        p->ctype = bits <= 8 ? "uint8_t"
+            : bits <= 16     ? "uint16_t"
+            : bits <= 32     ? "uint32_t"
+            : bits <= 64     ? "uint64_t"
+                             : "cmt_abi_u256_t";
+    } else if (strncmp(buf, "int", 3) == 0 || strncmp(buf, "bytes", 5) == 0) {
+        // signed values and fixed bytes are handed over as the raw word
+        p->kind = KIND_U256;
+        p->ctype = "cmt_abi_u256_t";
+    }
+}
+
+static void identifier(char *dst, size_t max, const char *src, size_t n) {
+    size_t j = 0;
+    for (size_t i = 0; i < n && j + 1 < max; ++i) {
+        dst[j++] = (isalnum((unsigned char) src[i]) || src[i] == '_') ? src[i] : '_';
+    }
+    dst[j] = '\0';
+}
+
+/* C keywords, and the object like macros of the headers the generated code
+ * includes, that a solidity parameter name may spell */
+static const char *const keywords[] = {
+    "NULL", "_Alignas", "_Alignof", "_Atomic", "_BitInt", "_Bool", "_Complex", "_Decimal128", "_Decimal32",
+    "_Decimal64", "_Generic", "_Imaginary", "_Noreturn", "_Static_assert", "_Thread_local", "alignas", "alignof",
+    "auto", "bool", "break", "case", "char", "const", "constexpr", "continue", "default", "do", "double", "else",
+    "enum", "errno", "extern", "false", "float", "for", "goto", "if", "inline", "int", "long", "nullptr", "register",
+    "restrict", "return", "short", "signed", "sizeof", "static", "static_assert", "struct", "switch",
+    "thread_local", "true", "typedef", "typeof", "typeof_unqual", "union", "unsigned", "void", "volatile", "while",
+};
+
+static bool is_keyword(const char *name) {
+    for (size_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); ++i) {
+        if (strcmp(name, keywords[i]) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* struct member for a parameter: keywords get a trailing `_`, names reserved
+ * to the implementation (`__x`, `_X`) or starting with a digit an `arg` prefix */
+static void member_name(char *dst, size_t max, const char *src, size_t n) {
+    char name[MAX_NAME];
+    identifier(name, sizeof(name), src, n);
+    bool reserved = isdigit((unsigned char) name[0]) ||
+        (name[0] == '_' && (name[1] == '_' || isupper((unsigned char) name[1])));
+    dst[0] = '\0';
+    if (reserved) {
+        append(dst, max, "arg", 3);
+    }
+    append(dst, max, name, strlen(name));
+    if (is_keyword(name)) {
+        append(dst, max, "_", 1);
+    }
+}
+
+/* whether a parameter of @p m other than @p skip is called @p name */
+static bool has_member(const method_t *m, int skip, const char *name) {
+    for (int i = 0; i < m->params_count; ++i) {
+        if (i != skip && strcmp(m->params[i].name, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void load_method(method_t *m, const json_t *fn) {
+    const json_t *name = json_get(fn, "name");
+    const json_t *inputs = json_get(fn, "inputs");
+    if (!name || name->type != JSON_STRING) {
+        die("function without a name", NULL);
+    }
+
+    identifier(m->base, sizeof(m->base), name->str, name->str_length);
+    strcpy(m->name, m->base);
+    append(m->decl, sizeof(m->decl), name->str, name->str_length);
+    append(m->decl, sizeof(m->decl), "(", 1);
+    m->decodable = true;
+    m->params_count = 0;
+    for (const json_t *it = inputs ? inputs->child : NULL; it; it = it->next) {
+        if (m->params_count == MAX_PARAMS) {
+            die("too many parameters", m->decl);
+        }
+        param_t *p = &m->params[m->params_count];
+        const json_t *pname = json_get(it, "name");
+        p->name[0] = '\0';
+        if (pname && pname->type == JSON_STRING && pname->str_length) {
+            member_name(p->name, sizeof(p->name), pname->str, pname->str_length);
+            if (has_member(m, -1, p->name)) {
+                die("parameter names clash", p->name);
+            }
+        }
+        classify(p, it);
+        m->decodable = m->decodable && p->ctype;
+
+        canonical_type(m->decl, sizeof(m->decl), it);
+        if (it->next) {
+            append(m->decl, sizeof(m->decl), ",", 1);
+        }
+        m->params_count++;
+    }
+    append(m->decl, sizeof(m->decl), ")", 1);
+    m->funsel = cmt_keccak_funsel(m->decl);
+
+    // unnamed parameters are named after their position, once every real name is known
+    for (int i = 0; i < m->params_count; ++i) {
+        param_t *p = &m->params[i];
+        if (p->name[0]) {
+            continue;
+        }
+        (void) snprintf(p->name, sizeof(p->name), "arg%d", i);
+        while (has_member(m, i, p->name)) {
+            append(p->name, sizeof(p->name), "_", 1);
+        }
+    }
+}
+
+static void upper(char *dst, size_t max, const char *src) {
+    size_t i = 0;
+    for (; src[i] && i + 1 < max; ++i) {
+        dst[i] = (char) toupper((unsigned char) src[i]);
+    }
+    dst[i] = '\0';
+}
+
+/* whether @p name clashes with a method other than @p skip once both are
+ * turned into the <PREFIX>_<NAME> and <PREFIX>_<NAME>_FUNSEL macros */
+static bool name_taken(const method_t *methods, int n, int skip, const char *name) {
+    char NAME[MAX_NAME + 8];
+    char OTHER[MAX_NAME + 8];
+    upper(NAME, sizeof(NAME), name);
+    if (strcmp(NAME, "METHOD_COUNT") == 0) {
+        return true;
+    }
+    size_t length = strlen(NAME);
+    for (int j = 0; j < n; ++j) {
+        if (j == skip) {
+            continue;
+        }
+        upper(OTHER, sizeof(OTHER), methods[j].name);
+        size_t other_length = strlen(OTHER);
+        if (strcmp(NAME, OTHER) == 0 ||
+            (length == other_length + 7 && strncmp(NAME, OTHER, other_length) == 0 &&
+                strcmp(NAME + other_length, "_FUNSEL") == 0) ||
+            (other_length == length + 7 && strncmp(OTHER, NAME, length) == 0 &&
+                strcmp(OTHER + length, "_FUNSEL") == 0)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* overloaded functions share a name, disambiguate them with the first numeric
+ * suffix that is free, then refuse names that still clash, as `ping` and `Ping` do */
+static void disambiguate(method_t *methods, int n) {
+    for (int i = 0; i < n; ++i) {
+        int count = 0;
+        for (int j = 0; j < i; ++j) {
+            count += strcmp(methods[i].base, methods[j].base) == 0;
+        }
+        if (!count) {
+            continue;
+        }
+        for (;; ++count) {
+            strcpy(methods[i].name, methods[i].base);
+            char suffix[16];
+            (void) snprintf(suffix, sizeof(suffix), "_%d", count);
+            append(methods[i].name, sizeof(methods[i].name), suffix, strlen(suffix));
+            if (!name_taken(methods, n, i, methods[i].name)) {
+                break;
+            }
+        }
+    }
+    for (int i = 0; i < n; ++i) {
+        if (name_taken(methods, n, i, methods[i].name)) {
+            die("generated names clash", methods[i].decl);
+        }
+    }
+}
+
+// perfect hash -------------------------------------------------------------
+
+/* multiplicative hashing: slot = (funsel * seed) >> (32 - bits) */
+static uint32_t slot_of(uint32_t funsel, uint32_t seed, int bits) {
+    return (uint32_t) (funsel * seed) >> (32 - bits);
+}
+
+static uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += UINT64_C(0x9e3779b97f4a7c15));
+    z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+    return z ^ (z >> 31);
+}
+
+static void perfect_hash(const method_t *methods, int n, int16_t **table, int *bits, uint32_t *seed) {
+    uint64_t rng = 0;
+    for (*bits = 1; (1 << *bits) < n; ++*bits) {
+        ;
+    }
+    for (; *bits < 24; ++*bits) {
+        size_t size = (size_t) 1 << *bits;
+        *table = malloc(size * sizeof(**table));
+        if (!*table) {
+            die("out of memory", NULL);
+        }
+        for (int tries = 0; tries < MAX_SEED_TRIES; ++tries) {
+            *seed = (uint32_t) splitmix64(&rng) | 1;
+            memset(*table, 0xff, size * sizeof(**table));
+            int i = 0;
+            for (; i < n; ++i) {
+                uint32_t s = slot_of(methods[i].funsel, *seed, *bits);
+                if ((*table)[s] >= 0) {
+                    break;
+                }
+                (*table)[s] = (int16_t) i;
+            }
+            if (i == n) {
+                return;
+            }
+        }
+        free(*table);
+    }
+    die("failed to find a collision free hash", NULL);
+}
+
+// output -------------------------------------------------------------------
+
+static void print_funsel(uint32_t funsel) {
+    const uint8_t *b = (const uint8_t *) &funsel;
+    printf("CMT_ABI_FUNSEL(0x%02x, 0x%02x, 0x%02x, 0x%02x)", b[0], b[1], b[2], b[3]);
+}
+
+static void print_decoder(const char *prefix, const char *PREFIX, const method_t *m) {
+    char NAME[MAX_NAME];
+    upper(NAME, sizeof(NAME), m->name);
+
+    printf("\n/** Arguments of `%s` */\n", m->decl);
+    printf("typedef struct %s_%s_args {\n", prefix, m->name);
+    for (int i = 0; i < m->params_count; ++i) {
+        printf("    %s %s;\n", m->params[i].ctype, m->params[i].name);
+    }
+    if (m->params_count == 0) {
+        printf("    char _; /**< no arguments */\n");
+    }
+    printf("} %s_%s_args_t;\n\n", prefix, m->name);
+
+    printf("/** Decode `%s` from @p rd */\n", m->decl);
+    printf("static inline int %s_decode_%s(cmt_buf_t *rd, %s_%s_args_t *args) {\n", prefix, m->name, prefix, m->name);
+    printf("    cmt_buf_t frame[1];\n");
+    printf("    int rc = cmt_abi_check_funsel(rd, %s_%s_FUNSEL);\n", PREFIX, NAME);
+    printf("    if (rc) {\n        return rc;\n    }\n");
+    printf("    rc = cmt_abi_mark_frame(rd, frame);\n");
+    for (int i = 0; i < m->params_count; ++i) {
+        const param_t *p = &m->params[i];
+        switch (p->kind) {
+            case KIND_UINT:
+                printf("    if (rc == 0) {\n        rc = cmt_abi_get_uint(rd, sizeof(args->%s), &args->%s);\n    }\n",
+                    p->name, p->name);
+                break;
+            case KIND_U256:
+                printf("    if (rc == 0) {\n        rc = cmt_abi_get_uint256(rd, &args->%s);\n    }\n", p->name);
+                break;
+            case KIND_ADDRESS:
+                printf("    if (rc == 0) {\n        rc = cmt_abi_get_address(rd, &args->%s);\n    }\n", p->name);
+                break;
+            case KIND_BOOL:
+                printf("    if (rc == 0) {\n        rc = cmt_abi_get_bool(rd, &args->%s);\n    }\n", p->name);
+                break;
+            case KIND_BYTES:
+                printf("    if (rc == 0) {\n"
+                       "        cmt_buf_t of[1];\n"
+                       "        rc = cmt_abi_get_bytes_s(rd, of);\n"
+                       "        if (rc == 0) {\n"
+                       "            rc = cmt_abi_get_bytes_d(frame, of, &args->%s.length, &args->%s.data);\n"
+                       "        }\n"
+                       "    }\n",
+                    p->name, p->name);
+                break;
+            default:
+                break;
+        }
+    }
+    if (m->params_count == 0) {
+        printf("    (void) args;\n");
+    }
+    printf("    return rc;\n}\n");
+}
+
+static void generate(const char *path, const char *prefix) {
+    size_t length = 0;
+    char *text = read_file(path, &length);
+    json_parser_t parser = {text, text + length};
+    const json_t *root = json_value(&parser, 0);
+    if (!root) {
+        die("failed to parse", path);
+    }
+    if (root->type == JSON_OBJECT) {
+        root = json_get(root, "abi");
+    }
+    if (!root || root->type != JSON_ARRAY) {
+        die("expected an ABI array", path);
+    }
+
+    static method_t methods[MAX_METHODS];
+    int n = 0;
+    for (const json_t *it = root->child; it; it = it->next) {
+        const json_t *type = json_get(it, "type");
+        if (type && !json_str_eq(type, "function")) {
+            continue; // events, errors, constructor, ...
+        }
+        if (n == MAX_METHODS) {
+            die("too many functions", path);
+        }
+        load_method(&methods[n], it);
+        for (int j = 0; j < n; ++j) {
+            if (methods[j].funsel == methods[n].funsel) {
+                die("duplicated function selector", methods[n].decl);
+            }
+        }
+        ++n;
+    }
+    if (n == 0) {
+        die("no functions found", path);
+    }
+    disambiguate(methods, n);
+
+    int16_t *table = NULL;
+    int bits = 0;
+    uint32_t seed = 0;
+    perfect_hash(methods, n, &table, &bits, &seed);
+
+    char PREFIX[MAX_NAME];
+    upper(PREFIX, sizeof(PREFIX), prefix);
+
+    printf("/* generated by funsel from %s, do not edit. */\n", path);
+    printf("#ifndef %s_FUNSEL_H\n#define %s_FUNSEL_H\n", PREFIX, PREFIX);
+    printf("#include \"libcmt/abi.h\"\n\n");
+
+    for (int i = 0; i < n; ++i) {
+        char NAME[MAX_NAME];
+        upper(NAME, sizeof(NAME), methods[i].name);
+        printf("// %s\n#define %s_%s_FUNSEL ", methods[i].decl, PREFIX, NAME);
+        print_funsel(methods[i].funsel);
+        printf("\n");
+    }
+
+    printf("\n/** Method indices, as returned by @ref %s_dispatch */\nenum {\n", prefix);
+    for (int i = 0; i < n; ++i) {
+        char NAME[MAX_NAME];
+        upper(NAME, sizeof(NAME), methods[i].name);
+        printf("    %s_%s = %d,\n", PREFIX, NAME, i);
+    }
+    printf("    %s_METHOD_COUNT = %d,\n};\n\n", PREFIX, n);
+
+    size_t size = (size_t) 1 << bits;
+    printf("static const uint32_t %s_dispatch_funsel[%zu] = {\n", prefix, size);
+    for (size_t s = 0; s < size; ++s) {
+        if (table[s] < 0) {
+            printf("    0,\n");
+        } else {
+            char NAME[MAX_NAME];
+            upper(NAME, sizeof(NAME), methods[table[s]].name);
+            printf("    %s_%s_FUNSEL,\n", PREFIX, NAME);
+        }
+    }
+    printf("};\n\n");
+    printf("static const int16_t %s_dispatch_method[%zu] = {\n", prefix, size);
+    for (size_t s = 0; s < size; ++s) {
+        printf("    %d,\n", table[s]);
+    }
+    printf("};\n\n");
+
+    printf("/** Map @p funsel to its method index in constant time\n"
+           " * @return\n"
+           " * - method index, one of the %s_* enum values\n"
+           " * - -1 if @p funsel is unknown */\n",
+        PREFIX);
+    printf("static inline int %s_dispatch(uint32_t funsel) {\n", prefix);
+    printf("    uint32_t slot = (uint32_t) (funsel * UINT32_C(0x%08x)) >> %d;\n", seed, 32 - bits);
+    printf("    return %s_dispatch_funsel[slot] == funsel ? %s_dispatch_method[slot] : -1;\n}\n", prefix, prefix);
+
+    for (int i = 0; i < n; ++i) {
+        if (methods[i].decodable) {
+            print_decoder(prefix, PREFIX, &methods[i]);
+        } else {
+            printf("\n/* %s: no decoder, has parameters of types without a direct getter */\n", methods[i].decl);
+        }
+    }
+    printf("\n#endif /* %s_FUNSEL_H */\n", PREFIX);
+    free(table);
+    free(text);
+}
 
 int main(int argc, char *argv[]) {
+    const char *json = NULL;
+    const char *prefix = "app";
+
     if (argc < 2) {
-        (void) fprintf(stderr, "usage: %s \"<declaration>\"\n", argv[0]);
-        exit(1);
+        usage(argv[0]);
+    }
+    if (argv[1][0] != '-') {
+        // value encoded as big endian
+        uint32_t funsel = cmt_keccak_funsel(argv[1]);
+        printf("// %s\n"
+               "#define FUNSEL CMT_ABI_FUNSEL(0x%02x, 0x%02x, 0x%02x, 0x%02x)\n",
+            argv[1], ((uint8_t *) &funsel)[0], ((uint8_t *) &funsel)[1], ((uint8_t *) &funsel)[2],
+            ((uint8_t *) &funsel)[3]);
+        return 0;
     }
 
-    // value encoded as big endian
-    uint32_t funsel = cmt_keccak_funsel(argv[1]);
-    printf("// %s\n"
-           "#define FUNSEL CMT_ABI_FUNSEL(0x%02x, 0x%02x, 0x%02x, 0x%02x)\n",
-        argv[1], ((uint8_t *) &funsel)[0], ((uint8_t *) &funsel)[1], ((uint8_t *) &funsel)[2],
-        ((uint8_t *) &funsel)[3]);
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            json = argv[++i];
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            prefix = argv[++i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (!json) {
+        usage(argv[0]);
+    }
+    generate(json, prefix);
+    return 0;
 }
@@ -0,0 +1,132 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* Build and query CMT_GIO_STORE pack files, see @ref libcmt_giostore */
+#include "libcmt/giostore.h"
+#include "libcmt/util.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    ID_LENGTH = 2U << 20, /**< the default size of tx */
+};
+
+static void usage(const char *progname) {
+    (void) fprintf(stderr,
+        "usage: %s pack <dir> <file.pack>\n"
+        "       %s name <domain> <id-file>\n"
+        "       %s find <store> <domain> <id-file>\n"
+        "\n"
+        "  pack: write the <domain>-<keccak(id)>.bin responses of <dir> into a pack\n"
+        "  name: print the file name of the response to a request, in a directory store\n"
+        "  find: write the response to a request, from a directory or pack, to stdout\n",
+        progname, progname, progname);
+    exit(1);
+}
+
+static int parse_domain(const char *arg, uint16_t *domain) {
+    char *end = NULL;
+    unsigned long n = strtoul(arg, &end, 0);
+    if (!*arg || *end || n > UINT16_MAX) {
+        (void) fprintf(stderr, "invalid domain \"%s\"\n", arg);
+        return 1;
+    }
+    *domain = n;
+    return 0;
+}
+
+static int read_id(const char *path, void *id, size_t *length) {
+    int rc = cmt_util_read_whole_file(path, ID_LENGTH, id, length);
+    if (rc) {
+        (void) fprintf(stderr, "failed to read \"%s\". %s\n", path, strerror(-rc));
+        return 1;
+    }
+    return 0;
+}
+
+static int pack(const char *dir, const char *path) {
+    int rc = cmt_giostore_pack(dir, path);
+    if (rc) {
+        (void) fprintf(stderr, "failed to pack \"%s\" into \"%s\". %s\n", dir, path, strerror(-rc));
+        return 1;
+    }
+    return 0;
+}
+
+static int name(const char *domain_arg, const char *id_path, void *id) {
+    uint16_t domain = 0;
+    size_t length = 0;
+    if (parse_domain(domain_arg, &domain) || read_id(id_path, id, &length)) {
+        return 1;
+    }
+    char filename[CMT_GIOSTORE_NAME_LENGTH];
+    cmt_giostore_name(domain, length, id, filename);
+    printf("%s\n", filename);
+    return 0;
+}
+
+static int find(const char *store_path, const char *domain_arg, const char *id_path, void *id) {
+    uint16_t domain = 0;
+    size_t length = 0;
+    if (parse_domain(domain_arg, &domain) || read_id(id_path, id, &length)) {
+        return 1;
+    }
+
+    cmt_giostore_t *store = NULL;
+    int rc = cmt_giostore_open(&store, store_path, 0);
+    if (rc) {
+        (void) fprintf(stderr, "failed to open \"%s\". %s\n", store_path, strerror(-rc));
+        return 1;
+    }
+    const void *data = NULL;
+    size_t data_length = 0;
+    rc = cmt_giostore_find(store, domain, length, id, &data, &data_length);
+    if (rc) {
+        (void) fprintf(stderr, "no response. %s\n", strerror(-rc));
+    } else if (data_length && fwrite(data, 1, data_length, stdout) != data_length) {
+        (void) fprintf(stderr, "failed to write the response\n");
+        rc = -EIO;
+    }
+    cmt_giostore_close(store);
+    return rc ? 1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        usage(argv[0]);
+    }
+    if (strcmp(argv[1], "pack") == 0 && argc == 4) {
+        return pack(argv[2], argv[3]);
+    }
+
+    void *id = malloc(ID_LENGTH);
+    if (!id) {
+        (void) fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    int rc = 0;
+    if (strcmp(argv[1], "name") == 0 && argc == 4) {
+        rc = name(argv[2], argv[3], id);
+    } else if (strcmp(argv[1], "find") == 0 && argc == 5) {
+        rc = find(argv[2], argv[3], argv[4], id);
+    } else {
+        usage(argv[0]);
+    }
+    free(id);
+    return rc;
+}
@@ -0,0 +1,176 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* List and extract the outputs of a CMT_OUTPUT_LOG file, see @ref libcmt_outlog */
+#include "libcmt/outlog.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(const char *progname) {
+    (void) fprintf(stderr,
+        "usage: %s list <file.log>\n"
+        "       %s extract <file.log> <n>\n"
+        "\n"
+        "  list:    print one line per output, in the order they were emitted\n"
+        "  extract: write the payload of the n-th output (from 0) to stdout\n",
+        progname, progname);
+    exit(1);
+}
+
+static const char *kind_name(uint32_t kind) {
+    switch (kind) {
+        case CMT_OUTLOG_OUTPUT:
+            return "output";
+        case CMT_OUTLOG_REPORT:
+            return "report";
+        case CMT_OUTLOG_EXCEPTION:
+            return "exception";
+        case CMT_OUTLOG_GIO:
+            return "gio";
+        case CMT_OUTLOG_OUTPUTS_ROOT_HASH:
+            return "outputs_root_hash";
+        default:
+            return "?";
+    }
+}
+
+/* record offsets from the footer index, or -1 when the log was not closed */
+static long long footer_count(FILE *file, cmt_outlog_footer_t *footer) {
+    if (fseek(file, -(long) sizeof(*footer), SEEK_END) != 0 || fread(footer, sizeof(*footer), 1, file) != 1 ||
+        memcmp(footer->magic, "CMTOLOGX", sizeof(footer->magic)) != 0) {
+        return -1;
+    }
+    return (long long) footer->count;
+}
+
+static int read_record(FILE *file, long long offset, cmt_outlog_record_t *record) {
+    if (fseek(file, offset, SEEK_SET) != 0 || fread(record, sizeof(*record), 1, file) != 1) {
+        return -1;
+    }
+    return 0;
+}
+
+static long long next_offset(long long offset, const cmt_outlog_record_t *record) {
+    size_t length = (record->length + CMT_OUTLOG_ALIGN - 1) & ~(size_t) (CMT_OUTLOG_ALIGN - 1);
+    return offset + (long long) (sizeof(*record) + length);
+}
+
+/* offset of the n-th record, through the index if there is one */
+static long long find(FILE *file, unsigned long long n) {
+    cmt_outlog_footer_t footer;
+    cmt_outlog_record_t record;
+    if (footer_count(file, &footer) >= 0) {
+        uint64_t offset = 0;
+        if (n >= footer.count || fseek(file, (long) (footer.index + n * sizeof(offset)), SEEK_SET) != 0 ||
+            fread(&offset, sizeof(offset), 1, file) != 1) {
+            return -1;
+        }
+        return (long long) offset;
+    }
+    long long offset = sizeof(cmt_outlog_header_t);
+    for (unsigned long long i = 0; read_record(file, offset, &record) == 0; ++i) {
+        if (i == n) {
+            return offset;
+        }
+        offset = next_offset(offset, &record);
+    }
+    return -1;
+}
+
+static int list(FILE *file) {
+    cmt_outlog_footer_t footer;
+    cmt_outlog_record_t record;
+    long long count = footer_count(file, &footer);
+    long long end = count >= 0 ? (long long) footer.index : -1;
+    if (count < 0) {
+        printf("# no index, the log was not closed\n");
+    }
+
+    printf("%8s %8s %-18s %6s %10s %12s\n", "n", "input", "kind", "seq", "length", "offset");
+    long long offset = sizeof(cmt_outlog_header_t);
+    for (unsigned long long n = 0; (end < 0 || offset < end) && read_record(file, offset, &record) == 0; ++n) {
+        char input[24] = "-";
+        if (record.input != UINT64_MAX) {
+            // NOLINTNEXTLINE(cert-err33-c)
+            snprintf(input, sizeof input, "%llu", (unsigned long long) record.input);
+        }
+        printf("%8llu %8s %-18s %6u %10u %12lld\n", n, input, kind_name(record.kind), record.seq, record.length,
+            offset);
+        offset = next_offset(offset, &record);
+    }
+    return 0;
+}
+
+static int extract(FILE *file, const char *arg) {
+    char *end = NULL;
+    unsigned long long n = strtoull(arg, &end, 10);
+    if (!*arg || *end) {
+        (void) fprintf(stderr, "invalid output number \"%s\"\n", arg);
+        return 1;
+    }
+
+    cmt_outlog_record_t record;
+    long long offset = find(file, n);
+    if (offset < 0 || read_record(file, offset, &record) != 0) {
+        (void) fprintf(stderr, "no output %llu\n", n);
+        return 1;
+    }
+
+    char chunk[4096];
+    for (size_t left = record.length; left;) {
+        size_t k = left < sizeof chunk ? left : sizeof chunk;
+        if (fread(chunk, 1, k, file) != k || fwrite(chunk, 1, k, stdout) != k) {
+            (void) fprintf(stderr, "failed to copy output %llu\n", n);
+            return 1;
+        }
+        left -= k;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3 || (strcmp(argv[1], "list") == 0 && argc != 3) ||
+        (strcmp(argv[1], "extract") == 0 && argc != 4)) {
+        usage(argv[0]);
+    }
+    if (strcmp(argv[1], "list") != 0 && strcmp(argv[1], "extract") != 0) {
+        usage(argv[0]);
+    }
+
+    FILE *file = fopen(argv[2], "rb");
+    if (!file) {
+        (void) fprintf(stderr, "failed to open \"%s\". %s\n", argv[2], strerror(errno));
+        return 1;
+    }
+
+    cmt_outlog_header_t header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, "CMTOLOG1", sizeof(header.magic)) != 0) {
+        (void) fprintf(stderr, "\"%s\" is not an output log\n", argv[2]);
+        (void) fclose(file);
+        return 1;
+    }
+    if (header.version != CMT_OUTLOG_VERSION) {
+        (void) fprintf(stderr, "unsupported output log version %u\n", header.version);
+        (void) fclose(file);
+        return 1;
+    }
+
+    int rc = strcmp(argv[1], "list") == 0 ? list(file) : extract(file, argv[3]);
+    (void) fclose(file);
+    return rc;
+}
@@ -1,6 +1,7 @@
 #!/bin/sh
 
 sed \
+	-e 's|/\*.*\*/||' \
 	-e '/\/\*/,/\*\//d' \
 	-e '/#if\s/,/#endif/d' \
 	-e '/#define/d' \
@@ -0,0 +1,700 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* Replay independent input streams on parallel copies of an application, each one under the socket mock (see
+ * CMT_MOCK_SOCKET), and merge their outputs in manifest order */
+#include "libcmt/io.h"
+#include "libcmt/keccak.h"
+#include "libcmt/outlog.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+enum {
+    KINDS = CMT_OUTLOG_OUTPUTS_ROOT_HASH + 1,
+};
+
+typedef struct {
+    char *inputs;                    /**< the inputs file, `<reason>:<filepath>` lines as CMT_INPUTS_FILE */
+    char **env;                      /**< environment of the application, with the shard's own variables */
+    char *vars;                      /**< storage of the shard's own variables */
+    char log_path[4096];             /**< outputs of the shard alone, merged at the end */
+    uint64_t input;                  /**< index of the input being processed, UINT64_MAX before the first */
+    uint32_t seq[KINDS];             /**< per kind of output of the current input */
+    uint64_t count[KINDS];           /**< per kind of output */
+    uint8_t root[CMT_KECCAK_LENGTH]; /**< last outputs root hash */
+    bool has_root;                   /**< @b root is set */
+    uint64_t *latency;               /**< per finished input, in ns */
+    size_t latency_count;            /**< entries used in @b latency */
+    size_t latency_capacity;         /**< entries allocated in @b latency */
+    int status;                      /**< exit status of the application, -1 if it was killed or never ran */
+    int rc;                          /**< 0 or why serving it failed */
+} shard_t;
+
+typedef struct {
+    shard_t *shards;
+    size_t count;
+    size_t next;          /**< first shard no worker took yet */
+    pthread_mutex_t lock; /**< of @b next */
+    pthread_mutex_t fork; /**< keeps new connections out of the applications being started */
+    char **argv;          /**< application command line */
+    char dir[64];         /**< temporary directory of the sockets */
+    const char *output;   /**< -o, NULL to only count the outputs */
+    uint32_t tx_length;   /**< largest frame payload */
+    uint32_t rx_length;   /**< largest input */
+} replay_t;
+
+typedef struct {
+    replay_t *r;
+    shard_t *s;
+    int fd;           /**< connection to the application */
+    FILE *inputs;     /**< @b s inputs file */
+    cmt_outlog_t log; /**< @b s log_path */
+    bool logging;     /**< @b log is open */
+    uint8_t *tx;      /**< payload of the last frame */
+    uint8_t *rx;      /**< input to send */
+} session_t;
+
+static void usage(const char *progname) {
+    (void) fprintf(stderr,
+        "usage: %s [-j jobs] [-o outputs.log] [-t tx-length] [-r rx-length] <manifest> <application> [args...]\n"
+        "\n"
+        "Replay every shard of the manifest on its own copy of the application, up to -j at once (the\n"
+        "number of cores by default), with CMT_MOCK_SOCKET. Each manifest line is an inputs file, in the\n"
+        "CMT_INPUTS_FILE format, optionally followed by KEY=VALUE variables for that copy, to start it from\n"
+        "a checkpoint for instance. Shards must not depend on each other. The outputs go to -o as a single\n"
+        "log, shard after shard in manifest order, with the input indices counted across shards, so the\n"
+        "log does not depend on -j. A line per shard with its last outputs root hash goes to stdout.\n",
+        progname);
+    exit(1);
+}
+
+static double now(void) {
+    struct timespec ts;
+    (void) clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+static uint32_t parse_length(const char *arg) {
+    char *end = NULL;
+    unsigned long long n = strtoull(arg, &end, 0);
+    if (!*arg || *end || n == 0 || n > UINT32_MAX) {
+        (void) fprintf(stderr, "invalid length \"%s\"\n", arg);
+        exit(1);
+    }
+    return n;
+}
+
+/* the environment of the parent, then the variables of the manifest line in @p vars */
+static char **shard_env(char *vars) {
+    size_t n = 0;
+    while (environ[n]) {
+        n++;
+    }
+    size_t extra = (strlen(vars) / 2) + 1; // no more variables than that
+    char **env = calloc(n + extra + 3, sizeof(*env)); // then CMT_MOCK_SOCKET, CMT_REPLAY_SHARD and NULL
+    if (!env) {
+        return NULL;
+    }
+    memcpy(env, environ, n * sizeof(*env));
+    for (char *save = NULL, *var = strtok_r(vars, " \t", &save); var; var = strtok_r(NULL, " \t", &save)) {
+        env[n++] = var;
+    }
+    return env;
+}
+
+static int read_manifest(replay_t *r, const char *filepath) {
+    FILE *file = fopen(filepath, "r");
+    if (!file) {
+        int rc = -errno;
+        (void) fprintf(stderr, "failed to open \"%s\". %s\n", filepath, strerror(-rc));
+        return rc;
+    }
+    char line[4096];
+    size_t capacity = 0;
+    while (fgets(line, sizeof line, file)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char *inputs = line + strspn(line, " \t");
+        if (!*inputs || *inputs == '#') {
+            continue;
+        }
+        if (r->count == capacity) {
+            capacity = capacity ? 2 * capacity : 64;
+            shard_t *shards = realloc(r->shards, capacity * sizeof(*shards));
+            if (!shards) {
+                (void) fclose(file);
+                return -ENOMEM;
+            }
+            r->shards = shards;
+        }
+        char *rest = inputs + strcspn(inputs, " \t");
+        if (*rest) {
+            *rest++ = '\0';
+        }
+        shard_t *s = &r->shards[r->count++];
+        *s = (shard_t){.inputs = strdup(inputs), .vars = strdup(rest), .input = UINT64_MAX, .status = -1};
+        s->env = s->inputs && s->vars ? shard_env(s->vars) : NULL;
+        if (!s->env) {
+            (void) fclose(file);
+            return -ENOMEM;
+        }
+    }
+    (void) fclose(file);
+    return 0;
+}
+
+static int send_all(int fd, const void *data, size_t length) {
+    const uint8_t *p = data;
+    while (length) {
+        ssize_t n = send(fd, p, length, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        p += n;
+        length -= n;
+    }
+    return 0;
+}
+
+/* @return 0, -ENODATA if the application closed the connection or a negative errno */
+static int receive_all(int fd, void *data, size_t length) {
+    uint8_t *p = data;
+    while (length) {
+        ssize_t n = recv(fd, p, length, 0);
+        if (n == 0) {
+            return -ENODATA;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        p += n;
+        length -= n;
+    }
+    return 0;
+}
+
+static int store(session_t *ss, uint32_t kind, uint32_t length) {
+    shard_t *s = ss->s;
+    s->count[kind]++;
+    cmt_outlog_record_t record = {.input = s->input, .kind = kind, .seq = s->seq[kind]++, .length = length};
+    if (!ss->logging) {
+        return 0;
+    }
+    int rc = cmt_outlog_append(&ss->log, &record, ss->tx);
+    if (rc) {
+        (void) fprintf(stderr, "failed to log the output of \"%s\". %s\n", s->inputs, strerror(-rc));
+    }
+    return rc;
+}
+
+/* next input of the shard into rx, -ENODATA when there are none left */
+static int load_next_input(session_t *ss, cmt_io_socket_reply_t *reply) {
+    char entry[256];
+    char filepath[256];
+    int type = 0;
+    for (;;) {
+        if (!fgets(entry, sizeof entry, ss->inputs)) {
+            return -ENODATA;
+        }
+        entry[strcspn(entry, "\r\n")] = '\0';
+        if (entry[0] && entry[0] != '#') {
+            break;
+        }
+    }
+    // NOLINTNEXTLINE(cert-err34-c)
+    if (sscanf(entry, "%d:%255s", &type, filepath) != 2) {
+        (void) fprintf(stderr, "invalid input \"%s\"\n", entry);
+        return -EINVAL;
+    }
+    FILE *file = fopen(filepath, "rbe");
+    if (!file) {
+        int rc = -errno;
+        (void) fprintf(stderr, "failed to load \"%s\". %s\n", filepath, strerror(-rc));
+        return rc;
+    }
+    size_t n = fread(ss->rx, 1, ss->r->rx_length, file);
+    bool fits = n < ss->r->rx_length || fgetc(file) == EOF;
+    (void) fclose(file);
+    if (!fits) {
+        (void) fprintf(stderr, "\"%s\" does not fit in rx\n", filepath);
+        return -ENOBUFS;
+    }
+    reply->reason = type;
+    reply->data = n;
+    return 0;
+}
+
+static int next_input(session_t *ss, cmt_io_socket_reply_t *reply) {
+    int rc = load_next_input(ss, reply);
+    if (rc) {
+        return rc;
+    }
+    ss->s->input++;
+    memset(ss->s->seq, 0, sizeof(ss->s->seq));
+    return 0;
+}
+
+static int add_latency(shard_t *s, double seconds) {
+    if (s->latency_count == s->latency_capacity) {
+        size_t capacity = s->latency_capacity ? 2 * s->latency_capacity : 1024;
+        uint64_t *latency = realloc(s->latency, capacity * sizeof(*latency));
+        if (!latency) {
+            return -ENOMEM;
+        }
+        s->latency = latency;
+        s->latency_capacity = capacity;
+    }
+    s->latency[s->latency_count++] = (uint64_t) (seconds * 1e9);
+    return 0;
+}
+
+/* the same semantics as the mock driver, @p reply is only sent for manual yields */
+static int handle(session_t *ss, const cmt_io_socket_request_t *request, cmt_io_socket_reply_t *reply,
+    double started) {
+    shard_t *s = ss->s;
+    if (request->cmd == HTIF_YIELD_CMD_AUTOMATIC) {
+        switch (request->reason) {
+            case HTIF_YIELD_AUTOMATIC_REASON_PROGRESS:
+                return 0;
+            case HTIF_YIELD_AUTOMATIC_REASON_TX_OUTPUT:
+                return store(ss, CMT_OUTLOG_OUTPUT, request->length);
+            default:
+                return store(ss, CMT_OUTLOG_REPORT, request->length);
+        }
+    }
+    bool finish = request->reason == HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED ||
+        request->reason == HTIF_YIELD_MANUAL_REASON_RX_REJECTED;
+    if (finish && s->input != UINT64_MAX) {
+        int rc = add_latency(s, now() - started);
+        if (rc) {
+            return rc;
+        }
+    }
+    switch (request->reason) {
+        case HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED:
+            if (s->input != UINT64_MAX) {
+                int rc = store(ss, CMT_OUTLOG_OUTPUTS_ROOT_HASH, request->length);
+                if (rc) {
+                    return rc;
+                }
+                s->has_root = request->length == CMT_KECCAK_LENGTH;
+                memcpy(s->root, ss->tx, s->has_root ? CMT_KECCAK_LENGTH : 0);
+            }
+            return next_input(ss, reply);
+        case HTIF_YIELD_MANUAL_REASON_RX_REJECTED:
+            return next_input(ss, reply);
+        case HTIF_YIELD_MANUAL_REASON_TX_EXCEPTION:
+            return store(ss, CMT_OUTLOG_EXCEPTION, request->length);
+        default: {
+            int rc = store(ss, CMT_OUTLOG_GIO, request->length);
+            return rc ? rc : load_next_input(ss, reply);
+        }
+    }
+}
+
+static int serve(session_t *ss) {
+    double started = 0;
+    cmt_io_socket_request_t request;
+    int rc = 0;
+    while ((rc = receive_all(ss->fd, &request, sizeof(request))) == 0) {
+        if (request.length > ss->r->tx_length) {
+            return -EPROTO;
+        }
+        rc = receive_all(ss->fd, ss->tx, request.length);
+        if (rc) {
+            return rc == -ENODATA ? -EPROTO : rc;
+        }
+        cmt_io_socket_reply_t reply = {0};
+        rc = handle(ss, &request, &reply, started);
+        if (rc == -ENODATA) {
+            return 0; // no inputs left, closing the connection ends the application
+        }
+        if (rc) {
+            return rc;
+        }
+        if (request.cmd == HTIF_YIELD_CMD_AUTOMATIC) {
+            continue;
+        }
+        rc = send_all(ss->fd, &reply, sizeof(reply));
+        if (rc == 0) {
+            rc = send_all(ss->fd, ss->rx, reply.data);
+        }
+        if (rc) {
+            return rc;
+        }
+        started = now();
+    }
+    if (rc == -ENODATA) {
+        (void) fprintf(stderr, "the application of \"%s\" quit before its inputs ran out\n", ss->s->inputs);
+        return -EPIPE;
+    }
+    return rc;
+}
+
+/* listen on the socket of shard @p k before the application is started, so it can connect right away */
+static int listen_shard(replay_t *r, size_t k, struct sockaddr_un *addr) {
+    *addr = (struct sockaddr_un){.sun_family = AF_UNIX};
+    (void) snprintf(addr->sun_path, sizeof(addr->sun_path), "%s/%zu.sock", r->dir, k);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -errno;
+    }
+    if (bind(fd, (struct sockaddr *) addr, sizeof(*addr)) || listen(fd, 1)) {
+        int rc = -errno;
+        (void) close(fd);
+        return rc;
+    }
+    return fd;
+}
+
+static pid_t spawn(replay_t *r, shard_t *s, size_t k, const char *socket_path) {
+    char socket_var[160];
+    char shard_var[48];
+    (void) snprintf(socket_var, sizeof socket_var, "CMT_MOCK_SOCKET=%s", socket_path);
+    (void) snprintf(shard_var, sizeof shard_var, "CMT_REPLAY_SHARD=%zu", k);
+    size_t n = 0;
+    while (s->env[n]) {
+        n++;
+    }
+    s->env[n] = socket_var;
+    s->env[n + 1] = shard_var;
+
+    (void) pthread_mutex_lock(&r->fork);
+    pid_t pid = fork();
+    if (pid == 0) {
+        environ = s->env;
+        execvp(r->argv[0], r->argv);
+        _exit(127);
+    }
+    (void) pthread_mutex_unlock(&r->fork);
+    s->env[n] = NULL;
+    return pid;
+}
+
+/* wait for the application to connect, or to exit without doing so */
+static int accept_application(replay_t *r, int listen_fd, pid_t pid, int *status) {
+    struct pollfd pfd = {.fd = listen_fd, .events = POLLIN};
+    for (;;) {
+        int n = poll(&pfd, 1, 100);
+        if (n > 0) { // a copy in another application would keep it open after we close it
+            (void) pthread_mutex_lock(&r->fork);
+            int fd = accept(listen_fd, NULL, NULL);
+            int rc = fd < 0 || fcntl(fd, F_SETFD, FD_CLOEXEC) ? -errno : fd;
+            (void) pthread_mutex_unlock(&r->fork);
+            if (rc < 0 && fd >= 0) {
+                (void) close(fd);
+            }
+            return rc;
+        }
+        if (n < 0 && errno != EINTR) {
+            return -errno;
+        }
+        if (waitpid(pid, status, WNOHANG) == pid) {
+            return -ECHILD;
+        }
+    }
+}
+
+static void run_shard(replay_t *r, size_t k, uint8_t *tx, uint8_t *rx) {
+    shard_t *s = &r->shards[k];
+    session_t ss = {.r = r, .s = s, .fd = -1, .tx = tx, .rx = rx};
+    ss.inputs = fopen(s->inputs, "re"); // not for the application
+    if (!ss.inputs) {
+        s->rc = -errno;
+        (void) fprintf(stderr, "failed to open \"%s\". %s\n", s->inputs, strerror(-s->rc));
+        return;
+    }
+    if (r->output) {
+        (void) snprintf(s->log_path, sizeof(s->log_path), "%s.%zu", r->output, k);
+        s->rc = cmt_outlog_open(&ss.log, s->log_path);
+        if (s->rc) {
+            (void) fprintf(stderr, "failed to open \"%s\". %s\n", s->log_path, strerror(-s->rc));
+            (void) fclose(ss.inputs);
+            return;
+        }
+        ss.logging = true;
+    }
+
+    struct sockaddr_un addr;
+    int listen_fd = listen_shard(r, k, &addr);
+    pid_t pid = -1;
+    int status = 0;
+    s->rc = listen_fd < 0 ? listen_fd : 0;
+    if (s->rc == 0) {
+        pid = spawn(r, s, k, addr.sun_path);
+        s->rc = pid < 0 ? -errno : 0;
+    }
+    if (s->rc == 0) {
+        ss.fd = accept_application(r, listen_fd, pid, &status);
+        s->rc = ss.fd < 0 ? ss.fd : 0;
+        if (s->rc == -ECHILD) {
+            (void) fprintf(stderr, "the application of \"%s\" quit without connecting\n", s->inputs);
+            pid = -1;
+        }
+    }
+    if (s->rc == 0) {
+        s->rc = serve(&ss);
+        (void) close(ss.fd);
+    }
+    if (pid > 0) {
+        if (s->rc) { // it may be blocked on a reply that is never coming
+            (void) kill(pid, SIGTERM);
+        }
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+            ;
+        }
+    }
+    s->status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    if (listen_fd >= 0) {
+        (void) close(listen_fd);
+        (void) unlink(addr.sun_path);
+    }
+    if (ss.logging && cmt_outlog_close(&ss.log)) {
+        s->rc = s->rc ? s->rc : -EIO;
+    }
+    (void) fclose(ss.inputs);
+}
+
+static void *worker(void *arg) {
+    replay_t *r = arg;
+    uint8_t *tx = malloc(r->tx_length);
+    uint8_t *rx = malloc(r->rx_length);
+    for (;;) {
+        (void) pthread_mutex_lock(&r->lock);
+        size_t k = r->next++;
+        (void) pthread_mutex_unlock(&r->lock);
+        if (k >= r->count) {
+            break;
+        }
+        if (!tx || !rx) {
+            r->shards[k].rc = -ENOMEM;
+            continue;
+        }
+        run_shard(r, k, tx, rx);
+    }
+    free(tx);
+    free(rx);
+    return NULL;
+}
+
+/* append the log of @p s to @p log, with its input indices moved past the @p base inputs of the previous shards */
+static int merge_shard(cmt_outlog_t *log, const shard_t *s, uint64_t base, uint8_t *payload, uint32_t capacity) {
+    FILE *file = fopen(s->log_path, "rb");
+    if (!file) {
+        return -errno;
+    }
+    cmt_outlog_footer_t footer;
+    if (fseek(file, -(long) sizeof(footer), SEEK_END) != 0 || fread(&footer, sizeof(footer), 1, file) != 1 ||
+        fseek(file, sizeof(cmt_outlog_header_t), SEEK_SET) != 0) {
+        (void) fclose(file);
+        return -EIO;
+    }
+    int rc = 0;
+    for (uint64_t i = 0; rc == 0 && i < footer.count; ++i) {
+        cmt_outlog_record_t record;
+        size_t padded = 0;
+        if (fread(&record, sizeof(record), 1, file) != 1 || record.length > capacity) {
+            rc = -EIO;
+            break;
+        }
+        padded = (record.length + CMT_OUTLOG_ALIGN - 1) & ~(size_t) (CMT_OUTLOG_ALIGN - 1);
+        if (fread(payload, 1, padded, file) != padded) {
+            rc = -EIO;
+            break;
+        }
+        if (record.input != UINT64_MAX) {
+            record.input += base;
+        }
+        rc = cmt_outlog_append(log, &record, payload);
+    }
+    (void) fclose(file);
+    return rc;
+}
+
+static int merge(replay_t *r) {
+    cmt_outlog_t log;
+    int rc = cmt_outlog_open(&log, r->output);
+    if (rc) {
+        (void) fprintf(stderr, "failed to open \"%s\". %s\n", r->output, strerror(-rc));
+        return rc;
+    }
+    uint32_t capacity = r->tx_length + CMT_OUTLOG_ALIGN;
+    uint8_t *payload = malloc(capacity);
+    uint64_t base = 0;
+    for (size_t k = 0; payload && rc == 0 && k < r->count; ++k) {
+        shard_t *s = &r->shards[k];
+        if (s->log_path[0]) { // or it failed before anything was logged
+            rc = merge_shard(&log, s, base, payload, r->tx_length);
+            if (rc) {
+                (void) fprintf(stderr, "failed to merge \"%s\". %s\n", s->log_path, strerror(-rc));
+            }
+            (void) remove(s->log_path);
+        }
+        base += s->input + 1; // wraps to 0 when it had no inputs
+    }
+    free(payload);
+    int err = cmt_outlog_close(&log);
+    rc = rc ? rc : err;
+    return payload ? rc : -ENOMEM;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+/* per shard on stdout, in manifest order so two runs can be diffed, and the throughput on stderr */
+static void summary(const replay_t *r, double elapsed) {
+    uint64_t inputs = 0;
+    uint64_t outputs = 0;
+    size_t count = 0;
+    for (size_t k = 0; k < r->count; ++k) {
+        count += r->shards[k].latency_count;
+    }
+    uint64_t *latency = malloc((count ? count : 1) * sizeof(*latency));
+    count = 0;
+    for (size_t k = 0; k < r->count; ++k) {
+        const shard_t *s = &r->shards[k];
+        uint64_t records = 0;
+        for (int kind = 0; kind < CMT_OUTLOG_OUTPUTS_ROOT_HASH; ++kind) {
+            records += s->count[kind];
+        }
+        char root[2 * CMT_KECCAK_LENGTH + 1] = "-";
+        for (int i = 0; s->has_root && i < CMT_KECCAK_LENGTH; ++i) {
+            (void) snprintf(root + (2 * i), 3, "%02x", s->root[i]);
+        }
+        printf("%zu %s %" PRIu64 " inputs %" PRIu64 " outputs %s\n", k, s->inputs, s->input + 1, records, root);
+        inputs += s->input + 1;
+        outputs += records;
+        if (latency) {
+            memcpy(latency + count, s->latency, s->latency_count * sizeof(*latency));
+            count += s->latency_count;
+        }
+    }
+    (void) fprintf(stderr,
+        "%zu shards, %" PRIu64 " inputs, %" PRIu64 " outputs in %.3fs, %.0f inputs/s, %.0f outputs/s\n", r->count,
+        inputs, outputs, elapsed, elapsed > 0 ? (double) inputs / elapsed : 0.0, elapsed > 0 ? (double) outputs / elapsed : 0.0);
+    if (latency && count) {
+        qsort(latency, count, sizeof(*latency), compare_u64);
+        (void) fprintf(stderr, "latency per input p50 %.1fus, p90 %.1fus, p99 %.1fus, max %.1fus\n",
+            (double) latency[count / 2] * 1e-3, (double) latency[count * 9 / 10] * 1e-3,
+            (double) latency[count * 99 / 100] * 1e-3, (double) latency[count - 1] * 1e-3);
+    }
+    free(latency);
+}
+
+int main(int argc, char *argv[]) {
+    replay_t r = {
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+        .fork = PTHREAD_MUTEX_INITIALIZER,
+        .tx_length = 2U << 20, // 2MB, as the mock
+        .rx_length = 2U << 20,
+    };
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+
+    int opt = 0;
+    while ((opt = getopt(argc, argv, "+j:o:t:r:")) != -1) {
+        switch (opt) {
+            case 'j':
+                jobs = (long) parse_length(optarg);
+                break;
+            case 'o':
+                r.output = optarg;
+                break;
+            case 't':
+                r.tx_length = parse_length(optarg);
+                break;
+            case 'r':
+                r.rx_length = parse_length(optarg);
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (argc - optind < 2) {
+        usage(argv[0]);
+    }
+    r.argv = argv + optind + 1;
+    if (read_manifest(&r, argv[optind])) {
+        return 1;
+    }
+    (void) snprintf(r.dir, sizeof(r.dir), "/tmp/cmt-replay-XXXXXX");
+    if (!mkdtemp(r.dir)) {
+        (void) fprintf(stderr, "failed to create the socket directory. %s\n", strerror(errno));
+        return 1;
+    }
+
+    size_t n = jobs < 1 ? 1 : (size_t) jobs;
+    n = n < r.count ? n : r.count;
+    pthread_t *threads = calloc(n ? n : 1, sizeof(*threads));
+    double start = now();
+    size_t started = 0;
+    while (threads && started < n && pthread_create(&threads[started], NULL, worker, &r) == 0) {
+        started++;
+    }
+    if (started == 0 && r.count) {
+        worker(&r); // no threads, one shard after the other
+    }
+    for (size_t i = 0; i < started; ++i) {
+        (void) pthread_join(threads[i], NULL);
+    }
+    double elapsed = now() - start;
+    free(threads);
+    (void) rmdir(r.dir);
+
+    int failed = 0;
+    for (size_t k = 0; k < r.count; ++k) {
+        const shard_t *s = &r.shards[k];
+        if (s->rc || s->status) {
+            (void) fprintf(stderr, "shard %zu \"%s\" failed, %s, exit status %d\n", k, s->inputs,
+                s->rc ? strerror(-s->rc) : "served", s->status);
+            failed = 1;
+        }
+    }
+    if (r.output && merge(&r)) {
+        failed = 1;
+    }
+    summary(&r, elapsed);
+    for (size_t k = 0; k < r.count; ++k) {
+        free(r.shards[k].latency);
+        free(r.shards[k].inputs);
+        free(r.shards[k].env);
+        free(r.shards[k].vars);
+    }
+    free(r.shards);
+    return failed;
+}
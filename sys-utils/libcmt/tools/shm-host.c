@@ -0,0 +1,303 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* Reference host process for the shm driver, a stand in for the emulator and the node, see @ref libcmt_shm */
+#include "libcmt/giostore.h"
+#include "libcmt/outlog.h"
+#include "libcmt/shm.h"
+#include "libcmt/util.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <unistd.h>
+
+typedef struct {
+    cmt_shm_host_t *host;
+    cmt_outlog_t *log;     /**< -o, NULL to discard the outputs */
+    cmt_giostore_t *store; /**< -g, NULL to answer gio requests from the inputs */
+    char **inputs;         /**< `<reason>:<filepath>` arguments */
+    int inputs_left;       /**< entries left in @b inputs */
+    FILE *inputs_file;     /**< -f, read after @b inputs */
+    uint64_t input;        /**< index of the input being processed, UINT64_MAX before the first */
+    uint32_t seq[5];       /**< per kind of output of the current input */
+    uint64_t count[5];     /**< per kind of output */
+    uint64_t accepted;     /**< inputs accepted */
+    uint64_t rejected;     /**< inputs rejected */
+    uint64_t yields;       /**< yields answered */
+} session_t;
+
+static void usage(const char *progname) {
+    (void) fprintf(stderr,
+        "usage: %s [-e] [-t tx-length] [-r rx-length] [-f inputs.txt] [-g gio-store] [-o outputs.log] <socket>\n"
+        "       [<reason>:<filepath>...]\n"
+        "\n"
+        "Serve the inputs, then the lines of -f, to an application started with CMT_MOCK_SHM=<socket>.\n"
+        "Gio requests are answered from -g, or else with the next input. Outputs, reports, exceptions,\n"
+        "gio requests and outputs root hashes go to -o, see the outlog tool. -e sleeps on eventfds instead\n"
+        "of the futex.\n",
+        progname);
+    exit(1);
+}
+
+static bool next_entry(session_t *s, char *entry, size_t size) {
+    if (s->inputs_left) {
+        (void) snprintf(entry, size, "%s", *s->inputs++);
+        s->inputs_left--;
+        return true;
+    }
+    while (s->inputs_file && fgets(entry, (int) size, s->inputs_file)) {
+        entry[strcspn(entry, "\r\n")] = '\0';
+        if (entry[0] && entry[0] != '#') {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* next input into rx, -ENODATA when there are none left */
+static int load_next_input(session_t *s, uint16_t *reason, uint32_t *length) {
+    char entry[256];
+    char filepath[256];
+    int type = 0;
+    if (!next_entry(s, entry, sizeof entry)) {
+        return -ENODATA;
+    }
+    // NOLINTNEXTLINE(cert-err34-c)
+    if (sscanf(entry, "%d:%255s", &type, filepath) != 2) {
+        (void) fprintf(stderr, "invalid input \"%s\"\n", entry);
+        return -EINVAL;
+    }
+    cmt_buf_t rx = cmt_shm_host_get_rx(s->host);
+    size_t n = 0;
+    int rc = cmt_util_read_whole_file(filepath, cmt_buf_length(&rx), rx.begin, &n);
+    if (rc) {
+        (void) fprintf(stderr, "failed to load \"%s\". %s\n", filepath, strerror(-rc));
+        return rc;
+    }
+    *reason = type;
+    *length = n;
+    return 0;
+}
+
+static int store(session_t *s, uint32_t kind, uint32_t length) {
+    s->count[kind]++;
+    if (!s->log) {
+        s->seq[kind]++;
+        return 0;
+    }
+    cmt_outlog_record_t record = {.input = s->input, .kind = kind, .seq = s->seq[kind]++, .length = length};
+    int rc = cmt_outlog_append(s->log, &record, cmt_shm_host_get_tx(s->host).begin);
+    if (rc) {
+        (void) fprintf(stderr, "failed to log the output. %s\n", strerror(-rc));
+    }
+    return rc;
+}
+
+static int next_input(session_t *s, uint16_t *reason, uint32_t *length) {
+    int rc = load_next_input(s, reason, length);
+    if (rc) {
+        return rc;
+    }
+    s->input++;
+    memset(s->seq, 0, sizeof(s->seq));
+    return 0;
+}
+
+/* answer a gio request from the store, or else with the next input */
+static int gio(session_t *s, const cmt_io_yield_t *request, uint16_t *reason, uint32_t *length) {
+    if (s->store) {
+        const void *data = NULL;
+        size_t n = 0;
+        cmt_buf_t rx = cmt_shm_host_get_rx(s->host);
+        int rc = cmt_giostore_find(s->store, request->reason, request->data, cmt_shm_host_get_tx(s->host).begin,
+            &data, &n);
+        if (rc == 0 && n <= cmt_buf_length(&rx)) {
+            memcpy(rx.begin, data, n);
+            *reason = 0;
+            *length = n;
+            return 0;
+        }
+    }
+    return load_next_input(s, reason, length);
+}
+
+/* the same semantics as the mock driver */
+static int handle(session_t *s, const cmt_io_yield_t *request, uint16_t *reason, uint32_t *length) {
+    *reason = 0;
+    *length = 0;
+    if (request->cmd == HTIF_YIELD_CMD_AUTOMATIC) {
+        switch (request->reason) {
+            case HTIF_YIELD_AUTOMATIC_REASON_PROGRESS:
+                (void) fprintf(stderr, "Progress: %6.2f\n", (double) request->data / 10);
+                return 0;
+            case HTIF_YIELD_AUTOMATIC_REASON_TX_OUTPUT:
+                return store(s, CMT_OUTLOG_OUTPUT, request->data);
+            default:
+                return store(s, CMT_OUTLOG_REPORT, request->data);
+        }
+    }
+    switch (request->reason) {
+        case HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED:
+            if (s->input != UINT64_MAX) {
+                s->accepted++;
+                int rc = store(s, CMT_OUTLOG_OUTPUTS_ROOT_HASH, request->data);
+                if (rc) {
+                    return rc;
+                }
+            }
+            return next_input(s, reason, length);
+        case HTIF_YIELD_MANUAL_REASON_RX_REJECTED:
+            s->rejected += s->input != UINT64_MAX;
+            return next_input(s, reason, length);
+        case HTIF_YIELD_MANUAL_REASON_TX_EXCEPTION:
+            return store(s, CMT_OUTLOG_EXCEPTION, request->data);
+        default: {
+            int rc = store(s, CMT_OUTLOG_GIO, request->data);
+            return rc ? rc : gio(s, request, reason, length);
+        }
+    }
+}
+
+static int serve(session_t *s) {
+    cmt_io_yield_t request;
+    int rc = 0;
+    while ((rc = cmt_shm_host_wait(s->host, &request)) == 0) {
+        uint16_t reason = 0;
+        uint32_t length = 0;
+        rc = handle(s, &request, &reason, &length);
+        if (rc) {
+            break;
+        }
+        rc = cmt_shm_host_reply(s->host, reason, length);
+        if (rc) {
+            break;
+        }
+        s->yields++;
+    }
+    if (rc == -ENODATA) {
+        return 0; // no inputs left, closing the session ends it
+    }
+    if (rc == -EPIPE) {
+        (void) fprintf(stderr, "the application went away\n");
+    }
+    return rc;
+}
+
+static uint32_t parse_length(const char *arg) {
+    char *end = NULL;
+    unsigned long long n = strtoull(arg, &end, 0);
+    if (!*arg || *end || n == 0 || n > UINT32_MAX) {
+        (void) fprintf(stderr, "invalid length \"%s\"\n", arg);
+        exit(1);
+    }
+    return n;
+}
+
+int main(int argc, char *argv[]) {
+    session_t s = {.input = UINT64_MAX};
+    uint32_t tx_length = 0;
+    uint32_t rx_length = 0;
+    int flags = 0;
+    const char *log_path = NULL;
+    const char *store_path = NULL;
+    cmt_outlog_t log;
+
+    int opt = 0;
+    while ((opt = getopt(argc, argv, "et:r:f:g:o:")) != -1) {
+        switch (opt) {
+            case 'e':
+                flags |= CMT_SHM_EVENTFD;
+                break;
+            case 't':
+                tx_length = parse_length(optarg);
+                break;
+            case 'r':
+                rx_length = parse_length(optarg);
+                break;
+            case 'f':
+                s.inputs_file = fopen(optarg, "r");
+                if (!s.inputs_file) {
+                    (void) fprintf(stderr, "failed to open \"%s\". %s\n", optarg, strerror(errno));
+                    return 1;
+                }
+                break;
+            case 'g':
+                store_path = optarg;
+                break;
+            case 'o':
+                log_path = optarg;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (optind >= argc) {
+        usage(argv[0]);
+    }
+    s.inputs = argv + optind + 1;
+    s.inputs_left = argc - optind - 1;
+
+    int rc = store_path ? cmt_giostore_open(&s.store, store_path, 16U << 20) : 0;
+    if (rc) {
+        (void) fprintf(stderr, "failed to open \"%s\". %s\n", store_path, strerror(-rc));
+        return 1;
+    }
+    rc = log_path ? cmt_outlog_open(&log, log_path) : 0;
+    if (rc) {
+        (void) fprintf(stderr, "failed to open \"%s\". %s\n", log_path, strerror(-rc));
+        return 1;
+    }
+    s.log = log_path ? &log : NULL;
+    rc = cmt_shm_host_open(&s.host, argv[optind], tx_length, rx_length, flags);
+    if (rc) {
+        (void) fprintf(stderr, "failed to listen on \"%s\". %s\n", argv[optind], strerror(-rc));
+        return 1;
+    }
+    rc = cmt_shm_host_accept(s.host);
+    if (rc) {
+        (void) fprintf(stderr, "failed to accept the application. %s\n", strerror(-rc));
+        cmt_shm_host_close(s.host);
+        return 1;
+    }
+
+    struct timespec t0;
+    struct timespec t1;
+    (void) clock_gettime(CLOCK_MONOTONIC, &t0);
+    rc = serve(&s);
+    (void) clock_gettime(CLOCK_MONOTONIC, &t1);
+    cmt_shm_host_close(s.host);
+    if (s.log && cmt_outlog_close(s.log)) {
+        rc = rc ? rc : -EIO;
+    }
+    cmt_giostore_close(s.store);
+    if (s.inputs_file) {
+        (void) fclose(s.inputs_file);
+    }
+
+    double elapsed = (double) (t1.tv_sec - t0.tv_sec) + (double) (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+    (void) fprintf(stderr,
+        "%" PRIu64 " accepted, %" PRIu64 " rejected, %" PRIu64 " outputs, %" PRIu64 " reports, %" PRIu64
+        " exceptions, %" PRIu64 " gio requests\n"
+        "%" PRIu64 " yields in %.3fs, %.0f yields/s\n",
+        s.accepted, s.rejected, s.count[CMT_OUTLOG_OUTPUT], s.count[CMT_OUTLOG_REPORT],
+        s.count[CMT_OUTLOG_EXCEPTION], s.count[CMT_OUTLOG_GIO], s.yields, elapsed,
+        elapsed > 0 ? (double) s.yields / elapsed : 0.0);
+    return rc ? 1 : 0;
+}
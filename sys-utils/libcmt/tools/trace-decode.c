@@ -0,0 +1,151 @@
+/* Copyright Cartesi and individual authors (see AUTHORS)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* Pretty print a binary trace written by libcmt, see @ref libcmt_trace */
+#include "libcmt/io.h"
+#include "libcmt/trace.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(const char *progname) {
+    (void) fprintf(stderr,
+        "usage: %s <file.trace>\n"
+        "\n"
+        "  print the events of a CMT_TRACE file, oldest first\n",
+        progname);
+    exit(1);
+}
+
+static const char *yield_name(uint8_t cmd, uint16_t reason) {
+    if (cmd == HTIF_YIELD_CMD_AUTOMATIC) {
+        switch (reason) {
+            case HTIF_YIELD_AUTOMATIC_REASON_PROGRESS:
+                return "progress";
+            case HTIF_YIELD_AUTOMATIC_REASON_TX_OUTPUT:
+                return "tx-output";
+            case HTIF_YIELD_AUTOMATIC_REASON_TX_REPORT:
+                return "tx-report";
+            default:
+                return "automatic-?";
+        }
+    }
+    if (cmd == HTIF_YIELD_CMD_MANUAL) {
+        switch (reason) {
+            case HTIF_YIELD_MANUAL_REASON_RX_ACCEPTED:
+                return "rx-accepted";
+            case HTIF_YIELD_MANUAL_REASON_RX_REJECTED:
+                return "rx-rejected";
+            case HTIF_YIELD_MANUAL_REASON_TX_EXCEPTION:
+                return "tx-exception";
+            default:
+                return "gio";
+        }
+    }
+    return "?";
+}
+
+static const char *emit_name(uint8_t kind) {
+    switch (kind) {
+        case CMT_TRACE_EMIT_VOUCHER:
+            return "voucher";
+        case CMT_TRACE_EMIT_DELEGATE_CALL_VOUCHER:
+            return "delegate-call-voucher";
+        case CMT_TRACE_EMIT_NOTICE:
+            return "notice";
+        case CMT_TRACE_EMIT_REPORT:
+            return "report";
+        case CMT_TRACE_EMIT_EXCEPTION:
+            return "exception";
+        case CMT_TRACE_EMIT_GIO:
+            return "gio";
+        default:
+            return "?";
+    }
+}
+
+static void print_event(const cmt_trace_event_t *e, uint64_t t0, const char *unit) {
+    printf("%12llu %s  ", (unsigned long long) (e->time - t0), unit);
+    switch (e->type) {
+        case CMT_TRACE_YIELD_TOHOST:
+            printf("tohost   %-12s cmd=%u reason=%u data=%u\n", yield_name(e->cmd, e->reason), e->cmd, e->reason,
+                e->data);
+            break;
+        case CMT_TRACE_YIELD_FROMHOST:
+            printf("fromhost %-12s cmd=%u reason=%u data=%u", yield_name(e->cmd, e->reason), e->cmd, e->reason,
+                e->data);
+            break;
+        case CMT_TRACE_EMIT:
+            printf("emit     %-12s size=%u", emit_name(e->cmd), e->data);
+            break;
+        case CMT_TRACE_FINISH:
+            printf("finish   %-12s length=%u", e->reason == HTIF_YIELD_REASON_INSPECT ? "inspect" : "advance", e->data);
+            break;
+        case CMT_TRACE_ERROR:
+            printf("error    line=%u", e->data);
+            break;
+        default:
+            printf("unknown  type=%u cmd=%u reason=%u data=%u", e->type, e->cmd, e->reason, e->data);
+            break;
+    }
+    if (e->type != CMT_TRACE_YIELD_TOHOST) {
+        if (e->rc) {
+            printf(" rc=%d (%s)\n", e->rc, strerror(-e->rc));
+        } else {
+            printf("\n");
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        usage(argv[0]);
+    }
+
+    FILE *file = fopen(argv[1], "rb");
+    if (!file) {
+        (void) fprintf(stderr, "failed to open \"%s\". %s\n", argv[1], strerror(errno));
+        return 1;
+    }
+
+    cmt_trace_header_t header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, "CMTTRACE", sizeof(header.magic)) != 0) {
+        (void) fprintf(stderr, "\"%s\" is not a trace file\n", argv[1]);
+        (void) fclose(file);
+        return 1;
+    }
+    if (header.version != CMT_TRACE_VERSION) {
+        (void) fprintf(stderr, "unsupported trace version %u\n", header.version);
+        (void) fclose(file);
+        return 1;
+    }
+
+    const char *unit = header.clock == CMT_TRACE_CLOCK_RDTIME ? "ticks" : "ns";
+    printf("# %llu events recorded, %llu kept\n", (unsigned long long) header.total,
+        (unsigned long long) header.count);
+
+    cmt_trace_event_t e;
+    uint64_t t0 = 0;
+    for (uint64_t i = 0; i < header.count && fread(&e, sizeof(e), 1, file) == 1; ++i) {
+        if (i == 0) {
+            t0 = e.time;
+        }
+        print_event(&e, t0, unit);
+    }
+    (void) fclose(file);
+    return 0;
+}